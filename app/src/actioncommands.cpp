@@ -36,6 +36,7 @@ GNU General Public License for more details.
 #include "colormanager.h"
 #include "selectionmanager.h"
 #include "util.h"
+#include "profiler.h"
 #include "app_util.h"
 
 #include "layercamera.h"
@@ -233,8 +234,6 @@ Status ActionCommands::importSound(FileType type)
     {
         mEditor->removeKey();
         emit mEditor->layers()->currentLayerChanged(mEditor->layers()->currentLayerIndex()); // trigger timeline repaint.
-    } else {
-        showSoundClipWarningIfNeeded();
     }
 
     return st;
@@ -280,14 +279,6 @@ Status ActionCommands::exportMovie(bool isGif)
 {
     FileType fileType = (isGif) ? FileType::GIF : FileType::MOVIE;
 
-    int clipCount = mEditor->sound()->soundClipCount();
-    if (fileType == FileType::MOVIE && clipCount >= MovieExporter::MAX_SOUND_FRAMES)
-    {
-        ErrorDialog errorDialog(tr("Something went wrong"), tr("You currently have a total of %1 sound clips. Due to current limitations, you will be unable to export any animation exceeding %2 sound clips. We recommend splitting up larger projects into multiple smaller project to stay within this limit.").arg(clipCount).arg(MovieExporter::MAX_SOUND_FRAMES), QString(), mParent);
-        errorDialog.exec();
-        return Status::FAIL;
-    }
-
     ExportMovieDialog* dialog = new ExportMovieDialog(mParent, ImportExportDialog::Export, fileType);
     OnScopeExit(dialog->deleteLater());
 
@@ -829,7 +820,6 @@ void ActionCommands::duplicateKey()
     if (layer->type() == Layer::SOUND)
     {
         mEditor->sound()->processSound(dynamic_cast<SoundClip*>(dupKey));
-        showSoundClipWarningIfNeeded();
     }
 
     mEditor->layers()->notifyAnimationLengthChanged();
@@ -1038,6 +1028,41 @@ void ActionCommands::openTemporaryDirectory()
     }
 }
 
+void ActionCommands::showPerformanceOverlay(bool show)
+{
+    // Timings are only collected while the overlay is shown, start from a clean slate
+    if (show && !Profiler::isEnabled())
+    {
+        Profiler::clear();
+    }
+    Profiler::setEnabled(show);
+    mEditor->getScribbleArea()->setProfilerOverlayVisible(show);
+}
+
+void ActionCommands::exportPerformanceTrace()
+{
+    if (!Profiler::hasEvents())
+    {
+        QMessageBox::information(mParent, tr("Export Performance Trace"),
+                                 tr("Nothing has been recorded yet. Turn on Help > Show Performance Overlay, "
+                                    "reproduce the slow operation and export again."));
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(mParent,
+                                                    tr("Export Performance Trace"),
+                                                    QDir::homePath() + "/" + tr("pencil2d-trace.json"),
+                                                    tr("Chrome Trace (*.json)"));
+    if (filePath.isEmpty()) { return; }
+
+    Status st = Profiler::exportChromeTrace(filePath);
+    if (!st.ok())
+    {
+        ErrorDialog errorDialog(st.title(), st.description(), st.details().html(), mParent);
+        errorDialog.exec();
+    }
+}
+
 void ActionCommands::about()
 {
     AboutDialog* aboutBox = new AboutDialog(mParent);
@@ -1045,14 +1070,3 @@ void ActionCommands::about()
     aboutBox->init();
     aboutBox->exec();
 }
-
-void ActionCommands::showSoundClipWarningIfNeeded()
-{
-    int clipCount = mEditor->sound()->soundClipCount();
-    if (clipCount >= MovieExporter::MAX_SOUND_FRAMES && !mSuppressSoundWarning) {
-        QMessageBox::warning(mParent, tr("Warning"), tr("You currently have a total of %1 sound clips. Due to current limitations, you will be unable to export any animation exceeding %2 sound clips. We recommend splitting up larger projects into multiple smaller project to stay within this limit.").arg(clipCount).arg(MovieExporter::MAX_SOUND_FRAMES));
-        mSuppressSoundWarning = true;
-    } else {
-        mSuppressSoundWarning = false;
-    }
-}
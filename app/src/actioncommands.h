@@ -99,19 +99,17 @@ public:
     void reportbug();
     void checkForUpdates();
     void openTemporaryDirectory();
+    void showPerformanceOverlay(bool show);
+    void exportPerformanceTrace();
     void about();
 
 private:
-    void showSoundClipWarningIfNeeded();
-
     void exposeSelectedFrames(int offset);
 
     Status convertSoundToWav(const QString& filePath);
 
     Editor* mEditor = nullptr;
     QWidget* mParent = nullptr;
-
-    bool mSuppressSoundWarning = false;
 };
 
 #endif // COMMANDCENTER_H
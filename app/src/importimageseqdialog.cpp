@@ -26,6 +26,8 @@ GNU General Public License for more details.
 #include "predefinedsetmodel.h"
 #include "layermanager.h"
 #include "viewmanager.h"
+#include "layer.h"
+#include "imagebatchdecoder.h"
 
 #include <QProgressDialog>
 #include <QMessageBox>
@@ -185,6 +187,30 @@ void ImportImageSeqDialog::importArbitrarySequence(const ImportImageConfig impor
     int imagesImportedSoFar = 0;
     progress.setMaximum(totalImagesToImport);
 
+    if (mEditor->layers()->currentLayer()->type() == Layer::BITMAP)
+    {
+        QList<int> positions;
+        for (int i = 0; i < files.count(); i++)
+        {
+            positions.append(mEditor->currentFrame() + i * number);
+        }
+
+        Status st = importBitmapImages(files, positions, importImageConfig, progress, imagesImportedSoFar);
+        if (!st.ok())
+        {
+            ErrorDialog errorDialog(st.title(), st.description(), st.details().html());
+            errorDialog.exec();
+        }
+        if (imagesImportedSoFar > 0)
+        {
+            mEditor->scrubTo(positions[imagesImportedSoFar - 1] + number);
+        }
+
+        emit notifyAnimationLengthChanged();
+        progress.close();
+        return;
+    }
+
     for (const QString& strImgFile : files)
     {
         Status st = mEditor->importImage(strImgFile, importImageConfig);
@@ -301,33 +327,47 @@ void ImportImageSeqDialog::importPredefinedSet(const ImportImageConfig importIma
 
     mEditor->layers()->createBitmapLayer(keySet.layerName());
 
+    QStringList files;
+    QList<int> positions;
     for (int i = 0; i < keySet.size(); i++)
     {
-        const int& frameIndex = keySet.keyFrameIndexAt(i);
-        const QString& filePath = keySet.filePathAt(i);
-
-        mEditor->scrubTo(frameIndex);
-        Status st = mEditor->importImage(filePath, importImageConfig);
-        if (!st.ok())
-        {
-            ErrorDialog errorDialog(st.title(), st.description(), st.details().html());
-            errorDialog.exec();
-            break;
-        }
-        imagesImportedSoFar++;
-
-        progress.setValue(imagesImportedSoFar);
-        QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);  // Required to make progress bar update
+        files.append(keySet.filePathAt(i));
+        positions.append(keySet.keyFrameIndexAt(i));
+    }
 
-        if (progress.wasCanceled())
-        {
-            break;
-        }
+    Status st = importBitmapImages(files, positions, importImageConfig, progress, imagesImportedSoFar);
+    if (!st.ok())
+    {
+        ErrorDialog errorDialog(st.title(), st.description(), st.details().html());
+        errorDialog.exec();
+    }
+    if (imagesImportedSoFar > 0)
+    {
+        mEditor->scrubTo(positions[imagesImportedSoFar - 1] + 1);
     }
 
     emit notifyAnimationLengthChanged();
 }
 
+Status ImportImageSeqDialog::importBitmapImages(const QStringList& files,
+                                                const QList<int>& positions,
+                                                const ImportImageConfig importImageConfig,
+                                                QProgressDialog& progress,
+                                                int& imagesImportedSoFar)
+{
+    return mEditor->importImageSequence(files, positions, importImageConfig, ImageImportOptions(),
+        [&progress, &imagesImportedSoFar](int imported)
+        {
+            imagesImportedSoFar = imported;
+            progress.setValue(imported);
+            QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);  // Required to make progress bar update
+        },
+        [&progress]
+        {
+            return progress.wasCanceled();
+        });
+}
+
 QStringList ImportImageSeqDialog::getFilePaths()
 {
     return ImportExportDialog::getFilePaths();
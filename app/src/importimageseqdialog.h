@@ -24,6 +24,7 @@ GNU General Public License for more details.
 #include "importimageconfig.h"
 
 class Editor;
+class QProgressDialog;
 
 namespace Ui {
 class ImportImageSeqOptions;
@@ -82,6 +83,8 @@ private:
     void setupPredefinedLayout();
     Status validateKeySet(const PredefinedKeySet& keySet, const QStringList& filepaths);
     Status validateFiles(const QStringList& filepaths);
+    Status importBitmapImages(const QStringList& files, const QList<int>& positions, const ImportImageConfig importImageConfig,
+                              QProgressDialog& progress, int& imagesImportedSoFar);
 
     Ui::ImportImageSeqOptions *uiOptionsBox;
     Ui::ImportImageSeqPreviewGroupBox *uiGroupBoxPreview;
@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QMessageBox>
+#include <QProgressDialog>
 
 #include "keyframe.h"
 #include "layermanager.h"
@@ -166,7 +167,31 @@ void PegBarAlignmentDialog::alignPegs()
     }
 
 
-    Status result = PegBarAligner(mEditor, mEditor->select()->mySelectionRect().toAlignedRect()).align(bitmaplayers);
+    int keyFrameCount = 0;
+    for (const QString& layerName : bitmaplayers)
+    {
+        if (const Layer* layer = mEditor->layers()->findLayerByName(layerName, Layer::BITMAP))
+        {
+            keyFrameCount += layer->keyFrameCount();
+        }
+    }
+
+    PegBarAligner aligner(mEditor, mEditor->select()->mySelectionRect().toAlignedRect());
+
+    QProgressDialog progress(tr("Aligning pegs..."), tr("Abort"), 0, keyFrameCount, this);
+    progress.setWindowModality(Qt::WindowModal);
+
+    // Every keyframe is searched before any of them is moved
+    std::vector<PegOffset> offsets;
+    Status result = aligner.findOffsets(bitmaplayers, offsets,
+                                        [&progress](int count) { progress.setValue(count); },
+                                        [&progress]() { return progress.wasCanceled(); });
+    progress.reset();
+
+    if (result == Status::CANCELED)
+    {
+        return;
+    }
     if (!result.ok())
     {
         QMessageBox::information(this, "Pencil2D",
@@ -175,6 +200,8 @@ void PegBarAlignmentDialog::alignPegs()
         return;
     }
 
+    aligner.applyOffsets(offsets);
+
     mEditor->deselectAll();
     done(QDialog::Accepted);
 }
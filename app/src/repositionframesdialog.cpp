@@ -4,11 +4,14 @@
 #include <QList>
 #include <QListWidgetItem>
 #include <QMessageBox>
+#include <QProgressDialog>
 
 #include "selectionmanager.h"
 #include "selectionpainter.h"
 #include "viewmanager.h"
 #include "toolmanager.h"
+#include "editor.h"
+#include "keyframe.h"
 #include "layer.h"
 #include "layermanager.h"
 #include "layerbitmap.h"
@@ -94,59 +97,53 @@ void RepositionFramesDialog::repositionFrames()
         return;
     }
 
-    QList<int> frames = mEditor->layers()->currentLayer()->getSelectedFramesByPos();
-    for (int i = 0; i < frames.size(); i++)
-    {
-        mEditor->repositionImage(mEndPoint, frames.at(i));
-    }
+    auto layerManager = mEditor->layers();
+    Layer* currentLayer = layerManager->currentLayer();
+    QList<int> frames = currentLayer->getSelectedFramesByPos();
+
+    QMap<int, QList<int>> keyFramesByLayer;
+    keyFramesByLayer.insert(currentLayer->id(), frames);
 
-    if (!ui->listSelectedLayers->selectedItems().isEmpty())
+    for (int i = 0; i < mLayerIndexes.size(); i++)
     {
-        auto layerManager = mEditor->layers();
+        QListWidgetItem* item = ui->listSelectedLayers->item(i);
+        if (item == nullptr || !item->isSelected()) { continue; }
+
+        Layer* layer = layerManager->getLayer(mLayerIndexes.at(i));
+        QList<int>& positions = keyFramesByLayer[layer->id()];
 
         // if only selected keyframe-numbers should be repositioned
         if (ui->rbSameKeyframes->isChecked())
         {
-            int currLayer = mEditor->currentLayerIndex();
-            for (int j = 0; j < mLayerIndexes.size(); j++)
-            {
-                QListWidgetItem* item = ui->listSelectedLayers->item(j);
-                if (item->isSelected())
+            for (int frame : frames)
+            {   // only move frame if it exists
+                if (layer->keyExists(frame))
                 {
-                    layerManager->setCurrentLayer(mLayerIndexes.at(j));
-                    for (int i = 0; i < frames.size(); i++)
-                    {       // only move frame if it exists
-                        if (layerManager->currentLayer()->keyExists(frames.at(i)))
-                        {
-                            mEditor->repositionImage(mEndPoint, frames.at(i));
-                        }
-                    }
+                    positions.append(frame);
                 }
             }
-            layerManager->setCurrentLayer(currLayer);
         }
         // if all keyframes on layer should be repositioned
         else
         {
-            int currLayer = mEditor->currentLayerIndex();
-            for (int i= 0; i < mLayerIndexes.size(); i++)
-            {
-                QListWidgetItem* item = ui->listSelectedLayers->item(i);
-                if (item->isSelected())
-                {
-                    layerManager->setCurrentLayer(mLayerIndexes.at(i));
-                    int keyframe = layerManager->currentLayer()->firstKeyFramePosition();
-                    do {
-                        mEditor->repositionImage(mEndPoint, keyframe);
-                        keyframe = layerManager->currentLayer()->getNextKeyFramePosition(keyframe);
-                    }
-                    while (mEditor->currentFrame() != layerManager->currentLayer()->getMaxKeyFramePosition());
-                }
-            }
-            layerManager->setCurrentLayer(currLayer);
+            layer->foreachKeyFrame([&positions](KeyFrame* key) { positions.append(key->pos()); });
         }
     }
-    mEditor->getScribbleArea()->applyTransformedSelection();
+
+    int frameCount = 0;
+    for (const QList<int>& positions : keyFramesByLayer)
+    {
+        frameCount += positions.count();
+    }
+
+    QProgressDialog progress(tr("Repositioning frames..."), tr("Abort"), 0, frameCount, this);
+    progress.setWindowModality(Qt::WindowModal);
+
+    // All the frames are moved in one go and can be undone as one step
+    mEditor->transformBitmapKeyFrames(keyFramesByLayer, QRect(), QTransform::fromTranslate(mEndPoint.x(), mEndPoint.y()), false,
+                                      [&progress](int count) { progress.setValue(count); },
+                                      [&progress]() { return progress.wasCanceled(); });
+
     mEditor->select()->resetSelectionProperties();
     mEditor->scrubTo(mRepositionFrame);
     
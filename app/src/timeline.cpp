@@ -233,7 +233,8 @@ void TimeLine::initUI()
     connect(mTracks, &TimeLineCells::insertNewKeyFrame, this, &TimeLine::insertKeyClick);
 
     connect(editor(), &Editor::scrubbed, this, &TimeLine::updateFrame);
-    connect(editor(), &Editor::frameModified, this, &TimeLine::updateContent);
+    connect(editor(), &Editor::frameModified, mTracks, &TimeLineCells::onFrameModified);
+    connect(editor(), &Editor::framesModified, mTracks, &TimeLineCells::invalidateDirtyThumbnails);
     connect(editor(), &Editor::framesModified, this, &TimeLine::updateContent);
 
     LayerManager* layer = editor()->layers();
@@ -367,6 +368,7 @@ int TimeLine::getRangeUpper()
 void TimeLine::onObjectLoaded()
 {
     mTimeControls->updateUI();
+    mTracks->resetThumbnails();
     updateLayerNumber(editor()->layers()->count());
 }
 
@@ -23,11 +23,14 @@ GNU General Public License for more details.
 #include <QPainter>
 #include <QRegularExpression>
 #include <QSettings>
+#include <QDir>
 #include <QDebug>
+#include <QStandardPaths>
 
 #include "camerapropertiesdialog.h"
 #include "editor.h"
 #include "keyframe.h"
+#include "keyframethumbnailcache.h"
 #include "layermanager.h"
 #include "viewmanager.h"
 #include "object.h"
@@ -49,6 +52,21 @@ TimeLineCells::TimeLineCells(TimeLine* parent, Editor* editor, TIMELINE_CELL_TYP
     mFrameSize = mPrefs->getInt(SETTING::FRAME_SIZE);
     mbShortScrub = mPrefs->isOn(SETTING::SHORT_SCRUB);
     mDrawFrameNumber = mPrefs->isOn(SETTING::DRAW_LABEL);
+    mShowThumbnails = mPrefs->isOn(SETTING::TIMELINE_THUMBNAILS);
+    updateLayerHeight();
+
+    if (mType == TIMELINE_CELL_TYPE::Tracks)
+    {
+        mThumbnails = new KeyFrameThumbnailCache(this);
+        // Thumbnails of saved frames are named after their content, so every project can share the folder
+        const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cacheLocation.isEmpty())
+        {
+            mThumbnails->setCacheDir(QDir(cacheLocation).filePath("thumbnails"));
+        }
+        connect(mThumbnails, &KeyFrameThumbnailCache::thumbnailReady, this, &TimeLineCells::onThumbnailReady);
+        updateThumbnailSize();
+    }
 
     setMinimumSize(500, 4 * mLayerHeight);
     setSizePolicy(QSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding));
@@ -84,6 +102,11 @@ void TimeLineCells::loadSetting(SETTING setting)
     case SETTING::DRAW_LABEL:
         mDrawFrameNumber = mPrefs->isOn(SETTING::DRAW_LABEL);
         break;
+    case SETTING::TIMELINE_THUMBNAILS:
+        mShowThumbnails = mPrefs->isOn(SETTING::TIMELINE_THUMBNAILS);
+        updateLayerHeight();
+        mTimeLine->updateLayerView();
+        break;
     default:
         break;
     }
@@ -159,6 +182,108 @@ int TimeLineCells::getLayerY(int layerNumber) const
     return mOffsetY + (mEditor->object()->getLayerCount() - 1 - layerNumber - mLayerOffset)*mLayerHeight;
 }
 
+void TimeLineCells::updateLayerHeight()
+{
+    mLayerHeight = mShowThumbnails ? mThumbnailLayerHeight : mDefaultLayerHeight;
+    updateThumbnailSize();
+}
+
+void TimeLineCells::updateThumbnailSize()
+{
+    if (mThumbnails == nullptr) { return; }
+
+    // Leave room for the keyframe border
+    const int thumbnailHeight = mLayerHeight - 6;
+    QRect viewRect(-400, -300, 800, 600);
+
+    const Object* object = mEditor->object();
+    if (object)
+    {
+        const std::vector<LayerCamera*> cameraLayers = object->getLayersByType<LayerCamera>();
+        if (!cameraLayers.empty())
+        {
+            viewRect = cameraLayers.front()->getViewRect();
+        }
+    }
+    if (viewRect.isEmpty()) { return; }
+
+    mThumbnails->setViewRect(viewRect);
+    mThumbnails->setThumbnailSize(QSize(thumbnailHeight * viewRect.width() / viewRect.height(), thumbnailHeight));
+}
+
+void TimeLineCells::resetThumbnails()
+{
+    if (mThumbnails == nullptr) { return; }
+
+    mThumbnails->clear();
+    updateThumbnailSize();
+    updateContent();
+}
+
+void TimeLineCells::invalidateDirtyThumbnails()
+{
+    if (mThumbnails == nullptr) { return; }
+
+    // Only the current layer is edited, and only its dirty frames get cleared by the canvas.
+    // This must run before ScribbleArea consumes them, hence the connection order in TimeLine::initUI.
+    mThumbnails->invalidateDirtyFrames(mEditor->layers()->currentLayer());
+}
+
+void TimeLineCells::onFrameModified(int frameNumber)
+{
+    invalidateDirtyThumbnails();
+
+    const Object* object = mEditor->object();
+    for (int i = 0; i < object->getLayerCount(); i++)
+    {
+        invalidateExposure(object->getLayer(i), frameNumber);
+    }
+
+    // Same as above, the current layer is the only one whose dirty frames are reliable
+    const Layer* currentLayer = mEditor->layers()->currentLayer();
+    if (currentLayer)
+    {
+        for (const auto& range : currentLayer->dirtyFrameRanges())
+        {
+            invalidateExposure(currentLayer, range.first, range.second);
+        }
+    }
+    redrawContent();
+}
+
+void TimeLineCells::onThumbnailReady(int layerId, int position)
+{
+    const Layer* layer = mEditor->object()->findLayerById(layerId);
+    if (layer == nullptr) { return; }
+
+    invalidateExposure(layer, position);
+    redrawContent();
+}
+
+void TimeLineCells::invalidateTrackStrip(int layerId, int fromFrame, int toFrame)
+{
+    auto it = mTrackStrips.find(layerId);
+    if (it == mTrackStrips.end())
+    {
+        // Will be painted from scratch anyway
+        return;
+    }
+    it->dirtyFrom = qMin(it->dirtyFrom, fromFrame);
+    it->dirtyTo = qMax(it->dirtyTo, toFrame);
+}
+
+void TimeLineCells::invalidateExposure(const Layer* layer, int firstFrame, int lastFrame)
+{
+    if (layer == nullptr) { return; }
+
+    // Thumbnails and sound clips span until the next keyframe,
+    // so adding or removing a key also changes how its neighbours look
+    const int fromFrame = qMin(firstFrame, layer->getPreviousKeyFramePosition(firstFrame));
+    const int nextFrame = layer->getNextKeyFramePosition(lastFrame);
+    const int toFrame = (nextFrame > lastFrame) ? nextFrame : INT_MAX;
+    invalidateTrackStrip(layer->id(), fromFrame, toFrame);
+}
+
 void TimeLineCells::updateFrame(int frameNumber)
 {
     int x = getFrameX(frameNumber);
@@ -166,6 +291,13 @@ void TimeLineCells::updateFrame(int frameNumber)
 }
 
 void TimeLineCells::updateContent()
+{
+    // Anything may have changed, start over with every track
+    mTrackStrips.clear();
+    redrawContent();
+}
+
+void TimeLineCells::redrawContent()
 {
     mRedrawContent = true;
     update();
@@ -246,12 +378,15 @@ void TimeLineCells::drawContent()
         if (layeri != nullptr)
         {
             const int layerY = getLayerY(i);
+            if (layerY + mLayerHeight <= 0 || layerY > height())
+            {
+                // Scrolled out of view
+                continue;
+            }
             switch (mType)
             {
             case TIMELINE_CELL_TYPE::Tracks:
-                paintTrack(painter, layeri, mOffsetX,
-                           layerY, widgetWidth - mOffsetX,
-                           mLayerHeight, false, mFrameSize);
+                paintTrackStrip(painter, layeri, layerY, false);
                 break;
 
             case TIMELINE_CELL_TYPE::Layers:
@@ -270,10 +405,7 @@ void TimeLineCells::drawContent()
         int layerYMouseMove = getLayerY(mEditor->layers()->currentLayerIndex()) + mMouseMoveY;
         if (mType == TIMELINE_CELL_TYPE::Tracks)
         {
-            paintTrack(painter, currentLayer,
-                       mOffsetX, layerYMouseMove,
-                       widgetWidth - mOffsetX, mLayerHeight,
-                       true, mFrameSize);
+            paintTrackStrip(painter, currentLayer, layerYMouseMove, true);
         }
         else if (mType == TIMELINE_CELL_TYPE::Layers)
         {
@@ -288,14 +420,7 @@ void TimeLineCells::drawContent()
     {
         if (mType == TIMELINE_CELL_TYPE::Tracks)
         {
-            paintTrack(painter,
-                       currentLayer,
-                       mOffsetX,
-                       getLayerY(mEditor->layers()->currentLayerIndex()),
-                       widgetWidth - mOffsetX,
-                       mLayerHeight,
-                       true,
-                       mFrameSize);
+            paintTrackStrip(painter, currentLayer, getLayerY(mEditor->layers()->currentLayerIndex()), true);
         }
         else if (mType == TIMELINE_CELL_TYPE::Layers)
         {
@@ -389,6 +514,77 @@ void TimeLineCells::paintTicks(QPainter& painter, const QPalette& palette) const
     }
 }
 
+void TimeLineCells::paintTrackStrip(QPainter& painter, const Layer* layer, int y, bool selected)
+{
+    TrackStrip& strip = mTrackStrips[layer->id()];
+    const QSize stripSize(width(), mLayerHeight + 1);
+
+    if (strip.pixmap.size() != stripSize || strip.frameSize != mFrameSize ||
+        strip.selected != selected || strip.visible != layer->visible())
+    {
+        strip.fullRepaint = true;
+    }
+    else if (!strip.fullRepaint && strip.frameOffset != mFrameOffset)
+    {
+        const int frameShift = mFrameOffset - strip.frameOffset;
+        const int firstFrame = getFrameNumber(0);
+        const int lastFrame = getFrameNumber(width());
+        if (qAbs(frameShift) > lastFrame - firstFrame)
+        {
+            strip.fullRepaint = true;
+        }
+        else
+        {
+            // Keep what is still in view, only the uncovered frames need to be painted
+            strip.pixmap.scroll(-frameShift * mFrameSize, 0, strip.pixmap.rect());
+            if (frameShift > 0)
+            {
+                invalidateTrackStrip(layer->id(), lastFrame - frameShift, lastFrame);
+            }
+            else
+            {
+                invalidateTrackStrip(layer->id(), firstFrame, firstFrame - frameShift);
+            }
+        }
+    }
+    strip.frameOffset = mFrameOffset;
+    strip.frameSize = mFrameSize;
+    strip.selected = selected;
+    strip.visible = layer->visible();
+
+    if (strip.fullRepaint || strip.dirtyFrom <= strip.dirtyTo)
+    {
+        if (strip.pixmap.size() != stripSize)
+        {
+            strip.pixmap = QPixmap(stripSize);
+        }
+
+        QRect area = strip.pixmap.rect();
+        if (!strip.fullRepaint)
+        {
+            const int fromFrame = qMax(strip.dirtyFrom, getFrameNumber(0) - 1);
+            const int toFrame = qMin(strip.dirtyTo, getFrameNumber(width()) + 1);
+            area &= QRect(QPoint(getFrameX(fromFrame - 1), 0), QPoint(getFrameX(toFrame) + 1, stripSize.height() - 1));
+        }
+
+        if (!area.isEmpty())
+        {
+            QPainter stripPainter(&strip.pixmap);
+            stripPainter.setClipRect(area);
+            stripPainter.fillRect(area, QApplication::palette().color(QPalette::Base));
+
+            // Tracks are drawn from one pixel above their row
+            paintTrack(stripPainter, layer, mOffsetX, 1, width() - mOffsetX, mLayerHeight, selected, mFrameSize);
+        }
+
+        strip.fullRepaint = false;
+        strip.dirtyFrom = INT_MAX;
+        strip.dirtyTo = INT_MIN;
+    }
+
+    painter.drawPixmap(0, y - 1, strip.pixmap);
+}
+
 void TimeLineCells::paintTrack(QPainter& painter, const Layer* layer,
                        int x, int y, int width, int height,
                        bool selected, int frameSize) const
@@ -433,6 +629,11 @@ void TimeLineCells::paintTrack(QPainter& painter, const Layer* layer,
 
     paintFrames(painter, col, layer, y, height, selected, frameSize);
 
+    if (mShowThumbnails && (layer->type() == Layer::BITMAP || layer->type() == Layer::VECTOR))
+    {
+        paintThumbnails(painter, layer, y, height);
+    }
+
     painter.restore();
 }
 
@@ -445,8 +646,15 @@ void TimeLineCells::paintFrames(QPainter& painter, QColor trackCol, const Layer*
 
     int recHeight = height - 4;
 
+    int fromFrame = 0;
+    int toFrame = 0;
+    getPaintedFrameRange(painter, fromFrame, toFrame);
+
+    // Sound clips may start before the painted area and still cover it
+    fromFrame = qMin(fromFrame, layer->getPreviousKeyFramePosition(fromFrame));
+
     const QList<int> selectedFrames = layer->getSelectedFramesByPos();
-    layer->foreachKeyFrame([&](KeyFrame* key)
+    layer->foreachKeyFrameInRange(fromFrame, toFrame, [&](KeyFrame* key)
     {
         int framePos = key->pos();
         int recWidth = standardWidth;
@@ -477,6 +685,52 @@ void TimeLineCells::paintFrames(QPainter& painter, QColor trackCol, const Layer*
     });
 }
 
+void TimeLineCells::paintThumbnails(QPainter& painter, const Layer* layer, int y, int height) const
+{
+    if (mThumbnails == nullptr) { return; }
+
+    const int firstVisibleFrame = mFrameOffset + 1;
+    const int lastVisibleFrame = getFrameNumber(width());
+    const int thumbnailTop = y + 2;
+    const int thumbnailHeight = height - 6;
+
+    int fromFrame = 0;
+    int toFrame = 0;
+    getPaintedFrameRange(painter, fromFrame, toFrame);
+
+    // The thumbnail of the previous keyframe may span over the painted area
+    fromFrame = qMin(fromFrame, layer->getPreviousKeyFramePosition(fromFrame));
+
+    layer->foreachKeyFrameInRange(fromFrame, qMin(toFrame, lastVisibleFrame), [&](KeyFrame* key)
+    {
+        const int framePos = key->pos();
+
+        // The thumbnail may span the whole exposure of the drawing
+        const int nextPos = layer->getNextKeyFramePosition(framePos);
+        const int exposure = (nextPos > framePos) ? nextPos - framePos : lastVisibleFrame - framePos + 1;
+        if (framePos + exposure <= firstVisibleFrame) { return; }
+
+        const QImage thumbnail = mThumbnails->thumbnail(layer, key, mEditor->object());
+        if (thumbnail.isNull()) { return; }
+
+        const int left = getFrameX(framePos) - mFrameSize + 3;
+        const int availableWidth = exposure * mFrameSize - 4;
+        const int thumbnailWidth = qMin(thumbnail.width(), availableWidth);
+        if (thumbnailWidth <= 0) { return; }
+
+        painter.drawImage(QPoint(left, thumbnailTop), thumbnail, QRect(0, 0, thumbnailWidth, thumbnailHeight));
+    });
+}
+
+void TimeLineCells::getPaintedFrameRange(const QPainter& painter, int& fromFrame, int& toFrame) const
+{
+    const QRect area = painter.hasClipping() ? painter.clipBoundingRect().toAlignedRect() : rect();
+
+    // Borders of the neighbouring frames overlap the area
+    fromFrame = getFrameNumber(area.left()) - 1;
+    toFrame = getFrameNumber(area.right()) + 1;
+}
+
 void TimeLineCells::paintCurrentFrameBorder(QPainter &painter, int recLeft, int recTop, int recWidth, int recHeight) const
 {
     painter.save();
@@ -886,6 +1140,7 @@ void TimeLineCells::mousePressEvent(QMouseEvent* event)
                     {
                         Layer *previousLayer = mEditor->object()->getLayer(previousLayerNumber);
                         previousLayer->deselectAll();
+                        invalidateTrackStrip(previousLayer->id());
                         emit mEditor->selectedFramesChanged();
                         mEditor->layers()->setCurrentLayer(layerNumber);
                     }
@@ -953,7 +1208,9 @@ void TimeLineCells::mousePressEvent(QMouseEvent* event)
                         emit selectionChanged();
                     }
 
-                    mTimeLine->updateContent();
+                    // Selected frames are painted on top of the tracks, only the clicked track changes
+                    invalidateTrackStrip(currentLayer->id());
+                    redrawContent();
                 }
                 else
                 {
@@ -1035,9 +1292,10 @@ void TimeLineCells::mouseMoveEvent(QMouseEvent* event)
                             currentLayer->setFrameSelected(mStartFrameNumber, true);
                             currentLayer->extendSelectionTo(mFramePosMoveX);
                             emit mEditor->selectedFramesChanged();
+                            invalidateTrackStrip(currentLayer->id());
                         }
                         mLastFrameNumber = mFramePosMoveX;
-                        updateContent();
+                        redrawContent();
                     }
                 }
                 update();
@@ -1079,7 +1337,8 @@ void TimeLineCells::mouseReleaseEvent(QMouseEvent* event)
             // Add/remove from already selected
             currentLayer->toggleFrameSelected(frameNumber, multipleSelection);
             emit mEditor->selectedFramesChanged();
-            updateContent();
+            invalidateTrackStrip(currentLayer->id());
+            redrawContent();
         }
     }
     if (mType == TIMELINE_CELL_TYPE::Layers && !mScrollingVertically && layerNumber != mStartLayerNumber && mStartLayerNumber != -1 && layerNumber != -1)
@@ -1202,14 +1461,14 @@ void TimeLineCells::editLayerName(Layer* layer) const
 void TimeLineCells::hScrollChange(int x)
 {
     mFrameOffset = x;
-    updateContent();
+    redrawContent();
 }
 
 void TimeLineCells::vScrollChange(int x)
 {
     mLayerOffset = x;
     mScrollingVertically = true;
-    updateContent();
+    redrawContent();
 }
 
 void TimeLineCells::onScrollingVerticallyStopped()
@@ -1220,7 +1479,7 @@ void TimeLineCells::onScrollingVerticallyStopped()
 void TimeLineCells::setMouseMoveY(int x)
 {
     mMouseMoveY = x;
-    updateContent();
+    redrawContent();
 }
 
 bool TimeLineCells::trackScrubber()
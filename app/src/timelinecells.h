@@ -18,8 +18,11 @@ GNU General Public License for more details.
 #ifndef TIMELINECELLS_H
 #define TIMELINECELLS_H
 
+#include <climits>
 #include <QString>
 #include <QWidget>
+#include <QHash>
+#include <QPixmap>
 #include "layercamera.h"
 
 class Layer;
@@ -32,6 +35,7 @@ class Editor;
 class PreferenceManager;
 class QMenu;
 class QAction;
+class KeyFrameThumbnailCache;
 enum class SETTING;
 
 enum class TIMELINE_CELL_TYPE
@@ -63,6 +67,9 @@ public:
 
     void showCameraMenu(QPoint pos);
 
+    /** Resets the thumbnail cache for a newly loaded object */
+    void resetThumbnails();
+
 signals:
     void mouseMovedY(int);
     void lengthChanged(int);
@@ -77,6 +84,8 @@ public slots:
     void vScrollChange(int);
     void onScrollingVerticallyStopped();
     void setMouseMoveY(int x);
+    void invalidateDirtyThumbnails();
+    void onFrameModified(int frameNumber);
 
 protected:
     bool event(QEvent *event) override;
@@ -89,8 +98,22 @@ protected:
 
 private slots:
     void loadSetting(SETTING setting);
+    void onThumbnailReady(int layerId, int position);
 
 private:
+    /** The cached rendering of a single layer track, kept up to date incrementally */
+    struct TrackStrip
+    {
+        QPixmap pixmap;
+        int frameOffset = 0;
+        int frameSize = 0;
+        bool selected = false;
+        bool visible = true;
+        bool fullRepaint = true;
+        int dirtyFrom = INT_MAX;
+        int dirtyTo = INT_MIN;
+    };
+
     int getLayerNumber(int y) const;
     int getInbetweenLayerNumber(int y) const;
     int getLayerY(int layerNumber) const;
@@ -100,12 +123,19 @@ private:
     void onDidLeaveWidget();
 
     bool trackScrubber();
+    void redrawContent();
     void drawContent();
+    void paintTrackStrip(QPainter& painter, const Layer* layer, int y, bool selected);
+    void invalidateTrackStrip(int layerId, int fromFrame = INT_MIN, int toFrame = INT_MAX);
+    void invalidateExposure(const Layer* layer, int frameNumber) { invalidateExposure(layer, frameNumber, frameNumber); }
+    void invalidateExposure(const Layer* layer, int firstFrame, int lastFrame);
+    void getPaintedFrameRange(const QPainter& painter, int& fromFrame, int& toFrame) const;
     void paintTicks(QPainter& painter, const QPalette& palette) const;
     void paintOnionSkin(QPainter& painter) const;
     void paintLayerGutter(QPainter& painter) const;
     void paintTrack(QPainter& painter, const Layer* layer, int x, int y, int width, int height, bool selected, int frameSize) const;
     void paintFrames(QPainter& painter, QColor trackCol, const Layer* layer, int y, int height, bool selected, int frameSize) const;
+    void paintThumbnails(QPainter& painter, const Layer* layer, int y, int height) const;
     void paintCurrentFrameBorder(QPainter& painter, int recLeft, int recTop, int recWidth, int recHeight) const;
     void paintFrameCursorOnCurrentLayer(QPainter& painter, int recTop, int recWidth, int recHeight) const;
     void paintSelectedFrames(QPainter& painter, const Layer* layer, const int layerIndex) const;
@@ -117,6 +147,9 @@ private:
     void editLayerProperties(LayerCamera *layer) const;
     void editLayerName(Layer* layer) const;
 
+    void updateLayerHeight();
+    void updateThumbnailSize();
+
     TimeLine* mTimeLine;
     Editor* mEditor; // the editor for which this timeLine operates
     PreferenceManager* mPrefs;
@@ -124,8 +157,11 @@ private:
     TIMELINE_CELL_TYPE mType;
 
     QPixmap* mCache = nullptr;
+    QHash<int, TrackStrip> mTrackStrips; // by layer id
     bool mRedrawContent = false;
     bool mDrawFrameNumber = true;
+    bool mShowThumbnails = false;
+    KeyFrameThumbnailCache* mThumbnails = nullptr;
     bool mbShortScrub = false;
     int mFrameLength = 1;
     int mFrameSize = 0;
@@ -172,6 +208,8 @@ private:
     const static int mOffsetX = 0;
     const static int mOffsetY = 20;
     const static int mLayerDetachThreshold = 5;
+    const static int mDefaultLayerHeight = 20;
+    const static int mThumbnailLayerHeight = 48;
 
 };
 
@@ -34,6 +34,7 @@ TimelinePage::TimelinePage()
     auto comboChanged = static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged);
     connect(ui->timelineLength, spinBoxValueChange, this, &TimelinePage::timelineLengthChanged);
     connect(ui->scrubBox, &QCheckBox::stateChanged, this, &TimelinePage::scrubChanged);
+    connect(ui->thumbnailsBox, &QCheckBox::stateChanged, this, &TimelinePage::thumbnailsChanged);
     connect(ui->radioButtonAddNewKey, &QRadioButton::toggled, this, &TimelinePage::drawEmptyKeyRadioButtonToggled);
     connect(ui->radioButtonDuplicate, &QRadioButton::toggled, this, &TimelinePage::drawEmptyKeyRadioButtonToggled);
     connect(ui->radioButtonDrawOnPrev, &QRadioButton::toggled, this, &TimelinePage::drawEmptyKeyRadioButtonToggled);
@@ -61,6 +62,9 @@ void TimelinePage::updateValues()
     QSignalBlocker b1(ui->scrubBox);
     ui->scrubBox->setChecked(mManager->isOn(SETTING::SHORT_SCRUB));
 
+    QSignalBlocker b2(ui->thumbnailsBox);
+    ui->thumbnailsBox->setChecked(mManager->isOn(SETTING::TIMELINE_THUMBNAILS));
+
     QSignalBlocker b3(ui->timelineLength);
     ui->timelineLength->setValue(mManager->getInt(SETTING::TIMELINE_SIZE));
     if (mManager->getString(SETTING::TIMELINE_SIZE).toInt() <= 0)
@@ -126,6 +130,11 @@ void TimelinePage::scrubChanged(int value)
     mManager->set(SETTING::SHORT_SCRUB, value != Qt::Unchecked);
 }
 
+void TimelinePage::thumbnailsChanged(int value)
+{
+    mManager->set(SETTING::TIMELINE_THUMBNAILS, value != Qt::Unchecked);
+}
+
 void TimelinePage::layerVisibilityChanged(int value)
 {
     mManager->set(SETTING::LAYER_VISIBILITY, value);
@@ -39,6 +39,7 @@ public slots:
     void timelineLengthChanged(int);
     void fontSizeChanged(int);
     void scrubChanged(int);
+    void thumbnailsChanged(int);
     void drawEmptyKeyRadioButtonToggled(bool);
     void flipRollMsecSliderChanged(int value);
     void flipRollMsecSpinboxChanged(int value);
@@ -28,6 +28,7 @@ PRECOMPILED_HEADER = src/corelib-pch.h
 HEADERS +=  \
     src/canvascursorpainter.h \
     src/corelib-pch.h \
+    src/graphics/bitmap/affinesampler.h \
     src/graphics/bitmap/bitmapbucket.h \
     src/graphics/bitmap/bitmapimage.h \
     src/graphics/bitmap/tile.h \
@@ -35,7 +36,10 @@ HEADERS +=  \
     src/graphics/vector/bezierarea.h \
     src/graphics/vector/beziercurve.h \
     src/graphics/vector/colorref.h \
+    src/graphics/vector/curveindex.h \
+    src/graphics/vector/planarmap.h \
     src/graphics/vector/vectorimage.h \
+    src/graphics/vector/vectorrasterizer.h \
     src/graphics/vector/vectorselection.h \
     src/graphics/vector/vertexref.h \
     src/interface/editor.h \
@@ -64,6 +68,7 @@ HEADERS +=  \
     src/camerapainter.h \
     src/structure/camera.h \
     src/structure/keyframe.h \
+    src/structure/keyframeselection.h \
     src/structure/layer.h \
     src/structure/layerbitmap.h \
     src/structure/layercamera.h \
@@ -90,11 +95,13 @@ HEADERS +=  \
     src/tool/smudgetool.h \
     src/tool/strokeinterpolator.h \
     src/tool/stroketool.h \
+    src/tool/vectorstrokefinalizer.h \
     src/util/blitrect.h \
     src/util/cameraeasingtype.h \
     src/util/camerafieldoption.h \
     src/util/colordictionary.h \
     src/util/fileformat.h \
+    src/util/framerangeset.h \
     src/util/filetype.h \
     src/util/importimageconfig.h \
     src/util/mathutils.h \
@@ -108,6 +115,7 @@ HEADERS +=  \
     src/util/transform.h \
     src/util/util.h \
     src/util/log.h \
+    src/util/profiler.h \
     src/util/movemode.h \
     src/util/pointerevent.h \
     src/canvaspainter.h \
@@ -116,19 +124,30 @@ HEADERS +=  \
     src/miniz.h \
     src/qminiz.h \
     src/activeframepool.h \
+    src/keyframethumbnailcache.h \
+    src/playbackscheduler.h \
+    src/renderaheadqueue.h \
+    src/soundmixer.h \
+    src/audiosink.h \
+    src/imagebatchdecoder.h \
+    src/bitmaptransformbatch.h \
     src/external/platformhandler.h \
     src/selectionpainter.h
 
 
 SOURCES +=  src/graphics/bitmap/bitmapimage.cpp \
     src/canvascursorpainter.cpp \
+    src/graphics/bitmap/affinesampler.cpp \
     src/graphics/bitmap/bitmapbucket.cpp \
     src/graphics/bitmap/tile.cpp \
     src/graphics/bitmap/tiledbuffer.cpp \
     src/graphics/vector/bezierarea.cpp \
     src/graphics/vector/beziercurve.cpp \
     src/graphics/vector/colorref.cpp \
+    src/graphics/vector/curveindex.cpp \
+    src/graphics/vector/planarmap.cpp \
     src/graphics/vector/vectorimage.cpp \
+    src/graphics/vector/vectorrasterizer.cpp \
     src/graphics/vector/vectorselection.cpp \
     src/graphics/vector/vertexref.cpp \
     src/interface/editor.cpp \
@@ -154,6 +173,7 @@ SOURCES +=  src/graphics/bitmap/bitmapimage.cpp \
     src/movieimporter.cpp \
     src/structure/camera.cpp \
     src/structure/keyframe.cpp \
+    src/structure/keyframeselection.cpp \
     src/structure/layer.cpp \
     src/structure/layerbitmap.cpp \
     src/structure/layercamera.cpp \
@@ -180,12 +200,15 @@ SOURCES +=  src/graphics/bitmap/bitmapimage.cpp \
     src/tool/smudgetool.cpp \
     src/tool/strokeinterpolator.cpp \
     src/tool/stroketool.cpp \
+    src/tool/vectorstrokefinalizer.cpp \
     src/util/blitrect.cpp \
     src/util/cameraeasingtype.cpp \
     src/util/fileformat.cpp \
+    src/util/framerangeset.cpp \
     src/util/pencilerror.cpp \
     src/util/pencilsettings.cpp \
     src/util/log.cpp \
+    src/util/profiler.cpp \
     src/util/transform.cpp \
     src/util/util.cpp \
     src/util/pointerevent.cpp \
@@ -198,6 +221,13 @@ SOURCES +=  src/graphics/bitmap/bitmapimage.cpp \
     src/miniz.cpp \
     src/qminiz.cpp \
     src/activeframepool.cpp \
+    src/keyframethumbnailcache.cpp \
+    src/playbackscheduler.cpp \
+    src/renderaheadqueue.cpp \
+    src/soundmixer.cpp \
+    src/audiosink.cpp \
+    src/imagebatchdecoder.cpp \
+    src/bitmaptransformbatch.cpp \
     src/selectionpainter.cpp
 
 win32 {
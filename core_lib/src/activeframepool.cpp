@@ -17,6 +17,7 @@ GNU General Public License for more details.
 
 #include "activeframepool.h"
 #include "keyframe.h"
+#include "profiler.h"
 
 
 ActiveFramePool::ActiveFramePool()
@@ -36,10 +37,15 @@ void ActiveFramePool::put(KeyFrame* key)
 
     Q_ASSERT(key->pos() > 0);
 
-    key->loadFile();
+    if (!key->isLoaded())
+    {
+        PROFILE_SCOPE("ActiveFramePool::load");
+        key->loadFile();
+    }
 
     auto it = mCacheFramesMap.find(key);
     const bool keyExistsInPool = (it != mCacheFramesMap.end());
+    Profiler::addToCounter(keyExistsInPool ? Profiler::FRAME_POOL_HITS : Profiler::FRAME_POOL_MISSES, 1);
     if (keyExistsInPool)
     {
         // move the keyframe to the front of the list, if the key already exists in frame pool
@@ -116,10 +122,14 @@ void ActiveFramePool::discardLeastUsedFrames()
 
         lastKeyFrame->removeEventListner(this);
     }
+    Profiler::setCounter(Profiler::FRAME_POOL_BYTES, static_cast<qint64>(mTotalUsedMemory));
 }
 
 void ActiveFramePool::unloadFrame(KeyFrame* key)
 {
+    PROFILE_SCOPE("ActiveFramePool::evict");
+    Profiler::addToCounter(Profiler::FRAME_POOL_EVICTIONS, 1);
+
     mTotalUsedMemory -= key->memoryUsage();
     key->unloadFile();
 }
@@ -131,4 +141,5 @@ void ActiveFramePool::recalcuateTotalUsedMemory()
     {
         mTotalUsedMemory += key->memoryUsage();
     }
+    Profiler::setCounter(Profiler::FRAME_POOL_BYTES, static_cast<qint64>(mTotalUsedMemory));
 }
@@ -0,0 +1,125 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+
+#include "audiosink.h"
+
+#include <QDebug>
+#include <QIODevice>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QAudioSink>
+#include <QAudioDevice>
+#include <QMediaDevices>
+#else
+#include <QAudioOutput>
+#include <QAudioDeviceInfo>
+#endif
+#include "soundmixer.h"
+
+DeviceAudioSink::DeviceAudioSink()
+{
+}
+
+DeviceAudioSink::~DeviceAudioSink()
+{
+    stop();
+    delete mOutput;
+}
+
+bool DeviceAudioSink::isAvailable()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+#else
+    const QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+#endif
+    return !device.isNull() && device.isFormatSupported(SoundMixer::audioFormat());
+}
+
+bool DeviceAudioSink::start(QIODevice* source)
+{
+    Q_ASSERT(source != nullptr);
+
+    if (mOutput == nullptr)
+    {
+        mOutput = new AudioOutputDevice(SoundMixer::audioFormat());
+    }
+    mOutput->stop();
+    mOutput->start(source);
+
+    if (mOutput->error() != QAudio::NoError)
+    {
+        qDebug() << "AudioSink Error: " << mOutput->error();
+        return false;
+    }
+    return true;
+}
+
+void DeviceAudioSink::stop()
+{
+    if (mOutput)
+    {
+        mOutput->stop();
+    }
+}
+
+bool DeviceAudioSink::isActive() const
+{
+    if (mOutput)
+    {
+        return mOutput->state() == QAudio::ActiveState || mOutput->state() == QAudio::IdleState;
+    }
+    return false;
+}
+
+qint64 DeviceAudioSink::processedUSecs() const
+{
+    if (mOutput == nullptr)
+    {
+        return 0;
+    }
+
+    // What has been handed to the device but is still waiting in its buffer hasn't been heard yet
+    const qint64 bufferedBytes = qMax(qint64(0), static_cast<qint64>(mOutput->bufferSize() - mOutput->bytesFree()));
+    const qint64 bufferedUSecs = bufferedBytes / SoundMixer::BYTES_PER_FRAME * 1000000 / SoundMixer::SAMPLE_RATE;
+    return mOutput->processedUSecs() - bufferedUSecs;
+}
+
+bool NullAudioSink::start(QIODevice* source)
+{
+    Q_ASSERT(source != nullptr);
+    mSource = source;
+    mProcessedUSecs = 0;
+    return true;
+}
+
+void NullAudioSink::stop()
+{
+    mSource = nullptr;
+}
+
+QByteArray NullAudioSink::pull(qint64 usecs)
+{
+    if (mSource == nullptr)
+    {
+        return QByteArray();
+    }
+
+    const qint64 count = usecs * SoundMixer::SAMPLE_RATE / 1000000;
+    const QByteArray data = mSource->read(count * SoundMixer::BYTES_PER_FRAME);
+    mProcessedUSecs += static_cast<qint64>(data.size()) / SoundMixer::BYTES_PER_FRAME * 1000000 / SoundMixer::SAMPLE_RATE;
+    return data;
+}
@@ -0,0 +1,88 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+class QIODevice;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+class QAudioSink;
+using AudioOutputDevice = QAudioSink;
+#else
+class QAudioOutput;
+using AudioOutputDevice = QAudioOutput;
+#endif
+
+/**
+ * Where the sound mixer output goes.
+ * A sink pulls samples in the SoundMixer format from its source as it needs them,
+ * and reports how much it has played so far, which serves as the audio clock.
+ */
+class AudioSink
+{
+public:
+    virtual ~AudioSink() = default;
+
+    virtual bool start(QIODevice* source) = 0;
+    virtual void stop() = 0;
+    virtual bool isActive() const = 0;
+
+    /** Microseconds of audio played since start() */
+    virtual qint64 processedUSecs() const = 0;
+};
+
+/** Plays on the default audio output device */
+class DeviceAudioSink : public AudioSink
+{
+public:
+    DeviceAudioSink();
+    ~DeviceAudioSink() override;
+
+    /** @return true if the default output device accepts the mixer format */
+    static bool isAvailable();
+
+    bool start(QIODevice* source) override;
+    void stop() override;
+    bool isActive() const override;
+    qint64 processedUSecs() const override;
+
+private:
+    AudioOutputDevice* mOutput = nullptr;
+};
+
+/** Discards the audio, it's only pulled from the source when asked to. Used by the tests. */
+class NullAudioSink : public AudioSink
+{
+public:
+    bool start(QIODevice* source) override;
+    void stop() override;
+    bool isActive() const override { return mSource != nullptr; }
+    qint64 processedUSecs() const override { return mProcessedUSecs; }
+
+    /** Pulls the given amount of audio from the source, as an output device would
+     *  @return the bytes that were read */
+    QByteArray pull(qint64 usecs);
+
+private:
+    QIODevice* mSource = nullptr;
+    qint64 mProcessedUSecs = 0;
+};
+
+#endif // AUDIOSINK_H
@@ -0,0 +1,142 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "bitmaptransformbatch.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include "bitmapimage.h"
+
+namespace
+{
+    struct TransformQueue
+    {
+        QMutex mutex;
+        QWaitCondition transformed;
+        std::vector<std::unique_ptr<BitmapImage>> results;
+        std::vector<bool> done;
+        QAtomicInt canceled;
+    };
+
+    class TransformTask : public QRunnable
+    {
+    public:
+        TransformQueue* queue = nullptr;
+        int index = 0;
+        std::unique_ptr<BitmapImage> copy; // Made on the calling thread, the worker never sees the keyframe
+        QRect selection;
+        QTransform transform;
+        bool smoothTransform = false;
+
+        void run() override
+        {
+            std::unique_ptr<BitmapImage> result;
+            if (!queue->canceled.loadAcquire())
+            {
+                // The copy shares the pixels of the keyframe until it's painted on,
+                // or reads them from the file if the keyframe isn't loaded
+                result = std::move(copy);
+                result->loadFile();
+                result->setFileName("");
+                BitmapTransformBatch::apply(*result, selection, transform, smoothTransform);
+            }
+
+            QMutexLocker locker(&queue->mutex);
+            queue->results[index] = std::move(result);
+            queue->done[index] = true;
+            queue->transformed.wakeAll();
+        }
+    };
+}
+
+void BitmapTransformBatch::apply(BitmapImage& image, const QRect& selection, const QTransform& transform, bool smoothTransform)
+{
+    if (!selection.isEmpty())
+    {
+        image.transformSelection(selection, transform, smoothTransform);
+        return;
+    }
+
+    // Without a selection the whole keyframe is transformed,
+    // shifting it by whole pixels doesn't need any resampling
+    const QPointF shift(transform.dx(), transform.dy());
+    if (transform.type() <= QTransform::TxTranslate && shift == QPointF(shift.toPoint()))
+    {
+        image.moveTopLeft(image.topLeft() + shift.toPoint());
+    }
+    else if (!image.bounds().isEmpty())
+    {
+        image.transformSelection(image.bounds(), transform, smoothTransform);
+    }
+}
+
+BitmapTransformBatch::BitmapTransformBatch(const QRect& selection, const QTransform& transform, bool smoothTransform)
+    : mSelection(selection), mTransform(transform), mSmoothTransform(smoothTransform)
+{
+}
+
+BitmapTransformBatch::~BitmapTransformBatch()
+{
+    mThreadPool.waitForDone();
+}
+
+void BitmapTransformBatch::run(const std::vector<const BitmapImage*>& keyFrames, const Callback& onTransformed)
+{
+    const int count = static_cast<int>(keyFrames.size());
+
+    TransformQueue queue;
+    queue.results.resize(keyFrames.size());
+    queue.done.resize(keyFrames.size(), false);
+
+    // Enough to keep every worker busy while the caller takes the previous keyframes
+    const int window = qMax(2, mThreadPool.maxThreadCount() * 2);
+    int submitted = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (; submitted < count && submitted < i + window; submitted++)
+        {
+            TransformTask* task = new TransformTask;
+            task->queue = &queue;
+            task->index = submitted;
+            task->copy.reset(new BitmapImage(*keyFrames[submitted]));
+            task->selection = mSelection;
+            task->transform = mTransform;
+            task->smoothTransform = mSmoothTransform;
+            mThreadPool.start(task);
+        }
+
+        std::unique_ptr<BitmapImage> transformed;
+        {
+            QMutexLocker locker(&queue.mutex);
+            while (!queue.done[i])
+            {
+                queue.transformed.wait(&queue.mutex);
+            }
+            transformed = std::move(queue.results[i]);
+        }
+
+        if (!onTransformed(i, std::move(transformed)))
+        {
+            queue.canceled.storeRelease(1);
+            break;
+        }
+    }
+
+    // The queue lives on this stack frame, so the remaining tasks must finish before we return
+    mThreadPool.waitForDone();
+}
@@ -0,0 +1,66 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef BITMAPTRANSFORMBATCH_H
+#define BITMAPTRANSFORMBATCH_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QRect>
+#include <QThreadPool>
+#include <QTransform>
+
+class BitmapImage;
+
+/**
+ * BitmapTransformBatch applies one selection transform to many bitmap keyframes on a pool of worker threads.
+ *
+ * Every keyframe is transformed on a copy with BitmapImage::transformSelection(), the same as applying
+ * a transform interactively, so the keyframes themselves are left alone until the caller commits the copies.
+ * The copies are made on the calling thread, they share the pixels of the keyframes and keyframes which
+ * aren't loaded are read from their file by the worker. The copies are handed back in order
+ * and only a few keyframes are worked on ahead of the caller.
+ *
+ * Without a selection, each keyframe is transformed as a whole.
+ */
+class BitmapTransformBatch
+{
+public:
+    /** Called on the calling thread with the transformed copy of each keyframe in order.
+     *  @return false to stop transforming the remaining keyframes */
+    using Callback = std::function<bool(int index, std::unique_ptr<BitmapImage> transformed)>;
+
+    BitmapTransformBatch(const QRect& selection, const QTransform& transform, bool smoothTransform);
+    ~BitmapTransformBatch();
+
+    /** Transforms copies of the given keyframes and blocks until all of them have been handed
+     *  to the callback, or until the callback asked to stop.
+     *  The workers never read the keyframes, so the callback may process events which load, paint
+     *  or unload them. The keyframes must not be deleted until this returns. */
+    void run(const std::vector<const BitmapImage*>& keyFrames, const Callback& onTransformed);
+
+    /** Transforms the pixels of the image within the selection, or the whole image if the selection is empty */
+    static void apply(BitmapImage& image, const QRect& selection, const QTransform& transform, bool smoothTransform);
+
+private:
+    QRect mSelection;
+    QTransform mTransform;
+    bool mSmoothTransform = false;
+    QThreadPool mThreadPool;
+};
+
+#endif // BITMAPTRANSFORMBATCH_H
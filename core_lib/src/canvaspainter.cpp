@@ -22,11 +22,13 @@ GNU General Public License for more details.
 #include "layerbitmap.h"
 #include "layervector.h"
 #include "bitmapimage.h"
+#include "affinesampler.h"
 #include "tile.h"
 #include "tiledbuffer.h"
 #include "vectorimage.h"
 
 #include "painterutils.h"
+#include "profiler.h"
 
 CanvasPainter::CanvasPainter(QPixmap& canvas) : mCanvas(canvas)
 {
@@ -81,10 +83,16 @@ void CanvasPainter::setTransformedSelection(QRect selection, QTransform transfor
 void CanvasPainter::ignoreTransformedSelection()
 {
     mRenderTransform = false;
+
+    // The transform session is over, let go of its buffers
+    mLiftedSelection = QImage();
+    mTransformPreview = QImage();
 }
 
 void CanvasPainter::paintCached(const QRect& blitRect)
 {
+    PROFILE_SCOPE("CanvasPainter::paintCached");
+
     if (!mPreLayersPixmapCacheValid)
     {
         QPainter preLayerPainter;
@@ -172,6 +180,8 @@ void CanvasPainter::setPaintSettings(const Object* object, int currentLayer, int
 
 void CanvasPainter::paint(const QRect& blitRect)
 {
+    PROFILE_SCOPE("CanvasPainter::paint");
+
     QPainter preLayerPainter;
     QPainter mainPainter;
     QPainter postLayerPainter;
@@ -222,12 +232,45 @@ void CanvasPainter::paintOnionSkinOnLayer(QPainter& painter, const QRect& blitRe
     });
 }
 
+void CanvasPainter::prefetchVectorOnionSkin(QPainter& painter, Layer* layer)
+{
+    if (layer->type() != Layer::VECTOR) { return; }
+
+    LayerVector* vectorLayer = static_cast<LayerVector*>(layer);
+
+    // The sub painter sets the opacity of each onion skin frame, which isn't painted yet
+    painter.save();
+    mOnionSkinSubPainter.paint(painter, layer, mOnionSkinPainterOptions, mFrameNumber, [&] (OnionSkinPaintState state, int onionFrameNumber) {
+        if (state == OnionSkinPaintState::CURRENT) { return; }
+        mVectorRasterizer.prefetch(vectorLayer->getVectorImageAtFrame(onionFrameNumber), mOnionSkinRasterRequest);
+    });
+    painter.restore();
+}
+
 void CanvasPainter::paintOnionSkin(QPainter& painter, const QRect& blitRect)
 {
+    PROFILE_SCOPE("CanvasPainter::paintOnionSkin");
+
+    // Vector onion skins are rasterized at the resolution of the canvas pixmaps
+    mOnionSkinRasterRequest.transform = mViewTransform;
+    mOnionSkinRasterRequest.size = mOnionSkinPixmap.size();
+    mOnionSkinRasterRequest.devicePixelRatio = mOnionSkinPixmap.devicePixelRatioF();
+    mOnionSkinRasterRequest.palette = mObject->paletteColors();
+    mOnionSkinRasterRequest.simplified = mOptions.bOutlines;
+    mOnionSkinRasterRequest.showThinCurves = mOptions.bThinLines;
+    mOnionSkinRasterRequest.antialiasing = mOptions.bAntiAlias;
+
     if (!mOptions.bOnionSkinMultiLayer || mOptions.eLayerVisibility == LayerVisibility::CURRENTONLY) {
         Layer* layer = mObject->getLayer(mCurrentLayerIndex);
+        prefetchVectorOnionSkin(painter, layer);
         paintOnionSkinOnLayer(painter, blitRect, layer);
     } else {
+        for (int i = 0; i < mObject->getLayerCount(); i++) {
+            Layer* layer = mObject->getLayer(i);
+            if (layer == nullptr) { continue; }
+
+            prefetchVectorOnionSkin(painter, layer);
+        }
         for (int i = 0; i < mObject->getLayerCount(); i++) {
             Layer* layer = mObject->getLayer(i);
             if (layer == nullptr) { continue; }
@@ -261,10 +304,14 @@ void CanvasPainter::paintVectorOnionSkinFrame(QPainter& painter, const QRect& bl
     VectorImage* vectorImage = vectorLayer->getVectorImageAtFrame(nFrame);
     if (vectorImage == nullptr) { return; }
 
+    // Rendered on the workers of the rasterizer, or taken from its cache
+    const QImage image = mVectorRasterizer.rasterize(vectorImage, mOnionSkinRasterRequest);
+
     QPainter onionSkinPainter;
     initializePainter(onionSkinPainter, mOnionSkinPixmap, blitRect);
 
-    vectorImage->paintImage(onionSkinPainter, *mObject, mOptions.bOutlines, mOptions.bThinLines, mOptions.bAntiAlias);
+    onionSkinPainter.setWorldMatrixEnabled(false);
+    onionSkinPainter.drawImage(mPointZero, image);
     paintOnionSkinFrame(painter, onionSkinPainter, nFrame, colorize, vectorImage->getOpacity());
 }
 
@@ -297,6 +344,8 @@ void CanvasPainter::paintOnionSkinFrame(QPainter& painter, QPainter& onionSkinPa
 
 void CanvasPainter::paintCurrentBitmapFrame(QPainter& painter, const QRect& blitRect, Layer* layer, bool isCurrentLayer)
 {
+    PROFILE_SCOPE("CanvasPainter::paintCurrentBitmapFrame");
+
     LayerBitmap* bitmapLayer = static_cast<LayerBitmap*>(layer);
     BitmapImage* paintedImage = bitmapLayer->getLastBitmapImageAtFrame(mFrameNumber);
 
@@ -325,7 +374,7 @@ void CanvasPainter::paintCurrentBitmapFrame(QPainter& painter, const QRect& blit
     // We do not wish to draw selection transformations on anything but the current layer
     Q_ASSERT(!isDrawing || mSelectionTransform.isIdentity());
     if (isCurrentLayer && mRenderTransform && !isDrawing) {
-        paintTransformedSelection(currentBitmapPainter, paintedImage, mSelection);
+        paintTransformedSelection(currentBitmapPainter, paintedImage, mSelection, blitRect);
     }
 
     painter.drawPixmap(mPointZero, mCurrentLayerPixmap);
@@ -333,6 +382,8 @@ void CanvasPainter::paintCurrentBitmapFrame(QPainter& painter, const QRect& blit
 
 void CanvasPainter::paintCurrentVectorFrame(QPainter& painter, const QRect& blitRect, Layer* layer, bool isCurrentLayer)
 {
+    PROFILE_SCOPE("CanvasPainter::paintCurrentVectorFrame");
+
     LayerVector* vectorLayer = static_cast<LayerVector*>(layer);
     VectorImage* vectorImage = vectorLayer->getLastVectorImageAtFrame(mFrameNumber, 0);
     if (vectorImage == nullptr)
@@ -370,19 +421,15 @@ void CanvasPainter::paintCurrentVectorFrame(QPainter& painter, const QRect& blit
     painter.drawPixmap(mPointZero, mCurrentLayerPixmap);
 }
 
-void CanvasPainter::paintTransformedSelection(QPainter& painter, BitmapImage* bitmapImage, const QRect& selection) const
+void CanvasPainter::paintTransformedSelection(QPainter& painter, BitmapImage* bitmapImage, const QRect& selection, const QRect& blitRect)
 {
+    PROFILE_SCOPE("CanvasPainter::paintTransformedSelection");
+
     // Make sure there is something selected
     if (selection.width() == 0 && selection.height() == 0)
         return;
 
-    QPixmap transformedPixmap = QPixmap(mSelection.size());
-    transformedPixmap.fill(Qt::transparent);
-
-    QPainter imagePainter(&transformedPixmap);
-    imagePainter.translate(-selection.topLeft());
-    imagePainter.drawImage(bitmapImage->topLeft(), *bitmapImage->image());
-    imagePainter.end();
+    liftSelection(bitmapImage, selection);
 
     painter.save();
 
@@ -398,11 +445,58 @@ void CanvasPainter::paintTransformedSelection(QPainter& painter, BitmapImage* bi
     // Now the image origin will be topleft
     painter.setTransform(mSelectionTransform*mViewTransform);
 
-    // Draw the selection image separately and on top
-    painter.drawPixmap(selection, transformedPixmap);
+    // Sample the lifted pixels straight onto the device pixels that need repainting
+    const QTransform toDevice = QTransform::fromTranslate(selection.left(), selection.top()) * painter.deviceTransform();
+    const qreal dpr = painter.device()->devicePixelRatioF();
+    const QRect deviceBlitRect = QRectF(QPointF(blitRect.topLeft()) * dpr, QSizeF(blitRect.size()) * dpr).toAlignedRect();
+    const QRect deviceRect = toDevice.mapRect(QRectF(mLiftedSelection.rect())).toAlignedRect() & deviceBlitRect;
+
+    if (deviceRect.isEmpty())
+    {
+        painter.restore();
+        return;
+    }
+
+    if (mTransformPreview.size() != deviceRect.size())
+    {
+        mTransformPreview = QImage(deviceRect.size(), QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const AffineSampler::Filter filter = mOptions.bAntiAlias ? AffineSampler::Filter::Bilinear : AffineSampler::Filter::Nearest;
+    if (AffineSampler::sample(mLiftedSelection, toDevice, mTransformPreview, deviceRect.topLeft(), filter))
+    {
+        // Undo the device pixel ratio, so the preview lands on the device pixels 1:1
+        painter.setTransform(QTransform::fromScale(1 / dpr, 1 / dpr));
+        painter.drawImage(deviceRect.topLeft(), mTransformPreview);
+    }
+    else
+    {
+        // Draw the selection image separately and on top
+        painter.drawImage(selection, mLiftedSelection);
+    }
     painter.restore();
 }
 
+void CanvasPainter::liftSelection(BitmapImage* bitmapImage, const QRect& selection)
+{
+    const qint64 imageKey = bitmapImage->image()->cacheKey();
+    if (!mLiftedSelection.isNull() && mLiftedImageKey == imageKey &&
+        mLiftedRect == selection && mLiftedImageTopLeft == bitmapImage->topLeft())
+    {
+        return;
+    }
+
+    // Pixels outside of the image are transparent in the copy
+    mLiftedSelection = bitmapImage->image()->copy(selection.translated(-bitmapImage->topLeft()));
+    if (mLiftedSelection.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        mLiftedSelection = mLiftedSelection.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    mLiftedImageKey = imageKey;
+    mLiftedRect = selection;
+    mLiftedImageTopLeft = bitmapImage->topLeft();
+}
+
 /** Paints layers within the specified range for the current frame.
  *
  *  @param painter The painter to paint to
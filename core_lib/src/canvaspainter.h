@@ -29,6 +29,7 @@ GNU General Public License for more details.
 
 #include "onionskinpainteroptions.h"
 #include "onionskinsubpainter.h"
+#include "vectorrasterizer.h"
 
 
 class TiledBuffer;
@@ -82,6 +83,8 @@ private:
     void initializePainter(QPainter& painter, QPaintDevice& device, const QRect& blitRect);
 
     void paintOnionSkinOnLayer(QPainter& painter, const QRect& blitRect, Layer* layer);
+    /** Hands the vector onion skin frames of the layer to the rasterizer, so they're rendered side by side */
+    void prefetchVectorOnionSkin(QPainter& painter, Layer* layer);
     void paintOnionSkin(QPainter& painter, const QRect& blitRect);
 
     void renderPostLayers(QPainter& painter, const QRect& blitRect);
@@ -89,7 +92,10 @@ private:
 
     void paintCurrentFrame(QPainter& painter, const QRect& blitRect, int startLayer, int endLayer);
 
-    void paintTransformedSelection(QPainter& painter, BitmapImage* bitmapImage, const QRect& selection) const;
+    void paintTransformedSelection(QPainter& painter, BitmapImage* bitmapImage, const QRect& selection, const QRect& blitRect);
+
+    /** Copies the selected pixels out of the image, unless they are cached already */
+    void liftSelection(BitmapImage* bitmapImage, const QRect& selection);
 
     void paintBitmapOnionSkinFrame(QPainter& painter, const QRect& blitRect, Layer* layer, int nFrame, bool colorize);
     void paintVectorOnionSkinFrame(QPainter& painter, const QRect& blitRect, Layer* layer, int nFrame, bool colorize);
@@ -116,6 +122,13 @@ private:
     QRect mSelection;
     QTransform mSelectionTransform;
 
+    // The selected pixels are lifted out of the image once per transform session
+    QImage mLiftedSelection;
+    qint64 mLiftedImageKey = 0;
+    QRect mLiftedRect;
+    QPoint mLiftedImageTopLeft;
+    QImage mTransformPreview;
+
     // Caches specifically for when drawing on the canvas
     QPixmap mPostLayersPixmap;
     QPixmap mPreLayersPixmap;
@@ -132,6 +145,9 @@ private:
     OnionSkinSubPainter mOnionSkinSubPainter;
     OnionSkinPainterOptions mOnionSkinPainterOptions;
 
+    VectorRasterizer mVectorRasterizer;
+    VectorRasterizer::Request mOnionSkinRasterRequest;
+
     const static int OVERLAY_SAFE_CENTER_CROSS_SIZE = 25;
 };
 
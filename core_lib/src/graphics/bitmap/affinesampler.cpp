@@ -0,0 +1,179 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "affinesampler.h"
+
+#include <algorithm>
+#include <QImage>
+#include <QTransform>
+#include <QtMath>
+
+namespace
+{
+    const int FIXED_SHIFT = 16;
+    const qreal FIXED_ONE = 1 << FIXED_SHIFT;
+
+    inline qint64 toFixed(qreal value)
+    {
+        return qRound64(value * FIXED_ONE);
+    }
+
+    /** Blends two premultiplied pixels, two channels at a time. t goes from 0 (only a) to 256 (only b) */
+    inline quint32 interpolate(quint32 a, quint32 b, quint32 t)
+    {
+        const quint32 rb = (((a & 0xff00ff) * (256 - t) + (b & 0xff00ff) * t) >> 8) & 0xff00ff;
+        const quint32 ag = (((a >> 8) & 0xff00ff) * (256 - t) + ((b >> 8) & 0xff00ff) * t) & 0xff00ff00;
+        return rb | ag;
+    }
+
+    /** Narrows [x0, x1) to the pixels at which start + x * step lies within [low, high) */
+    void clipSpan(qreal start, qreal step, qreal low, qreal high, int& x0, int& x1)
+    {
+        if (qFuzzyIsNull(step))
+        {
+            if (start < low || start >= high) { x1 = x0; }
+            return;
+        }
+
+        qreal first = (low - start) / step;
+        qreal last = (high - start) / step;
+        if (step < 0) { std::swap(first, last); }
+
+        x0 = qMax(x0, qCeil(qBound(qreal(x0), first, qreal(x1))));
+        x1 = qMin(x1, qCeil(qBound(qreal(x0), last, qreal(x1))));
+    }
+
+    struct Source
+    {
+        explicit Source(const QImage& image)
+            : bits(image.constBits()), bytesPerLine(image.bytesPerLine()), width(image.width()), height(image.height()) {}
+
+        const quint32* line(int y) const { return reinterpret_cast<const quint32*>(bits + y * bytesPerLine); }
+
+        quint32 pixelOrTransparent(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= width || y >= height) { return 0; }
+            return line(y)[x];
+        }
+
+        const uchar* bits;
+        qint64 bytesPerLine;
+        int width;
+        int height;
+    };
+
+    void sampleNearest(const Source& source, qint64 u, qint64 v, qint64 du, qint64 dv, quint32* target, int count)
+    {
+        for (int x = 0; x < count; ++x)
+        {
+            // The span is clipped to the source already, clamping only guards against rounding at its ends
+            const int sx = qBound(0, static_cast<int>(u >> FIXED_SHIFT), source.width - 1);
+            const int sy = qBound(0, static_cast<int>(v >> FIXED_SHIFT), source.height - 1);
+            target[x] = source.line(sy)[sx];
+            u += du;
+            v += dv;
+        }
+    }
+
+    void sampleBilinear(const Source& source, qint64 u, qint64 v, qint64 du, qint64 dv, quint32* target, int count)
+    {
+        // Biased by one pixel, so that the coordinates stay positive along the edges
+        const qint64 bias = qint64(1) << FIXED_SHIFT;
+        u += bias;
+        v += bias;
+        for (int x = 0; x < count; ++x)
+        {
+            const int sx = static_cast<int>(u >> FIXED_SHIFT) - 1;
+            const int sy = static_cast<int>(v >> FIXED_SHIFT) - 1;
+            const quint32 fx = static_cast<quint32>(u >> (FIXED_SHIFT - 8)) & 0xff;
+            const quint32 fy = static_cast<quint32>(v >> (FIXED_SHIFT - 8)) & 0xff;
+
+            quint32 top;
+            quint32 bottom;
+            if (sx >= 0 && sy >= 0 && sx + 1 < source.width && sy + 1 < source.height)
+            {
+                const quint32* line = source.line(sy);
+                const quint32* nextLine = source.line(sy + 1);
+                top = interpolate(line[sx], line[sx + 1], fx);
+                bottom = interpolate(nextLine[sx], nextLine[sx + 1], fx);
+            }
+            else
+            {
+                top = interpolate(source.pixelOrTransparent(sx, sy), source.pixelOrTransparent(sx + 1, sy), fx);
+                bottom = interpolate(source.pixelOrTransparent(sx, sy + 1), source.pixelOrTransparent(sx + 1, sy + 1), fx);
+            }
+            target[x] = interpolate(top, bottom, fy);
+            u += du;
+            v += dv;
+        }
+    }
+}
+
+bool AffineSampler::sample(const QImage& source, const QTransform& transform, QImage& target, const QPoint& targetOffset, Filter filter)
+{
+    Q_ASSERT(source.format() == QImage::Format_ARGB32_Premultiplied);
+    Q_ASSERT(target.format() == QImage::Format_ARGB32_Premultiplied);
+
+    bool invertible = false;
+    const QTransform inverse = transform.inverted(&invertible);
+    if (!invertible || !transform.isAffine() || source.isNull() || target.isNull()) { return false; }
+
+    const Source src(source);
+    const bool bilinear = (filter == Filter::Bilinear);
+
+    // Bilinear sampling looks at the four pixels around a pixel center,
+    // so it reaches half a pixel further, fading out over the edges
+    const qreal centerOffset = bilinear ? 0.5 : 0.0;
+    const qreal lowLimit = bilinear ? -1.0 : 0.0;
+
+    // Moving one pixel to the right in the target moves by (du, dv) in the source
+    const qreal du = inverse.m11();
+    const qreal dv = inverse.m12();
+
+    for (int y = 0; y < target.height(); ++y)
+    {
+        quint32* line = reinterpret_cast<quint32*>(target.scanLine(y));
+
+        const QPointF start = inverse.map(QPointF(targetOffset.x() + 0.5, targetOffset.y() + y + 0.5));
+        const qreal u = start.x() - centerOffset;
+        const qreal v = start.y() - centerOffset;
+
+        int x0 = 0;
+        int x1 = target.width();
+        clipSpan(u, du, lowLimit, src.width, x0, x1);
+        clipSpan(v, dv, lowLimit, src.height, x0, x1);
+        if (x1 <= x0)
+        {
+            std::fill(line, line + target.width(), 0u);
+            continue;
+        }
+
+        std::fill(line, line + x0, 0u);
+        std::fill(line + x1, line + target.width(), 0u);
+
+        const qint64 fu = toFixed(u + x0 * du);
+        const qint64 fv = toFixed(v + x0 * dv);
+        if (bilinear)
+        {
+            sampleBilinear(src, fu, fv, toFixed(du), toFixed(dv), line + x0, x1 - x0);
+        }
+        else
+        {
+            sampleNearest(src, fu, fv, toFixed(du), toFixed(dv), line + x0, x1 - x0);
+        }
+    }
+    return true;
+}
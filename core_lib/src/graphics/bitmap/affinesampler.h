@@ -0,0 +1,44 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef AFFINESAMPLER_H
+#define AFFINESAMPLER_H
+
+class QImage;
+class QPoint;
+class QTransform;
+
+/**
+ * Resamples an image through an affine transform, for previewing transformations interactively.
+ *
+ * Every target pixel is mapped back onto the source and the source is walked along each row
+ * in fixed point steps, so the cost depends on the size of the target rather than the source.
+ * Target pixels outside of the transformed source are cleared.
+ * Both images must be in ARGB32_Premultiplied format.
+ */
+class AffineSampler
+{
+public:
+    enum class Filter { Nearest, Bilinear };
+
+    /** Fills the target with the transformed source
+     *  @param transform Maps source pixels to target pixels, must be affine and invertible
+     *  @param targetOffset Where the target's top left pixel lies in the coordinate space of the transform
+     *  @return false if the transform can't be sampled, leaving the target untouched */
+    static bool sample(const QImage& source, const QTransform& transform, QImage& target, const QPoint& targetOffset, Filter filter);
+};
+
+#endif // AFFINESAMPLER_H
@@ -26,6 +26,7 @@ GNU General Public License for more details.
 #include "blitrect.h"
 #include "tile.h"
 #include "tiledbuffer.h"
+#include "profiler.h"
 
 BitmapImage::BitmapImage()
 {
@@ -193,6 +194,8 @@ BitmapImage BitmapImage::copy(QRect rectangle)
 
 void BitmapImage::paste(BitmapImage* bitmapImage, QPainter::CompositionMode cm)
 {
+    PROFILE_SCOPE("BitmapImage::paste");
+
     if(bitmapImage->width() <= 0 || bitmapImage->height() <= 0)
     {
         return;
@@ -212,6 +215,8 @@ void BitmapImage::paste(BitmapImage* bitmapImage, QPainter::CompositionMode cm)
 
 void BitmapImage::paste(const TiledBuffer* tiledBuffer, QPainter::CompositionMode cm)
 {
+    PROFILE_SCOPE("BitmapImage::paste");
+
     if(tiledBuffer->bounds().width() <= 0 || tiledBuffer->bounds().height() <= 0)
     {
         return;
@@ -276,6 +281,13 @@ BitmapImage BitmapImage::transformed(QRect selection, QTransform transform, bool
     return BitmapImage(transform.mapRect(selection).normalized().topLeft(), transformedImage);
 }
 
+void BitmapImage::transformSelection(QRect selection, QTransform transform, bool smoothTransform)
+{
+    BitmapImage transformedImage = transformed(selection, transform, smoothTransform);
+    clear(selection);
+    paste(&transformedImage, QPainter::CompositionMode_SourceOver);
+}
+
 BitmapImage BitmapImage::transformed(QRect newBoundaries, bool smoothTransform)
 {
     BitmapImage transformedImage(newBoundaries, QColor(0, 0, 0, 0));
@@ -438,6 +450,8 @@ void BitmapImage::autoCrop()
     // Exit if already min bounded
     if (mMinBound) return;
 
+    PROFILE_SCOPE("BitmapImage::autoCrop");
+
     // Get image properties
     const int width = mImage.width();
 
@@ -893,6 +907,8 @@ bool BitmapImage::floodFill(BitmapImage** replaceImage,
                             int tolerance,
                             const int expandValue)
 {
+    PROFILE_SCOPE("BitmapImage::floodFill");
+
     // Fill region must be 1 pixel larger than the target image to fill regions on the edge connected only by transparent pixels
     const QRect& fillBounds = targetImage->mBounds.adjusted(-1, -1, 1, 1);
     QRect maxBounds = cameraRect.united(fillBounds).adjusted(-expandValue, -expandValue, expandValue, expandValue);
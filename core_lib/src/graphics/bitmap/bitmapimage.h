@@ -66,6 +66,8 @@ public:
     BitmapImage transformed(QRect selection, QTransform transform, bool smoothTransform);
     BitmapImage transformed(QRect rectangle, bool smoothTransform);
     BitmapImage transformed(QRectF rectangle, bool smoothTransform) { return transformed(rectangle.toRect(), smoothTransform); }
+    /** Moves the pixels within the selection through the transform, leaving the rest of the image as is */
+    void transformSelection(QRect selection, QTransform transform, bool smoothTransform);
 
     bool contains(QPoint P) { return mBounds.contains(P); }
     bool contains(QPointF P) { return contains(P.toPoint()); }
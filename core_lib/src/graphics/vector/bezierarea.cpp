@@ -19,8 +19,9 @@ GNU General Public License for more details.
 #include "bezierarea.h"
 #include "pencilerror.h"
 
+#include <QDataStream>
 #include <QXmlStreamWriter>
-#include <QDomElement>
+#include <QXmlStreamReader>
 
 BezierArea::BezierArea()
 {
@@ -87,21 +88,49 @@ Status BezierArea::createDomElement( QXmlStreamWriter& xmlStream )
     return Status::OK;
 }
 
-void BezierArea::loadDomElement(const QDomElement& element)
+void BezierArea::loadDomElement(QXmlStreamReader& xmlStream)
 {
-    mColorNumber = element.attribute("colourNumber").toInt();
+    mColorNumber = xmlStream.attributes().value("colourNumber").toInt();
 
-    QDomNode vertexTag = element.firstChild();
-    while (!vertexTag.isNull())
+    while (xmlStream.readNextStartElement())
     {
-        QDomElement vertexElement = vertexTag.toElement();
-        if (!vertexElement.isNull())
+        if (xmlStream.name() == QLatin1String("vertex"))
         {
-            if (vertexElement.tagName() == "vertex")
-            {
-                mVertex.append( VertexRef(vertexElement.attribute("curve").toInt() , vertexElement.attribute("vertex").toInt() )  );
-            }
+            const QXmlStreamAttributes vertex = xmlStream.attributes();
+            mVertex.append( VertexRef(vertex.value("curve").toInt() , vertex.value("vertex").toInt() )  );
         }
-        vertexTag = vertexTag.nextSibling();
+        xmlStream.skipCurrentElement();
     }
 }
+
+void BezierArea::writeBinary(QDataStream& out) const
+{
+    out << qint32(mColorNumber) << quint8(mIsFilled) << quint32(mVertex.size());
+    for (const VertexRef& v : mVertex)
+    {
+        out << qint32(v.curveNumber) << qint32(v.vertexNumber);
+    }
+}
+
+bool BezierArea::readBinary(QDataStream& in)
+{
+    qint32 color = 0;
+    quint8 filled = 0;
+    quint32 vertexCount = 0;
+    in >> color >> filled >> vertexCount;
+    if (in.status() != QDataStream::Ok || vertexCount > quint32(in.device()->bytesAvailable() / 8))
+    {
+        return false;
+    }
+
+    mColorNumber = color;
+    mIsFilled = filled != 0;
+    mVertex.reserve(vertexCount);
+    for (quint32 i = 0; i < vertexCount; i++)
+    {
+        qint32 curve, vertex;
+        in >> curve >> vertex;
+        mVertex.append(VertexRef(curve, vertex));
+    }
+    return in.status() == QDataStream::Ok;
+}
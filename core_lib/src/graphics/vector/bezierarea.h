@@ -24,7 +24,8 @@ GNU General Public License for more details.
 
 class Status;
 class QXmlStreamWriter;
-class QDomElement;
+class QXmlStreamReader;
+class QDataStream;
 
 
 class BezierArea
@@ -34,7 +35,9 @@ public:
     BezierArea(QList<VertexRef> vertexList, int color);
 
     Status createDomElement(QXmlStreamWriter& xmlStream);
-    void loadDomElement(const QDomElement& element);
+    void loadDomElement(QXmlStreamReader& xmlStream);
+    void writeBinary(QDataStream& out) const;
+    bool readBinary(QDataStream& in);
 
     VertexRef getVertexRef(int i);
     int getColorNumber() { return mColorNumber; }
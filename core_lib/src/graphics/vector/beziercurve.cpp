@@ -17,15 +17,317 @@ GNU General Public License for more details.
 
 #include "beziercurve.h"
 
+#include <algorithm>
 #include <cmath>
 #include <QList>
+#include <QDataStream>
 #include <QXmlStreamWriter>
-#include <QDomElement>
+#include <QXmlStreamReader>
 #include <QDebug>
 #include <QPainterPath>
-#include "object.h"
+#include "pencildef.h"
 #include "pencilerror.h"
 
+namespace
+{
+    // Widens [low, high] to the extremes of one coordinate of a cubic, found where its derivative is zero
+    void cubicExtremes(qreal p0, qreal p1, qreal p2, qreal p3, qreal& low, qreal& high)
+    {
+        low = qMin(low, qMin(p0, p3));
+        high = qMax(high, qMax(p0, p3));
+
+        auto consider = [&](qreal t)
+        {
+            if (t <= 0 || t >= 1) { return; }
+            const qreal mt = 1 - t;
+            const qreal v = mt * mt * mt * p0 + 3 * mt * mt * t * p1 + 3 * mt * t * t * p2 + t * t * t * p3;
+            low = qMin(low, v);
+            high = qMax(high, v);
+        };
+
+        const qreal a = -p0 + 3 * p1 - 3 * p2 + p3;
+        const qreal b = 2 * (p0 - 2 * p1 + p2);
+        const qreal c = p1 - p0;
+        if (qFuzzyIsNull(a))
+        {
+            if (!qFuzzyIsNull(b)) { consider(-c / b); }
+            return;
+        }
+        const qreal discriminant = b * b - 4 * a * c;
+        if (discriminant >= 0)
+        {
+            const qreal root = std::sqrt(discriminant);
+            consider((-b + root) / (2 * a));
+            consider((-b - root) / (2 * a));
+        }
+    }
+    // A piece of a cubic section, with the parameter range it covers in the whole section
+    struct CubicPiece
+    {
+        QPointF p0, p1, p2, p3;
+        qreal t0;
+        qreal t1;
+
+        QPointF pointAt(qreal t) const
+        {
+            const qreal mt = 1 - t;
+            return mt * mt * mt * p0 + 3 * mt * mt * t * p1 + 3 * mt * t * t * p2 + t * t * t * p3;
+        }
+
+        QPointF tangentAt(qreal t) const
+        {
+            const qreal mt = 1 - t;
+            return 3 * mt * mt * (p1 - p0) + 6 * mt * t * (p2 - p1) + 3 * t * t * (p3 - p2);
+        }
+
+        // de Casteljau at the middle of the piece
+        void split(CubicPiece& first, CubicPiece& second) const
+        {
+            const QPointF p01 = (p0 + p1) / 2;
+            const QPointF p12 = (p1 + p2) / 2;
+            const QPointF p23 = (p2 + p3) / 2;
+            const QPointF p012 = (p01 + p12) / 2;
+            const QPointF p123 = (p12 + p23) / 2;
+            const QPointF middle = (p012 + p123) / 2;
+            const qreal tMiddle = (t0 + t1) / 2;
+            first = { p0, p01, p012, middle, t0, tMiddle };
+            second = { middle, p123, p23, p3, tMiddle, t1 };
+        }
+
+        QRectF bounds() const
+        {
+            const qreal left = qMin(qMin(p0.x(), p1.x()), qMin(p2.x(), p3.x()));
+            const qreal right = qMax(qMax(p0.x(), p1.x()), qMax(p2.x(), p3.x()));
+            const qreal top = qMin(qMin(p0.y(), p1.y()), qMin(p2.y(), p3.y()));
+            const qreal bottom = qMax(qMax(p0.y(), p1.y()), qMax(p2.y(), p3.y()));
+            return QRectF(QPointF(left, top), QPointF(right, bottom));
+        }
+
+        // The control points contain the piece, so their box does too
+        bool boxOverlaps(const CubicPiece& other) const
+        {
+            const qreal left = qMin(qMin(p0.x(), p1.x()), qMin(p2.x(), p3.x()));
+            const qreal right = qMax(qMax(p0.x(), p1.x()), qMax(p2.x(), p3.x()));
+            const qreal top = qMin(qMin(p0.y(), p1.y()), qMin(p2.y(), p3.y()));
+            const qreal bottom = qMax(qMax(p0.y(), p1.y()), qMax(p2.y(), p3.y()));
+            const qreal otherLeft = qMin(qMin(other.p0.x(), other.p1.x()), qMin(other.p2.x(), other.p3.x()));
+            const qreal otherRight = qMax(qMax(other.p0.x(), other.p1.x()), qMax(other.p2.x(), other.p3.x()));
+            const qreal otherTop = qMin(qMin(other.p0.y(), other.p1.y()), qMin(other.p2.y(), other.p3.y()));
+            const qreal otherBottom = qMax(qMax(other.p0.y(), other.p1.y()), qMax(other.p2.y(), other.p3.y()));
+            // Inclusive, so that horizontal and vertical pieces still overlap
+            return left <= otherRight && otherLeft <= right && top <= otherBottom && otherTop <= bottom;
+        }
+
+        // True when both control points lie within tolerance of the chord
+        bool isFlat(qreal tolerance) const
+        {
+            const QPointF chord = p3 - p0;
+            const qreal length = std::hypot(chord.x(), chord.y());
+            if (length < tolerance)
+            {
+                return std::hypot(p1.x() - p0.x(), p1.y() - p0.y()) < tolerance
+                    && std::hypot(p2.x() - p0.x(), p2.y() - p0.y()) < tolerance;
+            }
+            const qreal d1 = std::abs(chord.x() * (p1.y() - p0.y()) - chord.y() * (p1.x() - p0.x())) / length;
+            const qreal d2 = std::abs(chord.x() * (p2.y() - p0.y()) - chord.y() * (p2.x() - p0.x())) / length;
+            return d1 < tolerance && d2 < tolerance;
+        }
+    };
+
+    const qreal kFlatnessTolerance = 1e-3;
+    const qreal kMergeDistance = 1e-2;
+    const int kMaxSubdivision = 32;
+
+    // Intersects the chords of two flat pieces, giving the parameters along each chord
+    bool chordIntersection(const CubicPiece& a, const CubicPiece& b, qreal& u, qreal& v)
+    {
+        const QPointF r = a.p3 - a.p0;
+        const QPointF s = b.p3 - b.p0;
+        const qreal denominator = r.x() * s.y() - r.y() * s.x();
+        if (qFuzzyIsNull(denominator)) { return false; } // parallel or degenerate chords
+        const QPointF offset = b.p0 - a.p0;
+        u = (offset.x() * s.y() - offset.y() * s.x()) / denominator;
+        v = (offset.x() * r.y() - offset.y() * r.x()) / denominator;
+        const qreal slack = 1e-9;
+        return u >= -slack && u <= 1 + slack && v >= -slack && v <= 1 + slack;
+    }
+
+    // Newton iterations on A(t1) - B(t2) = 0, starting from the chord estimate
+    void refineIntersection(const CubicPiece& a, const CubicPiece& b, qreal& t1, qreal& t2)
+    {
+        QPointF difference = a.pointAt(t1) - b.pointAt(t2);
+        for (int i = 0; i < 4; i++)
+        {
+            const QPointF da = a.tangentAt(t1);
+            const QPointF db = b.tangentAt(t2);
+            const qreal determinant = -da.x() * db.y() + da.y() * db.x();
+            if (qFuzzyIsNull(determinant)) { return; }
+            const qreal nextT1 = t1 - (-difference.x() * db.y() + difference.y() * db.x()) / determinant;
+            const qreal nextT2 = t2 - (da.x() * difference.y() - da.y() * difference.x()) / determinant;
+            if (nextT1 < 0 || nextT1 > 1 || nextT2 < 0 || nextT2 > 1) { return; }
+            const QPointF nextDifference = a.pointAt(nextT1) - b.pointAt(nextT2);
+            if (std::hypot(nextDifference.x(), nextDifference.y()) >= std::hypot(difference.x(), difference.y())) { return; }
+            t1 = nextT1;
+            t2 = nextT2;
+            difference = nextDifference;
+        }
+    }
+
+    // Recursive subdivision, discarding pairs of pieces whose control boxes are apart
+    void intersectPieces(const CubicPiece& a, const CubicPiece& b, int depth, QList<Intersection>& intersections)
+    {
+        if (!a.boxOverlaps(b)) { return; }
+
+        const bool aFlat = a.isFlat(kFlatnessTolerance);
+        const bool bFlat = b.isFlat(kFlatnessTolerance);
+        if ((aFlat && bFlat) || depth >= kMaxSubdivision)
+        {
+            qreal u = 0;
+            qreal v = 0;
+            if (chordIntersection(a, b, u, v))
+            {
+                Intersection intersection;
+                intersection.t1 = a.t0 + qBound(0.0, u, 1.0) * (a.t1 - a.t0);
+                intersection.t2 = b.t0 + qBound(0.0, v, 1.0) * (b.t1 - b.t0);
+                intersections.append(intersection);
+            }
+            return;
+        }
+
+        CubicPiece a1, a2, b1, b2;
+        if (aFlat)
+        {
+            b.split(b1, b2);
+            intersectPieces(a, b1, depth + 1, intersections);
+            intersectPieces(a, b2, depth + 1, intersections);
+        }
+        else if (bFlat)
+        {
+            a.split(a1, a2);
+            intersectPieces(a1, b, depth + 1, intersections);
+            intersectPieces(a2, b, depth + 1, intersections);
+        }
+        else
+        {
+            a.split(a1, a2);
+            b.split(b1, b2);
+            intersectPieces(a1, b1, depth + 1, intersections);
+            intersectPieces(a1, b2, depth + 1, intersections);
+            intersectPieces(a2, b1, depth + 1, intersections);
+            intersectPieces(a2, b2, depth + 1, intersections);
+        }
+    }
+    const qreal kStrokeTolerance = 0.05;
+    const int kMinStrokeSubdivision = 1;
+    const int kMaxStrokeSubdivision = 8;
+
+    // A point of the centre line, with the unit normal and the distance to the outline there
+    struct StrokeSample
+    {
+        QPointF point;
+        QPointF normal;
+        qreal offset;
+        bool join; // first sample of a section that follows another one
+    };
+
+    StrokeSample strokeSample(const CubicPiece& cubic, qreal offset0, qreal offset1, qreal t)
+    {
+        QPointF tangent = cubic.tangentAt(t);
+        // a control point on top of its vertex cancels the derivative there
+        if (std::hypot(tangent.x(), tangent.y()) < 1e-9) { tangent = (t < 0.5) ? cubic.p2 - cubic.p0 : cubic.p3 - cubic.p1; }
+        if (std::hypot(tangent.x(), tangent.y()) < 1e-9) { tangent = cubic.p3 - cubic.p0; }
+        const qreal length = std::hypot(tangent.x(), tangent.y());
+
+        StrokeSample sample;
+        sample.point = cubic.pointAt(t);
+        sample.normal = (length < 1e-9) ? QPointF(0, 1) : QPointF(-tangent.y(), tangent.x()) / length;
+        sample.offset = (1 - t) * offset0 + t * offset1;
+        sample.join = false;
+        return sample;
+    }
+
+    // Appends the samples after t0 up to t1, until both sides of the outline are within tolerance of their chords
+    void sampleSection(const CubicPiece& cubic, qreal offset0, qreal offset1, qreal t0, qreal t1, int depth, QVector<StrokeSample>& samples)
+    {
+        const qreal tMiddle = (t0 + t1) / 2;
+        const StrokeSample begin = samples.last();
+        const StrokeSample middle = strokeSample(cubic, offset0, offset1, tMiddle);
+        const StrokeSample end = strokeSample(cubic, offset0, offset1, t1);
+
+        qreal error = 0;
+        for (qreal side : { -1.0, 0.0, 1.0 })
+        {
+            const QPointF chordMiddle = (begin.point + side * begin.offset * begin.normal + end.point + side * end.offset * end.normal) / 2;
+            const QPointF difference = middle.point + side * middle.offset * middle.normal - chordMiddle;
+            error = qMax(error, std::hypot(difference.x(), difference.y()));
+        }
+
+        if (depth < kMinStrokeSubdivision || (error > kStrokeTolerance && depth < kMaxStrokeSubdivision))
+        {
+            sampleSection(cubic, offset0, offset1, t0, tMiddle, depth + 1, samples);
+            sampleSection(cubic, offset0, offset1, tMiddle, t1, depth + 1, samples);
+        }
+        else
+        {
+            samples.append(end);
+        }
+    }
+
+    // Adds an arc around centre starting in the unit direction from, finer as the radius grows
+    void appendArc(QPainterPath& path, const QPointF& centre, qreal radius, const QPointF& from, qreal sweep)
+    {
+        int steps = 1;
+        if (radius > kStrokeTolerance)
+        {
+            const qreal maxStep = 2 * std::acos(1 - kStrokeTolerance / radius);
+            steps = qBound(1, static_cast<int>(std::ceil(std::abs(sweep) / maxStep)), 64);
+        }
+        const qreal startAngle = std::atan2(from.y(), from.x());
+        for (int k = 1; k <= steps; k++)
+        {
+            const qreal angle = startAngle + sweep * k / steps;
+            path.lineTo(centre + radius * QPointF(std::cos(angle), std::sin(angle)));
+        }
+    }
+
+    qreal turnAngle(const QPointF& from, const QPointF& to)
+    {
+        return std::atan2(from.x() * to.y() - from.y() * to.x(), from.x() * to.x() + from.y() * to.y());
+    }
+
+    qreal distanceToChord(const CubicPiece& cubic, const QPointF& point)
+    {
+        const QPointF chord = cubic.p3 - cubic.p0;
+        const qreal lengthSquared = chord.x() * chord.x() + chord.y() * chord.y();
+        qreal t = 0;
+        if (lengthSquared > 1e-18)
+        {
+            t = qBound(0.0, QPointF::dotProduct(point - cubic.p0, chord) / lengthSquared, 1.0);
+        }
+        const QPointF difference = point - (cubic.p0 + t * chord);
+        return std::hypot(difference.x(), difference.y());
+    }
+
+    // Recursive subdivision, only the pieces whose control box comes within distance of the point are split
+    bool pieceComesWithin(const CubicPiece& cubic, const QPointF& point, qreal distance, int depth)
+    {
+        const QRectF box = cubic.bounds();
+        if (point.x() < box.left() - distance || point.x() > box.right() + distance ||
+            point.y() < box.top() - distance || point.y() > box.bottom() + distance)
+        {
+            return false;
+        }
+
+        if (cubic.isFlat(kStrokeTolerance) || depth >= kMaxSubdivision)
+        {
+            return distanceToChord(cubic, point) < distance;
+        }
+
+        CubicPiece first, second;
+        cubic.split(first, second);
+        return pieceComesWithin(first, point, distance, depth + 1) || pieceComesWithin(second, point, distance, depth + 1);
+    }
+}
 
 BezierCurve::BezierCurve()
 {
@@ -84,7 +386,7 @@ BezierCurve::BezierCurve(const QList<QPointF>& pointList, const QList<qreal>& pr
 }
 
 
-Status BezierCurve::createDomElement( QXmlStreamWriter& xmlStream )
+Status BezierCurve::createDomElement( QXmlStreamWriter& xmlStream ) const
 {
     xmlStream.writeStartElement( "curve" );
     xmlStream.writeAttribute( "width", QString::number( width ) );
@@ -95,19 +397,20 @@ Status BezierCurve::createDomElement( QXmlStreamWriter& xmlStream )
     xmlStream.writeAttribute( "colourNumber", QString::number( colorNumber ) );
     xmlStream.writeAttribute( "originX", QString::number( origin.x() ) );
     xmlStream.writeAttribute( "originY", QString::number( origin.y() ) );
-    xmlStream.writeAttribute( "originPressure", QString::number( pressure.at(0) ) );
+    xmlStream.writeAttribute( "originPressure", QString::number( mOriginPressure ) );
 
     int errorLocation = -1;
-    for ( int i = 0; i < c1.size() ; i++ )
+    for ( int i = 0; i < mSegments.size() ; i++ )
     {
+        const Segment& segment = mSegments.at( i );
         xmlStream.writeEmptyElement( "segment" );
-        xmlStream.writeAttribute( "c1x", QString::number( c1.at( i ).x() ) );
-        xmlStream.writeAttribute( "c1y", QString::number( c1.at( i ).y() ) );
-        xmlStream.writeAttribute( "c2x", QString::number( c2.at( i ).x() ) );
-        xmlStream.writeAttribute( "c2y", QString::number( c2.at( i ).y() ) );
-        xmlStream.writeAttribute( "vx", QString::number( vertex.at( i ).x() ) );
-        xmlStream.writeAttribute( "vy", QString::number( vertex.at( i ).y() ) );
-        xmlStream.writeAttribute( "pressure", QString::number( pressure.at( i + 1 ) ) );
+        xmlStream.writeAttribute( "c1x", QString::number( segment.c1.x() ) );
+        xmlStream.writeAttribute( "c1y", QString::number( segment.c1.y() ) );
+        xmlStream.writeAttribute( "c2x", QString::number( segment.c2.x() ) );
+        xmlStream.writeAttribute( "c2y", QString::number( segment.c2.y() ) );
+        xmlStream.writeAttribute( "vx", QString::number( segment.vertex.x() ) );
+        xmlStream.writeAttribute( "vy", QString::number( segment.vertex.y() ) );
+        xmlStream.writeAttribute( "pressure", QString::number( segment.pressure ) );
         if ( errorLocation < 0 && xmlStream.hasError() )
         {
             errorLocation = i;
@@ -128,15 +431,16 @@ Status BezierCurve::createDomElement( QXmlStreamWriter& xmlStream )
         debugInfo << QString("colorNumber = %1").arg(colorNumber);
         debugInfo << QString("originX = %1").arg(origin.x());
         debugInfo << QString("originY = %1").arg(origin.y());
-        debugInfo << QString("originPressure = %1").arg(pressure.at(0));
+        debugInfo << QString("originPressure = %1").arg(mOriginPressure);
         debugInfo << QString("- segmentTag[%1] has failed to write").arg(errorLocation);
-        debugInfo << QString("&nbsp;&nbsp;c1x = %1").arg(c1.at(errorLocation).x());
-        debugInfo << QString("&nbsp;&nbsp;c1y = %1").arg(c1.at(errorLocation).y());
-        debugInfo << QString("&nbsp;&nbsp;c2x = %1").arg(c2.at(errorLocation).x());
-        debugInfo << QString("&nbsp;&nbsp;c2y = %1").arg(c2.at(errorLocation).y());
-        debugInfo << QString("&nbsp;&nbsp;vx = %1").arg(vertex.at(errorLocation).x());
-        debugInfo << QString("&nbsp;&nbsp;vy = %1").arg(vertex.at(errorLocation).y());
-        debugInfo << QString("&nbsp;&nbsp;pressure = %1").arg(pressure.at(errorLocation + 1));
+        const Segment& segment = mSegments.at(errorLocation);
+        debugInfo << QString("&nbsp;&nbsp;c1x = %1").arg(segment.c1.x());
+        debugInfo << QString("&nbsp;&nbsp;c1y = %1").arg(segment.c1.y());
+        debugInfo << QString("&nbsp;&nbsp;c2x = %1").arg(segment.c2.x());
+        debugInfo << QString("&nbsp;&nbsp;c2y = %1").arg(segment.c2.y());
+        debugInfo << QString("&nbsp;&nbsp;vx = %1").arg(segment.vertex.x());
+        debugInfo << QString("&nbsp;&nbsp;vy = %1").arg(segment.vertex.y());
+        debugInfo << QString("&nbsp;&nbsp;pressure = %1").arg(segment.pressure);
 
         return Status(Status::FAIL, debugInfo);
     }
@@ -144,57 +448,117 @@ Status BezierCurve::createDomElement( QXmlStreamWriter& xmlStream )
     return Status::OK;
 }
 
-void BezierCurve::loadDomElement(const QDomElement& element)
+void BezierCurve::loadDomElement(QXmlStreamReader& xmlStream)
 {
-    width = element.attribute("width").toDouble();
-    variableWidth = (element.attribute("variableWidth") == "1") || (element.attribute("variableWidth") == "true");
-    feather = element.attribute("feather").toDouble();
-    invisible = (element.attribute("invisible") == "1") || (element.attribute("invisible") == "true");
-    mFilled = (element.attribute("filled") == "1") || (element.attribute("filled") == "true");
+    const QXmlStreamAttributes attributes = xmlStream.attributes();
+    width = attributes.value("width").toDouble();
+    variableWidth = (attributes.value("variableWidth") == QLatin1String("1")) || (attributes.value("variableWidth") == QLatin1String("true"));
+    feather = attributes.value("feather").toDouble();
+    invisible = (attributes.value("invisible") == QLatin1String("1")) || (attributes.value("invisible") == QLatin1String("true"));
+    mFilled = (attributes.value("filled") == QLatin1String("1")) || (attributes.value("filled") == QLatin1String("true"));
     if (width == 0) invisible = true;
 
-    colorNumber = element.attribute("colourNumber").toInt();
-    origin = QPointF( element.attribute("originX").toFloat(), element.attribute("originY").toFloat() );
-    pressure.append( element.attribute("originPressure").toFloat() );
-    selected.append(false);
+    colorNumber = attributes.value("colourNumber").toInt();
+    origin = QPointF( attributes.value("originX").toFloat(), attributes.value("originY").toFloat() );
+    mOriginPressure = attributes.value("originPressure").toFloat();
+    mOriginSelected = false;
+    mSegments.clear();
+    geometryChanged();
 
-    QDomNode segmentTag = element.firstChild();
-    while (!segmentTag.isNull())
+    while (xmlStream.readNextStartElement())
     {
-        QDomElement segmentElement = segmentTag.toElement();
-        if (!segmentElement.isNull())
+        if (xmlStream.name() == QLatin1String("segment"))
         {
-            if (segmentElement.tagName() == "segment")
-            {
-                QPointF c1Point = QPointF(segmentElement.attribute("c1x").toFloat(), segmentElement.attribute("c1y").toFloat());
-                QPointF c2Point = QPointF(segmentElement.attribute("c2x").toFloat(), segmentElement.attribute("c2y").toFloat());
-                QPointF vertexPoint = QPointF(segmentElement.attribute("vx").toFloat(), segmentElement.attribute("vy").toFloat());
-                qreal pressureValue = segmentElement.attribute("pressure").toFloat();
-                appendCubic(c1Point, c2Point, vertexPoint, pressureValue);
-            }
+            const QXmlStreamAttributes segment = xmlStream.attributes();
+            QPointF c1Point = QPointF(segment.value("c1x").toFloat(), segment.value("c1y").toFloat());
+            QPointF c2Point = QPointF(segment.value("c2x").toFloat(), segment.value("c2y").toFloat());
+            QPointF vertexPoint = QPointF(segment.value("vx").toFloat(), segment.value("vy").toFloat());
+            qreal pressureValue = segment.value("pressure").toFloat();
+            appendCubic(c1Point, c2Point, vertexPoint, pressureValue);
         }
-        segmentTag = segmentTag.nextSibling();
+        xmlStream.skipCurrentElement();
     }
 }
 
+/**
+ * Writes the curve the way VectorImage's binary format stores it:
+ * the segment count, color, width, feather and flags, followed by the origin and
+ * one record of seven floats (c1, c2, vertex, pressure) per segment.
+ * The stream is expected to be little-endian with single precision floats.
+ */
+void BezierCurve::writeBinary(QDataStream& out) const
+{
+    quint8 flags = 0;
+    if (variableWidth) flags |= 1;
+    if (invisible) flags |= 2;
+    if (mFilled) flags |= 4;
+
+    out << quint32(mSegments.size()) << qint32(colorNumber) << width << feather << flags;
+    out << origin.x() << origin.y() << mOriginPressure;
+    for (const Segment& segment : mSegments)
+    {
+        out << segment.c1.x() << segment.c1.y()
+            << segment.c2.x() << segment.c2.y()
+            << segment.vertex.x() << segment.vertex.y()
+            << segment.pressure;
+    }
+}
+
+bool BezierCurve::readBinary(QDataStream& in)
+{
+    quint32 segmentCount = 0;
+    qint32 color = 0;
+    quint8 flags = 0;
+    in >> segmentCount >> color >> width >> feather >> flags;
+
+    // Each segment takes 28 bytes, don't trust a count the rest of the data can't hold
+    if (in.status() != QDataStream::Ok || segmentCount > quint32(in.device()->bytesAvailable() / 28))
+    {
+        return false;
+    }
+
+    colorNumber = color;
+    variableWidth = flags & 1;
+    invisible = (flags & 2) || width == 0;
+    mFilled = flags & 4;
+
+    float x, y, p;
+    in >> x >> y >> p;
+    origin = QPointF(x, y);
+    mOriginPressure = p;
+    mOriginSelected = false;
+    mSegments.clear();
+    mSegments.reserve(static_cast<int>(segmentCount));
+    geometryChanged();
+    for (quint32 i = 0; i < segmentCount; i++)
+    {
+        float c1x, c1y, c2x, c2y, vx, vy;
+        in >> c1x >> c1y >> c2x >> c2y >> vx >> vy >> p;
+        appendCubic(QPointF(c1x, c1y), QPointF(c2x, c2y), QPointF(vx, vy), p);
+    }
+    return in.status() == QDataStream::Ok;
+}
 
 void BezierCurve::setOrigin(const QPointF& point)
 {
     origin = point;
+    geometryChanged();
 }
 
 void BezierCurve::setOrigin(const QPointF& point, const qreal& pressureValue, const bool& trueOrFalse)
 {
     origin = point;
-    pressure[0] = pressureValue;
-    selected[0] = trueOrFalse;
+    mOriginPressure = pressureValue;
+    mOriginSelected = trueOrFalse;
+    geometryChanged();
 }
 
 void BezierCurve::setC1(int i, const QPointF& point)
 {
-    if ( i >= 0 || i < c1.size() )
+    if ( i >= 0 && i < mSegments.size() )
     {
-        c1[i] = point;
+        mSegments[i].c1 = point;
+        geometryChanged();
     }
     else
     {
@@ -204,9 +568,10 @@ void BezierCurve::setC1(int i, const QPointF& point)
 
 void BezierCurve::setC2(int i, const QPointF& point)
 {
-    if ( i >= 0 || i < c2.size() )
+    if ( i >= 0 && i < mSegments.size() )
     {
-        c2[i] = point;
+        mSegments[i].c2 = point;
+        geometryChanged();
     }
     else
     {
@@ -219,10 +584,12 @@ void BezierCurve::setVertex(int i, const QPointF& point)
     if (i == -1)
     {
         origin = point;
+        geometryChanged();
     }
-    else if (i >= 0 && i < vertex.size())
+    else if (i >= 0 && i < mSegments.size())
     {
-        vertex[i] = point;
+        mSegments[i].vertex = point;
+        geometryChanged();
     }
     else
     {
@@ -232,9 +599,10 @@ void BezierCurve::setVertex(int i, const QPointF& point)
 
 void BezierCurve::setLastVertex(const QPointF& point)
 {
-    if (vertex.size() > 0)
+    if (mSegments.size() > 0)
     {
-        vertex[vertex.size()-1] = point;
+        mSegments.last().vertex = point;
+        geometryChanged();
     }
     else
     {
@@ -246,6 +614,7 @@ void BezierCurve::setLastVertex(const QPointF& point)
 void BezierCurve::setWidth(qreal desiredWidth)
 {
     width = desiredWidth;
+    geometryChanged();
 }
 
 void BezierCurve::setFeather(qreal desiredFeather)
@@ -265,7 +634,37 @@ void BezierCurve::setInvisibility(bool YesOrNo)
 
 void BezierCurve::setSelected(int i, bool YesOrNo)
 {
-    selected[i+1] = YesOrNo;
+    if (i == -1) { mOriginSelected = YesOrNo; }
+    else { mSegments[i].selected = YesOrNo; }
+}
+
+void BezierCurve::setSelected(bool YesOrNo)
+{
+    mOriginSelected = YesOrNo;
+    for (Segment& segment : mSegments)
+    {
+        segment.selected = YesOrNo;
+    }
+}
+
+bool BezierCurve::isSelected() const
+{
+    if (!mOriginSelected) { return false; }
+    for (const Segment& segment : mSegments)
+    {
+        if (!segment.selected) { return false; }
+    }
+    return true;
+}
+
+bool BezierCurve::isPartlySelected() const
+{
+    if (mOriginSelected) { return true; }
+    for (const Segment& segment : mSegments)
+    {
+        if (segment.selected) { return true; }
+    }
+    return false;
 }
 
 /**
@@ -282,58 +681,36 @@ void BezierCurve::setFilled(bool YesOrNo)
 BezierCurve BezierCurve::transformed(QTransform transformation) const
 {
     BezierCurve transformedCurve = *this; // copy the curve
-    if (isSelected(-1)) { transformedCurve.setOrigin(transformation.map(origin)); }
-    for(int i=0; i< vertex.size(); i++)
-    {
-        if (isSelected(i-1)) { transformedCurve.setC1(i, transformation.map(c1.at(i))); }
-        if (isSelected(i))
-        {
-            transformedCurve.setC2(i, transformation.map(c2.at(i)));
-            transformedCurve.setVertex(i, transformation.map(vertex.at(i)));
-        }
-    }
-    //transformedCurve.smoothCurve();
-    /*QPointF newOrigin = origin;
-    if (isSelected(-1)) { newOrigin =  transformation.map(newOrigin); }
-    transformedCurve.setOrigin( newOrigin );
-    for(int i=0; i< vertex.size(); i++) {
-        QPointF newC1 = c1.at(i);
-        QPointF newC2 = c2.at(i);
-        QPointF newVertex = vertex.at(i);
-        if (isSelected(i-1)) { newC1 = transformation.map(newC1); }
-        if (isSelected(i)) { newC2 = transformation.map(newC2);  newVertex = transformation.map(newVertex); }
-        transformedCurve.appendCubic( newC1, newC2, newVertex, pressure.at(i) );
-        if (isSelected(i)) { transformedCurve.setSelected(i, true); }
-    }
-    transformedCurve.setWidth( width);
-    transformedCurve.setVariableWidth( variableWidth );
-    //transformedCurve.setSelected(true); // or select only the selected elements of the orginal curve?
-    */
+    transformedCurve.transform(transformation);
     return transformedCurve;
 }
 
 void BezierCurve::transform(QTransform transformation)
 {
-    if (isSelected(-1)) setOrigin( transformation.map(origin) );
-    for(int i=0; i< vertex.size(); i++)
+    if (mOriginSelected) { origin = transformation.map(origin); }
+    bool previousSelected = mOriginSelected;
+    for (Segment& segment : mSegments)
     {
-        if (isSelected(i-1)) c1[i] = transformation.map(c1.at(i));
-        if (isSelected(i))
+        if (previousSelected) { segment.c1 = transformation.map(segment.c1); }
+        if (segment.selected)
         {
-            c2[i] = transformation.map(c2.at(i));
-            vertex[i] = transformation.map(vertex.at(i));
+            segment.c2 = transformation.map(segment.c2);
+            segment.vertex = transformation.map(segment.vertex);
         }
+        previousSelected = segment.selected;
     }
-    //smoothCurve();
+    geometryChanged();
 }
 
 void BezierCurve::appendCubic(const QPointF& c1Point, const QPointF& c2Point, const QPointF& vertexPoint, qreal pressureValue)
 {
-    c1.append(c1Point);
-    c2.append(c2Point);
-    vertex.append(vertexPoint);
-    pressure.append(pressureValue);
-    selected.append(false);
+    Segment segment;
+    segment.c1 = c1Point;
+    segment.c2 = c2Point;
+    segment.vertex = vertexPoint;
+    segment.pressure = pressureValue;
+    mSegments.append(segment);
+    geometryChanged();
 }
 
 void BezierCurve::addPoint(int position, const QPointF point)
@@ -345,14 +722,17 @@ void BezierCurve::addPoint(int position, const QPointF point)
         QPointF c1o = getC1(position);
         QPointF c2o = getC2(position);
 
-        c1[position] = point + 0.2*(v2-v1);
-        c2[position] = v2 + (c2o-v2)*(0.5);
+        Segment segment;
+        segment.c1 = v1 + (c1o-v1)*(0.5);
+        segment.c2 = point - 0.2*(v2-v1);
+        segment.vertex = point;
+        segment.pressure = getPressure(position);
+        segment.selected = isSelected(position) && isSelected(position-1);
 
-        c1.insert(position, v1 + (c1o-v1)*(0.5) );
-        c2.insert(position, point - 0.2*(v2-v1));
-        vertex.insert(position, point);
-        pressure.insert(position, getPressure(position));
-        selected.insert(position, isSelected(position) && isSelected(position-1));
+        mSegments[position].c1 = point + 0.2*(v2-v1);
+        mSegments[position].c2 = v2 + (c2o-v2)*(0.5);
+        mSegments.insert(position, segment);
+        geometryChanged();
 
         //smoothCurve();
     }
@@ -380,14 +760,17 @@ void BezierCurve::addPoint(int position, const qreal fraction) // fraction is wh
         QPointF cB1 = (1-fraction)*c12 + fraction*cB2;
         QPointF vM = (1-fraction)*cA2 + fraction*cB1;
 
-        setC1(position, cB1);
-        setC2(position, cB2);
+        Segment segment;
+        segment.c1 = cA1;
+        segment.c2 = cA2;
+        segment.vertex = vM;
+        segment.pressure = getPressure(position);
+        segment.selected = isSelected(position) && isSelected(position-1);
 
-        c1.insert(position, cA1);
-        c2.insert(position, cA2);
-        vertex.insert(position, vM);
-        pressure.insert(position, getPressure(position));
-        selected.insert(position, isSelected(position) && isSelected(position-1));
+        mSegments[position].c1 = cB1;
+        mSegments[position].c2 = cB2;
+        mSegments.insert(position, segment);
+        geometryChanged();
 
         //smoothCurve();
     }
@@ -399,43 +782,41 @@ void BezierCurve::addPoint(int position, const qreal fraction) // fraction is wh
 
 void BezierCurve::removeVertex(int i)
 {
-    int n = vertex.size();
+    int n = mSegments.size();
     if (i>-2 && i< n)
     {
         if (i== -1)
         {
-            origin = vertex.at(0);
-            vertex.removeAt(0);
-            c1.removeAt(0);
-            c2.removeAt(0);
-            pressure.removeAt(0);
-            selected.removeAt(0);
+            // the first vertex becomes the origin
+            origin = mSegments.at(0).vertex;
+            mOriginPressure = mSegments.at(0).pressure;
+            mOriginSelected = mSegments.at(0).selected;
+            mSegments.removeAt(0);
+        }
+        else if ( i != n-1 )
+        {
+            // the next segment now starts where the removed one started, with its first control point
+            const QPointF c1 = mSegments.at(i).c1;
+            mSegments.removeAt(i);
+            mSegments[i].c1 = c1;
         }
         else
         {
-            vertex.removeAt(i);
-            c2.removeAt(i);
-            pressure.removeAt(i+1);
-            selected.removeAt(i+1);
-            if ( i != n-1 )
-            {
-                c1.removeAt(i+1);
-            }
-            else
-            {
-                c1.removeAt(i);
-            }
+            mSegments.removeAt(i);
         }
+        geometryChanged();
     }
 }
 
-void BezierCurve::drawPath(QPainter& painter, const Object& object, QTransform transformation, bool simplified, bool showThinLines )
+void BezierCurve::drawPath(QPainter& painter, const QColor& curveColor, QTransform transformation, bool simplified, bool showThinLines ) const
 {
-    QColor color = object.getColor(colorNumber).color;
+    QColor color = curveColor;
 
-    BezierCurve myCurve;
-    if (isPartlySelected()) { myCurve = (transformed(transformation)); }
-    else { myCurve = *this; }
+    // Only a selection being transformed needs a copy of the curve
+    BezierCurve transformedCurve;
+    const bool partlySelected = isPartlySelected();
+    if (partlySelected) { transformedCurve = transformed(transformation); }
+    const BezierCurve& myCurve = partlySelected ? transformedCurve : *this;
 
     if ( variableWidth && !simplified && !invisible)
     {
@@ -493,7 +874,7 @@ void BezierCurve::drawPath(QPainter& painter, const Object& object, QTransform t
         if (isSelected()) painter.drawPath(myCurve.getSimplePath());
 
 
-        for(int i=-1; i< vertex.size(); i++)
+        for(int i=-1; i< mSegments.size(); i++)
         {
             if (isSelected(i))
             {
@@ -514,115 +895,147 @@ void BezierCurve::drawPath(QPainter& painter, const Object& object, QTransform t
 }
 
 // Without curve fitting
-QPainterPath BezierCurve::getStraightPath()
+QPainterPath BezierCurve::getStraightPath() const
 {
     QPainterPath path;
     path.moveTo(origin);
-    for(int i=0; i<vertex.size(); i++)
+    for(int i=0; i<mSegments.size(); i++)
     {
-        path.lineTo(vertex[i]);
+        path.lineTo(getVertex(i));
     }
     return path;
 }
 
 // With bezier curve fitting
-QPainterPath BezierCurve::getSimplePath()
+QPainterPath BezierCurve::getSimplePath() const
 {
-    QPainterPath path;
-    path.moveTo(origin);
-    for(int i=0; i<vertex.size(); i++)
+    if (!mSimplePathValid)
     {
-        path.cubicTo(c1.at(i), c2.at(i), vertex.at(i));
+        mSimplePath = QPainterPath();
+        mSimplePath.moveTo(origin);
+        for (const Segment& segment : mSegments)
+        {
+            mSimplePath.cubicTo(segment.c1, segment.c2, segment.vertex);
+        }
+        mSimplePathValid = true;
     }
-    return path;
+    return mSimplePath;
 }
 
-QPainterPath BezierCurve::getStrokedPath()
+QPainterPath BezierCurve::getStrokedPath() const
 {
-    return getStrokedPath( width );
+    if (!mStrokedPathValid)
+    {
+        mStrokedPath = createStrokedPath(width, true);
+        mStrokedPathValid = true;
+    }
+    return mStrokedPath;
 }
 
-QPainterPath BezierCurve::getStrokedPath(qreal width)
+QPainterPath BezierCurve::getStrokedPath(qreal width) const
 {
     return getStrokedPath(width, true);
 }
 
-// this function is a mess and outputs buggy results randomly...
-QPainterPath BezierCurve::getStrokedPath(qreal width, bool usePressure)
+QPainterPath BezierCurve::getStrokedPath(qreal width, bool usePressure) const
+{
+    if (usePressure && width == this->width)
+    {
+        return getStrokedPath();
+    }
+    return createStrokedPath(width, usePressure);
+}
+
+QPainterPath BezierCurve::createStrokedPath(qreal width, bool usePressure) const
 {
     QPainterPath path;
-    QPointF tangentVec, normalVec, normalVec2, normalVec2_1, normalVec2_2;
-    qreal width2 = width;
-    int n = vertex.size();
     path.setFillRule(Qt::WindingFill);
+    const int n = mSegments.size();
+    if (n == 0) { return path; }
 
-    normalVec = QPointF(-(c1.at(0) - origin).y(), (c1.at(0) - origin).x());
-    normalise(normalVec);
-    if (usePressure) width2 = width * 0.5 * pressure.at(0);
-    if (n==1 && width2 == 0.0)  width2 = 0.15 * width;
-    path.moveTo(origin + width2*normalVec);
-    for(int i=0; i<n; i++)
+    auto offsetAt = [&](int vertex)
+    {
+        qreal offset = width;
+        if (usePressure) offset = width * 0.5 * ((vertex == -1) ? mOriginPressure : mSegments.at(vertex).pressure);
+        if (n == 1 && offset == 0.0) offset = 0.15 * width;
+        return offset;
+    };
+
+    // Sample the centre line finely enough for both sides of the outline to be within tolerance
+    QVector<StrokeSample> samples;
+    samples.reserve(n * 4 + 1);
+    QPointF start = origin;
+    for (int i = 0; i < n; i++)
+    {
+        const Segment& segment = mSegments.at(i);
+        const CubicPiece cubic = { start, segment.c1, segment.c2, segment.vertex, 0, 1 };
+        const qreal offset0 = offsetAt(i - 1);
+        const qreal offset1 = offsetAt(i);
+
+        StrokeSample first = strokeSample(cubic, offset0, offset1, 0);
+        first.join = (i > 0);
+        samples.append(first);
+        sampleSection(cubic, offset0, offset1, 0, 1, 0, samples);
+        start = segment.vertex;
+    }
+
+    // Left side forwards, round cap, right side backwards, round cap; vertices get round joins
+    const StrokeSample& head = samples.first();
+    path.moveTo(head.point + head.offset * head.normal);
+    for (int k = 1; k < samples.size(); k++)
+    {
+        const StrokeSample& sample = samples.at(k);
+        if (sample.join)
+        {
+            appendArc(path, sample.point, sample.offset, samples.at(k - 1).normal, turnAngle(samples.at(k - 1).normal, sample.normal));
+        }
+        else
+        {
+            path.lineTo(sample.point + sample.offset * sample.normal);
+        }
+    }
+
+    const StrokeSample& tail = samples.last();
+    appendArc(path, tail.point, tail.offset, tail.normal, -M_PI);
+    for (int k = samples.size() - 2; k >= 0; k--)
     {
-        if (i==n-1)
+        const StrokeSample& sample = samples.at(k);
+        const StrokeSample& next = samples.at(k + 1);
+        if (next.join)
         {
-            normalVec2 = QPointF(-(vertex.at(i) - c2.at(i)).y(), (vertex.at(i) - c2.at(i)).x());
+            appendArc(path, sample.point, sample.offset, -next.normal, turnAngle(-next.normal, -sample.normal));
         }
         else
         {
-            normalVec2_1 = QPointF(-(vertex.at(i) - c2.at(i)).y(), (vertex.at(i) - c2.at(i)).x());
-            normalise(normalVec2_1);
-            normalVec2_2 = QPointF(-(c1.at(i+1) - vertex.at(i)).y(), (c1.at(i+1) - vertex.at(i)).x());
-            normalise(normalVec2_2);
-            normalVec2 = normalVec2_1 + normalVec2_2;
-        }
-        normalise(normalVec2);
-        if (usePressure) width2 = width * 0.5 * pressure.at(i);
-        if (n==1 && width2 == 0.0)  width2 = 0.15 * width;
-        //if (i==n-1) width2 = 0.0;
-        path.cubicTo(c1.at(i) + width2*normalVec, c2.at(i) + width2*normalVec2, vertex.at(i) + width2*normalVec2);
-        //path.moveTo(vertex.at(i) + width*normalVec2);
-        //path.lineTo(vertex.at(i) - width*normalVec2);
-        normalVec = normalVec2;
-    }
-    if (usePressure) width2 = width * 0.5 * pressure.at(n-1);
-    if (n==1 && width2 == 0.0)  width2 = 0.15 * width;
-
-    //path.lineTo(vertex.at(n-1) - width2*normalVec);
-    tangentVec = (vertex.at(n-1)-c2.at(n-1));
-    normalise(tangentVec);
-    path.cubicTo(vertex.at(n-1) + width2*(normalVec+1.8*tangentVec), vertex.at(n-1) + width2*(-normalVec+1.8*tangentVec), vertex.at(n-1) - width2*normalVec);
-
-    for(int i=n-2; i>=0; i--)
-    {
-        normalVec2_1 = QPointF((vertex.at(i) - c1.at(i+1)).y(), -(vertex.at(i) - c1.at(i+1)).x());
-        normalise(normalVec2_1);
-        normalVec2_2 = QPointF((c2.at(i) - vertex.at(i)).y(), -(c2.at(i) - vertex.at(i)).x());
-        normalise(normalVec2_2);
-        normalVec2 = normalVec2_1 + normalVec2_2;
-        normalise(normalVec2);
-        if (usePressure) width2 = width * 0.5 * pressure.at(i);
-        if (n==1 && width2 == 0.0)  width2 = 0.15 * width;
-        path.cubicTo(c2.at(i+1) - width2*normalVec, c1.at(i+1) - width2*normalVec2, vertex.at(i) - width2*normalVec2);
-        normalVec = normalVec2;
-    }
-    normalVec2 = QPointF((origin - c1.at(0)).y(), -(origin - c1.at(0)).x());
-    normalise(normalVec2);
-    if (usePressure) width2 = width * 0.5 * pressure.at(0);
-    if (n==1 && width2 == 0.0)  width2 = 0.15 * width;
-    path.cubicTo(c2.at(0) - width2*normalVec, c1.at(0) - width2*normalVec2, origin - width2*normalVec2);
-
-    tangentVec = (origin-c1.at(0));
-    normalise(tangentVec);
-    path.cubicTo(origin + width2*(-normalVec+1.8*tangentVec), origin + width2*(normalVec+1.8*tangentVec), origin + width2*normalVec);
+            path.lineTo(sample.point - sample.offset * sample.normal);
+        }
+    }
+    appendArc(path, head.point, head.offset, -head.normal, -M_PI);
 
     path.closeSubpath();
     return path;
 }
 
-QRectF BezierCurve::getBoundingRect()
+QRectF BezierCurve::getBoundingRect() const
 {
-    qreal radius = getWidth() / 2;
-    return getSimplePath().boundingRect().adjusted(-radius, -radius, radius, radius);
+    if (!mBoundsValid)
+    {
+        qreal left = origin.x();
+        qreal right = origin.x();
+        qreal top = origin.y();
+        qreal bottom = origin.y();
+        QPointF start = origin;
+        for (const Segment& segment : mSegments)
+        {
+            cubicExtremes(start.x(), segment.c1.x(), segment.c2.x(), segment.vertex.x(), left, right);
+            cubicExtremes(start.y(), segment.c1.y(), segment.c2.y(), segment.vertex.y(), top, bottom);
+            start = segment.vertex;
+        }
+        qreal radius = getWidth() / 2;
+        mBounds = QRectF(QPointF(left, top), QPointF(right, bottom)).adjusted(-radius, -radius, radius, radius);
+        mBoundsValid = true;
+    }
+    return mBounds;
 }
 
 void BezierCurve::createCurve(const QList<QPointF>& pointList, const QList<qreal>& pressureList, bool smooth)
@@ -631,24 +1044,18 @@ void BezierCurve::createCurve(const QList<QPointF>& pointList, const QList<qreal
     int n = pointList.size();
     // generate the Bezier (cubic) curve from the simplified path and mouse pressure
     // first, empty everything
-    while (c1.size()>0) c1.removeAt(0);
-    while (c2.size()>0) c2.removeAt(0);
-    while (vertex.size()>0) vertex.removeAt(0);
-    while (selected.size()>0) selected.removeAt(0);
-    while (pressure.size()>0) pressure.removeAt(0);
-
-    setOrigin( pointList.at(0) );
-    selected.append(false);
-    pressure.append(pressureList.at(0));
+    mSegments.clear();
+    setOrigin( pointList.at(0), pressureList.at(0), false );
+    mSegments.reserve(n - 1);
 
     for (p=1; p<n; p++)
     {
-        c1.append(pointList.at(p));
-        c2.append(pointList.at(p));
-        vertex.append(pointList.at(p));
-        pressure.append(pressureList.at(p));
-        selected.append(false);
-
+        Segment segment;
+        segment.c1 = pointList.at(p);
+        segment.c2 = pointList.at(p);
+        segment.vertex = pointList.at(p);
+        segment.pressure = pressureList.at(p);
+        mSegments.append(segment);
     }
     if (smooth)
     {
@@ -662,7 +1069,7 @@ void BezierCurve::createCurve(const QList<QPointF>& pointList, const QList<qreal
 void BezierCurve::smoothCurve()
 {
     QPointF c1, c2, c2old, tangentVec, normalVec;
-    int n = vertex.size();
+    int n = mSegments.size();
     c2old = QPointF(-100,-100); // bogus point
     for(int p=0; p<n-1; p++)
     {
@@ -689,19 +1096,20 @@ void BezierCurve::smoothCurve()
 
         if (p==0)
         {
-            c2old  = 0.5*(vertex.at(0)+c1);
+            c2old  = 0.5*(getVertex(0)+c1);
         }
 
-        this->c1[p] = c2old;
-        this->c2[p] = c1;
+        mSegments[p].c1 = c2old;
+        mSegments[p].c2 = c1;
         //appendCubic(c2old, c1, D, pressureList->at(p));
         c2old = c2;
     }
     if (n>2)
     {
-        this->c1[n-1] = c2old;
-        this->c2[n-1] = 0.5*(c2old+vertex.at(n-1));
+        mSegments[n-1].c1 = c2old;
+        mSegments[n-1].c2 = 0.5*(c2old+getVertex(n-1));
     }
+    geometryChanged();
 }
 
 void BezierCurve::simplify(double tol, const QList<QPointF>& inputList, int j, int k, QList<bool>& markList)
@@ -777,7 +1185,7 @@ void BezierCurve::normalise(QPointF& point)
     }
 }
 
-qreal BezierCurve::findDistance(BezierCurve curve, int i, QPointF P, QPointF& nearestPoint, qreal& t)   //finds the distance between a cubic section and a point
+qreal BezierCurve::findDistance(const BezierCurve& curve, int i, QPointF P, QPointF& nearestPoint, qreal& t)   //finds the distance between a cubic section and a point
 {
     //qDebug() << "---- INTER CUBIC SEGMENT";
     int nSteps = 24;
@@ -802,7 +1210,7 @@ qreal BezierCurve::findDistance(BezierCurve curve, int i, QPointF P, QPointF& ne
     return distMin;
 }
 
-QPointF BezierCurve::getPointOnCubic(int i, qreal t)
+QPointF BezierCurve::getPointOnCubic(int i, qreal t) const
 {
     return (1.0-t)*(1.0-t)*(1.0-t)*getVertex(i-1)
            + 3*t*(1.0-t)*(1.0-t)*getC1(i)
@@ -811,110 +1219,75 @@ QPointF BezierCurve::getPointOnCubic(int i, qreal t)
 }
 
 
-bool BezierCurve::intersects(QPointF point, qreal distance)
+bool BezierCurve::intersects(QPointF point, qreal distance) const
 {
-    bool result = false;
-    if ( getStrokedPath(distance, false).contains(point) )
+    // The bounds hold the whole width around the centre line
+    const QRectF bounds = getBoundingRect().adjusted(-distance, -distance, distance, distance);
+    if (!bounds.contains(point)) { return false; }
+
+    for (int i = 0; i < mSegments.size(); i++)
     {
-        //if ( getSimplePath().controlPointRect().contains(point)) {
-        result = true;
+        if (sectionIntersects(i, point, distance)) { return true; }
     }
-    return result;
+    return false;
 }
 
-bool BezierCurve::intersects(QRectF rectangle)
+bool BezierCurve::intersects(QRectF rectangle) const
 {
     bool result = false;
     if ( getSimplePath().controlPointRect().intersects(rectangle))
     {
-        for(int i=0; i<vertex.size(); i++)
+        for (const Segment& segment : mSegments)
         {
-            if ( rectangle.contains( getVertex(i) ) ) return true;
+            if ( rectangle.contains( segment.vertex ) ) return true;
         }
     }
     return result;
 }
 
-bool BezierCurve::findIntersection(BezierCurve curve1, int i1, BezierCurve curve2, int i2, QList<Intersection>& intersections)   //finds the intersection between two cubic sections
+bool BezierCurve::sectionIntersects(int i, QPointF point, qreal distance) const
 {
-    bool result = false;
-    //qDebug() << "---- INTER CUBIC CUBIC"  << i1 << i2;
-    QPointF P1, Q1, P2, Q2;
-    QLineF L1, L2;
-    QRectF R1;
-    QRectF R2;
-
-    P1 = curve1.getVertex(i1-1);
-    Q1 = curve1.getVertex(i1);
-    P2 = curve2.getVertex(i2-1);
-    Q2 = curve2.getVertex(i2);
-    L1 = QLineF(P1, Q1);
-    L2 = QLineF(P2, Q2);
-
-    //qDebug() << "-------------------- ";
-
-    R1.setTopLeft(P1);
-    R1.setBottomRight(Q1);
-    R2.setTopLeft(P2);
-    R2.setBottomRight(Q2);
-
-    QPointF intersectionPoint = QPointF(50.0, 50.0); // bogus point
-    QPointF* cubicIntersection = &intersectionPoint;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-    if ( R1.intersects(R2) || L2.intersects(L1, cubicIntersection) == QLineF::BoundedIntersection )
-#else
-    if ( R1.intersects(R2) || L2.intersect(L1, cubicIntersection) == QLineF::BoundedIntersection )
-#endif
-    {
-        //if (L2.intersect(L1, intersection) == QLineF::BoundedIntersection) {
-        //qDebug() << "                   FOUND rectangle intersection ";
-        //if (intersectionPoint != curve1.getVertex(i1-1) && intersectionPoint != curve1.getVertex(i1)) {
-        //    qDebug() << "                   it's not one of the points ";
-        // find the cubic intersection
-        int nSteps = 24;
-        P1 = curve1.getVertex(i1-1);
-        for(int i=1; i<=nSteps; i++)
-        {
-            qreal s = (i+0.0)/nSteps;
-            Q1 = curve1.getPointOnCubic(i1, s);
-            P2 = curve2.getVertex(i2-1);
-            for(int j=1; j<=nSteps; j++)
-            {
-                qreal t = (j+0.0)/nSteps;
-                Q2 = curve2.getPointOnCubic(i2, t);
-                L1 = QLineF(P1, Q1);
-                L2 = QLineF(P2, Q2);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-                if (L2.intersects(L1, cubicIntersection) == QLineF::BoundedIntersection)
-#else
-                if (L2.intersect(L1, cubicIntersection) == QLineF::BoundedIntersection)
-#endif
-                {
-                    QPointF intersectionPoint = *cubicIntersection;
-                    if (intersectionPoint != curve1.getVertex(i1-1) && intersectionPoint != curve1.getVertex(i1))
-                    {
-                        qreal fraction1 = eLength(intersectionPoint-Q1)/(0.0+eLength(Q1-P1));
-                        qreal fraction2 = eLength(intersectionPoint-Q2)/(0.0+eLength(Q2-P2));
-                        qreal t1 = (i - fraction1)/nSteps;
-                        qreal t2 = (j - fraction2)/nSteps;
-                        Intersection intersection;
-                        intersection.point = intersectionPoint;
-                        intersection.t1 = t1;
-                        intersection.t2 = t2;
-                        intersections.append( intersection );
-                        result = true;
-                        //qDebug() << "FOUND cubic interesection " << intersectionPoint << i << j;
-                    }
-                }
-                P2 = Q2;
-            }
-            P1 = Q1;
-        }
+    const CubicPiece cubic = { getVertex(i - 1), getC1(i), getC2(i), getVertex(i), 0, 1 };
+    return pieceComesWithin(cubic, point, distance, 0);
+}
+
+QRectF BezierCurve::getSectionBounds(int i) const
+{
+    const CubicPiece cubic = { getVertex(i - 1), getC1(i), getC2(i), getVertex(i), 0, 1 };
+    return cubic.bounds();
+}
+
+bool BezierCurve::findIntersection(const BezierCurve& curve1, int i1, const BezierCurve& curve2, int i2, QList<Intersection>& intersections)   //finds the intersection between two cubic sections
+{
+    const CubicPiece cubic1 = { curve1.getVertex(i1 - 1), curve1.getC1(i1), curve1.getC2(i1), curve1.getVertex(i1), 0, 1 };
+    const CubicPiece cubic2 = { curve2.getVertex(i2 - 1), curve2.getC1(i2), curve2.getC2(i2), curve2.getVertex(i2), 0, 1 };
+
+    QList<Intersection> found;
+    intersectPieces(cubic1, cubic2, 0, found);
+    if (found.isEmpty()) { return false; }
+
+    for (Intersection& intersection : found)
+    {
+        refineIntersection(cubic1, cubic2, intersection.t1, intersection.t2);
+        intersection.point = cubic1.pointAt(intersection.t1);
     }
-    else
+    std::sort(found.begin(), found.end(), [](const Intersection& a, const Intersection& b) { return a.t1 < b.t1; });
+
+    QList<Intersection> accepted;
+    for (const Intersection& intersection : found)
     {
-        //return false; // approximation to speed up the calculation
+        // the ends of the first section are vertices already, e.g. where two sections of one curve meet
+        if (eLength(intersection.point - cubic1.p0) < kMergeDistance || eLength(intersection.point - cubic1.p3) < kMergeDistance)
+        {
+            continue;
+        }
+        // a crossing on the border of two pieces is found by both of them
+        auto samePoint = [&](const Intersection& other) { return eLength(other.point - intersection.point) < kMergeDistance; };
+        if (std::none_of(accepted.cbegin(), accepted.cend(), samePoint))
+        {
+            accepted.append(intersection);
+        }
     }
-    //qDebug() << "------";
-    return result;
+    intersections.append(accepted);
+    return !accepted.isEmpty();
 }
@@ -17,11 +17,12 @@ GNU General Public License for more details.
 #define BEZIERCURVE_H
 
 #include <QPainter>
+#include <QVector>
 
-class Object;
 class Status;
 class QXmlStreamWriter;
-class QDomElement;
+class QXmlStreamReader;
+class QDataStream;
 
 struct Intersection
 {
@@ -37,26 +38,34 @@ public:
     explicit BezierCurve(const QList<QPointF>& pointList, bool smooth=true);
     explicit BezierCurve(const QList<QPointF>& pointList, const QList<qreal>& pressureList, double tol, bool smooth=true);
 
-    Status createDomElement(QXmlStreamWriter &xmlStream);
-    void loadDomElement(const QDomElement& element);
+    Status createDomElement(QXmlStreamWriter &xmlStream) const;
+    void loadDomElement(QXmlStreamReader& xmlStream);
+    void writeBinary(QDataStream& out) const;
+    bool readBinary(QDataStream& in);
 
     qreal getWidth() const { return width; }
     qreal getFeather() const { return feather; }
     bool getVariableWidth() const { return variableWidth; }
     int getColorNumber() const { return colorNumber; }
     void decreaseColorNumber() { colorNumber--; }
-    int getVertexSize() const { return vertex.size(); }
-    QPointF getOrigin() const {	return origin; }
-    QPointF getVertex(int i) const { if (i==-1) { return origin; } else { return vertex.at(i);} }
-    QPointF getC1(int i) const { return c1.at(i); }
-    QPointF getC2(int i) const { return c2.at(i); }
-    qreal getPressure(int i) const { return pressure.at(i); }
-    bool isSelected(int vertex) const { return selected.at(vertex+1); }
-    bool isSelected() const { bool result=true; for(int i=0; i<selected.size(); i++) result = result && selected[i]; return result; }
-    bool isPartlySelected() const { bool result=false; for(int i=0; i<selected.size(); i++) result = result || selected[i]; return result; }
+    int getVertexSize() const { return mSegments.size(); }
+    QPointF getOrigin() const { return origin; }
+    QPointF getVertex(int i) const { return (i == -1) ? origin : mSegments.at(i).vertex; }
+    QPointF getC1(int i) const { return mSegments.at(i).c1; }
+    QPointF getC2(int i) const { return mSegments.at(i).c2; }
+    /** The pressure at vertex i-1, 0 being the origin */
+    qreal getPressure(int i) const { return (i == 0) ? mOriginPressure : mSegments.at(i - 1).pressure; }
+    bool isSelected(int vertex) const { return (vertex == -1) ? mOriginSelected : mSegments.at(vertex).selected; }
+    bool isSelected() const;
+    bool isPartlySelected() const;
     bool isInvisible() const { return invisible; }
-    bool intersects(QPointF point, qreal distance);
-    bool intersects(QRectF rectangle);
+    /** True when the centre line of the curve comes within distance of point */
+    bool intersects(QPointF point, qreal distance) const;
+    bool intersects(QRectF rectangle) const;
+    /** True when section i, from vertex i-1 to vertex i, comes within distance of point */
+    bool sectionIntersects(int i, QPointF point, qreal distance) const;
+    /** The box of the control points of section i, which the section lies in */
+    QRectF getSectionBounds(int i) const;
     bool isFilled() const { return mFilled; }
 
     void setOrigin(const QPointF& point);
@@ -70,7 +79,7 @@ public:
     void setVariableWidth(bool YesOrNo);
     void setInvisibility(bool YesOrNo);
     void setColorNumber(int colorNumber) { this->colorNumber = colorNumber; }
-    void setSelected(bool YesOrNo) { for(int i=0; i<selected.size(); i++) { selected[i] = YesOrNo; } }
+    void setSelected(bool YesOrNo);
     void setSelected(int i, bool YesOrNo);
     void setFilled(bool yesOrNo);
 
@@ -80,16 +89,23 @@ public:
     void appendCubic(const QPointF& c1Point, const QPointF& c2Point, const QPointF& vertexPoint, qreal pressureValue);
     void addPoint(int position, const QPointF point);
     void addPoint(int position, const qreal fraction);
-    QPointF getPointOnCubic(int i, qreal t);
+    QPointF getPointOnCubic(int i, qreal t) const;
     void removeVertex(int i);
-    QPainterPath getStraightPath();
-    QPainterPath getSimplePath();
-    QPainterPath getStrokedPath();
-    QPainterPath getStrokedPath(qreal width);
-    QPainterPath getStrokedPath(qreal width, bool pressure);
-    QRectF getBoundingRect();
-
-    void drawPath(QPainter& painter, const Object& object, QTransform transformation, bool simplified, bool showThinLines );
+    QPainterPath getStraightPath() const;
+    /** The centre line of the curve, kept until the geometry changes */
+    QPainterPath getSimplePath() const;
+    /** The outline of the curve at its own width and pressure, kept until the geometry changes */
+    QPainterPath getStrokedPath() const;
+    QPainterPath getStrokedPath(qreal width) const;
+    /**
+     * The outline of the curve, offset by width on both sides, or by half the width
+     * scaled by the pressure at each vertex. Round caps and joins, flattened to within 0.05.
+     */
+    QPainterPath getStrokedPath(qreal width, bool pressure) const;
+    /** The exact bounds of the curve and its width, kept until the geometry changes */
+    QRectF getBoundingRect() const;
+
+    void drawPath(QPainter& painter, const QColor& color, QTransform transformation, bool simplified, bool showThinLines) const;
     void createCurve(const QList<QPointF>& pointList, const QList<qreal>& pressureList , bool smooth);
     void smoothCurve();
 
@@ -99,22 +115,42 @@ public:
     static qreal eLength(const QPointF point); // returns the Euclidean length of a point (seen as a vector)
     static qreal mLength(const QPointF point); // returns the Manhattan length of a point (seen as a vector)
     static void normalise(QPointF& point); // normalises a point (seen as a vector);
-    static qreal findDistance(BezierCurve curve, int i, QPointF P, QPointF& nearestPoint, qreal& t); //finds the distance between a cubic section and a point
-    static bool findIntersection(BezierCurve curve1, int i1, BezierCurve curve2, int i2, QList<Intersection>& intersections); //finds the intersection between two cubic sections
+    static qreal findDistance(const BezierCurve& curve, int i, QPointF P, QPointF& nearestPoint, qreal& t); //finds the distance between a cubic section and a point
+    static bool findIntersection(const BezierCurve& curve1, int i1, const BezierCurve& curve2, int i2, QList<Intersection>& intersections); //finds the intersection between two cubic sections
 
 private:
+    /** A cubic from the previous vertex (or the origin) to this one */
+    struct Segment
+    {
+        QPointF c1;
+        QPointF c2;
+        QPointF vertex;
+        float pressure = 0.5f;
+        bool selected = false;
+    };
+
+    QPainterPath createStrokedPath(qreal width, bool usePressure) const;
+    void geometryChanged() { mBoundsValid = false; mSimplePathValid = false; mStrokedPathValid = false; }
+
     QPointF origin;
-    QList<QPointF> c1;
-    QList<QPointF> c2;
-    QList<QPointF> vertex;
-    QList<float> pressure; // this list has one more element than the other list (the first element is for the origin)
+    float mOriginPressure = 0.5f;
+    bool mOriginSelected = false;
+    // All segments in one implicitly shared array: copying a curve doesn't allocate
+    QVector<Segment> mSegments;
     int colorNumber = 0;
     float width = 0.f;
     float feather = 0.f;
     bool variableWidth = 0.f;
     bool invisible = false;
     bool mFilled = false;
-    QList<bool> selected; // this list has one more element than the other list (the first element is for the origin)
+
+    // Derived from the geometry, width and pressure; copies of a curve share them
+    mutable QRectF mBounds;
+    mutable bool mBoundsValid = false;
+    mutable QPainterPath mSimplePath;
+    mutable bool mSimplePathValid = false;
+    mutable QPainterPath mStrokedPath;
+    mutable bool mStrokedPathValid = false;
 };
 
 #endif
@@ -0,0 +1,141 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "curveindex.h"
+
+#include <algorithm>
+#include <QVarLengthArray>
+#include "beziercurve.h"
+
+namespace
+{
+    const int kLeafSize = 8;
+}
+
+void CurveIndex::build(const QVector<BezierCurve>& curves)
+{
+    mItems.clear();
+    mNodes.clear();
+
+    for (int i = 0; i < curves.size(); i++)
+    {
+        const BezierCurve& curve = curves.at(i);
+        if (curve.getVertexSize() == 0)
+        {
+            mItems.append({ QRectF(curve.getOrigin(), QSizeF(0, 0)), i, -1 });
+            continue;
+        }
+        for (int section = 0; section < curve.getVertexSize(); section++)
+        {
+            mItems.append({ curve.getSectionBounds(section), i, section });
+        }
+    }
+
+    if (!mItems.isEmpty())
+    {
+        mNodes.reserve(2 * mItems.size() / kLeafSize + 1);
+        buildNode(0, mItems.size());
+    }
+    mBuilt = true;
+}
+
+void CurveIndex::clear()
+{
+    mItems.clear();
+    mNodes.clear();
+    mBuilt = false;
+}
+
+QVector<CurveIndex::Item> CurveIndex::itemsIn(const QRectF& rect) const
+{
+    QVector<Item> result;
+    if (mNodes.isEmpty()) { return result; }
+
+    QVarLengthArray<int, 64> pending;
+    pending.append(0);
+    while (!pending.isEmpty())
+    {
+        const int index = pending.last();
+        pending.removeLast();
+        const Node& node = mNodes.at(index);
+        if (!overlaps(node.bounds, rect)) { continue; }
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; i++)
+            {
+                if (overlaps(mItems.at(i).bounds, rect)) { result.append(mItems.at(i)); }
+            }
+        }
+        else
+        {
+            pending.append(node.right);
+            pending.append(index + 1);
+        }
+    }
+    return result;
+}
+
+QVector<CurveIndex::Item> CurveIndex::itemsNear(const QPointF& point, qreal distance) const
+{
+    return itemsIn(QRectF(point.x() - distance, point.y() - distance, 2 * distance, 2 * distance));
+}
+
+int CurveIndex::buildNode(int first, int count)
+{
+    const int index = mNodes.size();
+    mNodes.append({ unite(mItems, first, count), first, count, -1 });
+    if (count <= kLeafSize) { return index; }
+
+    // Split at the median along the longer side of the box
+    const QRectF bounds = mNodes.at(index).bounds;
+    const bool alongX = bounds.width() >= bounds.height();
+    auto begin = mItems.begin() + first;
+    std::nth_element(begin, begin + count / 2, begin + count, [alongX](const Item& a, const Item& b) {
+        return alongX ? a.bounds.center().x() < b.bounds.center().x()
+                      : a.bounds.center().y() < b.bounds.center().y();
+    });
+
+    buildNode(first, count / 2);
+    const int right = buildNode(first + count / 2, count - count / 2);
+    mNodes[index].count = 0;
+    mNodes[index].right = right;
+    return index;
+}
+
+QRectF CurveIndex::unite(const QVector<Item>& items, int first, int count)
+{
+    // QRectF::united() skips empty rectangles, single vertex items are points
+    qreal left = items.at(first).bounds.left();
+    qreal top = items.at(first).bounds.top();
+    qreal right = items.at(first).bounds.right();
+    qreal bottom = items.at(first).bounds.bottom();
+    for (int i = first + 1; i < first + count; i++)
+    {
+        const QRectF& bounds = items.at(i).bounds;
+        left = qMin(left, bounds.left());
+        top = qMin(top, bounds.top());
+        right = qMax(right, bounds.right());
+        bottom = qMax(bottom, bounds.bottom());
+    }
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+bool CurveIndex::overlaps(const QRectF& a, const QRectF& b)
+{
+    // Inclusive, so that points and horizontal or vertical sections are found too
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
@@ -0,0 +1,72 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef CURVEINDEX_H
+#define CURVEINDEX_H
+
+#include <QRectF>
+#include <QVector>
+
+class BezierCurve;
+
+/**
+ * A bounding volume hierarchy over the sections of the curves of a vector image,
+ * so that hit testing only looks at the sections around the point or the area in question.
+ *
+ * Each section is kept with the box of its control points, which contains it.
+ * A curve made of a single vertex is kept as one item with section -1.
+ * The index doesn't follow the curves, build() it again once they changed.
+ */
+class CurveIndex
+{
+public:
+    struct Item
+    {
+        QRectF bounds;
+        int curve;
+        int section; // the cubic from vertex section-1 to vertex section
+    };
+
+    void build(const QVector<BezierCurve>& curves);
+    void clear();
+    bool isBuilt() const { return mBuilt; }
+
+    /** The items whose bounds overlap rect, edges included */
+    QVector<Item> itemsIn(const QRectF& rect) const;
+    /** The items whose bounds come within distance of point */
+    QVector<Item> itemsNear(const QPointF& point, qreal distance) const;
+
+    int itemCount() const { return mItems.size(); }
+
+private:
+    struct Node
+    {
+        QRectF bounds;
+        int first;  // first item of a leaf
+        int count;  // number of items of a leaf, 0 for inner nodes
+        int right;  // second child of an inner node, the first one follows it
+    };
+
+    int buildNode(int first, int count);
+    static QRectF unite(const QVector<Item>& items, int first, int count);
+    static bool overlaps(const QRectF& a, const QRectF& b);
+
+    QVector<Item> mItems;
+    QVector<Node> mNodes;
+    bool mBuilt = false;
+};
+
+#endif // CURVEINDEX_H
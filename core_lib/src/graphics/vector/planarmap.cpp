@@ -0,0 +1,383 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "planarmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "beziercurve.h"
+
+const qreal PlanarMap::kNodeTolerance = 0.1;
+
+namespace
+{
+    // The direction a section leaves p0 in, when it's seen from p0 towards p3
+    QPointF leavingDirection(const QPointF& p0, const QPointF& p1, const QPointF& p2, const QPointF& p3)
+    {
+        for (const QPointF& next : { p1, p2, p3 })
+        {
+            const QPointF direction = next - p0;
+            if (std::hypot(direction.x(), direction.y()) > 1e-9) { return direction; }
+        }
+        return QPointF(1, 0);
+    }
+
+    QPointF cubicPoint(const QPointF& p0, const QPointF& p1, const QPointF& p2, const QPointF& p3, qreal t)
+    {
+        const qreal mt = 1 - t;
+        return mt * mt * mt * p0 + 3 * mt * mt * t * p1 + 3 * mt * t * t * p2 + t * t * t * p3;
+    }
+
+    int findComponent(QVector<int>& parent, int node)
+    {
+        while (parent.at(node) != node)
+        {
+            parent[node] = parent.at(parent.at(node));
+            node = parent.at(node);
+        }
+        return node;
+    }
+}
+
+void PlanarMap::update(const QVector<BezierCurve>& curves)
+{
+    QMultiHash<quint64, int> previous;
+    for (int i = 0; i < mRecords.size(); i++)
+    {
+        previous.insert(mRecords.at(i).signature, i);
+    }
+
+    // Keep the records of the curves that didn't change, wherever they moved to
+    QVector<CurveRecord> records(curves.size());
+    QVector<bool> kept(mRecords.size(), false);
+    QVector<int> added;
+    bool changed = false;
+    for (int i = 0; i < curves.size(); i++)
+    {
+        const quint64 curveSignature = signature(curves.at(i));
+        int match = -1;
+        if (i < mRecords.size() && !kept.at(i) && mRecords.at(i).signature == curveSignature)
+        {
+            match = i;
+        }
+        else
+        {
+            for (auto it = previous.constFind(curveSignature); it != previous.constEnd() && it.key() == curveSignature; ++it)
+            {
+                if (!kept.at(it.value())) { match = it.value(); break; }
+            }
+        }
+
+        if (match != -1)
+        {
+            kept[match] = true;
+            records[i] = mRecords.at(match);
+            changed |= (match != i); // the vertex refs of its faces change
+        }
+        else
+        {
+            records[i].signature = curveSignature;
+            added.append(i);
+        }
+    }
+
+    for (int i = 0; i < mRecords.size(); i++)
+    {
+        if (kept.at(i)) { continue; }
+        for (int node : mRecords.at(i).nodes)
+        {
+            releaseNode(node);
+        }
+        changed = true;
+    }
+    for (int i : added)
+    {
+        const BezierCurve& curve = curves.at(i);
+        records[i].nodes.reserve(curve.getVertexSize() + 1);
+        for (int vertex = -1; vertex < curve.getVertexSize(); vertex++)
+        {
+            records[i].nodes.append(acquireNode(curve.getVertex(vertex)));
+        }
+        changed = true;
+    }
+    mRecords = records;
+
+    if (changed)
+    {
+        traceFaces(curves);
+    }
+}
+
+void PlanarMap::clear()
+{
+    mRecords.clear();
+    mNodes.clear();
+    mFreeNodes.clear();
+    mNodeGrid.clear();
+    mFaces.clear();
+}
+
+int PlanarMap::faceAt(const QPointF& point) const
+{
+    int result = -1;
+    for (int i = 0; i < mFaces.size(); i++)
+    {
+        const Face& face = mFaces.at(i);
+        if (!face.bounds.contains(point)) { continue; }
+        if (result != -1 && face.area >= mFaces.at(result).area) { continue; }
+        if (face.path.contains(point))
+        {
+            result = i;
+        }
+    }
+    return result;
+}
+
+quint64 PlanarMap::signature(const BezierCurve& curve)
+{
+    // FNV-1a over everything the faces are made of
+    quint64 hash = 14695981039346656037ULL;
+    auto add = [&hash](qreal value)
+    {
+        unsigned char bytes[sizeof(qreal)];
+        std::memcpy(bytes, &value, sizeof(qreal));
+        for (unsigned char byte : bytes)
+        {
+            hash = (hash ^ byte) * 1099511628211ULL;
+        }
+    };
+    auto addPoint = [&add](const QPointF& point)
+    {
+        add(point.x());
+        add(point.y());
+    };
+
+    add(curve.getVertexSize());
+    addPoint(curve.getOrigin());
+    for (int i = 0; i < curve.getVertexSize(); i++)
+    {
+        addPoint(curve.getC1(i));
+        addPoint(curve.getC2(i));
+        addPoint(curve.getVertex(i));
+    }
+    return hash;
+}
+
+int PlanarMap::acquireNode(const QPointF& position)
+{
+    const int x = static_cast<int>(std::floor(position.x() / kNodeTolerance));
+    const int y = static_cast<int>(std::floor(position.y() / kNodeTolerance));
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            const qint64 key = cellKey(x + dx, y + dy);
+            for (auto it = mNodeGrid.constFind(key); it != mNodeGrid.constEnd() && it.key() == key; ++it)
+            {
+                Node& node = mNodes[it.value()];
+                const QPointF offset = node.position - position;
+                if (std::hypot(offset.x(), offset.y()) <= kNodeTolerance)
+                {
+                    node.references++;
+                    return it.value();
+                }
+            }
+        }
+    }
+
+    int index = mNodes.size();
+    if (!mFreeNodes.isEmpty())
+    {
+        index = mFreeNodes.takeLast();
+    }
+    else
+    {
+        mNodes.append(Node());
+    }
+    mNodes[index].position = position;
+    mNodes[index].references = 1;
+    mNodeGrid.insert(cellKey(x, y), index);
+    return index;
+}
+
+void PlanarMap::releaseNode(int index)
+{
+    Node& node = mNodes[index];
+    if (--node.references > 0) { return; }
+
+    const int x = static_cast<int>(std::floor(node.position.x() / kNodeTolerance));
+    const int y = static_cast<int>(std::floor(node.position.y() / kNodeTolerance));
+    mNodeGrid.remove(cellKey(x, y), index);
+    mFreeNodes.append(index);
+}
+
+void PlanarMap::traceFaces(const QVector<BezierCurve>& curves)
+{
+    mFaces.clear();
+
+    // Two half-edges per section, going forwards then backwards
+    QVector<HalfEdge> halfEdges;
+    QVector<QVector<int>> leaving(mNodes.size());
+    QVector<int> component(mNodes.size());
+    for (int i = 0; i < component.size(); i++) { component[i] = i; }
+
+    for (int c = 0; c < mRecords.size(); c++)
+    {
+        const BezierCurve& curve = curves.at(c);
+        const QVector<int>& nodes = mRecords.at(c).nodes;
+        for (int i = 0; i < curve.getVertexSize(); i++)
+        {
+            const QPointF p0 = curve.getVertex(i - 1);
+            const QPointF p1 = curve.getC1(i);
+            const QPointF p2 = curve.getC2(i);
+            const QPointF p3 = curve.getVertex(i);
+            if (nodes.at(i) == nodes.at(i + 1) &&
+                BezierCurve::eLength(p1 - p0) <= kNodeTolerance && BezierCurve::eLength(p2 - p0) <= kNodeTolerance)
+            {
+                continue; // a section that collapsed to a point
+            }
+
+            const QPointF out = leavingDirection(p0, p1, p2, p3);
+            const QPointF back = leavingDirection(p3, p2, p1, p0);
+            halfEdges.append({ c, i, true, nodes.at(i), nodes.at(i + 1), std::atan2(out.y(), out.x()) });
+            halfEdges.append({ c, i, false, nodes.at(i + 1), nodes.at(i), std::atan2(back.y(), back.x()) });
+            leaving[nodes.at(i)].append(halfEdges.size() - 2);
+            leaving[nodes.at(i + 1)].append(halfEdges.size() - 1);
+            component[findComponent(component, nodes.at(i))] = findComponent(component, nodes.at(i + 1));
+        }
+    }
+
+    // The half-edges around each node, counterclockwise
+    QVector<int> slot(halfEdges.size());
+    for (QVector<int>& around : leaving)
+    {
+        std::sort(around.begin(), around.end(), [&halfEdges](int a, int b) { return halfEdges.at(a).angle < halfEdges.at(b).angle; });
+        for (int k = 0; k < around.size(); k++) { slot[around.at(k)] = k; }
+    }
+
+    auto controlPoints = [&](const HalfEdge& edge, QPointF points[4])
+    {
+        const BezierCurve& curve = curves.at(edge.curve);
+        points[0] = curve.getVertex(edge.section - 1);
+        points[1] = curve.getC1(edge.section);
+        points[2] = curve.getC2(edge.section);
+        points[3] = curve.getVertex(edge.section);
+        if (!edge.forward)
+        {
+            std::swap(points[0], points[3]);
+            std::swap(points[1], points[2]);
+        }
+    };
+
+    // Walking each cycle keeping the face on the same side: faces have a positive area,
+    // the outer side of each connected shape a negative or zero one.
+    struct Cycle
+    {
+        QPainterPath path;
+        QList<VertexRef> boundary;
+        qreal area;
+        int component;
+        QPointF start;
+    };
+    QVector<Cycle> faces;
+    QVector<Cycle> outsides;
+    QVector<bool> visited(halfEdges.size(), false);
+    for (int first = 0; first < halfEdges.size(); first++)
+    {
+        if (visited.at(first)) { continue; }
+
+        Cycle cycle;
+        cycle.area = 0;
+        cycle.component = findComponent(component, halfEdges.at(first).from);
+        int edge = first;
+        int steps = 0;
+        do
+        {
+            visited[edge] = true;
+            const HalfEdge& halfEdge = halfEdges.at(edge);
+            QPointF points[4];
+            controlPoints(halfEdge, points);
+            if (steps == 0)
+            {
+                cycle.start = points[0];
+                cycle.path.moveTo(points[0]);
+            }
+            cycle.path.cubicTo(points[1], points[2], points[3]);
+
+            // Shoelace over a few points of each section is plenty to tell faces apart
+            QPointF previous = points[0];
+            for (int k = 1; k <= 8; k++)
+            {
+                const QPointF point = cubicPoint(points[0], points[1], points[2], points[3], k / 8.0);
+                cycle.area += (previous.x() * point.y() - point.x() * previous.y()) / 2;
+                previous = point;
+            }
+
+            const VertexRef from(halfEdge.curve, halfEdge.forward ? halfEdge.section - 1 : halfEdge.section);
+            const VertexRef to(halfEdge.curve, halfEdge.forward ? halfEdge.section : halfEdge.section - 1);
+            if (cycle.boundary.isEmpty() || cycle.boundary.last() != from) { cycle.boundary.append(from); }
+            cycle.boundary.append(to);
+
+            const QVector<int>& around = leaving.at(halfEdge.to);
+            edge = around.at((slot.at(edge ^ 1) + around.size() - 1) % around.size());
+        }
+        while (edge != first && ++steps < halfEdges.size());
+
+        cycle.path.closeSubpath();
+        if (cycle.boundary.size() > 1 && cycle.boundary.first() == cycle.boundary.last()) { cycle.boundary.removeLast(); }
+
+        if (cycle.area > 1e-6)
+        {
+            faces.append(cycle);
+        }
+        else
+        {
+            outsides.append(cycle);
+        }
+    }
+
+    mFaces.reserve(faces.size());
+    for (const Cycle& cycle : faces)
+    {
+        Face face;
+        face.boundary = cycle.boundary;
+        face.path = cycle.path;
+        face.bounds = cycle.path.boundingRect();
+        face.area = cycle.area;
+        mFaces.append(face);
+    }
+
+    // A shape lying inside a face cuts a hole in the innermost face around it
+    for (const Cycle& outside : outsides)
+    {
+        int parent = -1;
+        for (int i = 0; i < faces.size(); i++)
+        {
+            const Cycle& face = faces.at(i);
+            if (face.component == outside.component) { continue; }
+            if (parent != -1 && face.area >= faces.at(parent).area) { continue; }
+            if (mFaces.at(i).bounds.contains(outside.start) && face.path.contains(outside.start))
+            {
+                parent = i;
+            }
+        }
+        if (parent != -1)
+        {
+            mFaces[parent].path.addPath(outside.path);
+        }
+    }
+}
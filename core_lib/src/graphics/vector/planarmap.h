@@ -0,0 +1,97 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef PLANARMAP_H
+#define PLANARMAP_H
+
+#include <QHash>
+#include <QPainterPath>
+#include <QVector>
+#include "vertexref.h"
+
+class BezierCurve;
+
+/**
+ * The curves of a vector image seen as a planar map: curve vertices are nodes, and
+ * vertices of different curves at the same place share one. The sections of the
+ * curves are the edges, and the regions they enclose are the faces that can be filled.
+ *
+ * update() compares the curves with the ones the map was built from, so only curves
+ * that were added, removed or changed are taken out of or put into the node table.
+ * Faces are traced again only when an edge changed.
+ */
+class PlanarMap
+{
+public:
+    struct Face
+    {
+        /** The vertices along the outer boundary, in the form BezierArea expects */
+        QList<VertexRef> boundary;
+        /** The boundary, and the outlines of the shapes lying inside the face */
+        QPainterPath path;
+        QRectF bounds;
+        qreal area = 0;
+    };
+
+    void update(const QVector<BezierCurve>& curves);
+    void clear();
+
+    /** The innermost face around point, or -1 */
+    int faceAt(const QPointF& point) const;
+    int faceCount() const { return mFaces.size(); }
+    const Face& face(int index) const { return mFaces.at(index); }
+    int nodeCount() const { return mNodes.size() - mFreeNodes.size(); }
+
+    /** Vertices closer than this become the same node */
+    static const qreal kNodeTolerance;
+
+private:
+    struct Node
+    {
+        QPointF position;
+        int references = 0;
+    };
+
+    struct CurveRecord
+    {
+        quint64 signature = 0;
+        QVector<int> nodes; // the node of vertex -1, 0, 1, ...
+    };
+
+    struct HalfEdge
+    {
+        int curve;
+        int section;
+        bool forward;
+        int from;
+        int to;
+        qreal angle;
+    };
+
+    static quint64 signature(const BezierCurve& curve);
+    int acquireNode(const QPointF& position);
+    void releaseNode(int node);
+    qint64 cellKey(int x, int y) const { return (static_cast<qint64>(x) << 32) ^ static_cast<quint32>(y); }
+    void traceFaces(const QVector<BezierCurve>& curves);
+
+    QVector<CurveRecord> mRecords;
+    QVector<Node> mNodes;
+    QVector<int> mFreeNodes;
+    QMultiHash<qint64, int> mNodeGrid;
+    QVector<Face> mFaces;
+};
+
+#endif // PLANARMAP_H
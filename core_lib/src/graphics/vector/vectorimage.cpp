@@ -16,11 +16,16 @@ GNU General Public License for more details.
 */
 #include "vectorimage.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <QImage>
 #include <QFile>
 #include <QFileInfo>
+#include <QBuffer>
+#include <QDataStream>
 #include <QDebug>
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include "object.h"
 #include "util.h"
@@ -33,6 +38,7 @@ VectorImage::VectorImage()
 
 VectorImage::VectorImage(const VectorImage& v2) : KeyFrame(v2)
 {
+    v2.ensureLoaded();
     deselectAll();
     mCurves = v2.mCurves;
     mArea = v2.mArea;
@@ -50,11 +56,15 @@ VectorImage& VectorImage::operator=(const VectorImage& a) {
         return *this; // a self-assignment
     }
 
+    a.ensureLoaded();
+    mLoaded = true; // whatever was in the file is replaced
     deselectAll();
     KeyFrame::operator=(a);
     mCurves = a.mCurves;
     mArea = a.mArea;
     mOpacity = a.mOpacity;
+    mAreaPathsVersion = -1;
+    mCurveIndex.clear();
     modification();
     return *this;
 }
@@ -66,41 +76,165 @@ VectorImage* VectorImage::clone() const
     return v;
 }
 
+VectorImage* VectorImage::snapshot() const
+{
+    VectorImage* v = clone();
+
+    // The curves cache their outlines, painting them from two threads must not go through the same instances
+    v->mCurves.detach();
+    v->mArea.detach();
+    return v;
+}
+
+void VectorImage::replaceDrawing(const VectorImage& other)
+{
+    if (this == &other) { return; }
+
+    other.ensureLoaded();
+    mLoaded = true;
+    deselectAll();
+    mCurves = other.mCurves;
+    mArea = other.mArea;
+    mAreaPathsVersion = -1;
+    mCurveIndex.clear();
+    modification();
+}
+
+void VectorImage::loadFile()
+{
+    load();
+}
+
+Status VectorImage::load()
+{
+    if (mLoaded || fileName().isEmpty())
+    {
+        mLoaded = true;
+        return Status::SAFE;
+    }
+
+    // Set first, reading goes through the same functions that load the image on demand
+    mLoaded = true;
+    const QString filePath = fileName();
+    Status st = read(filePath);
+    if (!st.ok())
+    {
+        mCurves.clear();
+        mArea.clear();
+        mCurveIndex.clear();
+        setFileName(filePath);
+        setModified(false);
+    }
+    return st;
+}
+
+void VectorImage::unloadFile()
+{
+    // Only what can be read back from the file can be dropped
+    if (mLoaded && !isModified() && !fileName().isEmpty() && QFile::exists(fileName()))
+    {
+        // Count the colors while they are at hand, a frame that was never read has nothing to count
+        if (!colorUsageKnown() && !(mCurves.isEmpty() && mArea.isEmpty()))
+        {
+            colorUsage();
+        }
+        mCurves.clear();
+        mArea.clear();
+        mCurveDisplayOrders.clear();
+        mSelectionRect = QRectF();
+        mSelectionTransformation.reset();
+        mPlanarMap.clear();
+        mAreaPathsVersion = -1;
+        mCurveIndex.clear();
+        mLoaded = false;
+    }
+}
+
+quint64 VectorImage::memoryUsage()
+{
+    if (!mLoaded)
+    {
+        return 0;
+    }
+
+    // An estimate, the lists hold three points, a pressure and a selection flag per vertex
+    const quint64 bytesPerVertex = 3 * sizeof(QPointF) + sizeof(float) + sizeof(bool) + 5 * sizeof(void*);
+    quint64 bytes = 0;
+    for (const BezierCurve& curve : mCurves)
+    {
+        bytes += sizeof(BezierCurve) + (curve.getVertexSize() + 1) * bytesPerVertex;
+    }
+    for (const BezierArea& area : mArea)
+    {
+        bytes += sizeof(BezierArea) + area.mVertex.size() * (sizeof(VertexRef) + sizeof(void*))
+               + area.mPath.elementCount() * sizeof(QPainterPath::Element);
+    }
+    return bytes;
+}
+
 /**
  * @brief VectorImage::read
- * @return True if file was read successfully from path
+ * @param filePath: QString
+ * @return Status
  */
-bool VectorImage::read(QString filePath)
+Status VectorImage::read(QString filePath)
 {
+    DebugDetails debugInfo;
+    debugInfo << "VectorImage::read";
+    debugInfo << QString("filePath = ").append(filePath);
+
     QFileInfo fileInfo(filePath);
     if (fileInfo.isDir())
     {
-        return false;
+        debugInfo << "Error: the path is a folder";
+        return Status(Status::FAIL, debugInfo);
     }
 
     QFile file(filePath);
     if (!file.open(QFile::ReadOnly))
     {
-        return false;
+        debugInfo << ("file.error() = " + file.errorString());
+        return Status(Status::FAIL, debugInfo);
     }
 
-    QDomDocument doc;
-    if (!doc.setContent(&file)) return false; // this is not a XML file
-    QDomDocumentType type = doc.doctype();
-    if (type.name() != "PencilVectorImage") return false; // this is not a Pencil document
-
-    QDomElement element = doc.documentElement();
-    if (element.tagName() == "image")
+    if (file.peek(4) == "PVEC")
     {
-        if (element.attribute("type") == "vector")
+        Status st = readBinary(&file);
+        if (!st.ok())
         {
-            loadDomElement(element);
+            debugInfo.collect(st.details());
+            return Status(Status::FAIL, debugInfo);
+        }
+    }
+    else
+    {
+        QXmlStreamReader xmlStream(&file);
+        const QString docType = readXmlDocType(xmlStream);
+        if (xmlStream.hasError() || docType != "PencilVectorImage")
+        {
+            debugInfo << "Error: not a Pencil vector image";
+            return Status(Status::FAIL, debugInfo);
+        }
+
+        if (xmlStream.name() == QLatin1String("image"))
+        {
+            if (xmlStream.attributes().value("type") == QLatin1String("vector"))
+            {
+                loadDomElement(xmlStream);
+            }
+        }
+        if (xmlStream.hasError())
+        {
+            debugInfo << ("xml error = " + xmlStream.errorString());
+            return Status(Status::FAIL, debugInfo);
         }
     }
 
     setFileName(filePath);
     setModified(false);
-    return true;
+    mAreaPathsVersion = -1;
+    mCurveIndex.clear();
+    return Status::OK;
 }
 
 /**
@@ -111,11 +245,18 @@ bool VectorImage::read(QString filePath)
  */
 Status VectorImage::write(QString filePath, QString format)
 {
+    ensureLoaded();
     DebugDetails debugInfo;
     debugInfo << "VectorImage::write";
     debugInfo << QString("filePath = ").append(filePath);
     debugInfo << QString("format = ").append(format);
 
+    if (format != "VEC" && format != "VECB")
+    {
+        debugInfo << "Unrecognized format";
+        return Status(Status::FAIL, debugInfo);
+    }
+
     QFile file(filePath);
     bool result = file.open(QIODevice::WriteOnly);
     if (!result)
@@ -125,10 +266,16 @@ Status VectorImage::write(QString filePath, QString format)
         return Status(Status::FAIL, debugInfo);
     }
 
-    if (format != "VEC")
+    if (format == "VECB")
     {
-        debugInfo << "Unrecognized format";
-        return Status(Status::FAIL, debugInfo);
+        Status st = writeBinary(&file);
+        if (!st.ok())
+        {
+            debugInfo.collect(st.details());
+            return Status(Status::FAIL, debugInfo);
+        }
+        setFileName(filePath);
+        return Status::OK;
     }
 
     QXmlStreamWriter xmlStream(&file);
@@ -153,6 +300,133 @@ Status VectorImage::write(QString filePath, QString format)
     return Status::OK;
 }
 
+namespace
+{
+    const char* const BINARY_MAGIC = "PVEC";
+    const quint16 BINARY_VERSION = 1;
+    const quint16 BINARY_COMPRESSED = 1;
+}
+
+Status VectorImage::writeBinary(QIODevice* device, bool compressed)
+{
+    ensureLoaded();
+
+    QByteArray body;
+    {
+        QDataStream out(&body, QIODevice::WriteOnly);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        out << quint32(mCurves.size());
+        for (const BezierCurve& curve : mCurves)
+        {
+            curve.writeBinary(out);
+        }
+        out << quint32(mArea.size());
+        for (const BezierArea& area : mArea)
+        {
+            area.writeBinary(out);
+        }
+    }
+    if (compressed)
+    {
+        body = qCompress(body);
+    }
+
+    QDataStream header(device);
+    header.setByteOrder(QDataStream::LittleEndian);
+    header.writeRawData(BINARY_MAGIC, 4);
+    header << BINARY_VERSION << quint16(compressed ? BINARY_COMPRESSED : 0);
+    header.writeRawData(body.constData(), body.size());
+
+    if (header.status() != QDataStream::Ok)
+    {
+        DebugDetails dd;
+        dd << "VectorImage::writeBinary";
+        dd << QString("- %1 bytes could not be written").arg(body.size() + 8);
+        return Status(Status::FAIL, dd);
+    }
+    return Status::OK;
+}
+
+Status VectorImage::readBinary(QIODevice* device)
+{
+    DebugDetails dd;
+    dd << "VectorImage::readBinary";
+
+    QDataStream header(device);
+    header.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[4];
+    quint16 version = 0;
+    quint16 flags = 0;
+    if (header.readRawData(magic, 4) != 4 || memcmp(magic, BINARY_MAGIC, 4) != 0)
+    {
+        dd << "- Not a binary vector image";
+        return Status(Status::FAIL, dd);
+    }
+    header >> version >> flags;
+    if (version > BINARY_VERSION)
+    {
+        dd << QString("- Version %1 is newer than this build supports").arg(version);
+        return Status(Status::FAIL, dd);
+    }
+
+    QByteArray body = device->readAll();
+    if (flags & BINARY_COMPRESSED)
+    {
+        body = qUncompress(body);
+    }
+    QBuffer buffer(&body);
+    buffer.open(QIODevice::ReadOnly);
+
+    QDataStream in(&buffer);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    QVector<BezierCurve> curves;
+    quint32 curveCount = 0;
+    in >> curveCount;
+    for (quint32 i = 0; i < curveCount && in.status() == QDataStream::Ok; i++)
+    {
+        BezierCurve curve;
+        if (!curve.readBinary(in))
+        {
+            dd << QString("- curve[%1] is corrupted").arg(i);
+            return Status(Status::FAIL, dd);
+        }
+        curves.append(curve);
+    }
+
+    QList<BezierArea> areas;
+    quint32 areaCount = 0;
+    in >> areaCount;
+    for (quint32 i = 0; i < areaCount && in.status() == QDataStream::Ok; i++)
+    {
+        BezierArea area;
+        if (!area.readBinary(in))
+        {
+            dd << QString("- area[%1] is corrupted").arg(i);
+            return Status(Status::FAIL, dd);
+        }
+        areas.append(area);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        dd << "- The data ends too early";
+        return Status(Status::FAIL, dd);
+    }
+
+    mCurves.append(curves);
+    for (const BezierArea& area : areas)
+    {
+        addArea(area);
+    }
+    clean();
+    return Status::OK;
+}
+
 /**
  * @brief VectorImage::createDomElement
  * @param xmlStream: QXmlStreamWriter&
@@ -160,6 +434,7 @@ Status VectorImage::write(QString filePath, QString format)
  */
 Status VectorImage::createDomElement(QXmlStreamWriter& xmlStream)
 {
+    ensureLoaded();
     DebugDetails debugInfo;
     debugInfo << "VectorImage::createDomElement";
 
@@ -188,36 +463,37 @@ Status VectorImage::createDomElement(QXmlStreamWriter& xmlStream)
 
 /**
  * @brief VectorImage::loadDomElement
- * @param element: QDomElement
+ * @param xmlStream: QXmlStreamReader& at the image element, left at the end of it
  */
-void VectorImage::loadDomElement(QDomElement element)
+void VectorImage::loadDomElement(QXmlStreamReader& xmlStream)
 {
-    QDomNode atomTag = element.firstChild(); // an atom in a vector picture is a curve or an area
-    while (!atomTag.isNull())
+    while (xmlStream.readNextStartElement()) // an atom in a vector picture is a curve or an area
     {
-        QDomElement atomElement = atomTag.toElement();
-        if (!atomElement.isNull())
+        if (xmlStream.name() == QLatin1String("curve"))
         {
-            if (atomElement.tagName() == "curve")
-            {
-                BezierCurve newCurve;
-                newCurve.loadDomElement(atomElement);
-                mCurves.append(newCurve);
-            }
-            if (atomElement.tagName() == "area")
-            {
-                BezierArea newArea;
-                newArea.loadDomElement(atomElement);
-                addArea(newArea);
-            }
+            BezierCurve newCurve;
+            newCurve.loadDomElement(xmlStream);
+            mCurves.append(newCurve);
+        }
+        else if (xmlStream.name() == QLatin1String("area"))
+        {
+            BezierArea newArea;
+            newArea.loadDomElement(xmlStream);
+            addArea(newArea);
+        }
+        else
+        {
+            xmlStream.skipCurrentElement();
         }
-        atomTag = atomTag.nextSibling();
     }
     clean();
 }
 
 BezierCurve& VectorImage::curve(int i)
 {
+    ensureLoaded();
+    // The curve may be changed through the reference
+    mCurveIndex.clear();
     return mCurves[i];
 }
 
@@ -263,6 +539,7 @@ void VectorImage::addPoint(int curveNumber, int vertexNumber, qreal fraction)
             }
         }
     }
+    mCurveIndex.clear();
     modification();
 }
 
@@ -272,6 +549,7 @@ void VectorImage::addPoint(int curveNumber, int vertexNumber, qreal fraction)
  */
 void VectorImage::removeCurveAt(int i)
 {
+    ensureLoaded();
     // first change the curve numbers in the areas
     for (int j = 0; j < mArea.size(); j++)
     {
@@ -282,6 +560,7 @@ void VectorImage::removeCurveAt(int i)
     }
     // then remove curve
     mCurves.removeAt(i);
+    mCurveIndex.clear();
     modification();
 }
 
@@ -294,6 +573,7 @@ void VectorImage::removeCurveAt(int i)
  */
 void VectorImage::insertCurve(int position, BezierCurve& newCurve, qreal factor, bool interacts)
 {
+    ensureLoaded();
     if (newCurve.getVertexSize() < 1) // security - a new curve should have a least 2 vertices
         return;
 
@@ -329,6 +609,7 @@ void VectorImage::insertCurve(int position, BezierCurve& newCurve, qreal factor,
         mCurves.insert(position, newCurve);
     }
     updateImageSize(newCurve);
+    mCurveIndex.clear();
     modification();
 }
 
@@ -340,6 +621,7 @@ void VectorImage::insertCurve(int position, BezierCurve& newCurve, qreal factor,
  */
 void VectorImage::addCurve(BezierCurve& newCurve, qreal factor, bool interacts)
 {
+    ensureLoaded();
     insertCurve(-1, newCurve, factor, interacts);
 }
 
@@ -594,10 +876,22 @@ void VectorImage::checkCurveIntersections(BezierCurve& newCurve, qreal tolerance
 
 void VectorImage::select(QRectF rectangle)
 {
+    ensureLoaded();
+    updateCurveIndex();
+
+    // A curve is selected when one of its vertices is inside, see BezierCurve::intersects()
+    QVector<bool> inside(mCurves.size(), false);
+    for (const CurveIndex::Item& item : mCurveIndex.itemsIn(rectangle))
+    {
+        if (item.section >= 0 && rectangle.contains(mCurves.at(item.curve).getVertex(item.section)))
+        {
+            inside[item.curve] = true;
+        }
+    }
+
     for (int i = 0; i < mCurves.size(); i++)
     {
-        bool bSelected = mCurves[i].intersects(rectangle);
-        setSelected(i, bSelected);
+        setSelected(i, inside.at(i));
     }
 
     for (int i = 0; i < mArea.size(); i++)
@@ -615,6 +909,7 @@ void VectorImage::select(QRectF rectangle)
  */
 void VectorImage::setSelected(int curveNumber, bool YesOrNo)
 {
+    ensureLoaded();
     if (mCurves.isEmpty()) return;
 
     mCurves[curveNumber].setSelected(YesOrNo);
@@ -632,6 +927,7 @@ void VectorImage::setSelected(int curveNumber, bool YesOrNo)
  */
 void VectorImage::setSelected(int curveNumber, int vertexNumber, bool YesOrNo)
 {
+    ensureLoaded();
     if (mCurves.isEmpty()) return;
     mCurves[curveNumber].setSelected(vertexNumber, YesOrNo);
     QPointF vertex = getVertex(curveNumber, vertexNumber);
@@ -647,6 +943,7 @@ void VectorImage::setSelected(int curveNumber, int vertexNumber, bool YesOrNo)
  */
 void VectorImage::setSelected(VertexRef vertexRef, bool YesOrNo)
 {
+    ensureLoaded();
     setSelected(vertexRef.curveNumber, vertexRef.vertexNumber, YesOrNo);
 }
 
@@ -657,6 +954,7 @@ void VectorImage::setSelected(VertexRef vertexRef, bool YesOrNo)
  */
 void VectorImage::setSelected(QList<int> curveList, bool YesOrNo)
 {
+    ensureLoaded();
     for (int i = 0; i < curveList.size(); i++)
     {
         setSelected(curveList.at(i), YesOrNo);
@@ -670,6 +968,7 @@ void VectorImage::setSelected(QList<int> curveList, bool YesOrNo)
  */
 void VectorImage::setSelected(QList<VertexRef> vertexList, bool YesOrNo)
 {
+    ensureLoaded();
     for (int i = 0; i < vertexList.size(); i++)
     {
         setSelected(vertexList.at(i), YesOrNo);
@@ -683,6 +982,7 @@ void VectorImage::setSelected(QList<VertexRef> vertexList, bool YesOrNo)
  */
 void VectorImage::setAreaSelected(int areaNumber, bool YesOrNo)
 {
+    ensureLoaded();
     mArea[areaNumber].setSelected(YesOrNo);
     if (YesOrNo) mSelectionRect |= mArea[areaNumber].mPath.boundingRect();
     modification();
@@ -695,6 +995,7 @@ void VectorImage::setAreaSelected(int areaNumber, bool YesOrNo)
  */
 bool VectorImage::isAreaSelected(int areaNumber)
 {
+    ensureLoaded();
     return mArea[areaNumber].isSelected();
 }
 
@@ -704,6 +1005,7 @@ bool VectorImage::isAreaSelected(int areaNumber)
  */
 bool VectorImage::isPathFilled()
 {
+    ensureLoaded();
     bool filled = false;
     QList<int> curveNumbers = getSelectedCurveNumbers();
     for (int curveNum : curveNumbers)
@@ -725,6 +1027,7 @@ bool VectorImage::isPathFilled()
  */
 bool VectorImage::isSelected(int curveNumber)
 {
+    ensureLoaded();
     return mCurves[curveNumber].isSelected();
 }
 
@@ -736,6 +1039,7 @@ bool VectorImage::isSelected(int curveNumber)
  */
 bool VectorImage::isSelected(int curveNumber, int vertexNumber)
 {
+    ensureLoaded();
     return mCurves[curveNumber].isSelected(vertexNumber);
 }
 
@@ -746,6 +1050,7 @@ bool VectorImage::isSelected(int curveNumber, int vertexNumber)
  */
 bool VectorImage::isSelected(VertexRef vertexRef)
 {
+    ensureLoaded();
     return isSelected(vertexRef.curveNumber, vertexRef.vertexNumber);
 }
 
@@ -756,6 +1061,7 @@ bool VectorImage::isSelected(VertexRef vertexRef)
  */
 bool VectorImage::isSelected(QList<int> curveList)
 {
+    ensureLoaded();
     bool result = true;
     for (int i = 0; i < curveList.size(); i++)
     {
@@ -771,6 +1077,7 @@ bool VectorImage::isSelected(QList<int> curveList)
  */
 bool VectorImage::isSelected(QList<VertexRef> vertexList)
 {
+    ensureLoaded();
     bool result = true;
     for (int i = 0; i < vertexList.size(); i++)
     {
@@ -785,6 +1092,7 @@ bool VectorImage::isSelected(QList<VertexRef> vertexList)
  */
 int VectorImage::getFirstSelectedCurve()
 {
+    ensureLoaded();
     int result = -1;
     for (int i = 0; i < mCurves.size() && result == -1; i++)
     {
@@ -799,6 +1107,7 @@ int VectorImage::getFirstSelectedCurve()
  */
 int VectorImage::getFirstSelectedArea()
 {
+    ensureLoaded();
     int result = -1;
     for (int i = 0; i < mArea.size() && result == -1; i++)
     {
@@ -812,6 +1121,7 @@ int VectorImage::getFirstSelectedArea()
  */
 void VectorImage::selectAll()
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         setSelected(i, true);
@@ -825,6 +1135,7 @@ void VectorImage::selectAll()
  */
 bool VectorImage::isAnyCurveSelected()
 {
+    ensureLoaded();
     if (mCurves.isEmpty()) return false;
     for (int curve = 0; curve < mCurves.size(); curve++)
     {
@@ -838,6 +1149,7 @@ bool VectorImage::isAnyCurveSelected()
  */
 void VectorImage::deselectAll()
 {
+    ensureLoaded();
     if (mCurves.empty()) return;
     for (int i = 0; i < mCurves.size(); i++)
     {
@@ -858,20 +1170,20 @@ void VectorImage::deselectAll()
  */
 void VectorImage::setSelectionRect(QRectF rectangle)
 {
+    ensureLoaded();
     mSelectionRect = rectangle;
     select(rectangle);
 }
 
 QRectF VectorImage::getBoundsOfTransformedCurves() const
 {
+    ensureLoaded();
     QRectF bounds;
     for (int i = 0; i < mCurves.size(); i++)
     {
-        BezierCurve curve;
         if (mCurves.at(i).isPartlySelected())
         {
-            curve = mCurves[i].transformed(mSelectionTransformation);
-            bounds |= curve.getBoundingRect();
+            bounds |= mCurves.at(i).transformed(mSelectionTransformation).getBoundingRect();
         }
     }
     return bounds;
@@ -882,6 +1194,7 @@ QRectF VectorImage::getBoundsOfTransformedCurves() const
  */
 void VectorImage::calculateSelectionRect()
 {
+    ensureLoaded();
     mSelectionRect = QRectF(0, 0, 0, 0);
     for (int i = 0; i < mCurves.size(); i++)
     {
@@ -905,6 +1218,7 @@ void VectorImage::setSelectionTransformation(QTransform transform)
  */
 void VectorImage::deleteSelection()
 {
+    ensureLoaded();
     // ---- deletes areas
     for (int i = 0; i < mArea.size(); i++)
     {
@@ -941,6 +1255,7 @@ void VectorImage::deleteSelection()
             i--;
         }
     }
+    mCurveIndex.clear();
     modification();
 }
 
@@ -951,6 +1266,7 @@ void VectorImage::deleteSelection()
  */
 void VectorImage::removeVertex(int curve, int vertex)
 {
+    ensureLoaded();
     // first eliminates areas which are associated to this point
     for (int j = 0; j < mArea.size(); j++)
     {
@@ -1022,6 +1338,8 @@ void VectorImage::removeVertex(int curve, int vertex)
         removeCurveAt(curve);
         curve--;
     }
+    mCurveIndex.clear();
+    modification();
 }
 
 /**
@@ -1029,6 +1347,7 @@ void VectorImage::removeVertex(int curve, int vertex)
  */
 void VectorImage::deleteSelectedPoints()
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         for (int m = -1; m < getCurveSize(i); m++)
@@ -1048,6 +1367,7 @@ void VectorImage::deleteSelectedPoints()
  */
 void VectorImage::paste(VectorImage& vectorImage)
 {
+    ensureLoaded();
     mSelectionRect = QRect(0, 0, 0, 0);
     int n = mCurves.size();
     QList<int> selectedCurves;
@@ -1086,6 +1406,7 @@ void VectorImage::paste(VectorImage& vectorImage)
         }
         if (ok) mArea.append(newArea);
     }
+    mCurveIndex.clear();
     modification();
 }
 
@@ -1096,6 +1417,7 @@ void VectorImage::paste(VectorImage& vectorImage)
  */
 int VectorImage::getColorNumber(QPointF point)
 {
+    ensureLoaded();
     int result = -1;
     int areaNumber = getLastAreaNumber(point);
     if (areaNumber != -1)
@@ -1111,6 +1433,7 @@ int VectorImage::getColorNumber(QPointF point)
  */
 int VectorImage::getCurvesColor(int curve)
 {
+    ensureLoaded();
     int result = -1;
     if (curve > -1)
     {
@@ -1121,6 +1444,7 @@ int VectorImage::getCurvesColor(int curve)
 
 bool VectorImage::isCurveVisible(int curve)
 {
+    ensureLoaded();
     if (curve > -1 && curve < mCurves.length())
     {
         return !mCurves[curve].isInvisible();
@@ -1135,15 +1459,34 @@ bool VectorImage::isCurveVisible(int curve)
  */
 bool VectorImage::usesColor(int index)
 {
+    return colorUsage().contains(index);
+}
+
+QMap<int, int> VectorImage::colorUsage()
+{
+    if (colorUsageKnown())
+    {
+        return mColorUsage;
+    }
+
+    ensureLoaded();
+    mColorUsage.clear();
     for (int i = 0; i < mArea.size(); i++)
     {
-        if (mArea[i].mColorNumber == index) return true;
+        mColorUsage[mArea[i].getColorNumber()]++;
     }
     for (int i = 0; i < mCurves.size(); i++)
     {
-        if (mCurves[i].getColorNumber() == index) return true;
+        mColorUsage[mCurves[i].getColorNumber()]++;
     }
-    return false;
+    mColorUsageVersion = version();
+    return mColorUsage;
+}
+
+void VectorImage::setColorUsage(const QMap<int, int>& usage)
+{
+    mColorUsage = usage;
+    mColorUsageVersion = version();
 }
 
 /**
@@ -1152,11 +1495,14 @@ bool VectorImage::usesColor(int index)
  */
 void VectorImage::removeColor(int index)
 {
+    ensureLoaded();
+    bool changed = false;
     for (int i = 0; i < mArea.size(); i++)
     {
         int colorNumber = mArea[i].getColorNumber();
         if (colorNumber >= index && colorNumber > 0) {
             mArea[i].decreaseColorNumber();
+            changed = true;
         }
     }
     for (int i = 0; i < mCurves.size(); i++)
@@ -1164,20 +1510,25 @@ void VectorImage::removeColor(int index)
         int colorNumber = mCurves[i].getColorNumber();
         if (colorNumber >= index && colorNumber > 0) {
             mCurves[i].decreaseColorNumber();
+            changed = true;
         }
     }
+    if (changed) { modification(); }
 }
 
 void VectorImage::moveColor(int start, int end)
 {
+    ensureLoaded();
+    bool changed = false;
     for(int i=0; i< mArea.size(); i++)
      {
-         if (mArea[i].getColorNumber() == start) mArea[i].setColorNumber(end);
+         if (mArea[i].getColorNumber() == start) { mArea[i].setColorNumber(end); changed = true; }
      }
      for(int i=0; i< mCurves.size(); i++)
      {
-         if (mCurves[i].getColorNumber() == start) mCurves[i].setColorNumber(end);
+         if (mCurves[i].getColorNumber() == start) { mCurves[i].setColorNumber(end); changed = true; }
      }
+    if (changed) { modification(); }
 }
 
 /**
@@ -1194,6 +1545,22 @@ void VectorImage::paintImage(QPainter& painter,
     bool showThinCurves,
     bool antialiasing)
 {
+    paintImage(painter, object.paletteColors(), simplified, showThinCurves, antialiasing);
+}
+
+void VectorImage::paintImage(QPainter& painter,
+    const QVector<QColor>& palette,
+    bool simplified,
+    bool showThinCurves,
+    bool antialiasing)
+{
+    // Like Object::getColor(), a color missing from the palette is painted white
+    auto colorAt = [&palette](int index) -> QColor
+    {
+        return (index > -1 && index < palette.size()) ? palette.at(index) : QColor(Qt::white);
+    };
+
+    ensureLoaded();
     painter.save();
     painter.setRenderHint(QPainter::Antialiasing, antialiasing);
 
@@ -1206,12 +1573,11 @@ void VectorImage::paintImage(QPainter& painter,
     // --- draw filled areas ----
     if (!simplified)
     {
+        updateAreaPaths();
         for (int i = 0; i < mArea.size(); i++)
         {
-            updateArea(mArea[i]); // to do: if selected
-
             // --- fill areas ---- //
-            QColor color = object.getColor(mArea[i].mColorNumber).color;
+            QColor color = colorAt(mArea[i].mColorNumber);
 
             painter.save();
             painter.setWorldMatrixEnabled(false);
@@ -1235,9 +1601,10 @@ void VectorImage::paintImage(QPainter& painter,
     }
 
     // ---- draw curves ----
-    for (BezierCurve curve : mCurves)
+    const QVector<BezierCurve>& curves = mCurves;
+    for (const BezierCurve& curve : curves)
     {
-        curve.drawPath(painter, object, mSelectionTransformation, simplified, showThinCurves);
+        curve.drawPath(painter, colorAt(curve.getColorNumber()), mSelectionTransformation, simplified, showThinCurves);
         painter.setClipping(false);
     }
     painter.restore();
@@ -1248,8 +1615,10 @@ void VectorImage::paintImage(QPainter& painter,
  */
 void VectorImage::clear()
 {
+    mLoaded = true;
     while (mCurves.size() > 0) { mCurves.removeAt(0); }
     while (mArea.size() > 0) { mArea.removeAt(0); }
+    mCurveIndex.clear();
     modification();
 }
 
@@ -1258,6 +1627,7 @@ void VectorImage::clear()
  */
 void VectorImage::clean()
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).getVertexSize() == 0)
@@ -1266,6 +1636,7 @@ void VectorImage::clean()
             i--;
         }
     }
+    mCurveIndex.clear();
 }
 
 /**
@@ -1273,6 +1644,7 @@ void VectorImage::clean()
  */
 void VectorImage::applySelectionTransformation()
 {
+    ensureLoaded();
     applySelectionTransformation(mSelectionTransformation);
 }
 
@@ -1282,6 +1654,7 @@ void VectorImage::applySelectionTransformation()
  */
 void VectorImage::applySelectionTransformation(QTransform transf)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isPartlySelected())
@@ -1291,6 +1664,7 @@ void VectorImage::applySelectionTransformation(QTransform transf)
     }
     calculateSelectionRect();
     mSelectionTransformation.reset();
+    mCurveIndex.clear();
     modification();
 }
 
@@ -1301,6 +1675,7 @@ void VectorImage::applySelectionTransformation(QTransform transf)
  */
 void VectorImage::applyColorToSelectedCurve(int colorNumber)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isSelected()) mCurves[i].setColorNumber(colorNumber);
@@ -1314,6 +1689,7 @@ void VectorImage::applyColorToSelectedCurve(int colorNumber)
  */
 void VectorImage::applyColorToSelectedArea(int colorNumber)
 {
+    ensureLoaded();
     for (int i = 0; i < mArea.size(); i++)
     {
         if (mArea.at(i).isSelected()) mArea[i].setColorNumber(colorNumber);
@@ -1327,6 +1703,7 @@ void VectorImage::applyColorToSelectedArea(int colorNumber)
  */
 void VectorImage::applyWidthToSelection(qreal width)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isSelected()) mCurves[i].setWidth(width);
@@ -1340,6 +1717,7 @@ void VectorImage::applyWidthToSelection(qreal width)
  */
 void VectorImage::applyFeatherToSelection(qreal feather)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isSelected()) mCurves[i].setFeather(feather);
@@ -1353,6 +1731,7 @@ void VectorImage::applyFeatherToSelection(qreal feather)
  */
 void VectorImage::applyOpacityToSelection(qreal opacity)
 {
+    ensureLoaded();
     Q_UNUSED(opacity);
     for (int i = 0; i < mCurves.size(); i++)
     {
@@ -1367,6 +1746,7 @@ void VectorImage::applyOpacityToSelection(qreal opacity)
  */
 void VectorImage::applyInvisibilityToSelection(bool YesOrNo)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isSelected()) mCurves[i].setInvisibility(YesOrNo);
@@ -1380,6 +1760,7 @@ void VectorImage::applyInvisibilityToSelection(bool YesOrNo)
  */
 void VectorImage::applyVariableWidthToSelection(bool YesOrNo)
 {
+    ensureLoaded();
     for (int i = 0; i < mCurves.size(); i++)
     {
         if (mCurves.at(i).isSelected()) {
@@ -1397,55 +1778,36 @@ void VectorImage::applyVariableWidthToSelection(bool YesOrNo)
  */
 QList<int> VectorImage::getCurvesCloseTo(QPointF P1, qreal maxDistance)
 {
+    ensureLoaded();
+    updateCurveIndex();
+
+    // The index has the curves where they are before the selection transformation
+    const bool transforming = !mSelectionTransformation.isIdentity();
+
     QList<int> result;
-    for (int j = 0; j < mCurves.size(); j++)
+    for (const CurveIndex::Item& item : mCurveIndex.itemsNear(P1, maxDistance))
     {
-        BezierCurve myCurve;
-        if (mCurves[j].isPartlySelected())
+        const BezierCurve& myCurve = mCurves.at(item.curve);
+        if (item.section < 0 || (transforming && myCurve.isPartlySelected())) { continue; }
+        if (myCurve.sectionIntersects(item.section, P1, maxDistance))
         {
-            myCurve = mCurves[j].transformed(mSelectionTransformation);
-        }
-        else
-        {
-            myCurve = mCurves[j];
-        }
-        if (myCurve.intersects(P1, maxDistance))
-        {
-            result.append(j);
-            // store stroke for later use.
-            mGetStrokedPath = myCurve.getStrokedPath(1.0, true);
+            result.append(item.curve);
         }
     }
-    return result;
-}
-
-/**
- * @brief VectorImage::getClosestVertexTo
- * @param curve: BezieCurve
- * @param curveNum: int
- * @param thePoint: QPointF
- * @return VertexRef of the closest point in the selected curve
- */
-VertexRef VectorImage::getClosestVertexTo(const BezierCurve& curve, int curveNum, QPointF thePoint)
-{
-    VertexRef result;
-    result = VertexRef(-1, -1);  // result = [-1, -1]
-
-    // distance of the closest point
-    QPointF P2 = getVertex(0, 0);
-    qreal minDistance = thePoint.dotProduct(QPointF(thePoint - P2), QPointF(thePoint - P2));
 
-    for (int vertexPoint = -1; vertexPoint < curve.getVertexSize(); vertexPoint++)
+    if (transforming)
     {
-        P2 = curve.getVertex(vertexPoint);
-        qreal distance = thePoint.dotProduct(QPointF(thePoint - P2), QPointF(thePoint - P2));
-
-        if (distance < minDistance)
+        for (int j = 0; j < mCurves.size(); j++)
         {
-            minDistance = distance;
-            result = VertexRef(curveNum, vertexPoint);
+            if (mCurves.at(j).isPartlySelected() && mCurves.at(j).transformed(mSelectionTransformation).intersects(P1, maxDistance))
+            {
+                result.append(j);
+            }
         }
     }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
     return result;
 }
 
@@ -1457,23 +1819,52 @@ VertexRef VectorImage::getClosestVertexTo(const BezierCurve& curve, int curveNum
  */
 QList<VertexRef> VectorImage::getVerticesCloseTo(QPointF P1, qreal maxDistance)
 {
+    ensureLoaded();
+    updateCurveIndex();
+
+    // Selected vertices are where the selection transformation puts them, not where the index has them
+    const bool transforming = !mSelectionTransformation.isIdentity();
+    const qreal maxDistanceSquared = maxDistance * maxDistance;
+
     QList<VertexRef> result;
+    auto check = [&](int curve, int vertex)
+    {
+        const bool selected = mCurves.at(curve).isSelected(vertex);
+        if (transforming && selected) { return; }
+        const QPointF P2 = mCurves.at(curve).getVertex(vertex);
+        if (QPointF::dotProduct(P1 - P2, P1 - P2) < maxDistanceSquared)
+        {
+            result.append(VertexRef(curve, vertex));
+        }
+    };
 
-    // Square maxDistance rather than taking the square root for each distance
-    maxDistance *= maxDistance;
+    // Each section has the vertex it ends at, the first one also has the origin
+    for (const CurveIndex::Item& item : mCurveIndex.itemsNear(P1, maxDistance))
+    {
+        if (item.section <= 0) { check(item.curve, -1); }
+        if (item.section >= 0) { check(item.curve, item.section); }
+    }
 
-    for (int curve = 0; curve < mCurves.size(); curve++)
+    if (transforming)
     {
-        for (int vertex = -1; vertex < mCurves.at(curve).getVertexSize(); vertex++)
+        for (int curve = 0; curve < mCurves.size(); curve++)
         {
-            QPointF P2 = getVertex(curve, vertex);
-            qreal distance = P1.dotProduct(QPointF(P1 - P2), QPointF(P1 - P2));
-            if (distance < maxDistance)
+            if (!mCurves.at(curve).isPartlySelected()) { continue; }
+            for (int vertex = -1; vertex < mCurves.at(curve).getVertexSize(); vertex++)
             {
-                result.append(VertexRef(curve, vertex));
+                if (!mCurves.at(curve).isSelected(vertex)) { continue; }
+                const QPointF P2 = mSelectionTransformation.map(mCurves.at(curve).getVertex(vertex));
+                if (QPointF::dotProduct(P1 - P2, P1 - P2) < maxDistanceSquared)
+                {
+                    result.append(VertexRef(curve, vertex));
+                }
             }
         }
     }
+
+    std::sort(result.begin(), result.end(), [](const VertexRef& a, const VertexRef& b) {
+        return a.curveNumber < b.curveNumber || (a.curveNumber == b.curveNumber && a.vertexNumber < b.vertexNumber);
+    });
     return result;
 }
 
@@ -1486,6 +1877,7 @@ QList<VertexRef> VectorImage::getVerticesCloseTo(QPointF P1, qreal maxDistance)
  */
 QList<VertexRef> VectorImage::getVerticesCloseTo(QPointF P1, qreal maxDistance, QList<VertexRef>* listOfPoints)
 {
+    ensureLoaded();
     QList<VertexRef> result;
     for (int j = 0; j < listOfPoints->size(); j++)
     {
@@ -1507,6 +1899,7 @@ QList<VertexRef> VectorImage::getVerticesCloseTo(QPointF P1, qreal maxDistance,
  */
 QList<VertexRef> VectorImage::getVerticesCloseTo(VertexRef P1ref, qreal maxDistance)
 {
+    ensureLoaded();
     return getVerticesCloseTo(getVertex(P1ref), maxDistance);
 }
 
@@ -1519,6 +1912,7 @@ QList<VertexRef> VectorImage::getVerticesCloseTo(VertexRef P1ref, qreal maxDista
  */
 QList<VertexRef> VectorImage::getVerticesCloseTo(VertexRef P1ref, qreal maxDistance, QList<VertexRef>* listOfPoints)
 {
+    ensureLoaded();
     return getVerticesCloseTo(getVertex(P1ref), maxDistance, listOfPoints);
 }
 
@@ -1531,6 +1925,7 @@ QList<VertexRef> VectorImage::getVerticesCloseTo(VertexRef P1ref, qreal maxDista
  */
 QList<VertexRef> VectorImage::getAndRemoveVerticesCloseTo(QPointF P1, qreal maxDistance, QList<VertexRef>* listOfPoints)
 {
+    ensureLoaded();
     QList<VertexRef> result;
     for (int j = 0; j < listOfPoints->size(); j++)
     {
@@ -1554,6 +1949,7 @@ QList<VertexRef> VectorImage::getAndRemoveVerticesCloseTo(QPointF P1, qreal maxD
  */
 QList<VertexRef> VectorImage::getAndRemoveVerticesCloseTo(VertexRef P1Ref, qreal maxDistance, QList<VertexRef>* listOfPoints)
 {
+    ensureLoaded();
     return getAndRemoveVerticesCloseTo(getVertex(P1Ref), maxDistance, listOfPoints);
 }
 
@@ -1565,18 +1961,16 @@ QList<VertexRef> VectorImage::getAndRemoveVerticesCloseTo(VertexRef P1Ref, qreal
  */
 QPointF VectorImage::getVertex(int curveNumber, int vertexNumber)
 {
+    ensureLoaded();
     QPointF result = QPointF(0, 0);
     if (curveNumber > -1 && curveNumber < mCurves.size())
     {
-        BezierCurve myCurve = mCurves.at(curveNumber);
-        if (myCurve.isPartlySelected())
-        {
-            myCurve = myCurve.transformed(mSelectionTransformation);
-        }
-
+        // A selected vertex is where the selection transformation puts it
+        const BezierCurve& myCurve = mCurves.at(curveNumber);
         if (vertexNumber > -2 && vertexNumber < myCurve.getVertexSize())
         {
             result = myCurve.getVertex(vertexNumber);
+            if (myCurve.isSelected(vertexNumber)) result = mSelectionTransformation.map(result);
         }
     }
     return result;
@@ -1589,6 +1983,7 @@ QPointF VectorImage::getVertex(int curveNumber, int vertexNumber)
  */
 QPointF VectorImage::getVertex(VertexRef vertexRef)
 {
+    ensureLoaded();
     return getVertex(vertexRef.curveNumber, vertexRef.vertexNumber);
 }
 
@@ -1600,14 +1995,15 @@ QPointF VectorImage::getVertex(VertexRef vertexRef)
  */
 QPointF VectorImage::getC1(int curveNumber, int vertexNumber)
 {
+    ensureLoaded();
     QPointF result = QPointF(0, 0);
     if (curveNumber > -1 && curveNumber < mCurves.size())
     {
-        BezierCurve myCurve = mCurves.at(curveNumber);
-        if (myCurve.isPartlySelected()) myCurve = myCurve.transformed(mSelectionTransformation);
+        const BezierCurve& myCurve = mCurves.at(curveNumber);
         if (vertexNumber > -1 && vertexNumber < myCurve.getVertexSize())
         {
             result = myCurve.getC1(vertexNumber);
+            if (myCurve.isSelected(vertexNumber - 1)) result = mSelectionTransformation.map(result);
         }
     }
     return result;
@@ -1620,6 +2016,7 @@ QPointF VectorImage::getC1(int curveNumber, int vertexNumber)
  */
 QPointF VectorImage::getC1(VertexRef vertexRef)
 {
+    ensureLoaded();
     return getC1(vertexRef.curveNumber, vertexRef.vertexNumber);
 }
 
@@ -1631,14 +2028,15 @@ QPointF VectorImage::getC1(VertexRef vertexRef)
  */
 QPointF VectorImage::getC2(int curveNumber, int vertexNumber)
 {
+    ensureLoaded();
     QPointF result = QPointF(0, 0);
     if (curveNumber > -1 && curveNumber < mCurves.size())
     {
-        BezierCurve myCurve = mCurves.at(curveNumber);
-        if (myCurve.isPartlySelected()) myCurve = myCurve.transformed(mSelectionTransformation);
+        const BezierCurve& myCurve = mCurves.at(curveNumber);
         if (vertexNumber > -1 && vertexNumber < myCurve.getVertexSize())
         {
             result = myCurve.getC2(vertexNumber);
+            if (myCurve.isSelected(vertexNumber)) result = mSelectionTransformation.map(result);
         }
     }
     return result;
@@ -1651,6 +2049,7 @@ QPointF VectorImage::getC2(int curveNumber, int vertexNumber)
  */
 QPointF VectorImage::getC2(VertexRef vertexRef)
 {
+    ensureLoaded();
     return getC2(vertexRef.curveNumber, vertexRef.vertexNumber);
 }
 
@@ -1661,13 +2060,13 @@ QPointF VectorImage::getC2(VertexRef vertexRef)
  */
 QList<VertexRef> VectorImage::getCurveVertices(int curveNumber)
 {
+    ensureLoaded();
     QList<VertexRef> result;
 
     if (curveNumber > -1 && curveNumber < mCurves.size())
     {
-        BezierCurve myCurve = mCurves[curveNumber];
-
-        for (int k = -1; k < myCurve.getVertexSize(); k++)
+        const int vertexCount = mCurves.at(curveNumber).getVertexSize();
+        for (int k = -1; k < vertexCount; k++)
         {
             VertexRef vertexRef = VertexRef(curveNumber, k);
             result.append(vertexRef);
@@ -1683,6 +2082,7 @@ QList<VertexRef> VectorImage::getCurveVertices(int curveNumber)
  */
 QList<VertexRef> VectorImage::getAllVertices()
 {
+    ensureLoaded();
     QList<VertexRef> result;
     for (int j = 0; j < mCurves.size(); j++)
     {
@@ -1703,6 +2103,7 @@ QList<VertexRef> VectorImage::getAllVertices()
  */
 int VectorImage::getCurveSize(int curveNumber)
 {
+    ensureLoaded();
     if (curveNumber > -1 && curveNumber < mCurves.size())
     {
         return mCurves.at(curveNumber).getVertexSize();
@@ -1719,6 +2120,7 @@ int VectorImage::getCurveSize(int curveNumber)
  */
 QList<BezierCurve> VectorImage::getSelectedCurves()
 {
+    ensureLoaded();
     QList<BezierCurve> curves;
     for (int curve = 0; curve < mCurves.size(); curve++)
     {
@@ -1736,6 +2138,7 @@ QList<BezierCurve> VectorImage::getSelectedCurves()
  */
 QList<int> VectorImage::getSelectedCurveNumbers()
 {
+    ensureLoaded();
     QList<int> result;
     for (int curve = 0; curve < mCurves.size(); curve++)
     {
@@ -1753,6 +2156,7 @@ QList<int> VectorImage::getSelectedCurveNumbers()
  */
 int VectorImage::getNumOfCurvesSelected()
 {
+    ensureLoaded();
     int count = 0;
     for (int curve = 0; curve < mCurves.size(); curve++)
     {
@@ -1771,6 +2175,8 @@ int VectorImage::getNumOfCurvesSelected()
  */
 BezierArea VectorImage::getSelectedArea(QPointF currentPoint)
 {
+    ensureLoaded();
+    updateAreaPaths();
     for (int i = 0; i < mArea.size(); i++)
     {
         if (mArea[i].mPath.controlPointRect().contains(currentPoint))
@@ -1788,33 +2194,14 @@ BezierArea VectorImage::getSelectedArea(QPointF currentPoint)
  */
 void VectorImage::fillSelectedPath(int color)
 {
-    QList<VertexRef> vertexPath;
+    ensureLoaded();
     QList<int> curveNumbers = getSelectedCurveNumbers();
-    QList<BezierCurve> curves = getSelectedCurves();
-    QList<VertexRef> vertexList;
-    VertexRef vertex;
-    for (int curve = 0; curve < getNumOfCurvesSelected(); curve++)
+    for (int curveNumber : curveNumbers)
     {
-        vertexList = getCurveVertices(curveNumbers[curve]);
-        for (int i = 0; i < vertexList.size(); i++)
-        {
-            QPointF point = getVertex(vertexList[i]);
-            vertex = getClosestVertexTo(curves[curve], curveNumbers[curve], point);
-
-            if (vertex.curveNumber != -1 && !vertexPath.contains(vertex))
-            {
-                vertexPath.append(vertex);
-            }
-        }
-
-        BezierArea bezierArea(vertexPath, color);
-        addArea(bezierArea);
+        addArea(BezierArea(getCurveVertices(curveNumber), color));
 
         // set selected curves as filled
-        mCurves[curveNumbers[curve]].setFilled(true);
-
-        // clear path for next area
-        vertexPath.clear();
+        mCurves[curveNumber].setFilled(true);
     }
 
     modification();
@@ -1822,30 +2209,49 @@ void VectorImage::fillSelectedPath(int color)
 
 /**
  * @brief VectorImage::fillContour
- * @param contourPath
+ * @param curveNumber
  * @param color
- * fills the contour with a given color
+ * fills the inside of a curve with a given color
  */
-void VectorImage::fillContour(QList<QPointF> contourPath, int color)
+void VectorImage::fillContour(int curveNumber, int color)
 {
-    QList<VertexRef> vertexPath;
-    VertexRef vertex;
+    ensureLoaded();
+    if (curveNumber < 0 || curveNumber >= mCurves.size()) { return; }
 
-    BezierCurve lastCurve = getLastCurve();
-    int lastCurveNum = getLastCurveNumber();
+    addArea(BezierArea(getCurveVertices(curveNumber), color));
+    modification();
+}
+
+/**
+ * @brief VectorImage::fillArea
+ * @param point
+ * @param color
+ * @return true if there was a region to fill
+ * fills the region enclosed by curves around the point with a given color
+ */
+bool VectorImage::fillArea(QPointF point, int color)
+{
+    ensureLoaded();
+    mPlanarMap.update(mCurves);
+    const int face = mPlanarMap.faceAt(point);
+    if (face == -1) { return false; }
 
-    for (QPointF point : contourPath) {
-        vertex = getClosestVertexTo(lastCurve, lastCurveNum, point);
+    const QList<VertexRef>& boundary = mPlanarMap.face(face).boundary;
 
-        if (vertex.curveNumber != -1 && !vertexPath.contains(vertex)) {
-            vertexPath.append(vertex);
+    // Filling a region again only changes its color
+    for (int i = 0; i < mArea.size(); i++)
+    {
+        const QList<VertexRef>& vertices = mArea.at(i).mVertex;
+        if (vertices.size() == boundary.size() && std::all_of(boundary.cbegin(), boundary.cend(), [&vertices](const VertexRef& vertex) { return vertices.contains(vertex); }))
+        {
+            mArea[i].setColorNumber(color);
+            modification();
+            return true;
         }
     }
 
-    BezierArea bezierArea(vertexPath, color);
-
-    addArea(bezierArea);
-    modification();
+    addArea(BezierArea(boundary, color));
+    return true;
 }
 
 //QList<QPointF> VectorImage::getfillContourPoints(QPoint point)
@@ -2222,6 +2628,7 @@ void VectorImage::fillContour(QList<QPointF> contourPath, int color)
  */
 void VectorImage::addArea(BezierArea bezierArea)
 {
+    ensureLoaded();
     updateArea(bezierArea);
     mArea.append(bezierArea);
     modification();
@@ -2234,6 +2641,8 @@ void VectorImage::addArea(BezierArea bezierArea)
  */
 int VectorImage::getFirstAreaNumber(QPointF point)
 {
+    ensureLoaded();
+    updateAreaPaths();
     int result = -1;
     for (int i = 0; i < mArea.size() && result == -1; i++)
     {
@@ -2255,6 +2664,7 @@ int VectorImage::getFirstAreaNumber(QPointF point)
  */
 int VectorImage::getLastAreaNumber(QPointF point)
 {
+    ensureLoaded();
     return getLastAreaNumber(point, mArea.size() - 1);
 }
 /**
@@ -2263,6 +2673,7 @@ int VectorImage::getLastAreaNumber(QPointF point)
  */
 int VectorImage::getLastCurveNumber()
 {
+    ensureLoaded();
     return !mCurves.isEmpty() ? mCurves.size() - 1 : 0;
 }
 
@@ -2272,6 +2683,7 @@ int VectorImage::getLastCurveNumber()
  */
 BezierCurve VectorImage::getLastCurve()
 {
+    ensureLoaded();
     return !mCurves.isEmpty() ? mCurves[mCurves.size() - 1] : BezierCurve();
 }
 
@@ -2283,6 +2695,8 @@ BezierCurve VectorImage::getLastCurve()
 */
 int VectorImage::getLastAreaNumber(QPointF point, int maxAreaNumber)
 {
+    ensureLoaded();
+    updateAreaPaths();
     int result = -1;
     for (int i = maxAreaNumber; i > -1 && result == -1; i--)
     {
@@ -2304,6 +2718,7 @@ int VectorImage::getLastAreaNumber(QPointF point, int maxAreaNumber)
  */
 void VectorImage::removeArea(QPointF point)
 {
+    ensureLoaded();
     int areaNumber = getLastAreaNumber(point);
     if (areaNumber != -1)
     {
@@ -2320,6 +2735,7 @@ void VectorImage::removeArea(QPointF point)
  */
 void VectorImage::removeAreaInCurve(int curve, int areaNumber)
 {
+    ensureLoaded();
     QPointF areaPoint = getVertex(curve, areaNumber);
     removeArea(areaPoint);
 }
@@ -2330,6 +2746,7 @@ void VectorImage::removeAreaInCurve(int curve, int areaNumber)
  */
 void VectorImage::updateArea(BezierArea& bezierArea)
 {
+    ensureLoaded();
     QPainterPath newPath;
     for (int i = 0; i < bezierArea.mVertex.size(); i++)
     {
@@ -2343,7 +2760,9 @@ void VectorImage::updateArea(BezierArea& bezierArea)
         }
         else
         {
-            if (bezierArea.mVertex[i - 1].curveNumber == bezierArea.mVertex[i].curveNumber)   // the two points are on the same curve
+            // the two points are the ends of a section of the same curve
+            if (bezierArea.mVertex[i - 1].curveNumber == bezierArea.mVertex[i].curveNumber &&
+                qAbs(bezierArea.mVertex[i - 1].vertexNumber - bezierArea.mVertex[i].vertexNumber) == 1)
             {
                 if (bezierArea.mVertex[i - 1].vertexNumber < bezierArea.mVertex[i].vertexNumber)   // the points follow the curve progression
                 {
@@ -2357,7 +2776,7 @@ void VectorImage::updateArea(BezierArea& bezierArea)
                 }
                 newPath.cubicTo(myC1, myC2, myPoint);
             }
-            else // the two points are not the same curve
+            else // the two points are not on the same section, e.g. where two curves meet
             {
                 if (bezierArea.mVertex[i].vertexNumber == -1)   // the current point is the first point in the new curve
                 {
@@ -2375,6 +2794,32 @@ void VectorImage::updateArea(BezierArea& bezierArea)
     bezierArea.mPath.setFillRule(Qt::WindingFill);
 }
 
+/**
+ * @brief VectorImage::updateAreaPaths
+ * Rebuilds the paths of the areas when the image changed since they were last built
+ */
+void VectorImage::updateAreaPaths()
+{
+    if (mAreaPathsVersion == version()) { return; }
+
+    for (int i = 0; i < mArea.size(); i++)
+    {
+        updateArea(mArea[i]);
+    }
+    mAreaPathsVersion = version();
+}
+
+/**
+ * Builds the curve index again when the curves changed since it was last built
+ */
+void VectorImage::updateCurveIndex()
+{
+    if (!mCurveIndex.isBuilt())
+    {
+        mCurveIndex.build(mCurves);
+    }
+}
+
 /**
  * @brief VectorImage::getDistance
  * @param r1: VertexRef
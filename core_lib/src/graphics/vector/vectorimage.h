@@ -18,15 +18,20 @@ GNU General Public License for more details.
 #define VECTORIMAGE_H
 
 #include <QTransform>
+#include <QMap>
 
 #include "bezierarea.h"
 #include "beziercurve.h"
+#include "curveindex.h"
+#include "planarmap.h"
 #include "vertexref.h"
 #include "keyframe.h"
 
 class Object;
 class QPainter;
 class QImage;
+class QIODevice;
+class QXmlStreamReader;
 
 class VectorImage : public KeyFrame
 {
@@ -37,12 +42,38 @@ public:
     VectorImage& operator=(const VectorImage& a);
 
     VectorImage* clone() const override;
-
-    bool read(QString filePath);
+    /** A copy which shares no curves with this image, so that it can be painted on another thread */
+    VectorImage* snapshot() const;
+    /** Takes the curves and areas of the other image, keeping this keyframe's position, file and listeners */
+    void replaceDrawing(const VectorImage& other);
+
+    void loadFile() override;
+    /** Reads the file like loadFile(), reporting a file that could not be read.
+     *  The frame is left empty and loaded then, so it is not read again */
+    Status load();
+    void unloadFile() override;
+    bool isLoaded() const override { return mLoaded; }
+    quint64 memoryUsage() override;
+
+    /** Reads a .vec XML or a .vecb binary file, whichever the file turns out to be */
+    Status read(QString filePath);
+    /** Writes the image as "VEC", the XML format projects are saved in,
+     *  or "VECB", the binary format, which released versions cannot read */
     Status write(QString filePath, QString format);
 
+    /**
+     * The binary format, all numbers little-endian:
+     *
+     *     char[4] "PVEC", quint16 version, quint16 flags (1 = the body is compressed with qCompress)
+     *     body: quint32 curve count, the curves, quint32 area count, the areas
+     *
+     * see BezierCurve::writeBinary() and BezierArea::writeBinary() for the records.
+     */
+    Status writeBinary(QIODevice* device, bool compressed = false);
+    Status readBinary(QIODevice* device);
+
     Status createDomElement(QXmlStreamWriter& doc);
-    void loadDomElement(QDomElement element);
+    void loadDomElement(QXmlStreamReader& xmlStream);
 
     BezierCurve& curve(int i);
 
@@ -79,18 +110,25 @@ public:
 
     QRectF getBoundsOfTransformedCurves() const;
 
-    bool isEmpty() const { return mCurves.isEmpty(); }
+    bool isEmpty() const { ensureLoaded(); return mCurves.isEmpty(); }
 
     void paste(VectorImage&);
 
     int  getColorNumber(QPointF point);
     bool usesColor(int index);
+    /** The number of curves and areas drawn with each color number.
+     *  Kept for unloaded frames, so palette edits only read the frames that use a color */
+    QMap<int, int> colorUsage();
+    bool colorUsageKnown() const { return mColorUsageVersion == version(); }
+    void setColorUsage(const QMap<int, int>& usage);
     void removeColor(int index);
     int getCurvesColor(int curve);
     bool isCurveVisible(int curve);
     void moveColor(int start, int end);
 
     void paintImage(QPainter& painter, const Object& object, bool simplified, bool showThinCurves, bool antialiasing);
+    /** Paints the image with the colors of a palette snapshot, see Object::paletteColors() */
+    void paintImage(QPainter& painter, const QVector<QColor>& palette, bool simplified, bool showThinCurves, bool antialiasing);
 
     void clear();
     void clean();
@@ -104,7 +142,10 @@ public:
     void applyOpacityToSelection(qreal opacity);
     void applyInvisibilityToSelection(bool YesOrNo);
     void applyVariableWidthToSelection(bool YesOrNo);
-    void fillContour(QList<QPointF> contourPath, int color);
+    /** Fills the region enclosed by curves around point, returns false if there is none */
+    bool fillArea(QPointF point, int color);
+    /** Fills the inside of a curve, e.g. one just drawn as a closed contour */
+    void fillContour(int curveNumber, int color);
     void fillSelectedPath(int color);
     //    void fill(QPointF point, int color, float tolerance);
     void addArea(BezierArea bezierArea);
@@ -117,12 +158,13 @@ public:
     void removeAreaInCurve(int curve, int areaNumber);
     void updateArea(BezierArea& bezierArea);
 
+    /** The curves passing within maxDistance of the point, looked up in the curve index */
     QList<int> getCurvesCloseTo(QPointF thisPoint, qreal maxDistance);
     QList<BezierCurve> getSelectedCurves();
     QList<int> getSelectedCurveNumbers();
     BezierArea getSelectedArea(QPointF currentPoint);
-    VertexRef getClosestVertexTo(const BezierCurve& curve, int curveNum, QPointF thisPoint);
     QList<VertexRef> getCurveVertices(int curveNumber);
+    /** The vertices within maxDistance of the point, looked up in the curve index */
     QList<VertexRef> getVerticesCloseTo(QPointF thisPoint, qreal maxDistance);
     QList<VertexRef> getVerticesCloseTo(QPointF thisPoint, qreal maxDistance, QList<VertexRef>* listOfPoints);
     QList<VertexRef> getVerticesCloseTo(VertexRef thisPointRef, qreal maxDistance);
@@ -138,8 +180,6 @@ public:
     QList<VertexRef> getAllVertices();
     int getCurveSize(int curveNumber);
 
-    QPainterPath getStrokedPath() { return mGetStrokedPath; }
-
     QList<BezierArea> mArea;
     QList<int> mCurveDisplayOrders;
 
@@ -151,21 +191,31 @@ public:
     qreal getOpacity() const { return mOpacity; }
 
 private:
+    /** A frame opened from a project is only read from its file when it's first used */
+    void ensureLoaded() const { if (!mLoaded) { const_cast<VectorImage*>(this)->loadFile(); } }
+
     void addPoint(int curveNumber, int vertexNumber, qreal fraction);
 
     void checkCurveExtremity(BezierCurve& newCurve, qreal tolerance);
     void checkCurveIntersections(BezierCurve& newCurve, qreal tolerance);
 
     void updateImageSize(BezierCurve& updatedCurve);
-    QPainterPath mGetStrokedPath;
+    void updateAreaPaths();
+    void updateCurveIndex();
 
 private:
-    QList<BezierCurve> mCurves;
+    QVector<BezierCurve> mCurves;
+    PlanarMap mPlanarMap;
+    int mAreaPathsVersion = -1; // the version the area paths were last built for
+    CurveIndex mCurveIndex;     // cleared whenever the geometry of the curves changes, selecting doesn't
+    QMap<int, int> mColorUsage;
+    int mColorUsageVersion = -1; // the version the color usage was counted for
 
     QRectF mSelectionRect;
     QTransform mSelectionTransformation;
     QSize mSize;
     qreal mOpacity = 1.0;
+    bool mLoaded = true;
 };
 
 #endif
@@ -0,0 +1,349 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "vectorrasterizer.h"
+
+#include <QMutex>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "object.h"
+#include "layervector.h"
+#include "vectorimage.h"
+#include "util.h"
+
+namespace
+{
+    // Memory budget of the image cache, in KB
+    const int RASTER_CACHE_BUDGET = 256 * 1024;
+    // Memory budget of the images being rendered ahead, in KB
+    const int RASTER_PENDING_BUDGET = RASTER_CACHE_BUDGET / 4;
+
+    int imageCost(const QSize& size)
+    {
+        return qMax(1, static_cast<int>(static_cast<qint64>(size.width()) * size.height() * 4 / 1024));
+    }
+}
+
+struct VectorRasterizer::PendingImage
+{
+    QMutex mutex;
+    QWaitCondition rendered;
+    bool done = false;
+    bool failed = false; // The file of the keyframe couldn't be read
+    QImage image;
+    int cost = 0;
+};
+
+class VectorRasterizer::RasterTask : public QRunnable
+{
+public:
+    std::shared_ptr<PendingImage> pending;
+    std::unique_ptr<VectorImage> snapshot; // The keyframe if it was loaded
+    QString filePath;                       // Otherwise the file to read
+    Request request;
+
+    void run() override
+    {
+        bool readOK = true;
+        if (!snapshot)
+        {
+            snapshot.reset(new VectorImage);
+            readOK = snapshot->read(filePath).ok();
+        }
+        QImage image;
+        if (readOK)
+        {
+            image = VectorRasterizer::render(*snapshot, request);
+        }
+
+        QMutexLocker locker(&pending->mutex);
+        pending->image = image;
+        pending->failed = !readOK;
+        pending->done = true;
+        pending->rendered.wakeAll();
+    }
+};
+
+bool operator==(const VectorRasterizer::CacheKey& a, const VectorRasterizer::CacheKey& b)
+{
+    return a.image == b.image
+        && a.version == b.version
+        && a.transform == b.transform
+        && a.size == b.size
+        && a.devicePixelRatio == b.devicePixelRatio
+        && a.paletteHash == b.paletteHash
+        && a.flags == b.flags;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
+uint qHash(const VectorRasterizer::CacheKey& key, uint seed)
+#else
+size_t qHash(const VectorRasterizer::CacheKey& key, size_t seed)
+#endif
+{
+    return qHash(key.image, seed) ^ qHash(key.version) ^ qHash(key.transform)
+        ^ qHash(key.size.width()) ^ (qHash(key.size.height()) << 16) ^ key.paletteHash ^ qHash(key.flags);
+}
+
+VectorRasterizer::VectorRasterizer()
+{
+    mCache.setMaxCost(RASTER_CACHE_BUDGET);
+
+    // The caller usually waits for the images, so every core can work on them
+    mThreadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+VectorRasterizer::~VectorRasterizer()
+{
+    mThreadPool.clear();
+    mThreadPool.waitForDone();
+    clear();
+}
+
+QImage VectorRasterizer::rasterize(VectorImage* vectorImage, const Request& request)
+{
+    if (vectorImage == nullptr || request.size.isEmpty()) { return QImage(); }
+
+    const CacheKey key = cacheKey(vectorImage, request);
+    if (QImage* image = mCache.object(key))
+    {
+        return *image;
+    }
+
+    QImage image;
+    bool rendered = false;
+    auto pending = mPending.find(key);
+    if (pending != mPending.end())
+    {
+        std::shared_ptr<PendingImage> result = pending.value();
+        mPending.erase(pending);
+
+        QMutexLocker locker(&result->mutex);
+        while (!result->done)
+        {
+            result->rendered.wait(&result->mutex);
+        }
+        image = result->image;
+        rendered = !result->failed;
+    }
+
+    if (!rendered)
+    {
+        // Painted from a copy like on the workers, so the selection is left out either way
+        VectorImage copy(*vectorImage);
+        image = render(copy, request);
+    }
+
+    dropEntries(vectorImage, vectorImage->version());
+    insert(key, image);
+    return image;
+}
+
+bool VectorRasterizer::prefetch(VectorImage* vectorImage, const Request& request)
+{
+    if (vectorImage == nullptr || request.size.isEmpty()) { return true; }
+
+    const CacheKey key = cacheKey(vectorImage, request);
+    if (mCache.contains(key) || mPending.contains(key)) { return true; }
+
+    collectFinished();
+
+    // The images on their way are held besides the cache, at least one is let through
+    const int cost = imageCost(request.size);
+    int pendingCost = cost;
+    for (auto it = mPending.cbegin(); it != mPending.cend(); ++it)
+    {
+        pendingCost += it.value()->cost;
+    }
+    if (pendingCost > RASTER_PENDING_BUDGET && !mPending.isEmpty()) { return false; }
+
+    RasterTask* task = new RasterTask;
+    if (vectorImage->isLoaded() || vectorImage->fileName().isEmpty())
+    {
+        task->snapshot.reset(vectorImage->snapshot());
+    }
+    else
+    {
+        // Read it from disk rather than loading it through the frame pool
+        task->filePath = vectorImage->fileName();
+    }
+    task->request = request;
+    task->pending = std::make_shared<PendingImage>();
+    task->pending->cost = cost;
+
+    dropEntries(vectorImage, vectorImage->version());
+    mPending.insert(key, task->pending);
+    listenTo(vectorImage);
+
+    mThreadPool.start(task);
+    return true;
+}
+
+bool VectorRasterizer::prefetchFrame(const Object* object, int frameNumber, const Request& request)
+{
+    if (object == nullptr) { return true; }
+
+    bool allStarted = true;
+    for (int i = 0; i < object->getLayerCount(); i++)
+    {
+        Layer* layer = object->getLayer(i);
+        if (layer->type() != Layer::VECTOR || !layer->visible()) { continue; }
+
+        LayerVector* layerVector = static_cast<LayerVector*>(layer);
+        if (!prefetch(layerVector->getLastVectorImageAtFrame(frameNumber, 0), request))
+        {
+            allStarted = false;
+        }
+    }
+    return allStarted;
+}
+
+void VectorRasterizer::clear()
+{
+    // Workers still running keep their own reference to the result, which is then dropped
+    mCache.clear();
+    mPending.clear();
+
+    for (KeyFrame* key : mListenedKeyFrames)
+    {
+        key->removeEventListner(this);
+    }
+    mListenedKeyFrames.clear();
+}
+
+void VectorRasterizer::onKeyFrameDestroy(KeyFrame* keyFrame)
+{
+    dropEntries(keyFrame);
+    mListenedKeyFrames.remove(keyFrame);
+}
+
+VectorRasterizer::Request VectorRasterizer::frameRequest(const Object* object, const QTransform& transform, const QSize& size, bool antialiasing)
+{
+    Request request;
+    request.transform = transform;
+    request.size = size;
+    request.palette = object->paletteColors();
+    request.antialiasing = antialiasing;
+    return request;
+}
+
+QTransform VectorRasterizer::windowTransform(const QSize& window, const QSize& device)
+{
+    if (window.isEmpty()) { return QTransform(); }
+    return QTransform::fromScale(static_cast<qreal>(device.width()) / window.width(),
+                                 static_cast<qreal>(device.height()) / window.height());
+}
+
+QImage VectorRasterizer::render(VectorImage& vectorImage, const Request& request)
+{
+    QImage image(request.size, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(request.devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setTransform(request.transform);
+    vectorImage.paintImage(painter, request.palette, request.simplified, request.showThinCurves, request.antialiasing);
+    return image;
+}
+
+VectorRasterizer::CacheKey VectorRasterizer::cacheKey(VectorImage* vectorImage, const Request& request) const
+{
+    uint paletteHash = 0;
+    for (const QColor& color : request.palette)
+    {
+        paletteHash = paletteHash * 31 + color.rgba();
+    }
+
+    CacheKey key;
+    key.image = vectorImage;
+    key.version = vectorImage->version();
+    key.transform = request.transform;
+    key.size = request.size;
+    key.devicePixelRatio = request.devicePixelRatio;
+    key.paletteHash = paletteHash;
+    key.flags = (request.simplified ? 1 : 0) | (request.showThinCurves ? 2 : 0) | (request.antialiasing ? 4 : 0);
+    return key;
+}
+
+void VectorRasterizer::insert(const CacheKey& key, const QImage& image)
+{
+    const int cost = qMax(1, static_cast<int>(imageSize(image) / 1024));
+    mCache.insert(key, new QImage(image), cost);
+    listenTo(key.image);
+}
+
+void VectorRasterizer::collectFinished()
+{
+    // Images which were prefetched but not asked for yet count against the cache budget once done
+    for (auto it = mPending.begin(); it != mPending.end();)
+    {
+        PendingImage* pending = it.value().get();
+        QMutexLocker locker(&pending->mutex);
+        if (pending->done)
+        {
+            // A file that couldn't be read is tried again when the image is asked for
+            const CacheKey key = it.key();
+            const QImage image = pending->image;
+            const bool failed = pending->failed;
+            locker.unlock();
+            it = mPending.erase(it);
+            if (!failed)
+            {
+                insert(key, image);
+            }
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void VectorRasterizer::dropEntries(const KeyFrame* keyFrame, int keptVersion)
+{
+    // Images of an older version of the keyframe will never be asked for again
+    const QList<CacheKey> cachedKeys = mCache.keys();
+    for (const CacheKey& key : cachedKeys)
+    {
+        if (key.image == keyFrame && key.version != keptVersion)
+        {
+            mCache.remove(key);
+        }
+    }
+    for (auto it = mPending.begin(); it != mPending.end();)
+    {
+        if (it.key().image == keyFrame && it.key().version != keptVersion)
+        {
+            it = mPending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void VectorRasterizer::listenTo(VectorImage* vectorImage)
+{
+    if (!mListenedKeyFrames.contains(vectorImage))
+    {
+        mListenedKeyFrames.insert(vectorImage);
+        vectorImage->addEventListener(this);
+    }
+}
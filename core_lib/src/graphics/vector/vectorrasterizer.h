@@ -0,0 +1,122 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef VECTORRASTERIZER_H
+#define VECTORRASTERIZER_H
+
+#include <memory>
+#include <QCache>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QThreadPool>
+#include <QTransform>
+#include <QVector>
+#include "keyframe.h"
+
+class Object;
+class VectorImage;
+
+/**
+ * VectorRasterizer renders vector keyframes to images on a pool of worker threads.
+ *
+ * A keyframe is handed to the workers as a snapshot along with the colors of the palette,
+ * so that painting it doesn't touch the keyframe or the Object. Keyframes which aren't loaded
+ * are read from their file by the worker.
+ *
+ * prefetch() schedules the rendering and returns right away, rasterize() waits for a prefetched
+ * image or paints it on the calling thread. Images are kept in a LRU memory cache keyed by keyframe,
+ * keyframe version, transform, size, palette and painting options.
+ */
+class VectorRasterizer : public KeyFrameEventListener
+{
+public:
+    struct Request
+    {
+        QTransform transform; // canvas -> image, in device independent pixels
+        QSize size;
+        qreal devicePixelRatio = 1.0;
+        QVector<QColor> palette;
+        bool simplified = false;
+        bool showThinCurves = false;
+        bool antialiasing = true;
+    };
+
+    VectorRasterizer();
+    ~VectorRasterizer();
+
+    /** Returns the image of the keyframe, waiting for it if it has been prefetched */
+    QImage rasterize(VectorImage* vectorImage, const Request& request);
+
+    /** Starts rendering the keyframe on a worker, unless it's cached or on its way already.
+     *  Returns false when the images on their way take up their share of the memory budget,
+     *  the keyframe is painted once it's asked for then. */
+    bool prefetch(VectorImage* vectorImage, const Request& request);
+
+    /** Prefetches the vector keyframes which are visible at the given frame of the object,
+     *  returns false if any of them didn't fit in the budget */
+    bool prefetchFrame(const Object* object, int frameNumber, const Request& request);
+
+    void clear();
+
+    void onKeyFrameDestroy(KeyFrame*) override;
+
+    /** The request for painting the vector keyframes of the object like Object::paintImage() does */
+    static Request frameRequest(const Object* object, const QTransform& transform, const QSize& size, bool antialiasing);
+
+    /** The transform QPainter::setWindow() adds when the window is mapped onto the whole device */
+    static QTransform windowTransform(const QSize& window, const QSize& device);
+
+    /** Paints the vector image into a new image, safe to call on any thread as long as
+     *  nobody else uses the vector image */
+    static QImage render(VectorImage& vectorImage, const Request& request);
+
+private:
+    struct CacheKey
+    {
+        VectorImage* image;
+        int version;
+        QTransform transform;
+        QSize size;
+        qreal devicePixelRatio;
+        uint paletteHash;
+        int flags;
+    };
+    friend bool operator==(const CacheKey& a, const CacheKey& b);
+#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
+    friend uint qHash(const CacheKey& key, uint seed);
+#else
+    friend size_t qHash(const CacheKey& key, size_t seed);
+#endif
+
+    struct PendingImage;
+    class RasterTask;
+
+    CacheKey cacheKey(VectorImage* vectorImage, const Request& request) const;
+    void insert(const CacheKey& key, const QImage& image);
+    void collectFinished();
+    /** Drops the cached and pending images of the keyframe, but those of the kept version */
+    void dropEntries(const KeyFrame* keyFrame, int keptVersion = -1);
+    void listenTo(VectorImage* vectorImage);
+
+    QCache<CacheKey, QImage> mCache;
+    QHash<CacheKey, std::shared_ptr<PendingImage>> mPending;
+    QSet<KeyFrame*> mListenedKeyFrames; // Keyframes rather than cache keys, the cache evicts keys on its own
+    QThreadPool mThreadPool;
+};
+
+#endif // VECTORRASTERIZER_H
@@ -0,0 +1,300 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "imagebatchdecoder.h"
+
+#include <vector>
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include "bitmapimage.h"
+
+namespace
+{
+    struct DecodeQueue
+    {
+        QMutex mutex;
+        QWaitCondition decoded;
+        std::vector<DecodedImage> results;
+        std::vector<bool> done;
+        QAtomicInt canceled;
+    };
+
+    class DecodeTask : public QRunnable
+    {
+    public:
+        DecodeQueue* queue = nullptr;
+        int index = 0;
+        QString filePath;
+        ImageImportOptions options;
+
+        void run() override
+        {
+            DecodedImage result;
+            if (!queue->canceled.loadAcquire())
+            {
+                result = ImageBatchDecoder::decode(filePath, options);
+            }
+
+            QMutexLocker locker(&queue->mutex);
+            queue->results[index] = result;
+            queue->done[index] = true;
+            queue->decoded.wakeAll();
+        }
+    };
+
+    struct FrameStream
+    {
+        QMutex mutex;
+        QWaitCondition changed;
+        QQueue<DecodedImage> frames;
+        bool finished = false;
+        bool canceled = false;
+    };
+
+    QSize scaledSize(const QSize& size, qreal scale)
+    {
+        return (QSizeF(size) * scale).toSize().expandedTo(QSize(1, 1));
+    }
+
+    /** Reads the next image from the reader at the size asked for by the options */
+    QImage readScaled(QImageReader& reader, const ImageImportOptions& options)
+    {
+        const bool rescale = !qFuzzyCompare(options.scale, 1.0);
+        const QSize originalSize = reader.size();
+        if (rescale && originalSize.isValid())
+        {
+            // Lets formats like JPEG decode straight to the smaller size
+            reader.setScaledSize(scaledSize(originalSize, options.scale));
+        }
+
+        QImage image = reader.read();
+        if (rescale && !image.isNull() && !originalSize.isValid())
+        {
+            image = image.scaled(scaledSize(image.size(), options.scale), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        return image;
+    }
+
+    void setReadError(DecodedImage& decoded, const QImageReader& reader)
+    {
+        decoded.failed = true;
+        decoded.error = reader.error();
+        decoded.errorString = reader.errorString();
+        decoded.format = QString::fromLatin1(reader.format());
+    }
+
+    class AnimationDecodeTask : public QRunnable
+    {
+    public:
+        FrameStream* stream = nullptr;
+        QString filePath;
+        ImageImportOptions options;
+        int maxQueued = 2;
+
+        void run() override
+        {
+            QImageReader reader(filePath);
+
+            QImage pendingSource;
+            DecodedImage pending;
+            for (QImage source = readScaled(reader, options); !source.isNull(); source = readScaled(reader, options))
+            {
+                if (source == pendingSource)
+                {
+                    pending.frameCount++;
+                    continue;
+                }
+                if (!pendingSource.isNull() && !push(pending))
+                {
+                    return;
+                }
+                pendingSource = source;
+                pending = ImageBatchDecoder::prepare(source, options);
+            }
+
+            if (pendingSource.isNull())
+            {
+                setReadError(pending, reader);
+            }
+            if (!push(pending))
+            {
+                return;
+            }
+
+            QMutexLocker locker(&stream->mutex);
+            stream->finished = true;
+            stream->changed.wakeAll();
+        }
+
+    private:
+        /** Hands a frame to the consumer, waiting while it's behind.
+         *  @return false if the consumer doesn't want any more frames */
+        bool push(const DecodedImage& decoded)
+        {
+            QMutexLocker locker(&stream->mutex);
+            while (stream->frames.count() >= maxQueued && !stream->canceled)
+            {
+                stream->changed.wait(&stream->mutex);
+            }
+            if (stream->canceled) { return false; }
+
+            stream->frames.enqueue(decoded);
+            stream->changed.wakeAll();
+            return true;
+        }
+    };
+}
+
+ImageBatchDecoder::ImageBatchDecoder(const ImageImportOptions& options) : mOptions(options)
+{
+}
+
+ImageBatchDecoder::~ImageBatchDecoder()
+{
+    mThreadPool.waitForDone();
+}
+
+void ImageBatchDecoder::run(const QStringList& filePaths, const Callback& onDecoded)
+{
+    const int count = filePaths.count();
+
+    DecodeQueue queue;
+    queue.results.resize(count);
+    queue.done.resize(count, false);
+
+    // Enough to keep every worker busy while the caller consumes the previous images
+    const int window = qMax(2, mThreadPool.maxThreadCount() * 2);
+    int submitted = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (; submitted < count && submitted < i + window; submitted++)
+        {
+            DecodeTask* task = new DecodeTask;
+            task->queue = &queue;
+            task->index = submitted;
+            task->filePath = filePaths[submitted];
+            task->options = mOptions;
+            mThreadPool.start(task);
+        }
+
+        DecodedImage decoded;
+        {
+            QMutexLocker locker(&queue.mutex);
+            while (!queue.done[i])
+            {
+                queue.decoded.wait(&queue.mutex);
+            }
+            decoded = queue.results[i];
+            queue.results[i] = DecodedImage();
+        }
+
+        if (!onDecoded(i, decoded))
+        {
+            queue.canceled.storeRelease(1);
+            break;
+        }
+    }
+
+    // The queue lives on this stack frame, so the remaining tasks must finish before we return
+    mThreadPool.waitForDone();
+}
+
+void ImageBatchDecoder::runAnimation(const QString& filePath, const Callback& onDecoded)
+{
+    FrameStream stream;
+
+    AnimationDecodeTask* task = new AnimationDecodeTask;
+    task->stream = &stream;
+    task->filePath = filePath;
+    task->options = mOptions;
+    task->maxQueued = qMax(2, mThreadPool.maxThreadCount() * 2);
+    mThreadPool.start(task);
+
+    for (int i = 0;; i++)
+    {
+        DecodedImage decoded;
+        {
+            QMutexLocker locker(&stream.mutex);
+            while (stream.frames.isEmpty() && !stream.finished)
+            {
+                stream.changed.wait(&stream.mutex);
+            }
+            if (stream.frames.isEmpty())
+            {
+                break;
+            }
+            decoded = stream.frames.dequeue();
+            stream.changed.wakeAll();
+        }
+
+        if (!onDecoded(i, decoded) || decoded.failed)
+        {
+            QMutexLocker locker(&stream.mutex);
+            stream.canceled = true;
+            stream.changed.wakeAll();
+            break;
+        }
+    }
+
+    // The stream lives on this stack frame, so the worker must finish before we return
+    mThreadPool.waitForDone();
+}
+
+DecodedImage ImageBatchDecoder::decode(const QString& filePath, const ImageImportOptions& options)
+{
+    QImageReader reader(filePath);
+    const QImage image = readScaled(reader, options);
+    if (image.isNull())
+    {
+        DecodedImage decoded;
+        setReadError(decoded, reader);
+        return decoded;
+    }
+    return prepare(image, options);
+}
+
+DecodedImage ImageBatchDecoder::prepare(const QImage& image, const ImageImportOptions& options)
+{
+    DecodedImage prepared;
+    prepared.image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    prepared.frameSize = prepared.image.size();
+
+    if (prepared.image.isNull() || (!options.scanToTransparent && !options.autoCrop))
+    {
+        return prepared;
+    }
+
+    BitmapImage bitmap(QPoint(0, 0), prepared.image);
+    if (options.scanToTransparent)
+    {
+        bitmap.scanToTransparent(&bitmap, options.threshold, options.redEnabled, options.greenEnabled, options.blueEnabled);
+    }
+    if (options.autoCrop)
+    {
+        // The constructor takes the image as already cropped, setting it again makes autoCrop() look at it
+        bitmap.setImage(bitmap.image());
+        bitmap.enableAutoCrop(true);
+        bitmap.autoCrop();
+    }
+
+    prepared.image = *bitmap.image();
+    prepared.offset = bitmap.bounds().topLeft();
+    return prepared;
+}
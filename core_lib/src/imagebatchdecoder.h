@@ -0,0 +1,96 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef IMAGEBATCHDECODER_H
+#define IMAGEBATCHDECODER_H
+
+#include <functional>
+#include <QImage>
+#include <QImageReader>
+#include <QStringList>
+#include <QThreadPool>
+
+/** Processing applied to every image while it's being decoded */
+struct ImageImportOptions
+{
+    /// Images are scaled by this factor, 1 keeps their original size
+    qreal scale = 1.0;
+
+    /// Makes the paper of scanned drawings transparent, see BitmapImage::scanToTransparent()
+    bool scanToTransparent = false;
+    int threshold = 220;
+    bool redEnabled = true;
+    bool greenEnabled = true;
+    bool blueEnabled = true;
+
+    /// Crops each image to its non-transparent content, see DecodedImage::offset
+    bool autoCrop = false;
+};
+
+struct DecodedImage
+{
+    QImage image;
+    QSize frameSize;  ///< The size of the image before it was cropped
+    QPoint offset;    ///< Where the cropped image sits within the frame
+
+    /// The number of identical frames in a row this image stands for, only animations have more than one
+    int frameCount = 1;
+
+    bool failed = false;
+    QImageReader::ImageReaderError error = QImageReader::UnknownError;
+    QString errorString;
+    QString format;
+};
+
+/**
+ * ImageBatchDecoder reads a list of image files on a pool of worker threads.
+ *
+ * Each image is decoded and converted in a single pass on the worker, so the calling thread
+ * only has to take the finished images. The images are handed back in order and only a few of
+ * them are decoded ahead of the caller, which keeps memory bounded for long sequences.
+ *
+ * The frames of an animated image can only be read one after another, so they are decoded by
+ * a single worker which streams them to the caller the same way.
+ */
+class ImageBatchDecoder
+{
+public:
+    /** Called on the calling thread for each image in order.
+     *  @return false to stop decoding the remaining images */
+    using Callback = std::function<bool(int index, const DecodedImage& decoded)>;
+
+    explicit ImageBatchDecoder(const ImageImportOptions& options);
+    ~ImageBatchDecoder();
+
+    /** Decodes the given files and blocks until all of them have been handed to the callback,
+     *  or until the callback asked to stop. */
+    void run(const QStringList& filePaths, const Callback& onDecoded);
+
+    /** Decodes the frames of an animated image, like run() does for a list of files.
+     *  Identical frames in a row are handed over once, see DecodedImage::frameCount. */
+    void runAnimation(const QString& filePath, const Callback& onDecoded);
+
+    static DecodedImage decode(const QString& filePath, const ImageImportOptions& options);
+
+    /** Applies the options to an image which was decoded at its final size */
+    static DecodedImage prepare(const QImage& image, const ImageImportOptions& options);
+
+private:
+    ImageImportOptions mOptions;
+    QThreadPool mThreadPool;
+};
+
+#endif // IMAGEBATCHDECODER_H
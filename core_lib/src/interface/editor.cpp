@@ -31,6 +31,9 @@ GNU General Public License for more details.
 #include "layervector.h"
 #include "layercamera.h"
 #include "undoredocommand.h"
+#include "imagebatchdecoder.h"
+#include "bitmaptransformbatch.h"
+#include "vectorstrokefinalizer.h"
 
 #include "colormanager.h"
 #include "filemanager.h"
@@ -92,6 +95,8 @@ bool Editor::init()
         pManager->init();
     }
 
+    mVectorStrokeFinalizer = new VectorStrokeFinalizer(this);
+
     makeConnections();
 
     mIsAutosave = mPreferenceManager->isOn(SETTING::AUTO_SAVE);
@@ -125,6 +130,7 @@ void Editor::makeConnections()
     // XXX: This is a hack to prevent crashes until #864 is done (see #1412)
     connect(mLayerManager, &LayerManager::layerDeleted, mUndoRedoManager, &UndoRedoManager::sanitizeLegacyBackupElementsAfterLayerDeletion);
     connect(mLayerManager, &LayerManager::currentLayerWillChange, this, &Editor::onCurrentLayerWillChange);
+    connect(mToolManager, &ToolManager::toolChanged, this, &Editor::finishVectorStrokes);
 }
 
 void Editor::settingUpdated(SETTING setting)
@@ -155,6 +161,8 @@ void Editor::settingUpdated(SETTING setting)
 
 void Editor::onCurrentLayerWillChange(int index)
 {
+    finishVectorStrokes();
+
     Layer* newLayer = layers()->getLayer(index);
     Layer* currentLayer = layers()->currentLayer();
     Q_ASSERT(newLayer && currentLayer);
@@ -326,9 +334,8 @@ void Editor::pasteToFrames()
 
         if (keyFrameNewPos != nullptr) {
 
-            // Select and move any frames that may come into contact with the new position
-            currentLayer->newSelectionOfConnectedFrames(newPosition);
-            currentLayer->moveSelectedFrames(1);
+            // Move any frames that may come into contact with the new position
+            currentLayer->moveConnectedKeyFrames(newPosition, 1);
         }
 
         KeyFrame* key = it->second;
@@ -388,21 +395,6 @@ void Editor::flipSelection(bool flipVertical)
     mScribbleArea->flipSelection(flipVertical);
 }
 
-void Editor::repositionImage(QPoint transform, int frame)
-{
-    if (layers()->currentLayer()->type() == Layer::BITMAP)
-    {
-        scrubTo(frame);
-        LayerBitmap* layer = static_cast<LayerBitmap*>(layers()->currentLayer());
-        QRect reposRect = layer->getFrameBounds(frame);
-        select()->setSelection(reposRect);
-        QPoint point = reposRect.topLeft();
-        point += transform;
-        layer->repositionFrame(point, frame);
-        backup(layer->id(), frame, tr("Reposition frame")); // TOOD: backup multiple reposition operations.
-    }
-}
-
 void Editor::setModified(int layerNumber, int frameNumber)
 {
     Layer* layer = object()->getLayer(layerNumber);
@@ -584,6 +576,23 @@ void Editor::updateObject()
     emit updateLayerCount();
 }
 
+namespace
+{
+    QString imageReaderErrorDescription(QImageReader::ImageReaderError error, const QString& filePath)
+    {
+        switch (error)
+        {
+        case QImageReader::ImageReaderError::FileNotFoundError:
+            return Editor::tr("File not found at path \"%1\". Please check the image is present at the specified location and try again.").arg(filePath);
+        case QImageReader::UnsupportedFormatError:
+            return Editor::tr("Image format is not supported. Please convert the image file to one of the following formats and try again:\n%1")
+                   .arg(QString::fromUtf8(QImageReader::supportedImageFormats().join(", ")));
+        default:
+            return Editor::tr("An error has occurred while reading the image. Please check that the file is a valid image and try again.");
+        }
+    }
+}
+
 Status Editor::importBitmapImage(const QString& filePath, const QTransform& importTransform)
 {
     QImageReader reader(filePath);
@@ -610,21 +619,7 @@ Status Editor::importBitmapImage(const QString& filePath, const QTransform& impo
         }
         dd << QString("QImageReader ImageReaderError type: %1").arg(reader.errorString());
 
-        QString errorDesc;
-        switch(reader.error())
-        {
-        case QImageReader::ImageReaderError::FileNotFoundError:
-            errorDesc = tr("File not found at path \"%1\". Please check the image is present at the specified location and try again.").arg(filePath);
-            break;
-        case QImageReader::UnsupportedFormatError:
-            errorDesc = tr("Image format is not supported. Please convert the image file to one of the following formats and try again:\n%1")
-                        .arg(QString::fromUtf8(reader.supportedImageFormats().join(", ")));
-            break;
-        default:
-            errorDesc = tr("An error has occurred while reading the image. Please check that the file is a valid image and try again.");
-        }
-
-        status = Status(Status::FAIL, dd, tr("Import failed"), errorDesc);
+        status = Status(Status::FAIL, dd, tr("Import failed"), imageReaderErrorDescription(reader.error(), filePath));
     }
 
     const QPoint pos = importTransform.map(QPoint(-img.width() / 2,
@@ -665,7 +660,7 @@ Status Editor::importVectorImage(const QString& filePath)
     }
 
     VectorImage importedVectorImage;
-    bool ok = importedVectorImage.read(filePath);
+    bool ok = importedVectorImage.read(filePath).ok();
     if (ok)
     {
         importedVectorImage.selectAll();
@@ -688,19 +683,35 @@ Status Editor::importImage(const QString& filePath, const ImportImageConfig impo
     DebugDetails dd;
     dd << QString("Raw file path: %1").arg(filePath);
 
+    switch (layer->type())
+    {
+    case Layer::BITMAP:
+        return importBitmapImage(filePath, importTransform(importConfig, currentFrame()));
+
+    case Layer::VECTOR:
+        return importVectorImage(filePath);
+
+    default:
+        dd << QString("Current layer: %1").arg(layer->type());
+        return Status(Status::ERROR_INVALID_LAYER_TYPE, dd, tr("Import failed"), tr("You can only import images to a bitmap layer."));
+    }
+}
+
+QTransform Editor::importTransform(const ImportImageConfig& importConfig, int frame) const
+{
     QTransform transform;
     switch (importConfig.positionType)
     {
         case ImportImageConfig::CenterOfCamera: {
-            LayerCamera* layerCam = static_cast<LayerCamera*>(layers()->getCameraLayerBelow(currentLayerIndex()));
+            LayerCamera* layerCam = static_cast<LayerCamera*>(mLayerManager->getCameraLayerBelow(currentLayerIndex()));
             Q_ASSERT(layerCam);
             transform = layerCam->getViewAtFrame(importConfig.importFrame).inverted();
             break;
         }
         case ImportImageConfig::CenterOfCameraFollowed: {
-            LayerCamera* camera = static_cast<LayerCamera*>(layers()->getCameraLayerBelow(currentLayerIndex()));
+            LayerCamera* camera = static_cast<LayerCamera*>(mLayerManager->getCameraLayerBelow(currentLayerIndex()));
             Q_ASSERT(camera);
-            transform = camera->getViewAtFrame(currentFrame()).inverted();
+            transform = camera->getViewAtFrame(frame).inverted();
             break;
         }
         case ImportImageConfig::CenterOfView: {
@@ -714,19 +725,160 @@ Status Editor::importImage(const QString& filePath, const ImportImageConfig impo
             break;
         }
     }
+    return transform;
+}
 
-    switch (layer->type())
+void Editor::placeImportedImage(LayerBitmap* layer, int frame, const QPoint& topLeft, const QImage& image)
+{
+    BitmapImage* bitmapImage = layer->getBitmapImageAtFrame(frame);
+    if (bitmapImage == nullptr)
     {
-    case Layer::BITMAP:
-        return importBitmapImage(filePath, transform);
+        bitmapImage = new BitmapImage(topLeft, image);
+        bitmapImage->enableAutoCrop(true);
+        layer->addKeyFrame(frame, bitmapImage);
+    }
+    else
+    {
+        BitmapImage importedBitmapImage(topLeft, image);
+        bitmapImage->paste(&importedBitmapImage);
+        layer->markFrameAsDirty(frame);
+    }
+}
 
-    case Layer::VECTOR:
-        return importVectorImage(filePath);
+Status Editor::importImageSequence(const QStringList& filePaths,
+                                   const QList<int>& positions,
+                                   const ImportImageConfig importConfig,
+                                   const ImageImportOptions& options,
+                                   const std::function<void(int)>& progressChanged,
+                                   const std::function<bool()>& wasCanceled)
+{
+    Q_ASSERT(filePaths.count() == positions.count());
 
-    default:
+    DebugDetails dd;
+
+    Layer* layer = layers()->currentLayer();
+    if (layer->type() != Layer::BITMAP)
+    {
         dd << QString("Current layer: %1").arg(layer->type());
         return Status(Status::ERROR_INVALID_LAYER_TYPE, dd, tr("Import failed"), tr("You can only import images to a bitmap layer."));
     }
+    if (!layer->visible())
+    {
+        mScribbleArea->showLayerNotVisibleWarning();
+        return Status::SAFE;
+    }
+    LayerBitmap* bitmapLayer = static_cast<LayerBitmap*>(layer);
+
+    std::unique_ptr<KeyFramesSaveState> undoState(new KeyFramesSaveState);
+    undoState->layerId = layer->id();
+
+    Status status = Status::OK;
+    int imported = 0;
+
+    // Keyframes are inserted as soon as their image is ready, while the workers decode the next ones
+    ImageBatchDecoder decoder(options);
+    decoder.run(filePaths, [&](int index, const DecodedImage& decoded)
+    {
+        const QString& filePath = filePaths[index];
+        if (decoded.failed)
+        {
+            dd << QString("Raw file path: %1").arg(filePath);
+            if (!decoded.format.isEmpty())
+            {
+                dd << QString("QImageReader format: %1").arg(decoded.format);
+            }
+            dd << QString("QImageReader ImageReaderError type: %1").arg(decoded.errorString);
+            status = Status(Status::FAIL, dd, tr("Import failed"), imageReaderErrorDescription(decoded.error, filePath));
+            return false;
+        }
+
+        const int frame = positions[index];
+        const QPoint pos = importTransform(importConfig, frame).map(QPoint(-decoded.image.width() / 2,
+                                                                           -decoded.image.height() / 2));
+        undoState->remember(bitmapLayer, frame);
+
+        placeImportedImage(bitmapLayer, frame, pos, decoded.image);
+
+        progressChanged(++imported);
+        return !wasCanceled();
+    });
+
+    if (imported > 0)
+    {
+        undoRedo()->recordKeyFrames(std::move(undoState), tr("Import Image"));
+        updateAutoSaveCounter();
+
+        // Repaint once for the whole sequence
+        layers()->notifyAnimationLengthChanged();
+        emit framesModified();
+    }
+    return status;
+}
+
+Status Editor::transformBitmapKeyFrames(const QMap<int, QList<int>>& keyFramesByLayer,
+                                        const QRect& selection,
+                                        const QTransform& transform,
+                                        bool smoothTransform,
+                                        const std::function<void(int)>& progressChanged,
+                                        const std::function<bool()>& wasCanceled)
+{
+    if (transform.isIdentity()) { return Status::SAFE; }
+
+    // The keyframes to transform, in the order their results come back
+    std::vector<std::pair<LayerBitmap*, int>> targets;
+    std::vector<const BitmapImage*> keyFrames;
+    for (auto it = keyFramesByLayer.cbegin(); it != keyFramesByLayer.cend(); ++it)
+    {
+        Layer* layer = object()->findLayerById(it.key());
+        if (layer == nullptr || layer->type() != Layer::BITMAP) { continue; }
+
+        LayerBitmap* bitmapLayer = static_cast<LayerBitmap*>(layer);
+        for (int position : it.value())
+        {
+            if (BitmapImage* keyFrame = bitmapLayer->getBitmapImageAtFrame(position))
+            {
+                targets.emplace_back(bitmapLayer, position);
+                keyFrames.push_back(keyFrame);
+            }
+        }
+    }
+    if (targets.empty()) { return Status::SAFE; }
+
+    std::vector<std::unique_ptr<BitmapImage>> results;
+    results.reserve(targets.size());
+
+    BitmapTransformBatch batch(selection, transform, smoothTransform);
+    batch.run(keyFrames, [&](int, std::unique_ptr<BitmapImage> transformed)
+    {
+        results.push_back(std::move(transformed));
+        progressChanged(static_cast<int>(results.size()));
+        return !wasCanceled();
+    });
+
+    // The keyframes are only replaced once every one of them is done
+    if (results.size() != targets.size()) { return Status::CANCELED; }
+
+    std::vector<std::unique_ptr<KeyFramesSaveState>> undoStates;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        LayerBitmap* layer = targets[i].first;
+        const int position = targets[i].second;
+
+        if (undoStates.empty() || undoStates.back()->layerId != layer->id())
+        {
+            undoStates.emplace_back(new KeyFramesSaveState);
+            undoStates.back()->layerId = layer->id();
+        }
+        undoStates.back()->remember(layer, position);
+        layer->addOrReplaceKeyFrame(position, results[i].release());
+    }
+
+    undoRedo()->recordKeyFrames(std::move(undoStates), tr("Transform Frames"));
+    updateAutoSaveCounter();
+
+    // Repaint once for all the keyframes
+    emit framesModified();
+    return Status::OK;
 }
 
 Status Editor::importAnimatedImage(const QString& filePath, int frameSpacing, const std::function<void(int)>& progressChanged, const std::function<bool()>& wasCanceled)
@@ -742,6 +894,11 @@ Status Editor::importAnimatedImage(const QString& filePath, int frameSpacing, co
         dd << QString("Current layer: %1").arg(layer->type());
         return Status(Status::ERROR_INVALID_LAYER_TYPE, dd, tr("Import failed"), tr("You can only import images to a bitmap layer."));
     }
+    if (!layer->visible())
+    {
+        mScribbleArea->showLayerNotVisibleWarning();
+        return Status::SAFE;
+    }
     LayerBitmap* bitmapLayer = static_cast<LayerBitmap*>(layers()->currentLayer());
 
     QImageReader reader(filePath);
@@ -749,56 +906,51 @@ Status Editor::importAnimatedImage(const QString& filePath, int frameSpacing, co
     if (!reader.supportsAnimation()) {
         return Status(Status::ERROR_INVALID_LAYER_TYPE, dd, tr("Import failed"), tr("The selected image has a format that does not support animation."));
     }
+    const int totalFrames = qMax(1, reader.imageCount());
 
-    QImage img(reader.size(), QImage::Format_ARGB32_Premultiplied);
-    const QPoint pos(view()->getView().dx() - (img.width() / 2),
-                     view()->getView().dy() - (img.height() / 2));
-    int totalFrames = reader.imageCount();
-    while (reader.read(&img))
-    {
-        if (reader.error())
-        {
-            dd << QString("QImageReader ImageReaderError type: %1").arg(reader.errorString());
+    std::unique_ptr<KeyFramesSaveState> undoState(new KeyFramesSaveState);
+    undoState->layerId = layer->id();
 
-            QString errorDesc;
-            switch(reader.error())
-            {
-            case QImageReader::ImageReaderError::FileNotFoundError:
-                errorDesc = tr("File not found at path \"%1\". Please check the image is present at the specified location and try again.").arg(filePath);
-                break;
-            case QImageReader::UnsupportedFormatError:
-                errorDesc = tr("Image format is not supported. Please convert the image file to one of the following formats and try again:\n%1")
-                            .arg((QString)reader.supportedImageFormats().join(", "));
-                break;
-            default:
-                errorDesc = tr("An error has occurred while reading the image. Please check that the file is a valid image and try again.");
-            }
+    ImageImportOptions options;
+    options.autoCrop = true;
 
-            return Status(Status::FAIL, dd, tr("Import failed"), errorDesc);
-        }
+    Status status = Status::OK;
+    const QPoint viewCenter(view()->getView().dx(), view()->getView().dy());
+    int frame = mFrame;
+    int framesRead = 0;
 
-        if (!bitmapLayer->keyExists(mFrame))
+    ImageBatchDecoder decoder(options);
+    decoder.runAnimation(filePath, [&](int, const DecodedImage& decoded)
+    {
+        if (decoded.failed)
         {
-            addNewKey();
+            dd << QString("QImageReader ImageReaderError type: %1").arg(decoded.errorString);
+            status = Status(Status::FAIL, dd, tr("Import failed"), imageReaderErrorDescription(decoded.error, filePath));
+            return false;
         }
-        BitmapImage* bitmapImage = bitmapLayer->getBitmapImageAtFrame(mFrame);
-        BitmapImage importedBitmapImage(pos, img);
-        bitmapImage->paste(&importedBitmapImage);
-        emit frameModified(bitmapImage->pos());
 
-        if (wasCanceled())
-        {
-            break;
-        }
+        const QPoint pos = viewCenter - QPoint(decoded.frameSize.width() / 2, decoded.frameSize.height() / 2) + decoded.offset;
+        undoState->remember(bitmapLayer, frame);
+        placeImportedImage(bitmapLayer, frame, pos, decoded.image);
 
-        scrubTo(mFrame + frameSpacing);
+        // Identical frames in a row become a single longer exposure
+        frame += frameSpacing * decoded.frameCount;
+        framesRead += decoded.frameCount;
 
-        backup(tr("Import Image"));
+        progressChanged(qFloor(qMin(static_cast<double>(framesRead) / totalFrames, 1.0) * 100));
+        return !wasCanceled();
+    });
 
-        progressChanged(qFloor(qMin(static_cast<double>(reader.currentImageNumber()) / totalFrames, 1.0) * 100));
-    }
+    if (!undoState->positions.isEmpty())
+    {
+        undoRedo()->recordKeyFrames(std::move(undoState), tr("Import Image"));
+        updateAutoSaveCounter();
 
-    return Status::OK;
+        layers()->notifyAnimationLengthChanged();
+        emit framesModified();
+        scrubTo(frame);
+    }
+    return status;
 }
 
 void Editor::selectAll() const
@@ -867,6 +1019,8 @@ void Editor::setCurrentLayerIndex(int i)
 
 void Editor::scrubTo(int frame)
 {
+    finishVectorStrokes();
+
     if (frame < 1) { frame = 1; }
     mFrame = frame;
 
@@ -1018,6 +1172,8 @@ bool Editor::canSwapLayers(int layerIndexLeft, int layerIndexRight) const
 
 void Editor::prepareSave()
 {
+    finishVectorStrokes();
+
     for (auto mgr : mAllManagers)
     {
         mgr->save(mObject.get());
@@ -1088,3 +1244,11 @@ bool Editor::backup(int layerNumber, int frameNumber, const QString &undoText)
     updateAutoSaveCounter();
     return didBackup;
 }
+
+void Editor::finishVectorStrokes()
+{
+    if (mVectorStrokeFinalizer)
+    {
+        mVectorStrokeFinalizer->finish();
+    }
+}
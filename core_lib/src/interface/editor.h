@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include <functional>
 #include <memory>
 #include <QObject>
+#include <QMap>
 #include "pencilerror.h"
 #include "pencildef.h"
 #include "importimageconfig.h"
@@ -40,12 +41,16 @@ Q_MOC_INCLUDE("undoredomanager.h")
 #endif
 
 class QClipboard;
+class QImage;
+class QRect;
+class QTransform;
 class QTemporaryDir;
 class Object;
 class KeyFrame;
 class BitmapImage;
 class VectorImage;
 class LayerCamera;
+class LayerBitmap;
 class MainWindow2;
 class BaseManager;
 class ColorManager;
@@ -63,7 +68,9 @@ class ScribbleArea;
 class TimeLine;
 class UndoRedoCommand;
 class ActiveFramePool;
+class VectorStrokeFinalizer;
 class Layer;
+struct ImageImportOptions;
 
 enum class SETTING;
 
@@ -105,6 +112,8 @@ public:
     ClipboardManager*  clipboards() const { return mClipboardManager; }
     UndoRedoManager*     undoRedo() const { return mUndoRedoManager; }
 
+    VectorStrokeFinalizer* vectorStrokes() const { return mVectorStrokeFinalizer; }
+
     Object* object() const { return mObject.get(); }
     Status openObject(const QString& strFilePath, const std::function<void(int)>& progressChanged, const std::function<void(int)>& progressRangeChanged);
     Status setObject(Object* object);
@@ -174,8 +183,30 @@ public: //slots
     void clearCurrentFrame();
 
     Status importImage(const QString& filePath, ImportImageConfig importConfig);
+    /**
+     * Imports a sequence of images into keyframes of the current bitmap layer in one go.
+     * The images are decoded on worker threads, the whole import is recorded as a single undo step
+     * and the canvas is repainted once at the end.
+     * @param filePaths The images to import
+     * @param positions The frame of each image
+     * @param progressChanged Called with the number of images imported so far
+     */
+    Status importImageSequence(const QStringList& filePaths, const QList<int>& positions, ImportImageConfig importConfig,
+                               const ImageImportOptions& options,
+                               const std::function<void(int)>& progressChanged, const std::function<bool()>& wasCanceled);
     Status importAnimatedImage(const QString& filePath, int frameSpacing, const std::function<void (int)>& progressChanged, const std::function<bool ()>& wasCanceled);
 
+    /**
+     * Applies one transform to many bitmap keyframes, possibly on several layers, in one go.
+     * The keyframes are transformed on worker threads and only replaced once all of them are done,
+     * the whole change is recorded as a single undo step.
+     * @param keyFramesByLayer The positions of the keyframes to transform, by layer id
+     * @param selection The area to transform in each keyframe, an empty one transforms the keyframes as a whole
+     * @param progressChanged Called with the number of keyframes transformed so far
+     */
+    Status transformBitmapKeyFrames(const QMap<int, QList<int>>& keyFramesByLayer, const QRect& selection, const QTransform& transform,
+                                    bool smoothTransform, const std::function<void(int)>& progressChanged, const std::function<bool()>& wasCanceled);
+
     void scrubNextKeyFrame();
     void scrubPreviousKeyFrame();
     void scrubForward();
@@ -207,6 +238,9 @@ public: //slots
     void backup(const QString& undoText);
     bool backup(int layerNumber, int frameNumber, const QString& undoText);
 
+    /** Commits the vector strokes that are still being finalized, see VectorStrokeFinalizer */
+    void finishVectorStrokes();
+
     void onCurrentLayerWillChange(int index);
 
     void copy();
@@ -220,7 +254,6 @@ public: //slots
     void increaseLayerVisibilityIndex();
     void decreaseLayerVisibilityIndex();
     void flipSelection(bool flipVertical);
-    void repositionImage(QPoint transform, int frame);
 
     void clearTemporary();
     void addTemporaryDir(QTemporaryDir* dir);
@@ -233,6 +266,9 @@ public: //slots
 
 private:
     Status importBitmapImage(const QString&, const QTransform& importTransform);
+    QTransform importTransform(const ImportImageConfig& importConfig, int frame) const;
+    /** Puts an imported image on the given frame, in a new keyframe or on top of the existing one */
+    void placeImportedImage(LayerBitmap* layer, int frame, const QPoint& topLeft, const QImage& image);
     Status importVectorImage(const QString&);
 
     void pasteToCanvas(BitmapImage* bitmapImage, int frameNumber);
@@ -265,6 +301,8 @@ private:
 
     std::vector< BaseManager* > mAllManagers;
 
+    VectorStrokeFinalizer* mVectorStrokeFinalizer = nullptr;
+
     bool mIsAutosave = true;
     int mAutosaveNumber = 12;
     int mAutosaveCounter = 0;
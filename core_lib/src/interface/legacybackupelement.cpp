@@ -131,3 +131,36 @@ void BackupLegacySoundElement::restore(Editor* editor)
         editor->undoRedo()->restoreLegacyKey();
     }
 }
+
+void BackupLegacyKeyFramesElement::restore(Editor* editor)
+{
+    apply(editor, true);
+}
+
+void BackupLegacyKeyFramesElement::redo(Editor* editor)
+{
+    apply(editor, false);
+}
+
+void BackupLegacyKeyFramesElement::apply(Editor* editor, bool undo)
+{
+    if (layers.empty()) { return; }
+
+    for (const LayerKeyFrames& part : layers)
+    {
+        Layer* layer = editor->object()->findLayerById(part.layerId);
+        if (layer == nullptr) { continue; }
+
+        layer->restoreKeyFrames(part.positions, undo ? part.undoKeyFrames : part.redoKeyFrames);
+    }
+
+    const LayerKeyFrames& first = layers.front();
+    if (Layer* layer = editor->object()->findLayerById(first.layerId))
+    {
+        editor->layers()->setCurrentLayer(layer);
+    }
+
+    editor->layers()->notifyAnimationLengthChanged();
+    emit editor->framesModified();
+    editor->scrubTo(first.positions.first());
+}
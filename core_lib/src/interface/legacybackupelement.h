@@ -18,6 +18,8 @@ GNU General Public License for more details.
 #ifndef LEGACYBACKUPELEMENT_H
 #define LEGACYBACKUPELEMENT_H
 
+#include <memory>
+#include <vector>
 #include <QObject>
 #include "vectorimage.h"
 #include "bitmapimage.h"
@@ -29,7 +31,7 @@ class LegacyBackupElement : public QObject
 {
     Q_OBJECT
 public:
-    enum types { UNDEFINED, BITMAP_MODIF, VECTOR_MODIF, SOUND_MODIF };
+    enum types { UNDEFINED, BITMAP_MODIF, VECTOR_MODIF, SOUND_MODIF, KEYFRAMES_MODIF };
 
     QString undoText;
     bool somethingSelected = false;
@@ -90,4 +92,32 @@ public:
     void restore( Editor* ) override;
 };
 
+class BackupLegacyKeyFramesElement : public LegacyBackupElement
+{
+    Q_OBJECT
+public:
+    /// The keyframes of one layer before and after the change
+    struct LayerKeyFrames
+    {
+        int layerId = 0;
+        int layer = 0;
+        QList<int> positions;
+        std::vector<std::unique_ptr<KeyFrame>> undoKeyFrames;
+        std::vector<std::unique_ptr<KeyFrame>> redoKeyFrames;
+    };
+
+    /// Every layer changed by this step, the first one is made current when it's undone or redone
+    std::vector<LayerKeyFrames> layers;
+
+    int type() override { return LegacyBackupElement::KEYFRAMES_MODIF; }
+    void restore(Editor*) override;
+
+    /** Unlike the other elements, which are redone by restoring the element that follows them,
+     *  this one holds the state after the change as well */
+    void redo(Editor*);
+
+private:
+    void apply(Editor*, bool undo);
+};
+
 #endif // LEGACYBACKUPELEMENT_H
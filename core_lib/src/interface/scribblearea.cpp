@@ -18,6 +18,7 @@ GNU General Public License for more details.
 #include "scribblearea.h"
 
 #include <cmath>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QMessageBox>
 #include <QPixmapCache>
@@ -34,6 +35,7 @@ GNU General Public License for more details.
 #include "vectorimage.h"
 #include "blitrect.h"
 #include "tile.h"
+#include "profiler.h"
 
 #include "onionskinpainteroptions.h"
 
@@ -44,6 +46,7 @@ GNU General Public License for more details.
 #include "viewmanager.h"
 #include "selectionmanager.h"
 #include "overlaymanager.h"
+#include "vectorstrokefinalizer.h"
 
 ScribbleArea::ScribbleArea(QWidget* parent) : QWidget(parent),
     mCanvasPainter(mCanvas),
@@ -75,6 +78,7 @@ bool ScribbleArea::init()
 
     connect(mEditor->select(), &SelectionManager::selectionChanged, this, &ScribbleArea::onSelectionChanged);
     connect(mEditor->select(), &SelectionManager::needDeleteSelection, this, &ScribbleArea::deleteSelection);
+    connect(mEditor->vectorStrokes(), &VectorStrokeFinalizer::strokeCommitted, this, &ScribbleArea::onVectorStrokeCommitted);
 
     connect(&mTiledBuffer, &TiledBuffer::tileUpdated, this, &ScribbleArea::onTileUpdated);
     connect(&mTiledBuffer, &TiledBuffer::tileCreated, this, &ScribbleArea::onTileCreated);
@@ -208,10 +212,16 @@ void ScribbleArea::updateFrame()
 void ScribbleArea::invalidateCacheForDirtyFrames()
 {
     Layer* currentLayer = mEditor->layers()->currentLayer();
-    for (int pos : currentLayer->dirtyFrames()) {
+    for (const auto& range : currentLayer->dirtyFrameRanges()) {
 
-        invalidateCacheForFrame(pos);
-        invalidateOnionSkinsCacheAround(pos);
+        invalidateCacheForFrames(range.first, range.second);
+
+        // Onion skins of the frames inside the range are gone already,
+        // only the ones reaching into it from either end are left
+        invalidateOnionSkinsCacheAround(range.first);
+        if (range.second != range.first) {
+            invalidateOnionSkinsCacheAround(range.second);
+        }
     }
     currentLayer->clearDirtyFrames();
 }
@@ -261,7 +271,19 @@ void ScribbleArea::invalidateAllCache()
 {
     if (currentTool()->isDrawingTool() && currentTool()->isActive()) { return; }
 
-    QPixmapCache::clear();
+    mRenderedAheadFrames.invalidate();
+    invalidateCanvasCache();
+}
+
+void ScribbleArea::invalidateCanvasCache()
+{
+    if (currentTool()->isDrawingTool() && currentTool()->isActive()) { return; }
+
+    // Only the canvases of this area, other users of QPixmapCache keep theirs
+    for (auto it = mPixmapCacheKeys.cbegin(); it != mPixmapCacheKeys.cend(); ++it)
+    {
+        QPixmapCache::remove(it.value());
+    }
     mPixmapCacheKeys.clear();
     invalidatePainterCaches();
     mEditor->layers()->currentLayer()->clearDirtyFrames();
@@ -271,20 +293,35 @@ void ScribbleArea::invalidateAllCache()
 
 void ScribbleArea::invalidateCacheForFrame(int frameNumber)
 {
-    auto cacheKeyIter = mPixmapCacheKeys.find(static_cast<unsigned int>(frameNumber));
-    if (cacheKeyIter != mPixmapCacheKeys.end())
+    invalidateCacheForFrames(frameNumber, frameNumber);
+}
+
+void ScribbleArea::invalidateCacheForFrames(int firstFrame, int lastFrame)
+{
+    // The frames may be shown in any of the frames rendered ahead, through exposure or onion skins
+    mRenderedAheadFrames.invalidate();
+
+    if (lastFrame < 0) { return; }
+
+    auto cacheKeyIter = mPixmapCacheKeys.lowerBound(static_cast<unsigned int>(qMax(firstFrame, 0)));
+    const auto cacheKeyEnd = mPixmapCacheKeys.upperBound(static_cast<unsigned int>(lastFrame));
+    while (cacheKeyIter != cacheKeyEnd)
     {
         QPixmapCache::remove(cacheKeyIter.value());
-        unsigned int key = cacheKeyIter.key();
-        mPixmapCacheKeys.remove(key);
+        cacheKeyIter = mPixmapCacheKeys.erase(cacheKeyIter);
     }
 }
 
 void ScribbleArea::invalidatePainterCaches()
+{
+    resetPainterCaches();
+    updateFrame();
+}
+
+void ScribbleArea::resetPainterCaches()
 {
     mCameraPainter.resetCache();
     mCanvasPainter.resetLayerCache();
-    updateFrame();
 }
 
 void ScribbleArea::onToolPropertyUpdated(ToolType, ToolPropertyType type)
@@ -323,6 +360,20 @@ void ScribbleArea::onPlayStateChanged()
     updateFrame();
 }
 
+void ScribbleArea::renderAhead(int frame)
+{
+    // The painters only render into mCanvas, keep the frame on screen aside meanwhile
+    const QPixmap displayedCanvas = mCanvas;
+    drawCanvas(frame, mCanvas.rect());
+    mRenderedAheadFrames.setCapacity(mEditor->playback()->renderAheadCapacity());
+    mRenderedAheadFrames.setView(mEditor->view()->getView());
+    mRenderedAheadFrames.push(frame, mCanvas);
+    mCanvas = displayedCanvas;
+
+    // The layer caches now belong to the frame rendered ahead, the frame on screen hasn't changed though
+    resetPainterCaches();
+}
+
 void ScribbleArea::onScrubbed(int frameNumber)
 {
     Q_UNUSED(frameNumber)
@@ -351,7 +402,17 @@ void ScribbleArea::onFrameModified(int frameNumber)
 
 void ScribbleArea::onViewChanged()
 {
-    invalidateAllCache();
+    // Every scrub reports a view change in case the camera moved. The canvases are drawn with the view
+    // alone and the camera on top of them, so they only go stale when the view itself changes
+    const QTransform view = mEditor->view()->getView();
+    if (view == mCanvasView)
+    {
+        updateFrame();
+        return;
+    }
+    mCanvasView = view;
+    mRenderedAheadFrames.setView(view);
+    invalidateCanvasCache();
 }
 
 void ScribbleArea::onLayerChanged()
@@ -879,29 +940,53 @@ void ScribbleArea::handleDrawingOnEmptyFrame()
 
 void ScribbleArea::paintEvent(QPaintEvent* event)
 {
+    PROFILE_SCOPE("ScribbleArea::paintEvent");
+
     int currentFrame = mEditor->currentFrame();
+    const bool isPlaying = mEditor->playback()->isPlaying();
+
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+    bool rendered = false;
+
     if (!currentTool()->isActive())
     {
-        // --- we retrieve the canvas from the cache; we create it if it doesn't exist
-        const int frameNumber = mEditor->layers()->lastFrameAtFrame(currentFrame);
-
-        if (frameNumber < 0)
+        // --- during playback, the frame may have been rendered ahead while the previous one was shown
+        if (isPlaying && mRenderedAheadFrames.take(currentFrame, mCanvas))
         {
-            drawCanvas(currentFrame, event->rect());
+            // Cached like any other canvas, so that the next loop or a scrub back finds it
+            if (mEditor->layers()->lastFrameAtFrame(currentFrame) >= 0)
+            {
+                mPixmapCacheKeys[static_cast<unsigned>(currentFrame)] = QPixmapCache::insert(mCanvas);
+            }
         }
         else
         {
-            auto cacheKeyIter = mPixmapCacheKeys.find(static_cast<unsigned>(frameNumber));
+            // --- we retrieve the canvas from the cache; we create it if it doesn't exist
+            const int frameNumber = mEditor->layers()->lastFrameAtFrame(currentFrame);
 
-            if (cacheKeyIter == mPixmapCacheKeys.end() || !QPixmapCache::find(cacheKeyIter.value(), &mCanvas))
+            if (frameNumber < 0)
             {
                 drawCanvas(currentFrame, event->rect());
-                mPixmapCacheKeys[static_cast<unsigned>(currentFrame)] = QPixmapCache::insert(mCanvas);
-                //qDebug() << "Repaint canvas!";
+                rendered = true;
             }
             else
             {
-                // Simply use the cached canvas from PixmapCache
+                auto cacheKeyIter = mPixmapCacheKeys.find(static_cast<unsigned>(frameNumber));
+
+                if (cacheKeyIter == mPixmapCacheKeys.end() || !QPixmapCache::find(cacheKeyIter.value(), &mCanvas))
+                {
+                    Profiler::addToCounter(Profiler::CANVAS_CACHE_MISSES, 1);
+                    drawCanvas(currentFrame, event->rect());
+                    mPixmapCacheKeys[static_cast<unsigned>(currentFrame)] = QPixmapCache::insert(mCanvas);
+                    rendered = true;
+                    //qDebug() << "Repaint canvas!";
+                }
+                else
+                {
+                    // Simply use the cached canvas from PixmapCache
+                    Profiler::addToCounter(Profiler::CANVAS_CACHE_HITS, 1);
+                }
             }
         }
     }
@@ -940,6 +1025,11 @@ void ScribbleArea::paintEvent(QPaintEvent* event)
     painter.setClipRect(event->rect());
     painter.drawPixmap(QPointF(), mCanvas);
 
+    if (isPlaying)
+    {
+        mEditor->playback()->framePresented(currentFrame, rendered ? renderTimer.nsecsElapsed() / 1000 : -1);
+    }
+
     currentTool()->paint(painter, event->rect());
 
     if (!editor()->playback()->isPlaying())    // we don't need to display the following when the animation is playing
@@ -1034,9 +1124,63 @@ void ScribbleArea::paintEvent(QPaintEvent* event)
     painter.drawRect(QRect(0, 0, width(), height()));
 #endif
 
+    if (mShowProfilerOverlay)
+    {
+        paintProfilerOverlay(painter);
+    }
+
     event->accept();
 }
 
+void ScribbleArea::setProfilerOverlayVisible(bool visible)
+{
+    mShowProfilerOverlay = visible;
+    update();
+}
+
+void ScribbleArea::paintProfilerOverlay(QPainter& painter)
+{
+    auto milliseconds = [](qint64 ns) {
+        return (ns < 0) ? QString("-") : QString::number(ns / 1000000.0, 'f', 2);
+    };
+
+    // The timings are from the previous paint, the current one isn't over yet
+    QStringList lines;
+    lines << tr("Frame: %1 ms").arg(milliseconds(Profiler::lastDuration("ScribbleArea::paintEvent")));
+    lines << tr("Canvas: %1 ms").arg(milliseconds(Profiler::lastDuration("CanvasPainter::paint")));
+    lines << tr("Canvas while drawing: %1 ms").arg(milliseconds(Profiler::lastDuration("CanvasPainter::paintCached")));
+    for (int i = 0; i < Profiler::COUNTER_COUNT; i++)
+    {
+        const Profiler::Counter counter = static_cast<Profiler::Counter>(i);
+        const qint64 value = Profiler::counter(counter);
+        const QString text = (counter == Profiler::FRAME_POOL_BYTES)
+            ? tr("%1 MB").arg(value / (1024 * 1024))
+            : QString::number(value);
+        lines << QString("%1: %2").arg(QString::fromLatin1(Profiler::counterName(counter)), text);
+    }
+    const QString text = lines.join('\n');
+
+    painter.save();
+    painter.setWorldMatrixEnabled(false);
+    painter.setClipping(false);
+
+    QFont font = painter.font();
+    font.setStyleHint(QFont::Monospace);
+    font.setFamily("monospace");
+    painter.setFont(font);
+
+    const int margin = 8;
+    QRect textRect = painter.fontMetrics().boundingRect(QRect(0, 0, width(), height()), Qt::AlignLeft | Qt::AlignTop, text);
+    textRect.moveTopLeft(QPoint(2 * margin, 2 * margin));
+
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0, 0, 0, 160));
+    painter.drawRect(textRect.adjusted(-margin, -margin, margin, margin));
+    painter.setPen(Qt::white);
+    painter.drawText(textRect, Qt::AlignLeft | Qt::AlignTop, text);
+    painter.restore();
+}
+
 void ScribbleArea::paintSelectionVisuals(QPainter &painter)
 {
     Object* object = mEditor->object();
@@ -1217,11 +1361,23 @@ void ScribbleArea::endStroke()
 {
     if (mEditor->layers()->currentLayer()->type() == Layer::BITMAP) {
         paintBitmapBuffer();
+    } else if (!mEditor->vectorStrokes()->hasPendingStrokes()) {
+        // Nothing was submitted, otherwise the raw stroke is shown until it has been committed
+        clearDrawingBuffer();
     }
 
     onFrameModified(mEditor->currentFrame());
 }
 
+void ScribbleArea::onVectorStrokeCommitted()
+{
+    // The next stroke may already be drawn in the buffer
+    if (mEditor->vectorStrokes()->hasPendingStrokes() || isPointerInUse()) { return; }
+
+    clearDrawingBuffer();
+    update();
+}
+
 void ScribbleArea::flipSelection(bool flipVertical)
 {
     mEditor->select()->flipSelection(flipVertical);
@@ -1361,11 +1517,7 @@ void ScribbleArea::applyTransformedSelection()
             handleDrawingOnEmptyFrame();
             BitmapImage* bitmapImage = currentBitmapImage(layer);
             if (bitmapImage == nullptr) { return; }
-            BitmapImage transformedImage = bitmapImage->transformed(selectMan->mySelectionRect().toRect(), selectMan->selectionTransform(), useAA);
-
-
-            bitmapImage->clear(selectMan->mySelectionRect());
-            bitmapImage->paste(&transformedImage, QPainter::CompositionMode_SourceOver);
+            bitmapImage->transformSelection(selectMan->mySelectionRect().toRect(), selectMan->selectionTransform(), useAA);
         }
         else if (layer->type() == Layer::VECTOR)
         {
@@ -38,6 +38,7 @@ GNU General Public License for more details.
 #include "selectionpainter.h"
 #include "camerapainter.h"
 #include "tiledbuffer.h"
+#include "renderaheadqueue.h"
 
 class Layer;
 class Editor;
@@ -89,6 +90,9 @@ public:
     /** Playstate changed, invalidate relevant cache */
     void onPlayStateChanged();
 
+    /** Renders the given frame ahead of time during playback, without showing it */
+    void renderAhead(int frame);
+
     /** View updated, invalidate relevant cache */
     void onViewChanged();
 
@@ -114,6 +118,9 @@ public:
     /** Tool changed, invalidate cache and frame if needed */
     void onToolChanged(ToolType);
 
+    /** A vector stroke has been added to its keyframe, drop the raw strokes once none is left */
+    void onVectorStrokeCommitted();
+
     void endStroke();
 
     void flipSelection(bool flipVertical);
@@ -127,6 +134,10 @@ public:
     void keyEvent(QKeyEvent* event);
     void keyEventForSelection(QKeyEvent* event);
 
+    /** Shows the frame times and cache statistics of the Profiler on top of the canvas */
+    void setProfilerOverlayVisible(bool visible);
+    bool isProfilerOverlayVisible() const { return mShowProfilerOverlay; }
+
 signals:
     void multiLayerOnionSkinChanged(bool);
     void selectionUpdated();
@@ -189,13 +200,22 @@ private:
     */
     void invalidatePainterCaches();
 
+    /** Same as invalidatePainterCaches(), without repainting the frame on screen */
+    void resetPainterCaches();
+
     /** Invalidate cache for the given frame */
     void invalidateCacheForFrame(int frameNumber);
 
+    /** Invalidate cache for the frames from first to last, inclusive */
+    void invalidateCacheForFrames(int firstFrame, int lastFrame);
+
     /** Invalidate all cache.
      * call this if you're certain that the change you've made affects all frames */
     void invalidateAllCache();
 
+    /** Invalidate the cached canvases, but keep the frames rendered ahead of playback */
+    void invalidateCanvasCache();
+
     /** invalidate cache for dirty keyframes. */
     void invalidateCacheForDirtyFrames();
 
@@ -208,6 +228,7 @@ private:
     void drawCanvas(int frame, QRect rect);
     void settingUpdated(SETTING setting);
     void paintSelectionVisuals(QPainter &painter);
+    void paintProfilerOverlay(QPainter& painter);
 
     BitmapImage* currentBitmapImage(Layer* layer) const;
     VectorImage* currentVectorImage(Layer* layer) const;
@@ -230,6 +251,7 @@ private:
     bool mMouseInUse = false;
     bool mTabletInUse = false;
     qreal mDevicePixelRatio = 1.;
+    bool mShowProfilerOverlay = false;
 
     // Double click handling for tablet input
     void handleDoubleClick();
@@ -257,6 +279,12 @@ private:
     // Pixmap Cache keys
     QMap<unsigned int, QPixmapCache::Key> mPixmapCacheKeys;
 
+    // Upcoming frames rendered during playback
+    RenderAheadQueue mRenderedAheadFrames;
+
+    // The view the cached canvases were drawn with
+    QTransform mCanvasView;
+
     // debug
     QLoggingCategory mLog{ "ScribbleArea" };
 };
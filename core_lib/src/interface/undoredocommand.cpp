@@ -121,6 +121,49 @@ void VectorReplaceCommand::redo()
     editor()->scrubTo(redoVector.pos());
 }
 
+KeyFramesReplaceCommand::KeyFramesReplaceCommand(const int layerId,
+                                                 const QList<int>& positions,
+                                                 std::vector<std::unique_ptr<KeyFrame>> undoKeyFrames,
+                                                 std::vector<std::unique_ptr<KeyFrame>> redoKeyFrames,
+                                                 const QString& description,
+                                                 Editor* editor,
+                                                 QUndoCommand* parent) : UndoRedoCommand(editor, parent)
+{
+    this->layerId = layerId;
+    this->positions = positions;
+    this->undoKeyFrames = std::move(undoKeyFrames);
+    this->redoKeyFrames = std::move(redoKeyFrames);
+
+    setText(description);
+}
+
+void KeyFramesReplaceCommand::undo()
+{
+    QUndoCommand::undo();
+
+    apply(undoKeyFrames);
+}
+
+void KeyFramesReplaceCommand::redo()
+{
+    QUndoCommand::redo();
+
+    // Ignore automatic redo when added to undo stack
+    if (isFirstRedo()) { setFirstRedo(false); return; }
+
+    apply(redoKeyFrames);
+}
+
+void KeyFramesReplaceCommand::apply(const std::vector<std::unique_ptr<KeyFrame>>& keyFrames)
+{
+    Layer* layer = editor()->layers()->findLayerById(layerId);
+    layer->restoreKeyFrames(positions, keyFrames);
+
+    editor()->layers()->notifyAnimationLengthChanged();
+    emit editor()->framesModified();
+    editor()->scrubTo(positions.first());
+}
+
 TransformCommand::TransformCommand(const QRectF& undoSelectionRect,
                                    const QPointF& undoTranslation,
                                    const qreal undoRotationAngle,
@@ -19,6 +19,8 @@ GNU General Public License for more details.
 #ifndef UNDOREDOCOMMAND_H
 #define UNDOREDOCOMMAND_H
 
+#include <memory>
+#include <vector>
 #include <QUndoCommand>
 #include <QRectF>
 
@@ -92,6 +94,30 @@ private:
     VectorImage redoVector;
 };
 
+class KeyFramesReplaceCommand : public UndoRedoCommand
+{
+public:
+    KeyFramesReplaceCommand(const int layerId,
+                            const QList<int>& positions,
+                            std::vector<std::unique_ptr<KeyFrame>> undoKeyFrames,
+                            std::vector<std::unique_ptr<KeyFrame>> redoKeyFrames,
+                            const QString& description,
+                            Editor* editor,
+                            QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    void apply(const std::vector<std::unique_ptr<KeyFrame>>& keyFrames);
+
+    int layerId = 0;
+    QList<int> positions;
+
+    std::vector<std::unique_ptr<KeyFrame>> undoKeyFrames;
+    std::vector<std::unique_ptr<KeyFrame>> redoKeyFrames;
+};
+
 class TransformCommand : public UndoRedoCommand
 
 {
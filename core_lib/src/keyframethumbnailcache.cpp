@@ -0,0 +1,430 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "keyframethumbnailcache.h"
+
+#include <algorithm>
+#include <memory>
+#include <QDir>
+#include <QFile>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QCryptographicHash>
+
+#include "layer.h"
+#include "object.h"
+#include "bitmapimage.h"
+#include "vectorimage.h"
+#include "vectorrasterizer.h"
+#include "util.h"
+
+namespace
+{
+    // Memory budget of the thumbnail cache, in KB
+    const int THUMBNAIL_CACHE_BUDGET = 64 * 1024;
+
+    class BitmapThumbnailTask : public QRunnable
+    {
+    public:
+        KeyFrameThumbnailCache* cache = nullptr;
+        int layerId = 0;
+        int position = 0;
+        int requestId = 0;
+
+        QImage image;         // A snapshot of the frame if it was loaded
+        QString filePath;     // Otherwise the file to decode
+        QPoint topLeft;
+        QTransform transform; // canvas -> thumbnail
+        QSize size;
+        QString cacheDir;
+        QString framingKey;
+
+        void run() override
+        {
+            QImage source = image;
+            QString cachedFilePath;
+
+            if (source.isNull())
+            {
+                QFile file(filePath);
+                if (!file.open(QIODevice::ReadOnly))
+                {
+                    emit cache->thumbnailGenerated(layerId, position, requestId, QImage());
+                    return;
+                }
+                const QByteArray bytes = file.readAll();
+
+                if (!cacheDir.isEmpty())
+                {
+                    // The same drawing framed differently must not share a thumbnail
+                    QCryptographicHash hash(QCryptographicHash::Sha1);
+                    hash.addData(bytes);
+                    hash.addData(QString("%1,%2;%3").arg(topLeft.x()).arg(topLeft.y()).arg(framingKey).toUtf8());
+                    cachedFilePath = QDir(cacheDir).filePath(QString::fromLatin1(hash.result().toHex()) + ".png");
+
+                    QImage cachedThumbnail(cachedFilePath);
+                    if (!cachedThumbnail.isNull())
+                    {
+                        emit cache->thumbnailGenerated(layerId, position, requestId, cachedThumbnail);
+                        return;
+                    }
+                }
+                source.loadFromData(bytes);
+            }
+
+            QImage thumbnail(size, QImage::Format_ARGB32_Premultiplied);
+            thumbnail.fill(Qt::transparent);
+
+            const QRect targetRect = transform.mapRect(QRectF(topLeft, source.size())).toAlignedRect();
+            if (!source.isNull() && !targetRect.isEmpty())
+            {
+                // Downscale once, painting a full size image with a scaled painter is both slower and aliased
+                const QImage scaled = source.scaled(targetRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                QPainter painter(&thumbnail);
+                painter.drawImage(targetRect.topLeft(), scaled);
+            }
+
+            if (!cachedFilePath.isEmpty())
+            {
+                thumbnail.save(cachedFilePath, "PNG");
+            }
+            emit cache->thumbnailGenerated(layerId, position, requestId, thumbnail);
+        }
+    };
+
+    class VectorThumbnailTask : public QRunnable
+    {
+    public:
+        KeyFrameThumbnailCache* cache = nullptr;
+        int layerId = 0;
+        int position = 0;
+        int requestId = 0;
+
+        std::unique_ptr<VectorImage> snapshot; // The keyframe if it was loaded
+        QString filePath;                       // Otherwise the file to read
+        VectorRasterizer::Request request;
+
+        void run() override
+        {
+            if (!snapshot)
+            {
+                // Like bitmaps, an unloaded frame is read from its file without bringing it back into memory
+                snapshot.reset(new VectorImage);
+                snapshot->read(filePath);
+            }
+            emit cache->thumbnailGenerated(layerId, position, requestId, VectorRasterizer::render(*snapshot, request));
+        }
+    };
+}
+
+KeyFrameThumbnailCache::KeyFrameThumbnailCache(QObject* parent) : QObject(parent)
+{
+    mCache.setMaxCost(THUMBNAIL_CACHE_BUDGET);
+
+    // Leave one core to the UI thread
+    mThreadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+    connect(this, &KeyFrameThumbnailCache::thumbnailGenerated,
+            this, &KeyFrameThumbnailCache::onThumbnailGenerated, Qt::QueuedConnection);
+}
+
+KeyFrameThumbnailCache::~KeyFrameThumbnailCache()
+{
+    mThreadPool.clear();
+    mThreadPool.waitForDone();
+    stopListening();
+}
+
+void KeyFrameThumbnailCache::setCacheDir(const QString& dirPath)
+{
+    mCacheDir = dirPath;
+    if (!mCacheDir.isEmpty())
+    {
+        QDir(mCacheDir).mkpath(".");
+    }
+}
+
+void KeyFrameThumbnailCache::setThumbnailSize(const QSize& size)
+{
+    if (mThumbnailSize != size)
+    {
+        mThumbnailSize = size;
+        clear();
+    }
+}
+
+void KeyFrameThumbnailCache::setViewRect(const QRect& rect)
+{
+    if (mViewRect != rect)
+    {
+        mViewRect = rect;
+        clear();
+    }
+}
+
+QImage KeyFrameThumbnailCache::thumbnail(const Layer* layer, KeyFrame* key, const Object* object)
+{
+    if (layer == nullptr || key == nullptr || mThumbnailSize.isEmpty()) { return QImage(); }
+
+    const quint64 k = entryKey(layer->id(), key->pos());
+    Entry* entry = mCache.object(k);
+    if (entry && entry->key == key && entry->version == key->version())
+    {
+        return entry->image;
+    }
+
+    // Keep showing the outdated thumbnail until the new one is ready, to avoid flickering
+    QImage staleImage = entry ? entry->image : QImage();
+
+    auto pending = mPending.find(k);
+    if (pending != mPending.end() && pending->key == key && pending->version == key->version())
+    {
+        return staleImage;
+    }
+
+    switch (layer->type())
+    {
+    case Layer::BITMAP:
+        requestBitmapThumbnail(layer->id(), key);
+        return staleImage;
+    case Layer::VECTOR:
+        requestVectorThumbnail(layer->id(), key, object);
+        return staleImage;
+    default:
+        break;
+    }
+    return QImage();
+}
+
+void KeyFrameThumbnailCache::invalidate(int layerId, int position)
+{
+    const quint64 k = entryKey(layerId, position);
+    mCache.remove(k);
+    mPending.remove(k);
+}
+
+void KeyFrameThumbnailCache::invalidateDirtyFrames(const Layer* layer)
+{
+    if (layer == nullptr) { return; }
+
+    const QList<std::pair<int, int>> ranges = layer->dirtyFrameRanges();
+    qint64 dirtyCount = 0;
+    for (const auto& range : ranges)
+    {
+        dirtyCount += static_cast<qint64>(range.second) - range.first + 1;
+    }
+
+    if (dirtyCount <= mCache.size() + mPending.size())
+    {
+        for (const auto& range : ranges)
+        {
+            for (int position = range.first; position <= range.second; position++)
+            {
+                invalidate(layer->id(), position);
+            }
+        }
+        return;
+    }
+
+    // Wide ranges, e.g. after a retime, hold far fewer thumbnails than positions
+    auto isDirty = [&ranges](quint64 k)
+    {
+        const int position = static_cast<int>(static_cast<quint32>(k));
+        auto range = std::upper_bound(ranges.begin(), ranges.end(), position,
+                                      [](int p, const std::pair<int, int>& r) { return p < r.first; });
+        return range != ranges.begin() && position <= std::prev(range)->second;
+    };
+    const quint32 layerId = static_cast<quint32>(layer->id());
+    for (quint64 k : mCache.keys() + mPending.keys())
+    {
+        if (static_cast<quint32>(k >> 32) == layerId && isDirty(k))
+        {
+            invalidate(layer->id(), static_cast<int>(static_cast<quint32>(k)));
+        }
+    }
+}
+
+void KeyFrameThumbnailCache::clear()
+{
+    mThreadPool.clear();
+    mCache.clear();
+    mPending.clear();
+    stopListening();
+}
+
+void KeyFrameThumbnailCache::onKeyFrameDestroy(KeyFrame* key)
+{
+    for (quint64 k : mListenedKeys.values(key))
+    {
+        Entry* entry = mCache.object(k);
+        if (entry && entry->key == key)
+        {
+            mCache.remove(k);
+        }
+        auto pending = mPending.find(k);
+        if (pending != mPending.end() && pending->key == key)
+        {
+            mPending.erase(pending);
+        }
+    }
+    mListenedKeys.remove(key);
+}
+
+void KeyFrameThumbnailCache::onThumbnailGenerated(int layerId, int position, int requestId, QImage image)
+{
+    const quint64 k = entryKey(layerId, position);
+    auto pending = mPending.find(k);
+    if (pending == mPending.end() || pending->requestId != requestId)
+    {
+        // The frame has been invalidated or requested again since
+        return;
+    }
+    KeyFrame* key = pending->key;
+    const int version = pending->version;
+    mPending.erase(pending);
+
+    if (image.isNull()) { return; }
+
+    insert(k, key, version, image);
+    emit thumbnailReady(layerId, position);
+}
+
+quint64 KeyFrameThumbnailCache::entryKey(int layerId, int position)
+{
+    return (static_cast<quint64>(static_cast<quint32>(layerId)) << 32) | static_cast<quint32>(position);
+}
+
+void KeyFrameThumbnailCache::insert(quint64 entryKey, KeyFrame* key, int version, const QImage& image)
+{
+    Entry* entry = new Entry;
+    entry->key = key;
+    entry->version = version;
+    entry->image = image;
+
+    const int cost = qMax(1, static_cast<int>(imageSize(image) / 1024));
+    mCache.insert(entryKey, entry, cost);
+    listenTo(key, entryKey);
+}
+
+void KeyFrameThumbnailCache::listenTo(KeyFrame* key, quint64 entryKey)
+{
+    if (!mListenedKeys.contains(key, entryKey))
+    {
+        mListenedKeys.insert(key, entryKey);
+    }
+    key->addEventListener(this);
+}
+
+void KeyFrameThumbnailCache::stopListening()
+{
+    for (KeyFrame* key : mListenedKeys.uniqueKeys())
+    {
+        key->removeEventListner(this);
+    }
+    mListenedKeys.clear();
+}
+
+void KeyFrameThumbnailCache::requestBitmapThumbnail(int layerId, KeyFrame* key)
+{
+    BitmapImage* bitmapImage = static_cast<BitmapImage*>(key);
+
+    BitmapThumbnailTask* task = new BitmapThumbnailTask;
+    if (bitmapImage->isLoaded())
+    {
+        // Cheap: QImage is implicitly shared, the worker keeps its own reference
+        task->image = *bitmapImage->image();
+    }
+    else if (!bitmapImage->fileName().isEmpty())
+    {
+        // Decode from disk rather than loading it through the frame pool
+        task->filePath = bitmapImage->fileName();
+        task->cacheDir = mCacheDir;
+    }
+    else
+    {
+        delete task;
+        return;
+    }
+
+    task->cache = this;
+    task->layerId = layerId;
+    task->position = key->pos();
+    task->requestId = ++mNextRequestId;
+    task->topLeft = bitmapImage->bounds().topLeft();
+    task->transform = viewToThumbnailTransform();
+    task->size = mThumbnailSize;
+    task->framingKey = QString("%1,%2,%3,%4;%5x%6")
+        .arg(mViewRect.x()).arg(mViewRect.y()).arg(mViewRect.width()).arg(mViewRect.height())
+        .arg(mThumbnailSize.width()).arg(mThumbnailSize.height());
+
+    addPending(layerId, key, task->requestId);
+    mThreadPool.start(task);
+}
+
+void KeyFrameThumbnailCache::requestVectorThumbnail(int layerId, KeyFrame* key, const Object* object)
+{
+    if (object == nullptr) { return; }
+
+    VectorImage* vectorImage = static_cast<VectorImage*>(key);
+
+    VectorThumbnailTask* task = new VectorThumbnailTask;
+    if (vectorImage->isLoaded() || vectorImage->fileName().isEmpty())
+    {
+        task->snapshot.reset(vectorImage->snapshot());
+    }
+    else
+    {
+        task->filePath = vectorImage->fileName();
+    }
+
+    task->cache = this;
+    task->layerId = layerId;
+    task->position = key->pos();
+    task->requestId = ++mNextRequestId;
+    task->request.transform = viewToThumbnailTransform();
+    task->request.size = mThumbnailSize;
+    task->request.palette = object->paletteColors();
+
+    addPending(layerId, key, task->requestId);
+    mThreadPool.start(task);
+}
+
+void KeyFrameThumbnailCache::addPending(int layerId, KeyFrame* key, int requestId)
+{
+    const quint64 k = entryKey(layerId, key->pos());
+    Entry& pending = mPending[k];
+    pending.key = key;
+    pending.version = key->version();
+    pending.requestId = requestId;
+    listenTo(key, k);
+}
+
+QTransform KeyFrameThumbnailCache::viewToThumbnailTransform() const
+{
+    if (mViewRect.isEmpty()) { return QTransform(); }
+
+    // Fit the view rect into the thumbnail, keeping its aspect ratio
+    const qreal scale = qMin(static_cast<qreal>(mThumbnailSize.width()) / mViewRect.width(),
+                             static_cast<qreal>(mThumbnailSize.height()) / mViewRect.height());
+    const QPointF center = QRectF(mViewRect).center();
+
+    QTransform t;
+    t.translate(mThumbnailSize.width() / 2.0, mThumbnailSize.height() / 2.0);
+    t.scale(scale, scale);
+    t.translate(-center.x(), -center.y());
+    return t;
+}
@@ -0,0 +1,108 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef KEYFRAMETHUMBNAILCACHE_H
+#define KEYFRAMETHUMBNAILCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QThreadPool>
+#include "keyframe.h"
+
+class Layer;
+class Object;
+
+/**
+ * KeyFrameThumbnailCache produces small previews of bitmap and vector keyframes for the timeline.
+ *
+ * Thumbnails are kept in a LRU memory cache keyed by layer id and frame position.
+ * Bitmap thumbnails are generated on a worker pool: loaded frames are snapshotted (QImage is implicitly shared),
+ * unloaded frames are decoded straight from their file without going through the ActiveFramePool.
+ * Thumbnails of file-backed frames are also written to a sidecar folder in the working directory, named after
+ * the hash of the file content, so they survive frame moves and cache evictions.
+ *
+ * Vector frames are rasterized on the same pool from a snapshot of the keyframe and of the palette,
+ * see VectorRasterizer.
+ *
+ * Entries are invalidated through the dirty frames of a layer, when the keyframe version changes
+ * or when the keyframe is destroyed.
+ */
+class KeyFrameThumbnailCache : public QObject, public KeyFrameEventListener
+{
+    Q_OBJECT
+public:
+    explicit KeyFrameThumbnailCache(QObject* parent = nullptr);
+    ~KeyFrameThumbnailCache() override;
+
+    /** The folder where thumbnails of file-backed frames are persisted, empty to disable the disk cache */
+    void setCacheDir(const QString& dirPath);
+    void setThumbnailSize(const QSize& size);
+    QSize thumbnailSize() const { return mThumbnailSize; }
+
+    /** The canvas area which is mapped onto the thumbnail, usually the camera field */
+    void setViewRect(const QRect& rect);
+
+    /** Returns the thumbnail of the given keyframe if it's ready, otherwise schedules
+     *  its generation and returns a null image. thumbnailReady() is emitted once done. */
+    QImage thumbnail(const Layer* layer, KeyFrame* key, const Object* object);
+
+    void invalidate(int layerId, int position);
+    void invalidateDirtyFrames(const Layer* layer);
+    void clear();
+
+    void onKeyFrameDestroy(KeyFrame*) override;
+
+signals:
+    void thumbnailReady(int layerId, int position);
+
+    /** Emitted from worker threads, delivered to onThumbnailGenerated() on the owner thread */
+    void thumbnailGenerated(int layerId, int position, int requestId, QImage image);
+
+private slots:
+    void onThumbnailGenerated(int layerId, int position, int requestId, QImage image);
+
+private:
+    struct Entry
+    {
+        KeyFrame* key = nullptr;
+        int version = 0;
+        int requestId = 0; // only used by pending requests
+        QImage image;
+    };
+
+    static quint64 entryKey(int layerId, int position);
+    void insert(quint64 entryKey, KeyFrame* key, int version, const QImage& image);
+    void listenTo(KeyFrame* key, quint64 entryKey);
+    void stopListening();
+    void requestBitmapThumbnail(int layerId, KeyFrame* key);
+    void requestVectorThumbnail(int layerId, KeyFrame* key, const Object* object);
+    void addPending(int layerId, KeyFrame* key, int requestId);
+    QTransform viewToThumbnailTransform() const;
+
+    QCache<quint64, Entry> mCache;
+    QHash<quint64, Entry> mPending;
+    QMultiHash<KeyFrame*, quint64> mListenedKeys;
+    QThreadPool mThreadPool;
+    int mNextRequestId = 0;
+
+    QString mCacheDir;
+    QSize mThumbnailSize{ 64, 48 };
+    QRect mViewRect{ -400, -300, 800, 600 };
+};
+
+#endif // KEYFRAMETHUMBNAILCACHE_H
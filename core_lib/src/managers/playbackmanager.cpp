@@ -26,8 +26,17 @@ GNU General Public License for more details.
 #include "layersound.h"
 #include "layermanager.h"
 #include "soundclip.h"
+#include "soundplayer.h"
+#include "soundmixer.h"
+#include "audiosink.h"
 #include "toolmanager.h"
 
+namespace
+{
+    // Keep the audio device open for a while after a scrub, so that scrubbing on doesn't reopen it
+    const int SCRUB_AUDIO_HOLD_MSEC = 1000;
+}
+
 
 PlaybackManager::PlaybackManager(Editor* editor) : BaseManager(editor, __FUNCTION__)
 {
@@ -36,6 +45,7 @@ PlaybackManager::PlaybackManager(Editor* editor) : BaseManager(editor, __FUNCTIO
 PlaybackManager::~PlaybackManager()
 {
     delete mElapsedTimer;
+    delete mAudioSink;
 }
 
 bool PlaybackManager::init()
@@ -50,6 +60,15 @@ bool PlaybackManager::init()
     mScrubTimer->setTimerType(Qt::PreciseTimer);
     mSoundclipsToPLay.clear();
 
+    mScrubAudioTimer = new QTimer(this);
+    mScrubAudioTimer->setSingleShot(true);
+
+    mSoundMixer = new SoundMixer(this);
+    if (DeviceAudioSink::isAvailable())
+    {
+        mAudioSink = new DeviceAudioSink;
+    }
+
     QSettings settings (PENCIL2D, PENCIL2D);
     mFps = settings.value(SETTING_FPS).toInt();
     mMsecSoundScrub = settings.value(SETTING_SOUND_SCRUB_MSEC).toInt();
@@ -59,6 +78,13 @@ bool PlaybackManager::init()
     mElapsedTimer = new QElapsedTimer;
     connect(mTimer, &QTimer::timeout, this, &PlaybackManager::timerTick);
     connect(mFlipTimer, &QTimer::timeout, this, &PlaybackManager::flipTimerTick);
+    connect(mScrubAudioTimer, &QTimer::timeout, this, [this]
+    {
+        if (mAudioSink && !mTimer->isActive())
+        {
+            mAudioSink->stop();
+        }
+    });
     return true;
 }
 
@@ -112,12 +138,9 @@ void PlaybackManager::play()
     mCheckForSoundsHalfway = true;
     playSounds(frame);
 
-    mTimer->setInterval(static_cast<int>(1000.f / mFps));
-    mTimer->start();
-
-    // for error correction, please ref skipFrame()
-    mPlayingFrameCounter = 1;
-    mElapsedTimer->start();
+    mScheduler.resetStats();
+    restartClock(frame);
+    mTimer->start(static_cast<int>(1000.f / mFps));
 
     emit playStateChanged(true);
 }
@@ -129,6 +152,30 @@ void PlaybackManager::stop()
     emit playStateChanged(false);
 }
 
+void PlaybackManager::framePresented(int frame, qint64 renderTime)
+{
+    if (!mTimer->isActive() || frame != mScheduler.presentedFrame()) { return; }
+
+    if (!mScheduler.recordPresentation(playbackTime())) { return; }
+    if (renderTime >= 0)
+    {
+        mScheduler.recordRenderTime(renderTime);
+    }
+
+    // Once the frame is on screen, use the time left to prepare the upcoming ones
+    QTimer::singleShot(0, this, &PlaybackManager::renderAhead);
+}
+
+void PlaybackManager::setAudioSink(AudioSink* sink)
+{
+    if (mAudioSink)
+    {
+        mAudioSink->stop();
+    }
+    delete mAudioSink;
+    mAudioSink = sink;
+}
+
 void PlaybackManager::playFlipRoll()
 {
     if (isPlaying()) { return; }
@@ -197,7 +244,16 @@ void PlaybackManager::playFlipInBetween()
 
 void PlaybackManager::playScrub(int frame)
 {
-    if (!mSoundScrub || !mSoundclipsToPLay.isEmpty()) {return; }
+    if (!mSoundScrub) { return; }
+
+    // Decoded clips play a short window from the mixer, the audio device stays open in between
+    if (mAudioSink && !mTimer->isActive())
+    {
+        startAudio(frame, static_cast<qint64>(mMsecSoundScrub) * SoundMixer::SAMPLE_RATE / 1000);
+        mScrubAudioTimer->start(mMsecSoundScrub + SCRUB_AUDIO_HOLD_MSEC);
+    }
+
+    if (!mSoundclipsToPLay.isEmpty()) { return; }
 
     auto layerMan = editor()->layers();
     for (int i = 0; i < layerMan->count(); i++)
@@ -206,7 +262,7 @@ void PlaybackManager::playScrub(int frame)
         if (layer->type() == Layer::SOUND && layer->visible())
         {
             KeyFrame* key = layer->getKeyFrameWhichCovers(frame);
-            if (key != nullptr)
+            if (key != nullptr && !isMixed(static_cast<SoundClip*>(key)))
             {
                 SoundClip* clip = static_cast<SoundClip*>(key);
                 mSoundclipsToPLay.append(clip);
@@ -232,6 +288,11 @@ void PlaybackManager::setFps(int fps)
         settings.setValue(SETTING_FPS, fps);
         emit fpsChanged(mFps);
 
+        if (mTimer->isActive())
+        {
+            restartClock(editor()->currentFrame());
+        }
+
         // Update key-frame lengths of sound layers,
         // since the length depends on fps.
         for (int i = 0; i < object()->getLayerCount(); ++i)
@@ -295,7 +356,10 @@ void PlaybackManager::playSounds(int frame)
                 {
                     key = layer->getKeyFrameWhichCovers(listPosition);
                     SoundClip* clip = static_cast<SoundClip*>(key);
-                    clip->playFromPosition(frame, mFps);
+                    if (!isMixed(clip))
+                    {
+                        clip->playFromPosition(frame, mFps);
+                    }
                 }
             }
         }
@@ -303,8 +367,10 @@ void PlaybackManager::playSounds(int frame)
         {
             key = layer->getKeyFrameAt(frame);
             SoundClip* clip = static_cast<SoundClip*>(key);
-
-            clip->play();
+            if (!isMixed(clip))
+            {
+                clip->play();
+            }
 
             // save the position of our active sound frame
             mActiveSoundFrame = frame;
@@ -331,30 +397,227 @@ void PlaybackManager::playSounds(int frame)
 }
 
 /**
- * @brief PlaybackManager::skipFrame()
- * Small errors accumulate while playing animation
- * If the error is greater than a frame interval, skip a frame
+ * @brief PlaybackManager::playSkippedSounds()
+ * Starts the sounds which should have started on frames dropped between fromFrame and toFrame
+ */
+void PlaybackManager::playSkippedSounds(int fromFrame, int toFrame)
+{
+    if (!mIsPlaySound || toFrame <= fromFrame + 1)
+    {
+        return;
+    }
+
+    for (int i = 0; i < object()->getLayerCount(); ++i)
+    {
+        Layer* layer = object()->getLayer(i);
+        if (layer->type() != Layer::SOUND || !layer->visible())
+        {
+            continue;
+        }
+
+        KeyFrame* key = layer->getLastKeyFrameAtPosition(toFrame);
+        if (key != nullptr && key->pos() > fromFrame && key->pos() < toFrame && key->pos() + key->length() > toFrame &&
+            !isMixed(static_cast<SoundClip*>(key)))
+        {
+            static_cast<SoundClip*>(key)->playFromPosition(toFrame, mFps);
+            if (!mListOfActiveSoundFrames.contains(key->pos()))
+            {
+                mListOfActiveSoundFrames.append(key->pos());
+            }
+        }
+    }
+}
+
+void PlaybackManager::restartClock(int frame)
+{
+    mScheduler.start(frame, mStartFrame, mEndFrame, mFps, mIsLooping);
+    mElapsedTimer->start();
+    mClockOffset = 0;
+    mLastPlaybackTime = 0;
+    mNextRenderAheadStep = 1;
+
+    if (mIsPlaySound)
+    {
+        startAudio(frame);
+    }
+}
+
+/**
+ * @brief PlaybackManager::isMixed()
+ * Whether the clip is played by the sound mixer rather than by its own media player.
+ * That's the case once it has been decoded, as long as there is an audio device to play the mix on.
+ */
+bool PlaybackManager::isMixed(SoundClip* clip) const
+{
+    return mAudioSink != nullptr && clip->player() != nullptr && clip->player()->decodedAudio() != nullptr;
+}
+
+void PlaybackManager::updateMixerTracks()
+{
+    QVector<SoundMixer::Track> tracks;
+    for (int i = 0; i < object()->getLayerCount(); ++i)
+    {
+        Layer* layer = object()->getLayer(i);
+        if (layer->type() != Layer::SOUND || !layer->visible())
+        {
+            continue;
+        }
+
+        layer->foreachKeyFrame([this, &tracks](KeyFrame* key)
+        {
+            SoundClip* clip = static_cast<SoundClip*>(key);
+            if (isMixed(clip))
+            {
+                SoundMixer::Track track;
+                track.samples = clip->player()->decodedAudio();
+                track.start = SoundMixer::frameToSample(clip->pos(), mFps);
+                tracks.append(track);
+            }
+        });
+    }
+    mSoundMixer->setTracks(tracks);
+}
+
+/**
+ * @brief PlaybackManager::startAudio()
+ * Moves the mixer to the start of the given frame and makes sure the audio device is playing it.
+ * The playback time at that moment is remembered, so that the audio clock can be read from the sink.
+ * @param length the number of samples to play, or all of them if negative
  */
-bool PlaybackManager::skipFrame()
+void PlaybackManager::startAudio(int frame, qint64 length)
 {
-    // uncomment these debug outputs to see what happens
-    //float expectedTime = (mPlayingFrameCounter) * (1000.f / mFps);
-    //qDebug("Expected:  %.2f ms", expectedTime);
-    //qDebug("Actual:    %d   ms", mElapsedTimer->elapsed());
+    if (mAudioSink == nullptr) { return; }
+
+    updateMixerTracks();
+    if (!mSoundMixer->hasTracks())
+    {
+        mAudioSink->stop();
+        return;
+    }
 
-    int t = qRound((mPlayingFrameCounter - 1) * (1000.f / mFps));
-    if (mElapsedTimer->elapsed() < t)
+    mSoundMixer->setPosition(SoundMixer::frameToSample(frame, mFps), length);
+    if (!mAudioSink->isActive() && !mAudioSink->start(mSoundMixer))
     {
-        qDebug() << "skip";
-        return true;
+        return;
+    }
+
+    mAudioAnchorUSecs = mAudioSink->processedUSecs();
+    mAudioAnchorTime = mTimer->isActive() ? mScheduler.timeOfStep(mScheduler.presentedStep()) : 0;
+}
+
+/**
+ * @brief PlaybackManager::playbackTime()
+ * Time since playback started, in microseconds.
+ * While a sound clip is playing, the clock follows its position once they drift apart by more than a frame,
+ * but never goes backwards: when the picture is ahead, the clock holds until the audio catches up.
+ */
+qint64 PlaybackManager::playbackTime()
+{
+    qint64 time = mElapsedTimer->nsecsElapsed() / 1000 + mClockOffset;
+
+    const qint64 audioTime = audioPlaybackTime();
+    const qint64 tolerance = 1500000 / mFps;
+    if (audioTime >= 0 && qAbs(audioTime - time) > tolerance)
+    {
+        mClockOffset += audioTime - time;
+        time = audioTime;
+    }
+
+    time = qMax(time, mLastPlaybackTime);
+    mLastPlaybackTime = time;
+    return time;
+}
+
+qint64 PlaybackManager::audioPlaybackTime()
+{
+    if (!mIsPlaySound)
+    {
+        return -1;
+    }
+
+    if (mAudioSink && mAudioSink->isActive() && mSoundMixer->hasTracks())
+    {
+        const qint64 played = mAudioSink->processedUSecs() - mAudioAnchorUSecs;
+        if (played > 0)
+        {
+            return mAudioAnchorTime + played;
+        }
+    }
+
+    const int frame = mScheduler.presentedFrame();
+    for (int i = 0; i < object()->getLayerCount(); ++i)
+    {
+        Layer* layer = object()->getLayer(i);
+        if (layer->type() != Layer::SOUND || !layer->visible())
+        {
+            continue;
+        }
+
+        KeyFrame* key = layer->getKeyFrameWhichCovers(frame);
+        if (key == nullptr || isMixed(static_cast<SoundClip*>(key)))
+        {
+            continue;
+        }
+
+        SoundPlayer* player = static_cast<SoundClip*>(key)->player();
+        if (player == nullptr || !player->isPlaying() || player->position() <= 0)
+        {
+            continue;
+        }
+
+        const qint64 time = mScheduler.timeOfFrameInCurrentLoop(key->pos()) + player->position() * 1000;
+        if (time >= 0)
+        {
+            return time;
+        }
     }
+    return -1;
+}
+
+/**
+ * @brief PlaybackManager::renderAhead()
+ * Asks the canvas to render the next frames while the current one is displayed,
+ * as long as the time left before the next frame is due covers an average render.
+ * At most mRenderAheadCapacity frames are kept ahead of the presented one.
+ */
+void PlaybackManager::renderAhead()
+{
+    if (!mTimer->isActive()) { return; }
+
+    const qint64 presentedStep = mScheduler.presentedStep();
+    const qint64 nextFrameTime = mScheduler.timeOfStep(presentedStep + 1);
+    mNextRenderAheadStep = qMax(mNextRenderAheadStep, presentedStep + 1);
 
-    ++mPlayingFrameCounter;
-    return false;
+    while (mNextRenderAheadStep <= presentedStep + mRenderAheadCapacity)
+    {
+        if (nextFrameTime - playbackTime() < mScheduler.stats().averageRenderTime())
+        {
+            break;
+        }
+
+        const int frame = mScheduler.frameOfStep(mNextRenderAheadStep);
+        if (frame < 0)
+        {
+            break;
+        }
+
+        QElapsedTimer renderTimer;
+        renderTimer.start();
+        emit renderAheadRequested(frame);
+        mScheduler.recordRenderTime(renderTimer.nsecsElapsed() / 1000);
+        mScheduler.recordRenderedAhead();
+
+        ++mNextRenderAheadStep;
+    }
 }
 
 void PlaybackManager::stopSounds()
 {
+    if (mAudioSink)
+    {
+        mAudioSink->stop();
+    }
+
     std::vector<LayerSound*> kSoundLayers;
 
     for (int i = 0; i < object()->getLayerCount(); ++i)
@@ -387,31 +650,42 @@ void PlaybackManager::stopScrubPlayback()
 
 void PlaybackManager::timerTick()
 {
-    int currentFrame = editor()->currentFrame();
+    const qint64 previousStep = mScheduler.presentedStep();
+    const int previousFrame = mScheduler.presentedFrame();
+
+    // Jump to whichever frame is due now, frames we are too late for are dropped
+    const int frame = mScheduler.advance(playbackTime());
 
     // reach the end
-    if (currentFrame >= mEndFrame)
+    if (mScheduler.isFinished())
+    {
+        stop();
+        return;
+    }
+
+    if (frame > 0)
     {
-        if (mIsLooping)
+        const qint64 step = mScheduler.presentedStep();
+        if (mScheduler.loopOfStep(step) != mScheduler.loopOfStep(previousStep))
         {
-            editor()->scrubTo(mStartFrame);
             mCheckForSoundsHalfway = true;
+            if (mIsPlaySound)
+            {
+                startAudio(frame);
+            }
         }
         else
         {
-            stop();
+            playSkippedSounds(previousFrame, frame);
         }
-        return;
-    }
-
-    if (skipFrame())
-        return;
 
-    // keep going
-    editor()->scrubForward();
+        editor()->scrubTo(frame);
+        playSounds(frame);
+    }
 
-    int newFrame = editor()->currentFrame();
-    playSounds(newFrame);
+    // Wake up when the next frame is due
+    const qint64 timeLeft = mScheduler.timeOfStep(mScheduler.presentedStep() + 1) - playbackTime();
+    mTimer->setInterval(qMax(1, static_cast<int>((timeLeft + 999) / 1000)));
 }
 
 void PlaybackManager::flipTimerTick()
@@ -434,6 +708,10 @@ void PlaybackManager::setLooping(bool isLoop)
     if (mIsLooping != isLoop)
     {
         mIsLooping = isLoop;
+        if (mTimer->isActive())
+        {
+            restartClock(editor()->currentFrame());
+        }
         emit loopStateChanged(mIsLooping);
     }
 }
@@ -446,6 +724,10 @@ void PlaybackManager::enableRangedPlayback(bool b)
 
         updateStartFrame();
         updateEndFrame();
+        if (mTimer->isActive())
+        {
+            restartClock(editor()->currentFrame());
+        }
 
         emit rangedPlaybackStateChanged(mIsRangedPlayback);
     }
@@ -486,4 +768,8 @@ void PlaybackManager::enableSound(bool b)
         // check for sounds partway through.
         mCheckForSoundsHalfway = true;
     }
+    else if (mTimer->isActive())
+    {
+        startAudio(editor()->currentFrame());
+    }
 }
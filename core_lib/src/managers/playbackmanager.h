@@ -19,11 +19,14 @@ GNU General Public License for more details.
 #define PLAYBACKMANAGER_H
 
 #include "basemanager.h"
+#include "playbackscheduler.h"
 #include <QVector>
 
 class QTimer;
 class QElapsedTimer;
 class SoundClip;
+class SoundMixer;
+class AudioSink;
 
 
 class PlaybackManager : public BaseManager
@@ -68,6 +71,17 @@ public:
 
     void stopSounds();
 
+    /** Called by the canvas when it has painted a frame during playback.
+     *  @param renderTime the time spent rendering it in microseconds, negative if it was rendered ahead */
+    void framePresented(int frame, qint64 renderTime);
+    const PlaybackStats& stats() const { return mScheduler.stats(); }
+    int renderAheadCapacity() const { return mRenderAheadCapacity; }
+
+    /** Replaces where the mixed sound goes, takes ownership of the sink.
+     *  A null sink leaves every clip to its own media player. */
+    void setAudioSink(AudioSink* sink);
+    SoundMixer* soundMixer() const { return mSoundMixer; }
+
 private slots:
     void stopScrubPlayback();
 
@@ -77,11 +91,21 @@ signals:
     void rangedPlaybackStateChanged(bool b);
     void playStateChanged(bool isPlaying);
 
+    /** Asks the canvas to render an upcoming frame while there is time left before it's due */
+    void renderAheadRequested(int frame);
+
 private:
     void timerTick();
     void flipTimerTick();
     void playSounds(int frame);
-    bool skipFrame();
+    void playSkippedSounds(int fromFrame, int toFrame);
+    void restartClock(int frame);
+    qint64 playbackTime();
+    qint64 audioPlaybackTime();
+    void renderAhead();
+    bool isMixed(SoundClip* clip) const;
+    void updateMixerTracks();
+    void startAudio(int frame, qint64 length = -1);
 
     int mStartFrame = 1;
     int mEndFrame = 60;
@@ -108,8 +132,19 @@ private:
     QTimer* mTimer = nullptr;
     QTimer* mFlipTimer = nullptr;
     QTimer* mScrubTimer = nullptr;
+    QTimer* mScrubAudioTimer = nullptr;
     QElapsedTimer* mElapsedTimer = nullptr;
-    int mPlayingFrameCounter = 0; // how many frames has passed after pressing play
+
+    PlaybackScheduler mScheduler;
+    qint64 mClockOffset = 0; // usec, correction applied to follow the audio
+    qint64 mLastPlaybackTime = 0;
+    qint64 mNextRenderAheadStep = 1;
+    int mRenderAheadCapacity = 6;
+
+    SoundMixer* mSoundMixer = nullptr;
+    AudioSink* mAudioSink = nullptr;
+    qint64 mAudioAnchorTime = 0; // usec, playback time at which the mixer was last moved
+    qint64 mAudioAnchorUSecs = 0; // usec, audio the sink had played by then
 
     bool mCheckForSoundsHalfway = false;
     QVector<int> mListOfActiveSoundFrames;
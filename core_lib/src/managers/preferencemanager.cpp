@@ -113,6 +113,7 @@ void PreferenceManager::loadPrefs()
     set(SETTING::FRAME_SIZE,               settings.value(SETTING_FRAME_SIZE,             12).toInt());
     set(SETTING::TIMELINE_SIZE,            settings.value(SETTING_TIMELINE_SIZE,          240).toInt());
     set(SETTING::DRAW_LABEL,               settings.value(SETTING_DRAW_LABEL,             false ).toBool());
+    set(SETTING::TIMELINE_THUMBNAILS,      settings.value(SETTING_TIMELINE_THUMBNAILS,    false ).toBool());
     set(SETTING::LABEL_FONT_SIZE,          settings.value(SETTING_LABEL_FONT_SIZE,        12).toInt());
 
     set( SETTING::DRAW_ON_EMPTY_FRAME_ACTION, settings.value( SETTING_DRAW_ON_EMPTY_FRAME_ACTION,
@@ -441,6 +442,9 @@ void PreferenceManager::set(SETTING option, bool value)
     case SETTING::DRAW_LABEL:
         settings.setValue(SETTING_DRAW_LABEL, value);
         break;
+    case SETTING::TIMELINE_THUMBNAILS:
+        settings.setValue(SETTING_TIMELINE_THUMBNAILS, value);
+        break;
     case SETTING::QUICK_SIZING:
         settings.setValue(SETTING_QUICK_SIZING, value);
         break;
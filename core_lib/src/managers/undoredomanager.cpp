@@ -19,6 +19,7 @@ GNU General Public License for more details.
 #include "object.h"
 #include "editor.h"
 
+#include <algorithm>
 #include <QAction>
 #include <QDebug>
 #include <QSettings>
@@ -32,6 +33,7 @@ GNU General Public License for more details.
 
 #include "undoredocommand.h"
 #include "legacybackupelement.h"
+#include "vectorstrokefinalizer.h"
 
 #include "layerbitmap.h"
 #include "layervector.h"
@@ -122,6 +124,86 @@ void UndoRedoManager::record(const UndoSaveState*& undoState, const QString& des
     undoState = nullptr;
 }
 
+void UndoRedoManager::recordKeyFrames(std::unique_ptr<KeyFramesSaveState> undoState, const QString& description)
+{
+    std::vector<std::unique_ptr<KeyFramesSaveState>> undoStates;
+    undoStates.push_back(std::move(undoState));
+    recordKeyFrames(std::move(undoStates), description);
+}
+
+void UndoRedoManager::recordKeyFrames(std::vector<std::unique_ptr<KeyFramesSaveState>> undoStates, const QString& description)
+{
+    undoStates.erase(std::remove_if(undoStates.begin(), undoStates.end(), [](const std::unique_ptr<KeyFramesSaveState>& state) {
+        return !state || state->positions.isEmpty();
+    }), undoStates.end());
+
+    if (undoStates.empty()) {
+        return;
+    }
+
+    if (mNewBackupSystemEnabled) {
+        // A single layer is a command of its own, several layers are grouped under one
+        QUndoCommand* parent = nullptr;
+        if (undoStates.size() > 1) {
+            parent = new UndoRedoCommand(editor());
+            parent->setText(description);
+        }
+
+        QUndoCommand* command = nullptr;
+        for (auto& undoState : undoStates)
+        {
+            command = new KeyFramesReplaceCommand(undoState->layerId,
+                                                  undoState->positions,
+                                                  std::move(undoState->keyframes),
+                                                  currentKeyFrames(*undoState),
+                                                  description,
+                                                  editor(),
+                                                  parent);
+        }
+        pushCommand(parent ? parent : command);
+        return;
+    }
+
+    trimLegacyBackupList();
+
+    BackupLegacyKeyFramesElement* element = new BackupLegacyKeyFramesElement;
+    element->undoText = description;
+    for (auto& undoState : undoStates)
+    {
+        Layer* layer = object()->findLayerById(undoState->layerId);
+        Q_ASSERT(layer);
+
+        BackupLegacyKeyFramesElement::LayerKeyFrames part;
+        part.layerId = undoState->layerId;
+        part.layer = editor()->layers()->getIndex(layer);
+        part.positions = undoState->positions;
+        part.undoKeyFrames = std::move(undoState->keyframes);
+        part.redoKeyFrames = currentKeyFrames(*undoState);
+        element->layers.push_back(std::move(part));
+    }
+
+    mLegacyBackupList.append(element);
+    mLegacyBackupIndex++;
+
+    emit didUpdateUndoStack();
+}
+
+std::vector<std::unique_ptr<KeyFrame>> UndoRedoManager::currentKeyFrames(const KeyFramesSaveState& undoState) const
+{
+    Layer* layer = object()->findLayerById(undoState.layerId);
+    Q_ASSERT(layer);
+
+    std::vector<std::unique_ptr<KeyFrame>> keyFrames;
+    for (int position : undoState.positions)
+    {
+        if (KeyFrame* keyframe = layer->getKeyFrameAt(position))
+        {
+            keyFrames.emplace_back(keyframe->clone());
+        }
+    }
+    return keyFrames;
+}
+
 bool UndoRedoManager::hasUnsavedChanges() const
 {
     if (mNewBackupSystemEnabled) {
@@ -259,7 +341,12 @@ QAction* UndoRedoManager::createUndoAction(QObject* parent, const QIcon& icon)
     undoAction->setIcon(icon);
 
     if (mNewBackupSystemEnabled) {
-        // The new system takes care of this automatically
+        // Strokes still being finalized are pushed first, so that they are what gets undone
+        disconnect(undoAction, &QAction::triggered, &mUndoStack, nullptr);
+        connect(undoAction, &QAction::triggered, this, [this] {
+            editor()->finishVectorStrokes();
+            mUndoStack.undo();
+        });
     } else {
         connect(undoAction, &QAction::triggered, this, &UndoRedoManager::legacyUndo);
     }
@@ -279,7 +366,11 @@ QAction* UndoRedoManager::createRedoAction(QObject* parent, const QIcon& icon)
     redoAction->setIcon(icon);
 
     if (mNewBackupSystemEnabled) {
-        // The new system takes care of this automatically
+        disconnect(redoAction, &QAction::triggered, &mUndoStack, nullptr);
+        connect(redoAction, &QAction::triggered, this, [this] {
+            editor()->finishVectorStrokes();
+            mUndoStack.redo();
+        });
     } else {
         connect(redoAction, &QAction::triggered, this, &UndoRedoManager::legacyRedo);
     }
@@ -359,6 +450,13 @@ void UndoRedoManager::legacyBackup(const QString& undoText)
 
     KeyFrame* frame = nullptr;
     int currentFrame = editor()->currentFrame();
+
+    // A stroke still being added to the current frame is the last modification, commit it first
+    Layer* currentLayer = editor()->layers()->currentLayer();
+    if (editor()->vectorStrokes()->hasPendingStrokes(currentLayer->getLastKeyFrameAtPosition(currentFrame)))
+    {
+        editor()->finishVectorStrokes();
+    }
     if (mLegacyLastModifiedLayer > -1 && mLegacyLastModifiedFrame > 0)
     {
         if (editor()->layers()->currentLayer()->type() == Layer::SOUND)
@@ -398,15 +496,7 @@ bool UndoRedoManager::legacyBackup(int backupLayer, int backupFrame, const QStri
         return false;
     }
 
-    while (mLegacyBackupList.size() - 1 > mLegacyBackupIndex && !mLegacyBackupList.empty())
-    {
-        delete mLegacyBackupList.takeLast();
-    }
-    while (mLegacyBackupList.size() >= editor()->preference()->getInt(SETTING::UNDO_REDO_MAX_STEPS))
-    {
-        delete mLegacyBackupList.takeFirst();
-        mLegacyBackupIndex--;
-    }
+    trimLegacyBackupList();
 
     Layer* layer = editor()->layers()->getLayer(backupLayer);
     int currentFrame = editor()->currentFrame();
@@ -448,6 +538,12 @@ bool UndoRedoManager::legacyBackup(int backupLayer, int backupFrame, const QStri
             VectorImage* vectorImage = static_cast<VectorImage*>(layer->getLastKeyFrameAtPosition(backupFrame));
             if (vectorImage != nullptr)
             {
+                // The backup must hold the strokes that are still being added to the frame
+                if (editor()->vectorStrokes()->hasPendingStrokes(vectorImage))
+                {
+                    editor()->finishVectorStrokes();
+                }
+
                 BackupLegacyVectorElement* element = new BackupLegacyVectorElement(vectorImage);
                 element->layerId = layer->id();
                 element->layer = backupLayer;
@@ -506,6 +602,20 @@ bool UndoRedoManager::legacyBackup(int backupLayer, int backupFrame, const QStri
     return true;
 }
 
+void UndoRedoManager::trimLegacyBackupList()
+{
+    // Drop the elements that could be redone and make room for a new one
+    while (mLegacyBackupList.size() - 1 > mLegacyBackupIndex && !mLegacyBackupList.empty())
+    {
+        delete mLegacyBackupList.takeLast();
+    }
+    while (mLegacyBackupList.size() >= editor()->preference()->getInt(SETTING::UNDO_REDO_MAX_STEPS))
+    {
+        delete mLegacyBackupList.takeFirst();
+        mLegacyBackupIndex--;
+    }
+}
+
 void UndoRedoManager::sanitizeLegacyBackupElementsAfterLayerDeletion(int layerIndex)
 {
     if (mNewBackupSystemEnabled) {
@@ -518,6 +628,7 @@ void UndoRedoManager::sanitizeLegacyBackupElementsAfterLayerDeletion(int layerIn
         BackupLegacyBitmapElement *bitmapElement;
         BackupLegacyVectorElement *vectorElement;
         BackupLegacySoundElement *soundElement;
+        BackupLegacyKeyFramesElement *keyFramesElement;
         switch (backupElement->type())
         {
         case LegacyBackupElement::BITMAP_MODIF:
@@ -559,6 +670,32 @@ void UndoRedoManager::sanitizeLegacyBackupElementsAfterLayerDeletion(int layerIn
                 continue;
             }
             break;
+        case LegacyBackupElement::KEYFRAMES_MODIF:
+        {
+            keyFramesElement = qobject_cast<BackupLegacyKeyFramesElement*>(backupElement);
+            Q_ASSERT(keyFramesElement);
+
+            // Only the part of the removed layer goes, unless it was the only one
+            auto& parts = keyFramesElement->layers;
+            for (auto part = parts.begin(); part != parts.end();)
+            {
+                if (part->layer == layerIndex)
+                {
+                    part = parts.erase(part);
+                    continue;
+                }
+                if (part->layer > layerIndex)
+                {
+                    part->layer--;
+                }
+                ++part;
+            }
+            if (!parts.empty())
+            {
+                continue;
+            }
+            break;
+        }
         default:
             Q_UNREACHABLE();
         }
@@ -628,6 +765,7 @@ void UndoRedoManager::restoreLegacyKey()
 
 void UndoRedoManager::legacyUndo()
 {
+    editor()->finishVectorStrokes();
     if (!mLegacyBackupList.empty() && mLegacyBackupIndex > -1)
     {
         if (mLegacyBackupIndex == mLegacyBackupList.size() - 1)
@@ -657,6 +795,15 @@ void UndoRedoManager::legacyUndo()
                     mLegacyBackupIndex--;
                 }
             }
+            if (lastBackupElement->type() == LegacyBackupElement::KEYFRAMES_MODIF)
+            {
+                // The element redoes itself, this one only keeps the list in the shape legacyRedo() expects
+                const auto& firstPart = static_cast<BackupLegacyKeyFramesElement*>(lastBackupElement)->layers.front();
+                if (legacyBackup(firstPart.layer, firstPart.positions.last(), "NoOp"))
+                {
+                    mLegacyBackupIndex--;
+                }
+            }
         }
 
         qDebug() << "Undo" << mLegacyBackupIndex;
@@ -669,11 +816,20 @@ void UndoRedoManager::legacyUndo()
 
 void UndoRedoManager::legacyRedo()
 {
+    editor()->finishVectorStrokes();
     if (!mLegacyBackupList.empty() && mLegacyBackupIndex < mLegacyBackupList.size() - 2)
     {
         mLegacyBackupIndex++;
 
-        mLegacyBackupList[mLegacyBackupIndex + 1]->restore(editor());
+        LegacyBackupElement* redoneElement = mLegacyBackupList[mLegacyBackupIndex];
+        if (redoneElement->type() == LegacyBackupElement::KEYFRAMES_MODIF)
+        {
+            static_cast<BackupLegacyKeyFramesElement*>(redoneElement)->redo(editor());
+        }
+        else
+        {
+            mLegacyBackupList[mLegacyBackupIndex + 1]->restore(editor());
+        }
         emit didUpdateUndoStack();
     }
 }
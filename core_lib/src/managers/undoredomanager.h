@@ -87,6 +87,24 @@ struct UndoSaveState {
     UndoRedoRecordType recordType = UndoRedoRecordType::INVALID;
 };
 
+/// The keyframes of a layer before an operation that changes many frames at once,
+/// such as importing an image sequence.
+struct KeyFramesSaveState {
+    int layerId = 0;
+    QList<int> positions;
+    std::vector<std::unique_ptr<KeyFrame>> keyframes;
+
+    /** Remembers the keyframe at the given position, call it before the position is modified. */
+    void remember(const Layer* layer, int position)
+    {
+        positions.append(position);
+        if (KeyFrame* keyframe = layer->getKeyFrameAt(position))
+        {
+            keyframes.emplace_back(keyframe->clone());
+        }
+    }
+};
+
 class UndoRedoManager : public BaseManager
 {
     Q_OBJECT
@@ -106,6 +124,16 @@ public:
     */
     void record(const UndoSaveState*& undoState, const QString& description);
 
+    /** Records a change to many keyframes as a single step, in either undo/redo system.
+     *  The state after the change is taken from the layer as it is now.
+    * @param undoState The keyframes before the change.
+    * @param description The description that will bound to the undo/redo action.
+    */
+    void recordKeyFrames(std::unique_ptr<KeyFramesSaveState> undoState, const QString& description);
+
+    /** Records a change to the keyframes of several layers as a single step, see above. */
+    void recordKeyFrames(std::vector<std::unique_ptr<KeyFramesSaveState>> undoStates, const QString& description);
+
 
     /** Checks whether there are unsaved changes.
      *  @return true if there are unsaved changes, otherwise false */
@@ -158,8 +186,12 @@ private:
 
     const UndoSaveState* savedKeyFrameState() const;
 
+    /** Copies of the keyframes now at the positions of the given save state */
+    std::vector<std::unique_ptr<KeyFrame>> currentKeyFrames(const KeyFramesSaveState& undoState) const;
+
     void pushCommand(QUndoCommand* command);
 
+    void trimLegacyBackupList();
     void legacyUndo();
     void legacyRedo();
 
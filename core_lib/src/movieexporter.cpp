@@ -19,8 +19,10 @@ GNU General Public License for more details.
 #include <ctime>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <QDir>
 #include <QDebug>
+#include <QHash>
 #include <QProcess>
 #include <QApplication>
 #include <QStandardPaths>
@@ -28,12 +30,15 @@ GNU General Public License for more details.
 #include <QtMath>
 #include <QPainter>
 #include <QRegularExpression>
+#include <QSysInfo>
 
 #include "object.h"
 #include "layercamera.h"
 #include "layersound.h"
 #include "soundclip.h"
+#include "soundplayer.h"
 #include "util.h"
+#include "vectorrasterizer.h"
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
 using Qt::SplitBehaviorFlags;
@@ -41,6 +46,29 @@ using Qt::SplitBehaviorFlags;
 using SplitBehaviorFlags = QString::SplitBehavior;
 #endif
 
+namespace
+{
+    /** Starts rendering the vector keyframes of the frames up to lastFrame on the workers of the rasterizer,
+     *  with the transform the frame is painted with. prefetchedFrame is the last frame handed to it so far,
+     *  it stops short when the rasterizer has no room for more images. */
+    void prefetchVectorFrames(VectorRasterizer& rasterizer, const Object* obj, const LayerCamera* cameraLayer,
+                              const QTransform& centralizeCamera, const QSize& camSize, const QSize& exportSize,
+                              int lastFrame, int& prefetchedFrame)
+    {
+        while (prefetchedFrame < lastFrame)
+        {
+            const int frame = prefetchedFrame + 1;
+            const QTransform transform = cameraLayer->getViewAtFrame(frame) * centralizeCamera
+                * VectorRasterizer::windowTransform(camSize, exportSize);
+            if (!rasterizer.prefetchFrame(obj, frame, VectorRasterizer::frameRequest(obj, transform, exportSize, true)))
+            {
+                break;
+            }
+            prefetchedFrame = frame;
+        }
+    }
+}
+
 MovieExporter::MovieExporter()
 {
 }
@@ -126,7 +154,12 @@ Status MovieExporter::run(const Object* obj,
         majorProgress(0.03f, 0.25f);
         progressMessage(tr("Assembling audio..."));
         minorProgress(0.f);
-        STATUS_CHECK(assembleAudio(obj, ffmpegPath, minorProgress))
+        const QString tempAudioPath = QDir(mTempWorkDir).filePath("tmpaudio.pcm");
+        auto decodeClip = [this, &ffmpegPath](const QString& soundFile, std::shared_ptr<const SoundMixer::Samples>& samples)
+        {
+            return decodeAudio(ffmpegPath, soundFile, samples);
+        };
+        STATUS_CHECK(assembleAudio(obj, mDesc, tempAudioPath, decodeClip, minorProgress))
         minorProgress(1.f);
         majorProgress(0.25f, 1.f);
         progressMessage(tr("Generating movie..."));
@@ -147,10 +180,18 @@ QString MovieExporter::error()
     return QString();
 }
 
-/** Combines all audio tracks in obj into a single file.
+/** Mixes all audio tracks in obj into a single raw audio file.
+ *
+ *  Every sound file is decoded once and each clip is placed at the position
+ *  of its key frame. Overlapping clips are summed and clamped, rather than
+ *  wrapped around, when they get too loud. The result covers the exported
+ *  frames in the SoundMixer format and is read by the movie pass as its
+ *  second input.
  *
  *  @param[in] obj
- *  @param[in] ffmpegPath
+ *  @param[in] desc The frames to cover, at desc.fps.
+ *  @param[in] filePath The raw audio file to write.
+ *  @param[in] decodeClip Used to decode the clips that haven't been decoded yet.
  *  @param[out] progress A function that takes one float argument
  *              (the percentage of the audio assembly complete) and
  *              may display the output to the user in any way it
@@ -160,22 +201,19 @@ QString MovieExporter::error()
  *          or safe if there was intentionally no output.
  */
 Status MovieExporter::assembleAudio(const Object* obj,
-                                    QString ffmpegPath,
+                                    const ExportMovieDesc& desc,
+                                    const QString& filePath,
+                                    const AudioDecoder& decodeClip,
                                     std::function<void(float)> progress)
 {
-    // Quicktime assemble call
-    const int startFrame = mDesc.startFrame;
-    const int endFrame = mDesc.endFrame;
-    const int fps = mDesc.fps;
+    const int startFrame = desc.startFrame;
+    const int endFrame = desc.endFrame;
+    const int fps = desc.fps;
 
     Q_ASSERT(startFrame >= 0);
     Q_ASSERT(endFrame >= startFrame);
 
-    QDir dir(mTempWorkDir);
-    Q_ASSERT(dir.exists());
-
-    QString tempAudioPath = QDir(mTempWorkDir).filePath("tmpaudio.wav");
-    qDebug() << "TempAudio=" << tempAudioPath;
+    qDebug() << "TempAudio=" << filePath;
 
     std::vector< SoundClip* > allSoundClips;
 
@@ -194,63 +232,119 @@ Status MovieExporter::assembleAudio(const Object* obj,
 
     if (allSoundClips.empty()) return Status::SAFE;
 
-    int clipCount = 0;
+    // Clips were usually decoded for playback already, and duplicated clips share their file
+    QHash<QString, std::shared_ptr<const SoundMixer::Samples>> decodedFiles;
+    QVector<SoundMixer::Track> tracks;
+    for (size_t i = 0; i < allSoundClips.size(); i++)
+    {
+        if (mCanceled)
+        {
+            return Status::CANCELED;
+        }
 
-    QString filterComplex, amergeInput, panChannelLayout;
-    QStringList args;
+        SoundClip* clip = allSoundClips[i];
+        std::shared_ptr<const SoundMixer::Samples> samples = decodedFiles.value(clip->fileName());
+        if (!samples && clip->player())
+        {
+            samples = clip->player()->decodedAudio();
+        }
+        if (!samples)
+        {
+            STATUS_CHECK(decodeClip(clip->fileName(), samples))
+        }
+        decodedFiles.insert(clip->fileName(), samples);
 
-    int wholeLen = qCeil(endFrame * 44100.0 / fps);
-    for (auto clip : allSoundClips)
+        SoundMixer::Track track;
+        track.samples = samples;
+        track.start = SoundMixer::frameToSample(clip->pos(), fps);
+        tracks.append(track);
+
+        progress(0.5f * (i + 1) / allSoundClips.size());
+    }
+
+    SoundMixer mixer;
+    mixer.setTracks(tracks);
+
+    const qint64 firstSample = SoundMixer::frameToSample(startFrame, fps);
+    const qint64 endSample = SoundMixer::frameToSample(endFrame + 1, fps);
+    mixer.setPosition(firstSample);
+
+    QFile audioFile(filePath);
+    if (!audioFile.open(QIODevice::WriteOnly))
+    {
+        return Status::FAIL;
+    }
+
+    // Mix a second at a time
+    SoundMixer::Samples block(SoundMixer::SAMPLE_RATE * SoundMixer::CHANNEL_COUNT);
+    for (qint64 position = firstSample; position < endSample;)
     {
         if (mCanceled)
         {
             return Status::CANCELED;
         }
 
-        // Add sound file as input
-        args << "-i" << clip->fileName();
+        const qint64 count = qMin(static_cast<qint64>(SoundMixer::SAMPLE_RATE), endSample - position);
+        mixer.mix(block.data(), count);
 
-        // Offset the sound to its correct position
-        // See https://superuser.com/questions/716320/ffmpeg-placing-audio-at-specific-location
-        filterComplex += QString("[%1:a:0] aformat=sample_fmts=fltp:sample_rates=44100:channel_layouts=mono,volume=1,adelay=%2S|%2S,apad=whole_len=%3[ad%1];")
-                    .arg(clipCount).arg(qRound(44100.0 * (clip->pos() - 1) / fps)).arg(wholeLen);
-        amergeInput += QString("[ad%1]").arg(clipCount);
-        panChannelLayout += QString("c%1+").arg(clipCount);
+        const qint64 size = count * SoundMixer::BYTES_PER_FRAME;
+        if (audioFile.write(reinterpret_cast<const char*>(block.constData()), size) != size)
+        {
+            return Status::FAIL;
+        }
 
-        clipCount++;
+        position += count;
+        progress(0.5f + 0.5f * (position - firstSample) / (endSample - firstSample));
     }
-    // Remove final '+'
-    panChannelLayout.chop(1);
-    // Output arguments
-    // Mix audio
-    args << "-filter_complex";
-    if (clipCount == 1)
+    qDebug() << "audio file: " + filePath;
+
+    return Status::OK;
+}
+
+/** Decodes a sound file into the SoundMixer format using FFmpeg.
+ *
+ *  Only used for clips that weren't decoded for playback, for instance
+ *  because Qt has no audio decoder on this platform.
+ *
+ *  @param[in]  ffmpegPath The path to the FFmpeg binary.
+ *  @param[in]  soundFile The file to decode.
+ *  @param[out] samples The decoded samples.
+ *
+ *  @return Returns the final status of the operation.
+ */
+Status MovieExporter::decodeAudio(const QString& ffmpegPath, const QString& soundFile, std::shared_ptr<const SoundMixer::Samples>& samples)
+{
+    const QString tempDecodePath = QDir(mTempWorkDir).filePath("tmpdecode.pcm");
+
+    QStringList args;
+    args << "-i" << soundFile;
+    args << "-f" << pcmFormatName() << "-ar" << QString::number(SoundMixer::SAMPLE_RATE) << "-ac" << QString::number(SoundMixer::CHANNEL_COUNT);
+    args << "-y" << tempDecodePath;
+
+    STATUS_CHECK(MovieExporter::executeFFmpeg(ffmpegPath, args, [this] (int) { return !mCanceled; }))
+
+    QFile decodedFile(tempDecodePath);
+    if (!decodedFile.open(QIODevice::ReadOnly))
     {
-        // If there is only one sound clip there is no need to use amerge
-        // Prior to ffmpeg 3.2, amerge does not support inputs=1
-        filterComplex.chop(1); // Remove final semicolon since there are no more filters added after
-        args << filterComplex << "-map" << amergeInput;
-    }
-    else {
-        args << QString("%1%2 amerge=inputs=%3, pan=mono|c0=%4 [out]")
-                .arg(filterComplex).arg(amergeInput).arg(clipCount).arg(panChannelLayout);
-        args << "-map" << "[out]";
+        return Status::FAIL;
     }
-    // Convert audio file: 44100Hz sampling rate, stereo, signed 16 bit little endian
-    // Supported audio file types: wav, mp3, ogg... ( all file types supported by ffmpeg )
-    args << "-ar" << "44100" << "-acodec" << "pcm_s16le" << "-ac" << "2" << "-y";
-    // Trim audio
-    args << "-ss" << QString::number((startFrame - 1) / static_cast<double>(fps));
-    args << "-to" << QString::number(endFrame / static_cast<double>(fps));
-    // Output path
-    args << tempAudioPath;
-
-    STATUS_CHECK(MovieExporter::executeFFmpeg(ffmpegPath, args, [&progress, this] (int frame) { progress(frame / static_cast<float>(mDesc.endFrame - mDesc.startFrame)); return !mCanceled; }))
-    qDebug() << "audio file: " + tempAudioPath;
+    const QByteArray data = decodedFile.readAll();
+    decodedFile.close();
+    decodedFile.remove();
+
+    auto decoded = std::make_shared<SoundMixer::Samples>(data.size() / static_cast<int>(sizeof(qint16)));
+    std::memcpy(decoded->data(), data.constData(), static_cast<size_t>(decoded->size()) * sizeof(qint16));
+    samples = decoded;
 
     return Status::OK;
 }
 
+/** The FFmpeg name of the raw format SoundMixer produces */
+QString MovieExporter::pcmFormatName()
+{
+    return (QSysInfo::ByteOrder == QSysInfo::BigEndian) ? QStringLiteral("s16be") : QStringLiteral("s16le");
+}
+
 /** Exports obj to a movie image at strOut using FFmpeg.
  *
  *  @param[in]  obj An Object containing the animation to export.
@@ -311,6 +405,11 @@ Status MovieExporter::generateMovie(
     QTransform centralizeCamera;
     centralizeCamera.translate(camSize.width() / 2, camSize.height() / 2);
 
+    // Vector keyframes of the next frames are rendered ahead while the current one is written out
+    VectorRasterizer rasterizer;
+    const int lookAhead = qMax(1, QThread::idealThreadCount());
+    int prefetchedFrame = frameStart - 1;
+
     int failCounter = 0;
     /* Movie export uses a "sliding window" to reduce memory usage
      * while having a relatively small impact on speed. This basically
@@ -324,7 +423,7 @@ Status MovieExporter::generateMovie(
     // Build FFmpeg command
 
     //int exportFps = mDesc.videoFps;
-    const QString tempAudioPath = QDir(mTempWorkDir).filePath("tmpaudio.wav");
+    const QString tempAudioPath = QDir(mTempWorkDir).filePath("tmpaudio.pcm");
 
     QStringList args = {"-f", "rawvideo", "-pixel_format", "bgra"};
     args << "-video_size" << QString("%1x%2").arg(exportSize.width()).arg(exportSize.height());
@@ -336,6 +435,8 @@ Status MovieExporter::generateMovie(
 
     if (QFile::exists(tempAudioPath))
     {
+        args << "-f" << pcmFormatName();
+        args << "-ar" << QString::number(SoundMixer::SAMPLE_RATE) << "-ac" << QString::number(SoundMixer::CHANNEL_COUNT);
         args << "-i" << tempAudioPath;
     }
 
@@ -374,6 +475,9 @@ Status MovieExporter::generateMovie(
 
         if((currentFrame - frameStart <= framesProcessed + frameWindow || failCounter > 10) && currentFrame <= frameEnd)
         {
+            prefetchVectorFrames(rasterizer, obj, cameraLayer, centralizeCamera, camSize, exportSize,
+                                 qMin(currentFrame + lookAhead, frameEnd), prefetchedFrame);
+
             QImage imageToExport = imageToExportBase.copy();
             QPainter painter(&imageToExport);
 
@@ -381,7 +485,7 @@ Status MovieExporter::generateMovie(
             painter.setWorldTransform(view * centralizeCamera);
             painter.setWindow(QRect(0, 0, camSize.width(), camSize.height()));
 
-            obj->paintImage(painter, currentFrame, false, true);
+            obj->paintImage(painter, currentFrame, false, true, &rasterizer);
             painter.end();
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
@@ -462,6 +566,11 @@ Status MovieExporter::generateGif(
     QTransform centralizeCamera;
     centralizeCamera.translate(camSize.width() / 2, camSize.height() / 2);
 
+    // Vector keyframes of the next frames are rendered ahead while the current one is written out
+    VectorRasterizer rasterizer;
+    const int lookAhead = qMax(1, QThread::idealThreadCount());
+    int prefetchedFrame = frameStart - 1;
+
     // Build FFmpeg command
 
     QStringList args = {"-f", "rawvideo", "-pixel_format", "bgra"};
@@ -496,6 +605,9 @@ Status MovieExporter::generateGif(
             return false;
         }
 
+        prefetchVectorFrames(rasterizer, obj, cameraLayer, centralizeCamera, camSize, exportSize,
+                             qMin(currentFrame + lookAhead, frameEnd), prefetchedFrame);
+
         QImage imageToExport = imageToExportBase.copy();
         QPainter painter(&imageToExport);
 
@@ -503,7 +615,7 @@ Status MovieExporter::generateGif(
         painter.setWorldTransform(view * centralizeCamera);
         painter.setWindow(QRect(0, 0, camSize.width(), camSize.height()));
 
-        obj->paintImage(painter, currentFrame, false, true);
+        obj->paintImage(painter, currentFrame, false, true, &rasterizer);
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
         bytesWritten = ffmpeg.write(reinterpret_cast<const char*>(imageToExport.constBits()), imageToExport.sizeInBytes());
@@ -18,11 +18,13 @@ GNU General Public License for more details.
 #define MOVIEEXPORTER_H
 
 #include <functional>
+#include <memory>
 #include <QCoreApplication>
 #include <QString>
 #include <QSize>
 #include <QTemporaryDir>
 #include "pencilerror.h"
+#include "soundmixer.h"
 
 class Object;
 class QProcess;
@@ -44,6 +46,9 @@ class MovieExporter
 {
     Q_DECLARE_TR_FUNCTIONS(MovieExporter)
 public:
+    /** Decodes a sound file into the SoundMixer format */
+    using AudioDecoder = std::function<Status(const QString& soundFile, std::shared_ptr<const SoundMixer::Samples>& samples)>;
+
     MovieExporter();
     ~MovieExporter();
 
@@ -56,12 +61,16 @@ public:
 
     void cancel() { mCanceled = true; }
 
-    // The maximum number of sound frames that can be successfully rendered
-    static const int MAX_SOUND_FRAMES = 63;
-
     static Status executeFFmpeg(const QString& cmd, const QStringList& args, std::function<bool(int)> progress);
+
+    Status assembleAudio(const Object* obj,
+                         const ExportMovieDesc& desc,
+                         const QString& filePath,
+                         const AudioDecoder& decodeClip,
+                         std::function<void(float)> progress);
 private:
-    Status assembleAudio(const Object* obj, QString ffmpegPath, std::function<void(float)> progress);
+    Status decodeAudio(const QString& ffmpegPath, const QString& soundFile, std::shared_ptr<const SoundMixer::Samples>& samples);
+    static QString pcmFormatName();
     Status generateMovie(const Object *obj, QString ffmpegPath, QString strOutputFile, std::function<void(float)> progress);
     Status generateGif(const Object *obj, QString ffmpeg, QString strOut, std::function<void(float)>  progress);
 
@@ -0,0 +1,115 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "playbackscheduler.h"
+
+namespace
+{
+    const qint64 USEC_PER_SEC = 1000000;
+}
+
+void PlaybackScheduler::start(int firstFrame, int rangeStart, int rangeEnd, int fps, bool looping)
+{
+    mRangeStart = rangeStart;
+    mRangeEnd = qMax(rangeStart, rangeEnd);
+    mFirstFrame = qBound(mRangeStart, firstFrame, mRangeEnd);
+    mFps = qMax(1, fps);
+    mLooping = looping;
+
+    mPresentedStep = 0;
+    mPresentationRecorded = false;
+    mFinished = false;
+}
+
+int PlaybackScheduler::advance(qint64 time)
+{
+    if (mFinished) { return -1; }
+
+    const qint64 step = stepAt(time);
+    if (step <= mPresentedStep)
+    {
+        return -1;
+    }
+
+    const int frame = frameOfStep(step);
+    if (frame < 0)
+    {
+        mFinished = true;
+        return -1;
+    }
+
+    mStats.droppedFrames += static_cast<int>(step - mPresentedStep - 1);
+    mPresentedStep = step;
+    mPresentationRecorded = false;
+    return frame;
+}
+
+int PlaybackScheduler::frameOfStep(qint64 step) const
+{
+    const qint64 offset = (mFirstFrame - mRangeStart) + step;
+    if (mLooping)
+    {
+        return mRangeStart + static_cast<int>(offset % rangeLength());
+    }
+    if (offset >= rangeLength())
+    {
+        return -1;
+    }
+    return mRangeStart + static_cast<int>(offset);
+}
+
+int PlaybackScheduler::loopOfStep(qint64 step) const
+{
+    if (!mLooping) { return 0; }
+    return static_cast<int>(((mFirstFrame - mRangeStart) + step) / rangeLength());
+}
+
+qint64 PlaybackScheduler::stepAt(qint64 time) const
+{
+    if (time < 0) { return 0; }
+    return time * mFps / USEC_PER_SEC;
+}
+
+qint64 PlaybackScheduler::timeOfStep(qint64 step) const
+{
+    // Round up, so that stepAt(timeOfStep(n)) == n
+    return (step * USEC_PER_SEC + mFps - 1) / mFps;
+}
+
+qint64 PlaybackScheduler::timeOfFrameInCurrentLoop(int frame) const
+{
+    const qint64 loopStart = static_cast<qint64>(loopOfStep(mPresentedStep)) * rangeLength();
+    return timeOfStep(loopStart + frame - mFirstFrame);
+}
+
+void PlaybackScheduler::recordRenderTime(qint64 renderTime)
+{
+    mStats.renderCount++;
+    mStats.totalRenderTime += renderTime;
+    mStats.maxRenderTime = qMax(mStats.maxRenderTime, renderTime);
+}
+
+bool PlaybackScheduler::recordPresentation(qint64 time)
+{
+    if (mPresentationRecorded) { return false; }
+    mPresentationRecorded = true;
+
+    const qint64 latency = qMax(qint64(0), time - timeOfStep(mPresentedStep));
+    mStats.presentedFrames++;
+    mStats.totalPresentLatency += latency;
+    mStats.maxPresentLatency = qMax(mStats.maxPresentLatency, latency);
+    return true;
+}
@@ -0,0 +1,99 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef PLAYBACKSCHEDULER_H
+#define PLAYBACKSCHEDULER_H
+
+#include <QtGlobal>
+
+/** Measurements of a playback session, times are in microseconds */
+struct PlaybackStats
+{
+    int presentedFrames = 0;
+    int droppedFrames = 0;
+    int framesRenderedAhead = 0;
+
+    int renderCount = 0;
+    qint64 totalRenderTime = 0;
+    qint64 maxRenderTime = 0;
+
+    qint64 totalPresentLatency = 0;
+    qint64 maxPresentLatency = 0;
+
+    qint64 averageRenderTime() const { return (renderCount > 0) ? totalRenderTime / renderCount : 0; }
+    qint64 averagePresentLatency() const { return (presentedFrames > 0) ? totalPresentLatency / presentedFrames : 0; }
+};
+
+/**
+ * PlaybackScheduler decides which frame should be on screen at a given playback time.
+ *
+ * Playback is counted in steps: step 0 is the frame playback started from and step n is due
+ * n frame intervals later. The frame of a step wraps around the playback range when looping.
+ * When the caller falls behind, advance() jumps straight to the frame that is due and counts
+ * the steps in between as dropped, so the same clock always yields the same sequence of frames.
+ *
+ * The scheduler has no clock of its own, times are passed in by the caller.
+ */
+class PlaybackScheduler
+{
+public:
+    void start(int firstFrame, int rangeStart, int rangeEnd, int fps, bool looping);
+    void setLooping(bool looping) { mLooping = looping; }
+    void resetStats() { mStats = PlaybackStats(); }
+
+    /** Moves to the step due at the given time.
+     *  @return the frame to present, or -1 if the presented frame is still due or playback has finished */
+    int advance(qint64 time);
+    bool isFinished() const { return mFinished; }
+
+    qint64 presentedStep() const { return mPresentedStep; }
+    int presentedFrame() const { return frameOfStep(mPresentedStep); }
+
+    /** @return the frame shown at the given step, or -1 if it's past the end of the range */
+    int frameOfStep(qint64 step) const;
+    int loopOfStep(qint64 step) const;
+    qint64 stepAt(qint64 time) const;
+    qint64 timeOfStep(qint64 step) const;
+
+    /** The time at which the given frame is due within the current loop, may be negative */
+    qint64 timeOfFrameInCurrentLoop(int frame) const;
+
+    void recordRenderTime(qint64 renderTime);
+    void recordRenderedAhead() { mStats.framesRenderedAhead++; }
+
+    /** Records when the presented frame actually reached the screen, only the first call per step counts
+     *  @return true if it was recorded */
+    bool recordPresentation(qint64 time);
+
+    const PlaybackStats& stats() const { return mStats; }
+
+private:
+    int rangeLength() const { return mRangeEnd - mRangeStart + 1; }
+
+    int mFirstFrame = 1;
+    int mRangeStart = 1;
+    int mRangeEnd = 1;
+    int mFps = 12;
+    bool mLooping = false;
+
+    qint64 mPresentedStep = 0;
+    bool mPresentationRecorded = false;
+    bool mFinished = false;
+
+    PlaybackStats mStats;
+};
+
+#endif // PLAYBACKSCHEDULER_H
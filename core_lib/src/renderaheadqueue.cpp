@@ -0,0 +1,69 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "renderaheadqueue.h"
+
+#include <algorithm>
+
+void RenderAheadQueue::setCapacity(int capacity)
+{
+    mCapacity = qMax(0, capacity);
+    while (size() > mCapacity)
+    {
+        mFrames.pop_front();
+    }
+}
+
+void RenderAheadQueue::setView(const QTransform& view)
+{
+    if (view == mView) { return; }
+
+    mView = view;
+    invalidate();
+}
+
+void RenderAheadQueue::invalidate()
+{
+    ++mGeneration;
+    mFrames.clear();
+}
+
+void RenderAheadQueue::push(int frame, const QPixmap& canvas)
+{
+    mFrames.push_back({ frame, mGeneration, canvas });
+    while (size() > mCapacity)
+    {
+        mFrames.pop_front();
+    }
+}
+
+bool RenderAheadQueue::take(int frame, QPixmap& canvas)
+{
+    auto it = std::find_if(mFrames.begin(), mFrames.end(),
+                           [frame](const RenderedFrame& rendered) { return rendered.frame == frame; });
+    if (it == mFrames.end())
+    {
+        return false;
+    }
+
+    const bool current = (it->generation == mGeneration);
+    if (current)
+    {
+        canvas = it->canvas;
+    }
+    mFrames.erase(mFrames.begin(), it + 1);
+    return current;
+}
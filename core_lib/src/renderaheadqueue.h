@@ -0,0 +1,66 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef RENDERAHEADQUEUE_H
+#define RENDERAHEADQUEUE_H
+
+#include <deque>
+#include <QPixmap>
+#include <QTransform>
+
+/**
+ * Canvases rendered ahead of playback, in the order they will be shown.
+ *
+ * Each canvas is kept with the generation it was rendered in. The generation moves on when
+ * the drawing or the view transform changes, which makes the canvases rendered before it stale.
+ * Moving to another frame is not a change: a canvas already shows the camera of its own frame.
+ */
+class RenderAheadQueue
+{
+public:
+    void setCapacity(int capacity);
+    int capacity() const { return mCapacity; }
+
+    /** The view the canvases are rendered with, a different transform starts a new generation */
+    void setView(const QTransform& view);
+    /** The drawing changed, starts a new generation */
+    void invalidate();
+    int generation() const { return mGeneration; }
+
+    /** Queues the canvas of a frame, the oldest ones are dropped beyond the capacity */
+    void push(int frame, const QPixmap& canvas);
+    /** Takes the canvas of the given frame out of the queue if it's there and current.
+     *  Canvases queued before it were for frames the playback dropped and are discarded */
+    bool take(int frame, QPixmap& canvas);
+
+    int size() const { return static_cast<int>(mFrames.size()); }
+    bool isEmpty() const { return mFrames.empty(); }
+
+private:
+    struct RenderedFrame
+    {
+        int frame;
+        int generation;
+        QPixmap canvas;
+    };
+
+    std::deque<RenderedFrame> mFrames;
+    QTransform mView;
+    int mGeneration = 0;
+    int mCapacity = 6;
+};
+
+#endif // RENDERAHEADQUEUE_H
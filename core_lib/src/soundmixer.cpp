@@ -0,0 +1,179 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+
+#include "soundmixer.h"
+
+#include <cstring>
+#include <QAudioFormat>
+#include <QMutexLocker>
+#include <QSysInfo>
+
+const int SoundMixer::SAMPLE_RATE;
+const int SoundMixer::CHANNEL_COUNT;
+const int SoundMixer::BYTES_PER_FRAME;
+
+SoundMixer::SoundMixer(QObject* parent) : QIODevice(parent)
+{
+    // Unbuffered, so that every read is mixed at the playhead instead of ahead of it
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+QAudioFormat SoundMixer::audioFormat()
+{
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(CHANNEL_COUNT);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    format.setSampleFormat(QAudioFormat::Int16);
+#else
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(static_cast<QAudioFormat::Endian>(QSysInfo::ByteOrder));
+    format.setCodec("audio/pcm");
+#endif
+    return format;
+}
+
+qint64 SoundMixer::frameToSample(int frame, int fps)
+{
+    return static_cast<qint64>(frame - 1) * SAMPLE_RATE / qMax(1, fps);
+}
+
+SoundMixer::Samples SoundMixer::resample(const qint16* samples, qint64 frameCount, int channelCount, int sampleRate)
+{
+    Samples result;
+    if (samples == nullptr || frameCount <= 0 || channelCount <= 0 || sampleRate <= 0)
+    {
+        return result;
+    }
+
+    const qint64 outCount = frameCount * SAMPLE_RATE / sampleRate;
+    result.resize(static_cast<int>(outCount * CHANNEL_COUNT));
+    qint16* out = result.data();
+
+    // Mono is played on both sides, extra channels are dropped
+    const int rightChannel = (channelCount > 1) ? 1 : 0;
+
+    for (qint64 i = 0; i < outCount; i++)
+    {
+        // Linear interpolation between the two nearest source samples
+        const qint64 sourcePos = i * sampleRate;
+        const qint64 index = sourcePos / SAMPLE_RATE;
+        const qint64 next = qMin(index + 1, frameCount - 1);
+        const qint64 weight = sourcePos % SAMPLE_RATE;
+
+        for (int c = 0; c < CHANNEL_COUNT; c++)
+        {
+            const int channel = (c == 0) ? 0 : rightChannel;
+            const qint64 a = samples[index * channelCount + channel];
+            const qint64 b = samples[next * channelCount + channel];
+            *out++ = static_cast<qint16>(a + (b - a) * weight / SAMPLE_RATE);
+        }
+    }
+    return result;
+}
+
+void SoundMixer::setTracks(const QVector<Track>& tracks)
+{
+    QMutexLocker locker(&mMutex);
+    mTracks = tracks;
+}
+
+bool SoundMixer::hasTracks() const
+{
+    QMutexLocker locker(&mMutex);
+    return !mTracks.isEmpty();
+}
+
+void SoundMixer::setPosition(qint64 position, qint64 length)
+{
+    QMutexLocker locker(&mMutex);
+    mPosition = position;
+    mEndPosition = (length >= 0) ? position + length : -1;
+}
+
+qint64 SoundMixer::position() const
+{
+    QMutexLocker locker(&mMutex);
+    return mPosition;
+}
+
+void SoundMixer::mix(qint16* out, qint64 count)
+{
+    if (count <= 0) { return; }
+
+    QMutexLocker locker(&mMutex);
+
+    const qint64 start = mPosition;
+    qint64 end = start + count;
+    if (mEndPosition >= 0)
+    {
+        end = qBound(start, mEndPosition, end);
+    }
+
+    mMixBuffer.fill(0, static_cast<int>(count * CHANNEL_COUNT));
+    qint32* sum = mMixBuffer.data();
+
+    for (const Track& track : mTracks)
+    {
+        if (!track.samples) { continue; }
+
+        const qint64 trackEnd = track.start + track.samples->size() / CHANNEL_COUNT;
+        const qint64 from = qMax(start, track.start);
+        const qint64 to = qMin(end, trackEnd);
+        if (from >= to) { continue; }
+
+        const qint16* src = track.samples->constData() + (from - track.start) * CHANNEL_COUNT;
+        qint32* dst = sum + (from - start) * CHANNEL_COUNT;
+        const qint64 n = (to - from) * CHANNEL_COUNT;
+        for (qint64 i = 0; i < n; i++)
+        {
+            dst[i] += src[i];
+        }
+    }
+
+    const int total = mMixBuffer.size();
+    for (int i = 0; i < total; i++)
+    {
+        out[i] = static_cast<qint16>(qBound(-32768, sum[i], 32767));
+    }
+
+    mPosition += count;
+}
+
+qint64 SoundMixer::bytesAvailable() const
+{
+    // The mix never runs dry, past the end of the tracks it's silence
+    return SAMPLE_RATE * BYTES_PER_FRAME + QIODevice::bytesAvailable();
+}
+
+qint64 SoundMixer::readData(char* data, qint64 maxSize)
+{
+    const qint64 count = maxSize / BYTES_PER_FRAME;
+    if (count <= 0) { return 0; }
+
+    // Mix into an aligned buffer, the device buffer may not be
+    mReadBuffer.resize(static_cast<int>(count * CHANNEL_COUNT));
+    mix(mReadBuffer.data(), count);
+    std::memcpy(data, mReadBuffer.constData(), static_cast<size_t>(count * BYTES_PER_FRAME));
+    return count * BYTES_PER_FRAME;
+}
+
+qint64 SoundMixer::writeData(const char*, qint64)
+{
+    return -1;
+}
@@ -0,0 +1,90 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+
+#ifndef SOUNDMIXER_H
+#define SOUNDMIXER_H
+
+#include <memory>
+#include <QIODevice>
+#include <QMutex>
+#include <QVector>
+
+class QAudioFormat;
+
+/**
+ * SoundMixer sums the decoded sound clips of a project into a single 16-bit stereo stream.
+ *
+ * Each track is a clip decoded once into interleaved samples at SAMPLE_RATE, placed on a
+ * timeline whose position 0 is the start of frame 1. Positions are counted in samples per channel.
+ * An audio sink pulls the mix by reading from the device, the mixer never blocks or decodes.
+ * Reads may come from the audio thread, so all state is guarded by a mutex.
+ */
+class SoundMixer : public QIODevice
+{
+    Q_OBJECT
+public:
+    static const int SAMPLE_RATE = 44100;
+    static const int CHANNEL_COUNT = 2;
+    static const int BYTES_PER_FRAME = CHANNEL_COUNT * sizeof(qint16);
+
+    using Samples = QVector<qint16>;
+
+    struct Track
+    {
+        std::shared_ptr<const Samples> samples;
+        qint64 start = 0;
+    };
+
+    explicit SoundMixer(QObject* parent = nullptr);
+
+    /** The format of the mixed stream and of the decoded tracks */
+    static QAudioFormat audioFormat();
+
+    /** The timeline position at which the given animation frame starts */
+    static qint64 frameToSample(int frame, int fps);
+
+    /** Converts interleaved samples of any channel count and rate into the mixer format */
+    static Samples resample(const qint16* samples, qint64 frameCount, int channelCount, int sampleRate);
+
+    void setTracks(const QVector<Track>& tracks);
+    bool hasTracks() const;
+
+    /** Moves the playhead, only `length` samples are played from there if it isn't negative */
+    void setPosition(qint64 position, qint64 length = -1);
+    qint64 position() const;
+
+    /** Mixes `count` samples per channel from the playhead into `out` and advances it.
+     *  Sums are clamped to the 16-bit range rather than wrapping around. */
+    void mix(qint16* out, qint64 count);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    mutable QMutex mMutex;
+    QVector<Track> mTracks;
+    QVector<qint32> mMixBuffer;
+    Samples mReadBuffer;
+    qint64 mPosition = 0;
+    qint64 mEndPosition = -1;
+};
+
+#endif // SOUNDMIXER_H
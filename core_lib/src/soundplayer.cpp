@@ -15,13 +15,93 @@ GNU General Public License for more details.
 */
 
 #include "soundplayer.h"
+#include <algorithm>
+#include <QAudioBuffer>
+#include <QAudioDecoder>
 #include <QAudioOutput>
 #include <QMediaPlayer>
 #include <QFile>
 #include <QDebug>
+#include <QSysInfo>
 #include "soundclip.h"
 #include "util.h"
 
+namespace
+{
+    /** Appends the samples of a decoded buffer as 16-bit integers
+     *  @return false if the sample format isn't one we know */
+    bool appendSamples(const QAudioBuffer& buffer, QVector<qint16>& out)
+    {
+        const QAudioFormat format = buffer.format();
+        const int count = static_cast<int>(buffer.sampleCount());
+        const int offset = out.size();
+        out.resize(offset + count);
+        qint16* dst = out.data() + offset;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        switch (format.sampleFormat())
+        {
+        case QAudioFormat::UInt8:
+        {
+            const quint8* src = buffer.constData<quint8>();
+            for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>((src[i] - 128) << 8); }
+            return true;
+        }
+        case QAudioFormat::Int16:
+        {
+            const qint16* src = buffer.constData<qint16>();
+            std::copy(src, src + count, dst);
+            return true;
+        }
+        case QAudioFormat::Int32:
+        {
+            const qint32* src = buffer.constData<qint32>();
+            for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>(src[i] >> 16); }
+            return true;
+        }
+        case QAudioFormat::Float:
+        {
+            const float* src = buffer.constData<float>();
+            for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>(qBound(-1.f, src[i], 1.f) * 32767); }
+            return true;
+        }
+        default:
+            break;
+        }
+#else
+        if (format.byteOrder() == static_cast<QAudioFormat::Endian>(QSysInfo::ByteOrder))
+        {
+            if (format.sampleType() == QAudioFormat::UnSignedInt && format.sampleSize() == 8)
+            {
+                const quint8* src = buffer.constData<quint8>();
+                for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>((src[i] - 128) << 8); }
+                return true;
+            }
+            if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 16)
+            {
+                const qint16* src = buffer.constData<qint16>();
+                std::copy(src, src + count, dst);
+                return true;
+            }
+            if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 32)
+            {
+                const qint32* src = buffer.constData<qint32>();
+                for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>(src[i] >> 16); }
+                return true;
+            }
+            if (format.sampleType() == QAudioFormat::Float && format.sampleSize() == 32)
+            {
+                const float* src = buffer.constData<float>();
+                for (int i = 0; i < count; i++) { dst[i] = static_cast<qint16>(qBound(-1.f, src[i], 1.f) * 32767); }
+                return true;
+            }
+        }
+#endif
+        out.resize(offset);
+        return false;
+    }
+}
+
 SoundPlayer::SoundPlayer()
 {
 }
@@ -56,6 +136,8 @@ void SoundPlayer::init(SoundClip* clip)
     makeConnections();
 
     clip->attachPlayer(this);
+
+    startDecoding();
 }
 
 void SoundPlayer::onKeyFrameDestroy(KeyFrame* keyFrame)
@@ -105,6 +187,28 @@ int64_t SoundPlayer::duration()
     return 0;
 }
 
+qint64 SoundPlayer::position()
+{
+    if (mMediaPlayer)
+    {
+        return mMediaPlayer->position();
+    }
+    return 0;
+}
+
+bool SoundPlayer::isPlaying()
+{
+    if (mMediaPlayer)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        return mMediaPlayer->playbackState() == QMediaPlayer::PlayingState;
+#else
+        return mMediaPlayer->state() == QMediaPlayer::PlayingState;
+#endif
+    }
+    return false;
+}
+
 void SoundPlayer::setMediaPlayerPosition(qint64 pos)
 {
     if (mMediaPlayer)
@@ -131,3 +235,84 @@ void SoundPlayer::makeConnections()
         emit durationChanged(this, duration);
     });
 }
+
+/**
+ * @brief SoundPlayer::startDecoding()
+ * Decodes the whole clip in the background, so that the sound mixer can play it
+ * without a media player of its own. The samples are kept in the decoder's output format
+ * until the end and converted into the mixer format in one go.
+ */
+void SoundPlayer::startDecoding()
+{
+    mDecoder = new QAudioDecoder(this);
+    mDecoder->setAudioFormat(SoundMixer::audioFormat());
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    mDecoder->setSource(QUrl::fromLocalFile(mSoundClip->fileName()));
+#else
+    mDecoder->setSourceFilename(mSoundClip->fileName());
+#endif
+
+    connect(mDecoder, &QAudioDecoder::bufferReady, this, &SoundPlayer::readDecodedBuffer);
+    connect(mDecoder, &QAudioDecoder::finished, this, &SoundPlayer::finishDecoding);
+
+    auto errorSignal = static_cast<void (QAudioDecoder::*)(QAudioDecoder::Error)>(&QAudioDecoder::error);
+    connect(mDecoder, errorSignal, this, [this](QAudioDecoder::Error err)
+    {
+        qDebug() << "AudioDecoder Error: " << err;
+        abortDecoding();
+    });
+
+    mDecoder->start();
+}
+
+void SoundPlayer::readDecodedBuffer()
+{
+    if (mDecoder == nullptr) { return; }
+
+    const QAudioBuffer buffer = mDecoder->read();
+    if (!buffer.isValid()) { return; }
+
+    const QAudioFormat format = buffer.format();
+    if (mDecodedChannelCount == 0)
+    {
+        mDecodedChannelCount = format.channelCount();
+        mDecodedSampleRate = format.sampleRate();
+    }
+
+    if (format.channelCount() != mDecodedChannelCount || format.sampleRate() != mDecodedSampleRate ||
+        !appendSamples(buffer, mDecodedSamples))
+    {
+        qDebug() << "AudioDecoder: unsupported format" << format;
+        abortDecoding();
+    }
+}
+
+void SoundPlayer::finishDecoding()
+{
+    if (mDecoder == nullptr) { return; }
+
+    if (mDecodedChannelCount > 0)
+    {
+        const qint64 frameCount = mDecodedSamples.size() / mDecodedChannelCount;
+        mDecodedAudio = std::make_shared<SoundMixer::Samples>(
+            SoundMixer::resample(mDecodedSamples.constData(), frameCount, mDecodedChannelCount, mDecodedSampleRate));
+    }
+    abortDecoding();
+
+    if (mDecodedAudio)
+    {
+        emit audioDecoded(this);
+    }
+}
+
+void SoundPlayer::abortDecoding()
+{
+    if (mDecoder)
+    {
+        mDecoder->disconnect(this);
+        mDecoder->stop();
+        mDecoder->deleteLater();
+        mDecoder = nullptr;
+    }
+    mDecodedSamples = QVector<qint16>();
+}
@@ -22,9 +22,11 @@ GNU General Public License for more details.
 #include <QBuffer>
 #include "pencilerror.h"
 #include "keyframe.h"
+#include "soundmixer.h"
 
 class SoundClip;
 class QMediaPlayer;
+class QAudioDecoder;
 
 class SoundPlayer : public QObject, public KeyFrameEventListener
 {
@@ -42,20 +44,37 @@ public:
     void stop();
 
     int64_t duration();
+    /** The playing position in msec */
+    qint64 position();
+    bool isPlaying();
     SoundClip* clip() { return mSoundClip; }
 
     void setMediaPlayerPosition(qint64 pos);
 
+    /** The clip decoded into the SoundMixer format, null until decoding has finished or if it failed */
+    std::shared_ptr<const SoundMixer::Samples> decodedAudio() const { return mDecodedAudio; }
+
 signals:
     void corruptedSoundFile(SoundClip*);
     void durationChanged(SoundPlayer*, int64_t duration);
+    void audioDecoded(SoundPlayer*);
 
 private:
     void makeConnections();
+    void startDecoding();
+    void readDecodedBuffer();
+    void finishDecoding();
+    void abortDecoding();
 
     SoundClip* mSoundClip = nullptr;
     QMediaPlayer* mMediaPlayer = nullptr;
     QBuffer mBuffer;
+
+    QAudioDecoder* mDecoder = nullptr;
+    QVector<qint16> mDecodedSamples;
+    int mDecodedChannelCount = 0;
+    int mDecodedSampleRate = 0;
+    std::shared_ptr<const SoundMixer::Samples> mDecodedAudio;
 };
 
 #endif // SOUNDPLAYER_H
@@ -26,6 +26,7 @@ GNU General Public License for more details.
 #include "object.h"
 #include "layercamera.h"
 #include "util.h"
+#include "profiler.h"
 
 FileManager::FileManager(QObject* parent) : QObject(parent)
 {
@@ -34,6 +35,8 @@ FileManager::FileManager(QObject* parent) : QObject(parent)
 
 Object* FileManager::load(const QString& sFileName)
 {
+    PROFILE_SCOPE("FileManager::load");
+
     DebugDetails dd;
     dd << "\n[Project LOAD diagnostics]\n";
     dd << QString("File name: ").append(sFileName);
@@ -122,26 +125,27 @@ Object* FileManager::load(const QString& sFileName)
 
     dd << "Main XML exists: Yes";
 
-    QDomDocument xmlDoc;
-    if (!xmlDoc.setContent(&file))
+    // The main XML is read as a stream, projects with many keyframes are never held in memory as a whole document
+    QXmlStreamReader xml(&file);
+    const QString docType = readXmlDocType(xml);
+    if (xml.hasError())
     {
         FILEMANAGER_LOG("Couldn't open the main XML file");
         dd << "Error: Unable to parse or open the main XML file";
+        dd << QString("  %1 at line %2").arg(xml.errorString()).arg(xml.lineNumber());
         handleOpenProjectError(Status::ERROR_INVALID_XML_FILE, dd);
         return nullptr;
     }
 
-    QDomDocumentType type = xmlDoc.doctype();
-    if (!(type.name() == "PencilDocument" || type.name() == "MyObject"))
+    if (!(docType == "PencilDocument" || docType == "MyObject"))
     {
         FILEMANAGER_LOG("Invalid main XML doctype");
-        dd << QString("Error: Invalid main XML doctype: ").append(type.name());
+        dd << QString("Error: Invalid main XML doctype: ").append(docType);
         handleOpenProjectError(Status::ERROR_INVALID_PENCIL_FILE, dd);
         return nullptr;
     }
 
-    QDomElement root = xmlDoc.documentElement();
-    if (root.isNull())
+    if (!xml.isStartElement())
     {
         dd << "Error: Main XML root node is null";
         handleOpenProjectError(Status::ERROR_INVALID_PENCIL_FILE, dd);
@@ -152,13 +156,29 @@ Object* FileManager::load(const QString& sFileName)
 
     bool ok = true;
 
-    if (root.tagName() == "document")
+    if (xml.name() == QLatin1String("document"))
+    {
+        ok = loadObject(obj.get(), xml);
+    }
+    else if (xml.name() == QLatin1String("object") || xml.name() == QLatin1String("MyOject")) // old Pencil format (<=0.4.3)
+    {
+        ok = loadObjectOldWay(obj.get(), xml);
+    }
+
+    // Whatever follows the root element has to be well-formed too
+    while (!xml.atEnd())
     {
-        ok = loadObject(obj.get(), root);
+        xml.readNext();
     }
-    else if (root.tagName() == "object" || root.tagName() == "MyOject") // old Pencil format (<=0.4.3)
+
+    if (xml.hasError())
     {
-        ok = loadObjectOldWay(obj.get(), root);
+        obj.reset();
+        FILEMANAGER_LOG("Couldn't parse the main XML file");
+        dd << "Error: Unable to parse or open the main XML file";
+        dd << QString("  %1 at line %2").arg(xml.errorString()).arg(xml.lineNumber());
+        handleOpenProjectError(Status::ERROR_INVALID_XML_FILE, dd);
+        return nullptr;
     }
 
     if (!ok)
@@ -174,34 +194,26 @@ Object* FileManager::load(const QString& sFileName)
     return obj.release();
 }
 
-bool FileManager::loadObject(Object* object, const QDomElement& root)
+bool FileManager::loadObject(Object* object, QXmlStreamReader& xml)
 {
-    QDomElement e = root.firstChildElement("object");
-    if (e.isNull())
-        return false;
-
+    bool hasObject = false;
     bool ok = true;
-    for (QDomNode node = root.firstChild(); !node.isNull(); node = node.nextSibling())
+    while (xml.readNextStartElement())
     {
-        QDomElement element = node.toElement(); // try to convert the node to an element.
-        if (element.isNull())
-        {
-            continue;
-        }
-
-        if (element.tagName() == "object")
+        if (xml.name() == QLatin1String("object"))
         {
-            ok = object->loadXML(element, [this]{ progressForward(); });
+            hasObject = true;
+            ok = object->loadXML(xml, [this]{ progressForward(); });
             if (!ok) FILEMANAGER_LOG("Failed to Load object");
 
         }
-        else if (element.tagName() == "editor" || element.tagName() == "projectdata")
+        else if (xml.name() == QLatin1String("editor") || xml.name() == QLatin1String("projectdata"))
         {
-            object->setData(loadProjectData(element));
+            object->setData(loadProjectData(xml));
         }
-        else if (element.tagName() == "version")
+        else if (xml.name() == QLatin1String("version"))
         {
-            QVersionNumber fileVersion = QVersionNumber::fromString(element.text());
+            QVersionNumber fileVersion = QVersionNumber::fromString(xml.readElementText());
             QVersionNumber appVersion = QVersionNumber::fromString(APP_VERSION);
 
             if (!fileVersion.isNull())
@@ -215,14 +227,15 @@ bool FileManager::loadObject(Object* object, const QDomElement& root)
         else
         {
             Q_ASSERT(false);
+            xml.skipCurrentElement();
         }
     }
-    return ok;
+    return ok && hasObject;
 }
 
-bool FileManager::loadObjectOldWay(Object* object, const QDomElement& root)
+bool FileManager::loadObjectOldWay(Object* object, QXmlStreamReader& xml)
 {
-    return object->loadXML(root, [this] { progressForward(); });
+    return object->loadXML(xml, [this] { progressForward(); });
 }
 
 bool FileManager::isArchiveFormat(const QString& fileName) const
@@ -235,6 +248,8 @@ bool FileManager::isArchiveFormat(const QString& fileName) const
 
 Status FileManager::save(const Object* object, const QString& sFileName)
 {
+    PROFILE_SCOPE("FileManager::save");
+
     DebugDetails dd;
     dd << "\n[Project SAVE diagnostics]\n";
     dd << ("file name:" + sFileName);
@@ -412,140 +427,118 @@ Status FileManager::writeToWorkingFolder(const Object* object)
     return Status(errorCode, dd);
 }
 
-ObjectData FileManager::loadProjectData(const QDomElement& docElem)
+ObjectData FileManager::loadProjectData(QXmlStreamReader& xml)
 {
     ObjectData data;
-    if (docElem.isNull())
-    {
-        return data;
-    }
-
-    QDomNode tag = docElem.firstChild();
-
-    while (!tag.isNull())
+    while (xml.readNextStartElement())
     {
-        QDomElement element = tag.toElement(); // try to convert the node to an element.
-        if (element.isNull())
-        {
-            continue;
-        }
-
-        extractProjectData(element, data);
-
-        tag = tag.nextSibling();
+        extractProjectData(xml, data);
+        xml.skipCurrentElement();
     }
     return data;
 }
 
-QDomElement FileManager::saveProjectData(const ObjectData* data, QDomDocument& xmlDoc)
+void FileManager::saveProjectData(const ObjectData* data, QXmlStreamWriter& xml)
 {
-    QDomElement rootTag = xmlDoc.createElement("projectdata");
+    xml.writeStartElement("projectdata");
 
     // Current Frame
-    QDomElement currentFrameTag = xmlDoc.createElement("currentFrame");
-    currentFrameTag.setAttribute("value", data->getCurrentFrame());
-    rootTag.appendChild(currentFrameTag);
+    xml.writeEmptyElement("currentFrame");
+    xml.writeAttribute("value", QString::number(data->getCurrentFrame()));
 
     // Current Color
-    QDomElement currentColorTag = xmlDoc.createElement("currentColor");
+    xml.writeEmptyElement("currentColor");
     QColor color = data->getCurrentColor();
-    currentColorTag.setAttribute("r", color.red());
-    currentColorTag.setAttribute("g", color.green());
-    currentColorTag.setAttribute("b", color.blue());
-    currentColorTag.setAttribute("a", color.alpha());
-    rootTag.appendChild(currentColorTag);
+    xml.writeAttribute("r", QString::number(color.red()));
+    xml.writeAttribute("g", QString::number(color.green()));
+    xml.writeAttribute("b", QString::number(color.blue()));
+    xml.writeAttribute("a", QString::number(color.alpha()));
 
     // Current Layer
-    QDomElement currentLayerTag = xmlDoc.createElement("currentLayer");
-    currentLayerTag.setAttribute("value", data->getCurrentLayer());
-    rootTag.appendChild(currentLayerTag);
+    xml.writeEmptyElement("currentLayer");
+    xml.writeAttribute("value", QString::number(data->getCurrentLayer()));
 
     // Current View
-    QDomElement currentViewTag = xmlDoc.createElement("currentView");
+    xml.writeEmptyElement("currentView");
     QTransform view = data->getCurrentView();
-    currentViewTag.setAttribute("m11", view.m11());
-    currentViewTag.setAttribute("m12", view.m12());
-    currentViewTag.setAttribute("m21", view.m21());
-    currentViewTag.setAttribute("m22", view.m22());
-    currentViewTag.setAttribute("dx", view.dx());
-    currentViewTag.setAttribute("dy", view.dy());
-    rootTag.appendChild(currentViewTag);
+    xml.writeAttribute("m11", xmlNumber(view.m11()));
+    xml.writeAttribute("m12", xmlNumber(view.m12()));
+    xml.writeAttribute("m21", xmlNumber(view.m21()));
+    xml.writeAttribute("m22", xmlNumber(view.m22()));
+    xml.writeAttribute("dx", xmlNumber(view.dx()));
+    xml.writeAttribute("dy", xmlNumber(view.dy()));
 
     // Fps
-    QDomElement fpsTag = xmlDoc.createElement("fps");
-    fpsTag.setAttribute("value", data->getFrameRate());
-    rootTag.appendChild(fpsTag);
+    xml.writeEmptyElement("fps");
+    xml.writeAttribute("value", QString::number(data->getFrameRate()));
 
     // Current Layer
-    QDomElement tagIsLoop = xmlDoc.createElement("isLoop");
-    tagIsLoop.setAttribute("value", data->isLooping() ? "true" : "false");
-    rootTag.appendChild(tagIsLoop);
+    xml.writeEmptyElement("isLoop");
+    xml.writeAttribute("value", data->isLooping() ? "true" : "false");
 
-    QDomElement tagRangedPlayback = xmlDoc.createElement("isRangedPlayback");
-    tagRangedPlayback.setAttribute("value", data->isRangedPlayback() ? "true" : "false");
-    rootTag.appendChild(tagRangedPlayback);
+    xml.writeEmptyElement("isRangedPlayback");
+    xml.writeAttribute("value", data->isRangedPlayback() ? "true" : "false");
 
-    QDomElement tagMarkInFrame = xmlDoc.createElement("markInFrame");
-    tagMarkInFrame.setAttribute("value", data->getMarkInFrameNumber());
-    rootTag.appendChild(tagMarkInFrame);
+    xml.writeEmptyElement("markInFrame");
+    xml.writeAttribute("value", QString::number(data->getMarkInFrameNumber()));
 
-    QDomElement tagMarkOutFrame = xmlDoc.createElement("markOutFrame");
-    tagMarkOutFrame.setAttribute("value", data->getMarkOutFrameNumber());
-    rootTag.appendChild(tagMarkOutFrame);
+    xml.writeEmptyElement("markOutFrame");
+    xml.writeAttribute("value", QString::number(data->getMarkOutFrameNumber()));
 
-    return rootTag;
+    xml.writeEndElement(); // projectdata
 }
 
-void FileManager::extractProjectData(const QDomElement& element, ObjectData& data)
+void FileManager::extractProjectData(const QXmlStreamReader& xml, ObjectData& data)
 {
-    QString strName = element.tagName();
+    const QString strName = xml.name().toString();
+    const QXmlStreamAttributes attributes = xml.attributes();
     if (strName == "currentFrame")
     {
-        data.setCurrentFrame(element.attribute("value").toInt());
+        data.setCurrentFrame(attributes.value("value").toInt());
     }
     else  if (strName == "currentColor")
     {
-        int r = element.attribute("r", "255").toInt();
-        int g = element.attribute("g", "255").toInt();
-        int b = element.attribute("b", "255").toInt();
-        int a = element.attribute("a", "255").toInt();
+        int r = xmlAttribute(attributes, "r", "255").toInt();
+        int g = xmlAttribute(attributes, "g", "255").toInt();
+        int b = xmlAttribute(attributes, "b", "255").toInt();
+        int a = xmlAttribute(attributes, "a", "255").toInt();
 
         data.setCurrentColor(QColor(r, g, b, a));
     }
     else if (strName == "currentLayer")
     {
-        data.setCurrentLayer(element.attribute("value", "0").toInt());
+        data.setCurrentLayer(xmlAttribute(attributes, "value", "0").toInt());
     }
     else if (strName == "currentView")
     {
-        double m11 = element.attribute("m11", "1").toDouble();
-        double m12 = element.attribute("m12", "0").toDouble();
-        double m21 = element.attribute("m21", "0").toDouble();
-        double m22 = element.attribute("m22", "1").toDouble();
-        double dx = element.attribute("dx", "0").toDouble();
-        double dy = element.attribute("dy", "0").toDouble();
+        double m11 = xmlAttribute(attributes, "m11", "1").toDouble();
+        double m12 = xmlAttribute(attributes, "m12", "0").toDouble();
+        double m21 = xmlAttribute(attributes, "m21", "0").toDouble();
+        double m22 = xmlAttribute(attributes, "m22", "1").toDouble();
+        double dx = xmlAttribute(attributes, "dx", "0").toDouble();
+        double dy = xmlAttribute(attributes, "dy", "0").toDouble();
 
         data.setCurrentView(QTransform(m11, m12, m21, m22, dx, dy));
     }
     else if (strName == "fps" || strName == "currentFps")
     {
-        data.setFrameRate(element.attribute("value", "12").toInt());
+        data.setFrameRate(xmlAttribute(attributes, "value", "12").toInt());
     }
     else if (strName == "isLoop")
     {
-        data.setLooping(element.attribute("value", "false") == "true");
+        data.setLooping(xmlAttribute(attributes, "value", "false") == "true");
     }
     else if (strName == "isRangedPlayback")
     {
-        data.setRangedPlayback((element.attribute("value", "false") == "true"));
+        data.setRangedPlayback((xmlAttribute(attributes, "value", "false") == "true"));
     }
     else if (strName == "markInFrame")
     {
-        data.setMarkInFrameNumber(element.attribute("value", "0").toInt());
+        data.setMarkInFrameNumber(xmlAttribute(attributes, "value", "0").toInt());
     }
     else if (strName == "markOutFrame")
     {
-        data.setMarkOutFrameNumber(element.attribute("value", "15").toInt());
+        data.setMarkOutFrameNumber(xmlAttribute(attributes, "value", "15").toInt());
     }
 }
 
@@ -661,13 +654,19 @@ Status FileManager::writeKeyFrameFiles(const Object* object, const QString& data
     const int numLayers = object->getLayerCount();
     dd << QString("Total layer count: %1").arg(numLayers);
 
+    bool saveLayersOK = true;
     for (int i = 0; i < numLayers; ++i)
     {
         Layer* layer = object->getLayer(i);
-        layer->presave(dataFolder);
+        Status st = layer->presave(dataFolder);
+        if (!st.ok())
+        {
+            saveLayersOK = false;
+            dd.collect(st.details());
+            dd << QString("\nError: Failed to read the frames of Layer[%1] %2").arg(i).arg(layer->name());
+        }
     }
 
-    bool saveLayersOK = true;
     for (int i = 0; i < numLayers; ++i)
     {
         Layer* layer = object->getLayer(i);
@@ -711,34 +710,34 @@ Status FileManager::writeMainXml(const Object* object, const QString& mainXmlPat
         file.close();
     });
 
-    QDomDocument xmlDoc("PencilDocument");
-    QDomElement root = xmlDoc.createElement("document");
-    QDomProcessingInstruction encoding = xmlDoc.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"UTF-8\"");
-    xmlDoc.appendChild(encoding);
-    xmlDoc.appendChild(root);
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(2);
+    xml.writeStartDocument();
+    xml.writeDTD("<!DOCTYPE PencilDocument>");
+    xml.writeStartElement("document");
 
     progressForward();
 
+    dd << "Writing main xml file...";
+
     // save editor information
-    QDomElement projDataXml = saveProjectData(object->data(), xmlDoc);
-    root.appendChild(projDataXml);
+    saveProjectData(object->data(), xml);
 
     // save object
-    QDomElement objectElement = object->saveXML(xmlDoc);
-    root.appendChild(objectElement);
+    object->saveXML(xml);
 
     // save Pencil2D version
-    QDomElement versionElem = xmlDoc.createElement("version");
-    versionElem.appendChild(xmlDoc.createTextNode(QString(APP_VERSION)));
-    root.appendChild(versionElem);
-
-    dd << "Writing main xml file...";
+    xml.writeTextElement("version", QString(APP_VERSION));
 
-    const int indentSize = 2;
+    xml.writeEndElement(); // document
+    xml.writeEndDocument();
 
-    QTextStream out(&file);
-    xmlDoc.save(out, indentSize);
-    out.flush();
+    if (xml.hasError())
+    {
+        dd << QString("Error: Failed to write Main XML at: %1, \nReason: %2").arg(mainXmlPath).arg(file.errorString());
+        return Status(Status::FAIL, dd);
+    }
 
     dd << "Done writing main xml file: " << mainXmlPath;
 
@@ -896,7 +895,7 @@ bool FileManager::isProjectRecoverable(const QString& projectFolder)
     Q_ASSERT(ok);
 
     QStringList nameFiler;
-    nameFiler << "*.png" << "*.vec" << "*.xml";
+    nameFiler << "*.png" << "*.vec" << "*.vecb" << "*.xml";
     QStringList entries = dir.entryList(nameFiler, QDir::Files);
 
     return (entries.size() > 0);
@@ -933,35 +932,35 @@ Status FileManager::recoverObject(Object* object)
     QFile file(object->mainXMLFile());
     mainXmlOK &= file.exists();
     mainXmlOK &= file.open(QFile::ReadOnly);
-    file.close();
-
-    QDomDocument xmlDoc;
-    mainXmlOK &= !!xmlDoc.setContent(&file);
-
-    QDomDocumentType type = xmlDoc.doctype();
-    mainXmlOK &= (type.name() == "PencilDocument" || type.name() == "MyObject");
 
-    QDomElement root = xmlDoc.documentElement();
-    mainXmlOK &= (!root.isNull());
+    QXmlStreamReader xml(&file);
+    const QString docType = readXmlDocType(xml);
+    mainXmlOK &= (docType == "PencilDocument" || docType == "MyObject");
+    mainXmlOK &= xml.isStartElement();
 
-    QDomElement objectTag = root.firstChildElement("object");
-    mainXmlOK &= (!objectTag.isNull());
+    bool hasObject = false;
+    while (mainXmlOK && xml.readNextStartElement())
+    {
+        hasObject |= (xml.name() == QLatin1String("object"));
+        xml.skipCurrentElement();
+    }
+    mainXmlOK &= hasObject && !xml.hasError();
+    file.close();
 
     if (mainXmlOK == false)
     {
         // the main.xml is broken, try to rebuild one
         rebuildMainXML(object);
-
-        // Load the newly built main.xml
-        QFile file(object->mainXMLFile());
-        file.open(QFile::ReadOnly);
-        xmlDoc.setContent(&file);
-        root = xmlDoc.documentElement();
-        objectTag = root.firstChildElement("object");
     }
+
+    // Load the main.xml from the beginning
+    file.open(QFile::ReadOnly);
+    xml.setDevice(&file);
+    readXmlDocType(xml);
+
     loadPalette(object);
 
-    bool ok = loadObject(object, root);
+    bool ok = loadObject(object, xml);
     verifyObject(object);
 
     return ok ? Status::OK : Status::FAIL;
@@ -973,7 +972,7 @@ Status FileManager::rebuildMainXML(Object* object)
     QDir dataDir(object->dataDir());
 
     QStringList nameFiler;
-    nameFiler << "*.png" << "*.vec";
+    nameFiler << "*.png" << "*.vec" << "*.vecb";
     const QStringList entries = dataDir.entryList(nameFiler, QDir::Files | QDir::Readable, QDir::Name);
 
     QMap<int, QStringList> keyFrameGroups;
@@ -996,29 +995,28 @@ Status FileManager::rebuildMainXML(Object* object)
         return Status::ERROR_FILE_CANNOT_OPEN;
     }
 
-    QDomDocument xmlDoc("PencilDocument");
-    QDomElement root = xmlDoc.createElement("document");
-    QDomProcessingInstruction encoding = xmlDoc.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"UTF-8\"");
-    xmlDoc.appendChild(encoding);
-    xmlDoc.appendChild(root);
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(2);
+    xml.writeStartDocument();
+    xml.writeDTD("<!DOCTYPE PencilDocument>");
+    xml.writeStartElement("document");
 
     // save editor information
-    QDomElement projDataXml = saveProjectData(object->data(), xmlDoc);
-    root.appendChild(projDataXml);
+    saveProjectData(object->data(), xml);
 
     // save object
-    QDomElement elemObject = xmlDoc.createElement("object");
-    root.appendChild(elemObject);
+    xml.writeStartElement("object");
 
     for (const int layerIndex : keyFrameGroups.keys())
     {
         const QStringList& frames = keyFrameGroups.value(layerIndex);
-        Status st = rebuildLayerXmlTag(xmlDoc, elemObject, layerIndex, frames);
+        Status st = rebuildLayerXmlTag(xml, layerIndex, frames);
     }
 
-    QTextStream fout(&file);
-    xmlDoc.save(fout, 2);
-    fout.flush();
+    xml.writeEndElement(); // object
+    xml.writeEndElement(); // document
+    xml.writeEndDocument();
 
     return Status::OK;
 }
@@ -1030,8 +1028,7 @@ Status FileManager::rebuildMainXML(Object* object)
  *    </layer>
  *  @endcode
  */
-Status FileManager::rebuildLayerXmlTag(QDomDocument& doc,
-                                       QDomElement& elemObject,
+Status FileManager::rebuildLayerXmlTag(QXmlStreamWriter& xml,
                                        const int layerIndex,
                                        const QStringList& frames)
 {
@@ -1039,31 +1036,30 @@ Status FileManager::rebuildLayerXmlTag(QDomDocument& doc,
 
     Layer::LAYER_TYPE type = frames[0].endsWith(".png") ? Layer::BITMAP : Layer::VECTOR;
 
-    QDomElement elemLayer = doc.createElement("layer");
-    elemLayer.setAttribute("id", layerIndex + 1); // starts from 1, not 0.
-    elemLayer.setAttribute("name", recoverLayerName(type, layerIndex));
-    elemLayer.setAttribute("visibility", true);
-    elemLayer.setAttribute("type", type);
-    elemObject.appendChild(elemLayer);
+    xml.writeStartElement("layer");
+    xml.writeAttribute("id", QString::number(layerIndex + 1)); // starts from 1, not 0.
+    xml.writeAttribute("name", recoverLayerName(type, layerIndex));
+    xml.writeAttribute("visibility", "1");
+    xml.writeAttribute("type", QString::number(type));
 
     for (const QString& s : frames)
     {
         const int framePos = framePosFromFilename(s);
         if (framePos < 0) { continue; }
 
-        QDomElement elemFrame = doc.createElement("image");
-        elemFrame.setAttribute("frame", framePos);
-        elemFrame.setAttribute("src", s);
+        xml.writeEmptyElement("image");
+        xml.writeAttribute("frame", QString::number(framePos));
+        xml.writeAttribute("src", s);
 
         if (type == Layer::BITMAP)
         {
             // Since we have no way to know the original img position
             // Put it at the top left corner of the default camera
-            elemFrame.setAttribute("topLeftX", -800);
-            elemFrame.setAttribute("topLeftY", -600);
+            xml.writeAttribute("topLeftX", "-800");
+            xml.writeAttribute("topLeftY", "-600");
         }
-        elemLayer.appendChild(elemFrame);
     }
+    xml.writeEndElement(); // layer
     return Status::OK;
 }
 
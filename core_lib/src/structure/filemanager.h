@@ -21,7 +21,8 @@ GNU General Public License for more details.
 
 #include <QObject>
 #include <QString>
-#include <QDomElement>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include "log.h"
 #include "pencildef.h"
 #include "pencilerror.h"
@@ -59,18 +60,18 @@ private:
     Status copyDir(const QDir src, const QDir dst);
     Status unzip(const QString& strZipFile, const QString& strUnzipTarget);
 
-    bool loadObject(Object*, const QDomElement& root);
-    bool loadObjectOldWay(Object*, const QDomElement& root);
+    bool loadObject(Object*, QXmlStreamReader& xml);
+    bool loadObjectOldWay(Object*, QXmlStreamReader& xml);
     bool isArchiveFormat(const QString& fileName) const;
     bool loadPalette(Object*);
     Status writeKeyFrameFiles(const Object* obj, const QString& dataFolder, QStringList& filesWritten);
     Status writeMainXml(const Object* obj, const QString& mainXmlPath, QStringList& filesWritten);
     Status writePalette(const Object* obj, const QString& dataFolder, QStringList& filesWritten);
 
-    ObjectData loadProjectData(const QDomElement& element);
-    QDomElement saveProjectData(const ObjectData*, QDomDocument& xmlDoc);
+    ObjectData loadProjectData(QXmlStreamReader& xml);
+    void saveProjectData(const ObjectData*, QXmlStreamWriter& xml);
 
-    void extractProjectData(const QDomElement& element, ObjectData& data);
+    void extractProjectData(const QXmlStreamReader& xml, ObjectData& data);
     void handleOpenProjectError(Status::ErrorCode, const DebugDetails&);
 
     QString backupPreviousFile(const QString& fileName);
@@ -83,7 +84,7 @@ private: // Project recovery
     bool isProjectRecoverable(const QString& projectFolder);
     Status recoverObject(Object* object);
     Status rebuildMainXML(Object* object);
-    Status rebuildLayerXmlTag(QDomDocument& doc, QDomElement& elemObject,
+    Status rebuildLayerXmlTag(QXmlStreamWriter& xml,
                               const int layerIndex, const QStringList& frames);
     QString recoverLayerName(Layer::LAYER_TYPE, int index);
     int layerIndexFromFilename(const QString& filename);
@@ -50,6 +50,7 @@ KeyFrame& KeyFrame::operator=(const KeyFrame& k2)
 	mLength = k2.mLength;
 	mIsModified = k2.mIsModified;
 	mAttachedFileName = k2.mAttachedFileName;
+	mVersion++;
     // intentionally not copying event listeners
     return *this;
 }
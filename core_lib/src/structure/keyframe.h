@@ -41,10 +41,15 @@ public:
     int length() const { return mLength; }
     void setLength(int len) { mLength = len; }
 
-    void modification() { mIsModified = true; }
-    void setModified(bool b) { mIsModified = b; }
+    void modification() { mIsModified = true; mVersion++; }
+    void setModified(bool b) { mIsModified = b; if (b) { mVersion++; } }
     bool isModified() const { return mIsModified; }
 
+    /** A counter that is bumped every time the keyframe content is modified.
+     *  Caches holding derived data (thumbnails, rasterized images...) can compare it
+     *  against the value they were built from to detect stale entries. */
+    int version() const { return mVersion; }
+
     QString fileName() const { return mAttachedFileName; }
     void    setFileName(QString strFileName) { mAttachedFileName = strFileName; }
 
@@ -62,6 +67,7 @@ private:
     int mFrame = -1;
     int mLength = 1;
     bool mIsModified = true;
+    int mVersion = 0;
     QString mAttachedFileName;
 
     std::vector<KeyFrameEventListener*> mEventListeners;
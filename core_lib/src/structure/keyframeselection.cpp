@@ -0,0 +1,136 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "keyframeselection.h"
+
+void KeyFrameSelection::insert(int position)
+{
+    if (contains(position)) { return; }
+
+    const quint64 order = mNextOrder++;
+    mPositions.emplace(position, order);
+    mRecency.emplace(order, position);
+}
+
+void KeyFrameSelection::remove(int position)
+{
+    auto it = mPositions.find(position);
+    if (it == mPositions.end()) { return; }
+
+    mRecency.erase(it->second);
+    mPositions.erase(it);
+}
+
+void KeyFrameSelection::clear()
+{
+    mPositions.clear();
+    mRecency.clear();
+}
+
+void KeyFrameSelection::swap(int position1, int position2)
+{
+    auto it1 = mPositions.find(position1);
+    auto it2 = mPositions.find(position2);
+    const bool selected1 = it1 != mPositions.end();
+    const bool selected2 = it2 != mPositions.end();
+
+    if (selected1 && selected2)
+    {
+        std::swap(it1->second, it2->second);
+        mRecency[it1->second] = position1;
+        mRecency[it2->second] = position2;
+    }
+    else if (selected1 || selected2)
+    {
+        auto it = selected1 ? it1 : it2;
+        const int to = selected1 ? position2 : position1;
+
+        const quint64 order = it->second;
+        mPositions.erase(it);
+        mPositions.emplace(to, order);
+        mRecency[order] = to;
+    }
+}
+
+void KeyFrameSelection::shift(int offset)
+{
+    if (offset == 0) { return; }
+
+    // Shifting keeps the positions in the same order, so the map can be rebuilt in a single pass
+    std::map<int, quint64> shifted;
+    for (const auto& entry : mPositions)
+    {
+        shifted.emplace_hint(shifted.end(), entry.first + offset, entry.second);
+    }
+    mPositions.swap(shifted);
+
+    for (auto& entry : mRecency)
+    {
+        entry.second += offset;
+    }
+}
+
+void KeyFrameSelection::remap(const std::map<int, int>& newPositions)
+{
+    if (newPositions.empty()) { return; }
+
+    std::map<int, quint64> remapped;
+    for (const auto& entry : mPositions)
+    {
+        auto moved = newPositions.find(entry.first);
+        const int position = (moved != newPositions.end()) ? moved->second : entry.first;
+        remapped.emplace(position, entry.second);
+        mRecency[entry.second] = position;
+    }
+    mPositions.swap(remapped);
+}
+
+int KeyFrameSelection::mostRecent() const
+{
+    return mRecency.empty() ? -1 : mRecency.rbegin()->second;
+}
+
+int KeyFrameSelection::first() const
+{
+    return mPositions.empty() ? -1 : mPositions.begin()->first;
+}
+
+int KeyFrameSelection::last() const
+{
+    return mPositions.empty() ? -1 : mPositions.rbegin()->first;
+}
+
+QList<int> KeyFrameSelection::byPosition() const
+{
+    QList<int> positions;
+    positions.reserve(count());
+    for (const auto& entry : mPositions)
+    {
+        positions.append(entry.first);
+    }
+    return positions;
+}
+
+QList<int> KeyFrameSelection::byRecency() const
+{
+    QList<int> positions;
+    positions.reserve(count());
+    for (auto it = mRecency.rbegin(); it != mRecency.rend(); ++it)
+    {
+        positions.append(it->second);
+    }
+    return positions;
+}
@@ -0,0 +1,70 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef KEYFRAMESELECTION_H
+#define KEYFRAMESELECTION_H
+
+#include <map>
+#include <QList>
+
+/**
+ * The keyframe positions selected on a layer.
+ *
+ * Positions are kept in order, so checking and changing the selection is logarithmic.
+ * A side index remembers the order in which the positions were selected, which is
+ * what range selection extends from.
+ */
+class KeyFrameSelection
+{
+public:
+    bool contains(int position) const { return mPositions.find(position) != mPositions.end(); }
+    bool isEmpty() const { return mPositions.empty(); }
+    int count() const { return static_cast<int>(mPositions.size()); }
+
+    /** Selects a position, it becomes the most recent one unless it was already selected */
+    void insert(int position);
+    void remove(int position);
+    void clear();
+
+    /** Exchanges the selection state of two positions, each keeps the place in the selection order of the other */
+    void swap(int position1, int position2);
+
+    /** Moves every selected position by the given offset, keeping the selection order */
+    void shift(int offset);
+
+    /** Moves the selected positions found in the map to their new positions, keeping the selection order.
+     *  The new positions must not collide with the positions that stay. */
+    void remap(const std::map<int, int>& newPositions);
+
+    /** @return the most recently selected position, or -1 if nothing is selected */
+    int mostRecent() const;
+    /** @return the lowest selected position, or -1 if nothing is selected */
+    int first() const;
+    /** @return the highest selected position, or -1 if nothing is selected */
+    int last() const;
+
+    /** All the selected positions, lowest first */
+    QList<int> byPosition() const;
+    /** All the selected positions, most recently selected first */
+    QList<int> byRecency() const;
+
+private:
+    std::map<int, quint64> mPositions; // position -> selection order
+    std::map<quint64, int> mRecency;   // selection order -> position
+    quint64 mNextOrder = 0;
+};
+
+#endif // KEYFRAMESELECTION_H
@@ -20,14 +20,13 @@ GNU General Public License for more details.
 #include <QDebug>
 #include <QSettings>
 #include <QPainter>
-#include <QDomElement>
+#include <QSet>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
 #include "keyframe.h"
-
-// Used to sort the selected frames list
-bool sortAsc(int left, int right)
-{
-    return left < right;
-}
+#include "util/util.h"
 
 Layer::Layer(int id, LAYER_TYPE eType)
 {
@@ -57,6 +56,15 @@ void Layer::foreachKeyFrame(std::function<void(KeyFrame*)> action) const
     }
 }
 
+void Layer::foreachKeyFrameInRange(int startPosition, int endPosition, std::function<void(KeyFrame*)> action) const
+{
+    // Keyframes are sorted in descending order, so lower_bound() is the last keyframe at or before endPosition
+    for (auto it = mKeyFrames.lower_bound(endPosition); it != mKeyFrames.end() && it->first >= startPosition; ++it)
+    {
+        action(it->second);
+    }
+}
+
 bool Layer::keyExists(int position) const
 {
     return (mKeyFrames.find(position) != mKeyFrames.end());
@@ -201,6 +209,25 @@ bool Layer::addKeyFrame(int position, KeyFrame* pKeyFrame)
     return true;
 }
 
+void Layer::restoreKeyFrames(const QList<int>& positions, const std::vector<std::unique_ptr<KeyFrame>>& keyFrames)
+{
+    QSet<int> restored;
+    for (const auto& keyFrame : keyFrames)
+    {
+        addOrReplaceKeyFrame(keyFrame->pos(), keyFrame->clone());
+        restored.insert(keyFrame->pos());
+    }
+
+    // Removed last, so that the layer is never left without keyframes in between
+    for (int position : positions)
+    {
+        if (!restored.contains(position) && keyExists(position))
+        {
+            removeKeyFrame(position);
+        }
+    }
+}
+
 bool Layer::insertExposureAt(int position)
 {
     if(position < 1 || position > getMaxKeyFramePosition() || !getKeyFrameAt(position))
@@ -208,10 +235,7 @@ bool Layer::insertExposureAt(int position)
         return false;
     }
 
-    newSelectionOfConnectedFrames(position + 1);
-    moveSelectedFrames(1);
-    deselectAll();
-
+    moveConnectedKeyFrames(position + 1, 1);
     return true;
 }
 
@@ -232,8 +256,7 @@ bool Layer::removeKeyFrame(int position)
 
 void Layer::removeFromSelectionList(int position)
 {
-    mSelectedFrames_byLast.removeAll(position);
-    mSelectedFrames_byPosition.removeAll(position);
+    mSelection.remove(position);
 }
 
 bool Layer::moveKeyFrame(int position, int offset)
@@ -241,51 +264,27 @@ bool Layer::moveKeyFrame(int position, int offset)
     int newPos = position + offset;
     if (newPos < 1) { return false; }
 
-    auto listOfFramesLast = mSelectedFrames_byLast;
-    auto listOfFramesPos = mSelectedFrames_byPosition;
+    KeyFrameSelection previousSelection = mSelection;
     bool frameSelected = isFrameSelected(position);
 
     if (swapKeyFrames(position, newPos)) {
-
-        auto oldPosIndex = mSelectedFrames_byPosition.indexOf(position);
-        auto newPosIndex = mSelectedFrames_byPosition.indexOf(newPos);
-
-        auto oldLastIndex = mSelectedFrames_byLast.indexOf(position);
-        auto newLastndex = mSelectedFrames_byLast.indexOf(newPos);
-
-
-        // Old position is selected
-        if (oldPosIndex != -1) {
-            mSelectedFrames_byPosition[oldPosIndex] = newPos;
-            mSelectedFrames_byLast[oldLastIndex] = newPos;
-        }
-
-        // Old position is selected
-        if (newPosIndex != -1) {
-            mSelectedFrames_byPosition[newPosIndex] = position;
-            mSelectedFrames_byLast[newLastndex] = position;
-        }
+        mSelection.swap(position, newPos);
         return true;
     }
 
-    mSelectedFrames_byLast.clear();
-    mSelectedFrames_byPosition.clear();
+    mSelection.clear();
 
     setFrameSelected(position, true);
 
     // If the move fails, assume we can't move at all and revert to old selection
     if (!moveSelectedFrames(offset)) {
-        mSelectedFrames_byLast = listOfFramesLast;
-        mSelectedFrames_byPosition = listOfFramesPos;
+        mSelection = previousSelection;
         return false;
     }
 
     // Remove old position from selection list
-    listOfFramesLast.removeOne(position);
-    listOfFramesPos.removeOne(position);
-
-    mSelectedFrames_byLast = listOfFramesLast;
-    mSelectedFrames_byPosition = listOfFramesPos;
+    previousSelection.remove(position);
+    mSelection = previousSelection;
 
     // If the frame was selected prior to moving, make sure it's still selected.
     setFrameSelected(newPos, frameSelected);
@@ -382,7 +381,7 @@ bool Layer::isFrameSelected(int position) const
     KeyFrame* keyFrame = getKeyFrameWhichCovers(position);
     if (keyFrame == nullptr) { return false; }
 
-    return mSelectedFrames_byLast.contains(keyFrame->pos());
+    return mSelection.contains(keyFrame->pos());
 }
 
 void Layer::setFrameSelected(int position, bool isSelected)
@@ -392,20 +391,13 @@ void Layer::setFrameSelected(int position, bool isSelected)
     {
         int startPosition = keyFrame->pos();
 
-        if (isSelected && !mSelectedFrames_byLast.contains(startPosition))
+        if (isSelected)
         {
-            // Add the selected frame to the lists
-            mSelectedFrames_byLast.insert(0, startPosition);
-            mSelectedFrames_byPosition.append(startPosition);
-
-            // We need to keep the list of selected frames sorted
-            // in order to easily handle their movement
-            std::sort(mSelectedFrames_byPosition.begin(), mSelectedFrames_byPosition.end(), sortAsc);
+            mSelection.insert(startPosition);
         }
-        else if (!isSelected)
+        else
         {
-            mSelectedFrames_byLast.removeOne(startPosition);
-            mSelectedFrames_byPosition.removeOne(startPosition);
+            mSelection.remove(startPosition);
         }
     }
 }
@@ -424,9 +416,9 @@ void Layer::toggleFrameSelected(int position, bool allowMultiple)
 
 void Layer::extendSelectionTo(int position)
 {
-    if (mSelectedFrames_byLast.count() > 0)
+    if (!mSelection.isEmpty())
     {
-        int lastSelected = mSelectedFrames_byLast[0];
+        int lastSelected = mSelection.mostRecent();
         int startPos;
         int endPos;
 
@@ -441,11 +433,18 @@ void Layer::extendSelectionTo(int position)
             endPos = lastSelected;
         }
 
-        int i = startPos;
-        while (i <= endPos)
+        // The key covering the start of the range, then every key starting within it.
+        // Keys are visited from right to left, so they're selected in reverse to keep the same selection order.
+        setFrameSelected(startPos, true);
+
+        QList<int> keysInRange;
+        foreachKeyFrameInRange(startPos + 1, endPos, [&keysInRange](KeyFrame* key)
+        {
+            keysInRange.append(key->pos());
+        });
+        for (auto it = keysInRange.crbegin(); it != keysInRange.crend(); ++it)
         {
-            setFrameSelected(i, true);
-            i++;
+            mSelection.insert(*it);
         }
     }
 }
@@ -490,18 +489,15 @@ void Layer::selectAllFramesAfter(int position)
 
 void Layer::deselectAll()
 {
-    mSelectedFrames_byLast.clear();
-    mSelectedFrames_byPosition.clear();
+    mSelection.clear();
 }
 
 bool Layer::canMoveSelectedFramesToOffset(int offset) const
 {
-    QList<int> newByPositions = mSelectedFrames_byPosition;
-
-    for (int pos : newByPositions)
+    for (int pos : mSelection.byPosition())
     {
         pos += offset;
-        if (keyExists(pos) && !newByPositions.contains(pos)) {
+        if (keyExists(pos) && !mSelection.contains(pos)) {
             return false;
         }
     }
@@ -511,97 +507,41 @@ bool Layer::canMoveSelectedFramesToOffset(int offset) const
 
 void Layer::setExposureForSelectedFrames(int offset)
 {
-    auto selectedFramesByLast = mSelectedFrames_byLast;
-    auto selectedFramesByPos = mSelectedFrames_byPosition;
-
-    int addSpaceBetweenFrames = offset;
-
-    if (selectedFramesByLast.isEmpty()) { return; }
-
-    const int max = selectedFramesByPos.count()-1;
-    const int posForIndex = selectedFramesByPos[max];
-    const int nextPos = getNextKeyFramePosition(selectedFramesByPos[max]);
-
-    // When exposing the frame in front of the right most element in the selection.
-    if (posForIndex != nextPos) {
-        selectedFramesByPos.append(nextPos);
-    }
+    if (offset == 0 || mSelection.isEmpty()) { return; }
 
-    auto initialLastList = selectedFramesByLast;
-    auto initialPosList = selectedFramesByPos;
+    // Lay out the keyframes in a single pass from the first selected one onwards:
+    // each selected keyframe's exposure changes by offset, but never drops below one frame,
+    // and every keyframe after it moves along by the change accumulated so far.
+    std::map<int, int> newPositions;
+    int shift = 0;
+    int previousPos = 0;
+    bool previousSelected = false;
 
-    auto offsetList = QList<int>();
+    auto first = mKeyFrames.find(mSelection.first());
+    if (first == mKeyFrames.end()) { return; }
 
-    // Create an offset list to have reference of how many frames should be moved
-    for (int offset = 0; offset < selectedFramesByPos.count(); offset++)
+    for (auto it = std::reverse_iterator<decltype(first)>(std::next(first)); it != mKeyFrames.rend(); ++it)
     {
-        int pos = selectedFramesByPos[offset];
-        int nextKeyPos = getNextKeyFramePosition(pos);
-
-        if (pos >= getMaxKeyFramePosition()) {
-            offsetList << (pos - 1) - getPreviousKeyFramePosition(pos) + addSpaceBetweenFrames;
-        } else { // first frame doesn't move so only the space that's required
-            offsetList << nextKeyPos - (pos + 1) + addSpaceBetweenFrames;
-        }
-    }
-
-    // Either positive or negative
-    int offsetDirection = offset > 0 ? 1 : -1;
-
-    for (int i = 0; i < selectedFramesByPos.count(); i++) {
-        const int itPos = selectedFramesByPos[i];
-        const int nextIndex = i + 1;
-        const int positionInFront = itPos + 1;
-
-        // Index safety
-        if (nextIndex < 0 || nextIndex >= selectedFramesByPos.count()) {
-            continue;
+        const int pos = it->first;
+        if (previousSelected)
+        {
+            const int exposure = pos - previousPos;
+            shift += qMax(1, exposure + offset) - exposure;
         }
-
-        // Offset above 0 will move frames forward
-        // Offset below 0 will move a frame backwards
-        while ((offset > 0 && getNextKeyFramePosition(itPos) - positionInFront < offsetList[i]) ||
-               (getNextKeyFramePosition(itPos) - positionInFront > offsetList[i] && getNextKeyFramePosition(itPos) - positionInFront > 0)) {
-
-           selectAllFramesAfter(getNextKeyFramePosition(itPos));
-
-           for (int selIndex = 0; selIndex < mSelectedFrames_byPosition.count(); selIndex++) {
-
-               if (nextIndex+selIndex >= selectedFramesByPos.count()) { break; }
-
-               int pos = selectedFramesByPos[nextIndex+selIndex];
-
-               if (!mSelectedFrames_byPosition.contains(pos)) { continue; }
-
-               selectedFramesByPos[nextIndex+selIndex] = pos + offsetDirection;
-
-               // To make the sure we get the correct index for last selection list
-               // use the initial list where values doesn't affect the index.
-               int initialPos = initialPosList[nextIndex+selIndex];
-               int indexOfLast = initialLastList.indexOf(initialPos);
-               if (indexOfLast == -1 || nextIndex+selIndex >= selectedFramesByLast.count()) {
-                   continue;
-               }
-               selectedFramesByLast[indexOfLast] = selectedFramesByLast[indexOfLast] + offsetDirection;
-           }
-
-           moveSelectedFrames(offsetDirection);
+        if (shift != 0)
+        {
+            newPositions.emplace_hint(newPositions.end(), pos, pos + shift);
         }
+        previousPos = pos;
+        previousSelected = mSelection.contains(pos);
     }
 
-    deselectAll();
-
-    // Reselect frames again based on last selection list to ensure selection behaviour
-    // works correctly
-    for (int pos : selectedFramesByLast) {
-        Q_UNUSED(pos)
-        setFrameSelected(selectedFramesByLast.takeLast(), true);
-    }
+    retimeKeyFrames(newPositions);
 }
 
 bool Layer::reverseOrderOfSelection()
 {
-    QList<int> selectedIndexes = mSelectedFrames_byPosition;
+    QList<int> selectedIndexes = mSelection.byPosition();
 
     if (selectedIndexes.isEmpty()) { return false; }
 
@@ -616,57 +556,118 @@ bool Layer::reverseOrderOfSelection()
 
 bool Layer::moveSelectedFrames(int offset)
 {
-    if (offset == 0 || mSelectedFrames_byPosition.count() <= 0) {
+    if (offset == 0 || mSelection.isEmpty()) {
         return false;
     }
 
-    // If we are moving to the right we start moving selected frames from the highest (right) to the lowest (left)
-    int indexInSelection = mSelectedFrames_byPosition.count() - 1;
-    int step = -1;
+    const QList<int> selectedFrames = mSelection.byPosition();
 
-    if (offset < 0)
+    // Check if we are not moving out of the timeline
+    if (selectedFrames.first() + offset < 1) {
+        offset = 1 - selectedFrames.first();
+    }
+
+    // The keyframes that stay in place, lowest first
+    std::vector<int> stayingFrames;
+    for (auto it = mKeyFrames.rbegin(); it != mKeyFrames.rend(); ++it)
     {
-        // If we are moving to the left we start moving selected frames from the lowest (left) to the highest (right)
-        indexInSelection = 0;
-        step = 1;
+        if (!mSelection.contains(it->first)) { stayingFrames.push_back(it->first); }
+    }
 
-        // Check if we are not moving out of the timeline
-        if (mSelectedFrames_byPosition[0] + offset < 1) {
-            offset = 1 - mSelectedFrames_byPosition[0];
-        }
+    // Find the nearest offset at which no selected frame lands on a frame that stays in place.
+    // Each selected frame keeps the offset at which it lands on the next staying frame,
+    // the nearest of them is taken first. The offset only grows, so each selected frame
+    // only steps forward through the staying frames and is never checked twice at one offset.
+    // An offset of 0 always fits, so moving to the left can't go past it.
+    using Landing = std::pair<int, int>; // The offset of the landing, the index of the selected frame
+    std::priority_queue<Landing, std::vector<Landing>, std::greater<Landing>> landings;
+    auto findLanding = [&](int i)
+    {
+        auto staying = std::lower_bound(stayingFrames.begin(), stayingFrames.end(), selectedFrames[i] + offset);
+        if (staying != stayingFrames.end()) { landings.emplace(*staying - selectedFrames[i], i); }
+    };
+    for (int i = 0; i < selectedFrames.size(); i++)
+    {
+        findLanding(i);
     }
 
-    while (!canMoveSelectedFramesToOffset(offset)) { offset += 1; }
+    while (!landings.empty() && landings.top().first <= offset)
+    {
+        const Landing landing = landings.top();
+        landings.pop();
+        if (landing.first == offset)
+        {
+            offset++;
+        }
+        findLanding(landing.second);
+    }
     if (offset == 0) { return false; }
 
-    for (; indexInSelection > -1 && indexInSelection < mSelectedFrames_byPosition.count(); indexInSelection += step)
+    std::map<int, int> newPositions;
+    for (int pos : selectedFrames)
     {
-        int fromPos = mSelectedFrames_byPosition[indexInSelection];
-        int toPos = fromPos + offset;
+        newPositions.emplace_hint(newPositions.end(), pos, pos + offset);
+    }
+    return retimeKeyFrames(newPositions);
+}
+
+bool Layer::moveConnectedKeyFrames(int position, int offset)
+{
+    if (offset == 0 || !keyExists(position)) { return false; }
+
+    std::map<int, int> newPositions;
+    int end = position;
 
-        // Get the frame to move
-        KeyFrame* selectedFrame = getKeyFrameAt(fromPos);
+    auto first = mKeyFrames.find(position);
+    for (auto it = std::reverse_iterator<decltype(first)>(std::next(first)); it != mKeyFrames.rend() && it->first <= end; ++it)
+    {
+        newPositions.emplace_hint(newPositions.end(), it->first, it->first + offset);
+        end = qMax(end, it->first + it->second->length());
+    }
+    return retimeKeyFrames(newPositions);
+}
 
-        Q_ASSERT(!keyExists(toPos));
+bool Layer::retimeKeyFrames(const std::map<int, int>& newPositions)
+{
+    if (newPositions.empty()) { return false; }
 
-        mKeyFrames.erase(fromPos);
-        markFrameAsDirty(fromPos);
+    // Check the whole layout first, so that a retime that doesn't fit leaves the layer untouched
+    QSet<int> targets;
+    targets.reserve(static_cast<int>(newPositions.size()));
+    int firstDirty = newPositions.begin()->first;
+    int lastDirty = firstDirty;
+    for (const auto& move : newPositions)
+    {
+        const int from = move.first;
+        const int to = move.second;
+        if (to < 1 || !keyExists(from) || targets.contains(to)) { return false; }
+        if (keyExists(to) && newPositions.find(to) == newPositions.end()) { return false; }
 
-        // Update the position of the selected frame
-        selectedFrame->setPos(toPos);
-        mKeyFrames.insert(std::make_pair(toPos, selectedFrame));
-        markFrameAsDirty(toPos);
+        targets.insert(to);
+        firstDirty = qMin(firstDirty, qMin(from, to));
+        lastDirty = qMax(lastDirty, qMax(from, to));
     }
 
-    // Update selection lists
-    for (int& pos : mSelectedFrames_byPosition)
+    // Take every moving keyframe out before putting any back, so they can't collide with each other
+    std::vector<KeyFrame*> movedKeyFrames;
+    movedKeyFrames.reserve(newPositions.size());
+    for (const auto& move : newPositions)
     {
-        pos += offset;
+        auto it = mKeyFrames.find(move.first);
+        movedKeyFrames.push_back(it->second);
+        mKeyFrames.erase(it);
     }
-    for (int& pos : mSelectedFrames_byLast)
+
+    auto keyFrame = movedKeyFrames.cbegin();
+    for (const auto& move : newPositions)
     {
-        pos += offset;
+        (*keyFrame)->setPos(move.second);
+        mKeyFrames.emplace(move.second, *keyFrame);
+        ++keyFrame;
     }
+
+    mSelection.remap(newPositions);
+    markFramesAsDirty(firstDirty, lastDirty);
     return true;
 }
 
@@ -693,23 +694,22 @@ KeyFrame* Layer::getKeyFrameWhichCovers(int frameNumber) const
     return nullptr;
 }
 
-QDomElement Layer::createBaseDomElement(QDomDocument& doc) const
+void Layer::createBaseDomElement(QXmlStreamWriter& writer) const
 {
-    QDomElement layerTag = doc.createElement("layer");
-    layerTag.setAttribute("id", id());
-    layerTag.setAttribute("name", name());
-    layerTag.setAttribute("visibility", visible());
-    layerTag.setAttribute("type", type());
-    return layerTag;
+    writer.writeStartElement("layer");
+    writer.writeAttribute("id", QString::number(id()));
+    writer.writeAttribute("name", name());
+    writer.writeAttribute("visibility", visible() ? "1" : "0");
+    writer.writeAttribute("type", QString::number(type()));
 }
 
-void Layer::loadBaseDomElement(const QDomElement& elem)
+void Layer::loadBaseDomElement(const QXmlStreamAttributes& attributes)
 {
-    if (!elem.attribute("id").isNull())
+    if (attributes.hasAttribute("id"))
     {
-        int id = elem.attribute("id").toInt();
+        int id = attributes.value("id").toInt();
         setId(id);
     }
-    setName(elem.attribute("name", "untitled"));
-    setVisible(elem.attribute("visibility", "1").toInt());
+    setName(xmlAttribute(attributes, "name", "untitled"));
+    setVisible(xmlAttribute(attributes, "visibility", "1").toInt());
 }
@@ -18,11 +18,16 @@ GNU General Public License for more details.
 #define LAYER_H
 
 #include <map>
+#include <memory>
+#include <vector>
 #include <functional>
 #include <QObject>
 #include <QString>
-#include <QDomElement>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include "pencilerror.h"
+#include "keyframeselection.h"
+#include "framerangeset.h"
 
 class KeyFrame;
 class Status;
@@ -59,16 +64,18 @@ public:
     void setVisible(bool b) { mVisible = b; }
 
     /** Get selected keyframe positions sorted by position */
-    QList<int> selectedKeyFramesPositions() const { return mSelectedFrames_byPosition; }
+    QList<int> selectedKeyFramesPositions() const { return mSelection.byPosition(); }
 
     /** Get selected keyframe positions based on the order they were selected */
-    QList<int> selectedKeyFramesByLast() const { return mSelectedFrames_byLast; }
+    QList<int> selectedKeyFramesByLast() const { return mSelection.byRecency(); }
 
     virtual Status saveKeyFrameFile(KeyFrame*, QString dataPath) = 0;
-    virtual void loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressForward) = 0;
-    virtual QDomElement createDomElement(QDomDocument& doc) const = 0;
-    QDomElement createBaseDomElement(QDomDocument& doc) const;
-    void loadBaseDomElement(const QDomElement& elem);
+    /** Reads the layer from the layer element the reader is on, and leaves the reader at the end of it */
+    virtual void loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressForward) = 0;
+    virtual void createDomElement(QXmlStreamWriter& writer) const = 0;
+    /** Starts the layer element, the layer types add their own attributes and keyframes and end it */
+    void createBaseDomElement(QXmlStreamWriter& writer) const;
+    void loadBaseDomElement(const QXmlStreamAttributes& attributes);
 
     // KeyFrame interface
     int getMaxKeyFramePosition() const;
@@ -81,8 +88,8 @@ public:
     int  getNextFrameNumber(int position, bool isAbsolute) const;
 
     int keyFrameCount() const { return static_cast<int>(mKeyFrames.size()); }
-    int selectedKeyFrameCount() const { return mSelectedFrames_byPosition.count(); }
-    bool hasAnySelectedFrames() const { return !mSelectedFrames_byLast.empty() && !mSelectedFrames_byPosition.empty(); }
+    int selectedKeyFrameCount() const { return mSelection.count(); }
+    bool hasAnySelectedFrames() const { return !mSelection.isEmpty(); }
 
     /** Will insert an empty frame (exposure) after the given position
         @param position The frame to add exposure to
@@ -105,6 +112,13 @@ public:
     virtual bool addKeyFrame(int position, KeyFrame* pKeyFrame);
     virtual bool removeKeyFrame(int position);
     virtual void replaceKeyFrame(const KeyFrame* pKeyFrame) = 0;
+    /**
+     * Puts copies of the given keyframes back at their positions and removes the keyframes
+     * at the remaining given positions. Used to restore many keyframes at once, e.g. on undo.
+     * @param positions All the positions to restore
+     * @param keyFrames The keyframes to restore, positioned within @p positions
+     */
+    void restoreKeyFrames(const QList<int>& positions, const std::vector<std::unique_ptr<KeyFrame>>& keyFrames);
 
     bool swapKeyFrames(int position1, int position2);
     bool moveKeyFrame(int position, int offset);
@@ -114,6 +128,8 @@ public:
     KeyFrame *getKeyFrameWhichCovers(int frameNumber) const;
 
     void foreachKeyFrame(std::function<void(KeyFrame*)>) const;
+    /** Like foreachKeyFrame() but only visits the keyframes positioned within [startPosition, endPosition] */
+    void foreachKeyFrameInRange(int startPosition, int endPosition, std::function<void(KeyFrame*)>) const;
 
     void setModified(int position, bool isModified) const;
 
@@ -148,7 +164,23 @@ public:
     void deselectAll();
 
     bool moveSelectedFrames(int offset);
-    QList<int> getSelectedFramesByPos() const { return mSelectedFrames_byPosition; }
+
+    /** Moves the keyframe at the given position, together with the keyframes following it
+     *  up to the first empty frame, by the given offset
+     *  @return false if there is no keyframe at the position or the keyframes can't be moved there
+     */
+    bool moveConnectedKeyFrames(int position, int offset);
+
+    /** Moves many keyframes at once. The keyframes are moved in a single step, so they may
+     *  swap or shift onto each other's positions, and the whole span is marked dirty once.
+     *  Selected keyframes stay selected in the same order.
+     *
+     * @param newPositions Maps the current position of each keyframe to move to its new position
+     * @return false if a keyframe doesn't exist or would land before the first frame or on a keyframe
+     *         that stays in place, in which case nothing is moved
+     */
+    bool retimeKeyFrames(const std::map<int, int>& newPositions);
+    QList<int> getSelectedFramesByPos() const { return mSelection.byPosition(); }
 
     /** Predetermines whether the frames can be moved to a new position depending on the offset
      *
@@ -162,12 +194,15 @@ public:
 
     bool isPaintable() const;
 
-    /** Returns a list of dirty frame positions */
-    QList<int> dirtyFrames() const { return mDirtyFrames; }
+    /** Returns the dirty frame positions as (first, last) ranges, lowest first */
+    QList<std::pair<int, int>> dirtyFrameRanges() const { return mDirtyFrames.ranges(); }
 
     /** Mark the frame position as dirty.
      *  Any operation causing the frame to be modified, added, updated or removed, should call this. */
-    void markFrameAsDirty(const int frameNumber) { mDirtyFrames << frameNumber; }
+    void markFrameAsDirty(const int frameNumber) { mDirtyFrames.insert(frameNumber); }
+
+    /** Marks all the frame positions from first to last as dirty, inclusive */
+    void markFramesAsDirty(const int firstFrame, const int lastFrame) { mDirtyFrames.insert(firstFrame, lastFrame); }
 
     /** Clear the list of dirty keyframes */
     void clearDirtyFrames() { mDirtyFrames.clear(); }
@@ -186,15 +221,12 @@ private:
 
     std::map<int, KeyFrame*, std::greater<int>> mKeyFrames;
 
-    // We need to keep track of selected frames ordered by last selected
-    // and by position.
-    // Both should be pre-sorted on each selection for optimization purpose when moving frames.
-    //
-    QList<int> mSelectedFrames_byLast; // Used to handle selection range (based on last selected
-    QList<int> mSelectedFrames_byPosition; // Used to handle frames movements on the timeline
+    // Selected frames, by position to handle their movements on the timeline
+    // and by last selected to handle selection ranges
+    KeyFrameSelection mSelection;
 
     // Used for clearing cache for modified frames.
-    QList<int> mDirtyFrames;
+    FrameRangeSet mDirtyFrames;
 };
 
 #endif
@@ -177,52 +177,50 @@ bool LayerBitmap::needSaveFrame(KeyFrame* key, const QString& savePath)
     return false;
 }
 
-QDomElement LayerBitmap::createDomElement(QDomDocument& doc) const
+void LayerBitmap::createDomElement(QXmlStreamWriter& writer) const
 {
-    QDomElement layerElem = createBaseDomElement(doc);
+    createBaseDomElement(writer);
 
     foreachKeyFrame([&](KeyFrame* pKeyFrame)
     {
         BitmapImage* pImg = static_cast<BitmapImage*>(pKeyFrame);
 
-        QDomElement imageTag = doc.createElement("image");
-        imageTag.setAttribute("frame", pKeyFrame->pos());
-        imageTag.setAttribute("src", fileName(pKeyFrame));
-        imageTag.setAttribute("topLeftX", pImg->topLeft().x());
-        imageTag.setAttribute("topLeftY", pImg->topLeft().y());
-        imageTag.setAttribute("opacity", pImg->getOpacity());
-        layerElem.appendChild(imageTag);
+        writer.writeEmptyElement("image");
+        writer.writeAttribute("frame", QString::number(pKeyFrame->pos()));
+        writer.writeAttribute("src", fileName(pKeyFrame));
+        writer.writeAttribute("topLeftX", QString::number(pImg->topLeft().x()));
+        writer.writeAttribute("topLeftY", QString::number(pImg->topLeft().y()));
+        writer.writeAttribute("opacity", xmlNumber(pImg->getOpacity()));
 
         if (!pKeyFrame->fileName().isEmpty()) {
             Q_ASSERT(QFileInfo(pKeyFrame->fileName()).fileName() == fileName(pKeyFrame));
         }
     });
 
-    return layerElem;
+    writer.writeEndElement(); // layer
 }
 
-void LayerBitmap::loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep)
+void LayerBitmap::loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep)
 {
-    this->loadBaseDomElement(element);
+    this->loadBaseDomElement(reader.attributes());
 
-    QDomNode imageTag = element.firstChild();
-    while (!imageTag.isNull())
+    while (reader.readNextStartElement())
     {
-        QDomElement imageElement = imageTag.toElement();
-        if (!imageElement.isNull() && imageElement.tagName() == "image")
+        if (reader.name() == QLatin1String("image"))
         {
-            QString path = validateDataPath(imageElement.attribute("src"), dataDirPath);
+            const QXmlStreamAttributes attributes = reader.attributes();
+            QString path = validateDataPath(xmlAttribute(attributes, "src"), dataDirPath);
             if (!path.isEmpty())
             {
-                int position = imageElement.attribute("frame").toInt();
-                int x = imageElement.attribute("topLeftX").toInt();
-                int y = imageElement.attribute("topLeftY").toInt();
-                qreal opacity = imageElement.attribute("opacity", "1.0").toDouble();
+                int position = attributes.value("frame").toInt();
+                int x = attributes.value("topLeftX").toInt();
+                int y = attributes.value("topLeftY").toInt();
+                qreal opacity = xmlAttribute(attributes, "opacity", "1.0").toDouble();
                 loadImageAtFrame(path, QPoint(x, y), position, opacity);
             }
 
             progressStep();
         }
-        imageTag = imageTag.nextSibling();
+        reader.skipCurrentElement();
     }
 }
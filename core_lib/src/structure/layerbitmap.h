@@ -30,8 +30,8 @@ public:
     explicit LayerBitmap(int id);
     ~LayerBitmap() override;
 
-    QDomElement createDomElement(QDomDocument& doc) const override;
-    void loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep) override;
+    void createDomElement(QXmlStreamWriter& writer) const override;
+    void loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep) override;
     Status presave(const QString& sDataFolder) override;
 
     BitmapImage* getBitmapImageAtFrame(int frameNumber);
@@ -21,6 +21,7 @@ GNU General Public License for more details.
 
 #include "camera.h"
 #include "pencildef.h"
+#include "util/util.h"
 
 LayerCamera::LayerCamera(int id) : Layer(id, Layer::CAMERA)
 {
@@ -554,80 +555,76 @@ KeyFrame* LayerCamera::createKeyFrame(int position)
     return c;
 }
 
-QDomElement LayerCamera::createDomElement(QDomDocument& doc) const
+void LayerCamera::createDomElement(QXmlStreamWriter& writer) const
 {
-    QDomElement layerElem = createBaseDomElement(doc);
-    layerElem.setAttribute("width", viewRect.width());
-    layerElem.setAttribute("height", viewRect.height());
+    createBaseDomElement(writer);
+    writer.writeAttribute("width", QString::number(viewRect.width()));
+    writer.writeAttribute("height", QString::number(viewRect.height()));
 
     if (mShowPath) {
-        layerElem.setAttribute("showPath", mShowPath);
+        writer.writeAttribute("showPath", "1");
     }
 
     if (mDotColorType != DotColorType::RED) {
-        layerElem.setAttribute("pathColorType", static_cast<int>(mDotColorType));
+        writer.writeAttribute("pathColorType", QString::number(static_cast<int>(mDotColorType)));
     }
 
     foreachKeyFrame([&](KeyFrame* pKeyFrame)
                     {
                         Camera* camera = static_cast<Camera*>(pKeyFrame);
-                        QDomElement keyTag = doc.createElement("camera");
-                        keyTag.setAttribute("frame", camera->pos());
+                        writer.writeEmptyElement("camera");
+                        writer.writeAttribute("frame", QString::number(camera->pos()));
 
-                        keyTag.setAttribute("r", camera->rotation());
-                        keyTag.setAttribute("s", camera->scaling());
-                        keyTag.setAttribute("dx", camera->translation().x());
-                        keyTag.setAttribute("dy", camera->translation().y());
+                        writer.writeAttribute("r", xmlNumber(camera->rotation()));
+                        writer.writeAttribute("s", xmlNumber(camera->scaling()));
+                        writer.writeAttribute("dx", xmlNumber(camera->translation().x()));
+                        writer.writeAttribute("dy", xmlNumber(camera->translation().y()));
 
                         if (camera->getEasingType() != CameraEasingType::LINEAR) {
-                            keyTag.setAttribute("easing", static_cast<int>(camera->getEasingType()));
+                            writer.writeAttribute("easing", QString::number(static_cast<int>(camera->getEasingType())));
                         }
                         if (camera->pathControlPointMoved()) {
-                            keyTag.setAttribute("pathCPX", camera->getPathControlPoint().x());
-                            keyTag.setAttribute("pathCPY", camera->getPathControlPoint().y());
+                            writer.writeAttribute("pathCPX", xmlNumber(camera->getPathControlPoint().x()));
+                            writer.writeAttribute("pathCPY", xmlNumber(camera->getPathControlPoint().y()));
                         }
-                        layerElem.appendChild(keyTag);
                     });
 
-    return layerElem;
+    writer.writeEndElement(); // layer
 }
 
-void LayerCamera::loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep)
+void LayerCamera::loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep)
 {
     Q_UNUSED(dataDirPath)
     Q_UNUSED(progressStep)
 
-    this->loadBaseDomElement(element);
+    const QXmlStreamAttributes layerAttributes = reader.attributes();
+    this->loadBaseDomElement(layerAttributes);
 
-    int width = element.attribute("width").toInt();
-    int height = element.attribute("height").toInt();
-    mShowPath = element.attribute("showPath").toInt();
-    updateDotColor(static_cast<DotColorType>(element.attribute("pathColorType").toInt()));
+    int width = layerAttributes.value("width").toInt();
+    int height = layerAttributes.value("height").toInt();
+    mShowPath = layerAttributes.value("showPath").toInt();
+    updateDotColor(static_cast<DotColorType>(layerAttributes.value("pathColorType").toInt()));
     viewRect = QRect(-width / 2, -height / 2, width, height);
 
-    QDomNode imageTag = element.firstChild();
-    while (!imageTag.isNull())
+    while (reader.readNextStartElement())
     {
-        QDomElement imageElement = imageTag.toElement();
-        if (!imageElement.isNull())
+        if (reader.name() == QLatin1String("camera"))
         {
-            if (imageElement.tagName() == "camera")
-            {
-                int frame = imageElement.attribute("frame").toInt();
+            const QXmlStreamAttributes attributes = reader.attributes();
+            int frame = attributes.value("frame").toInt();
 
-                qreal rotate = imageElement.attribute("r", "0").toDouble();
-                qreal scale = imageElement.attribute("s", "1").toDouble();
-                qreal dx = imageElement.attribute("dx", "0").toDouble();
-                qreal dy = imageElement.attribute("dy", "0").toDouble();
-                CameraEasingType easing = static_cast<CameraEasingType>(imageElement.attribute("easing", "0").toInt());
-                qreal pathX = imageElement.attribute("pathCPX", "0").toDouble();
-                qreal pathY = imageElement.attribute("pathCPY", "0").toDouble();
+            qreal rotate = xmlAttribute(attributes, "r", "0").toDouble();
+            qreal scale = xmlAttribute(attributes, "s", "1").toDouble();
+            qreal dx = xmlAttribute(attributes, "dx", "0").toDouble();
+            qreal dy = xmlAttribute(attributes, "dy", "0").toDouble();
+            CameraEasingType easing = static_cast<CameraEasingType>(xmlAttribute(attributes, "easing", "0").toInt());
+            qreal pathX = xmlAttribute(attributes, "pathCPX", "0").toDouble();
+            qreal pathY = xmlAttribute(attributes, "pathCPY", "0").toDouble();
 
-                bool pathMoved = pathX != 0 || pathY != 0;
+            bool pathMoved = pathX != 0 || pathY != 0;
 
-                loadImageAtFrame(frame, dx, dy, rotate, scale, easing, QPointF(pathX, pathY), pathMoved);
-            }
+            loadImageAtFrame(frame, dx, dy, rotate, scale, easing, QPointF(pathX, pathY), pathMoved);
         }
-        imageTag = imageTag.nextSibling();
+        reader.skipCurrentElement();
     }
 }
@@ -35,8 +35,8 @@ public:
 
     void loadImageAtFrame(int frame, qreal dx, qreal dy, qreal rotate, qreal scale, CameraEasingType easing, const QPointF& pathPoint, bool pathMoved);
 
-    QDomElement createDomElement(QDomDocument& doc) const override;
-    void loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep) override;
+    void createDomElement(QXmlStreamWriter& writer) const override;
+    void loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep) override;
 
     bool addKeyFrame(int position, KeyFrame* pKeyFrame) override;
     bool removeKeyFrame(int position) override;
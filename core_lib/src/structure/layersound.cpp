@@ -65,55 +65,51 @@ void LayerSound::updateFrameLengths(int fps)
     });
 }
 
-QDomElement LayerSound::createDomElement(QDomDocument& doc) const
+void LayerSound::createDomElement(QXmlStreamWriter& writer) const
 {
-    QDomElement layerElem = createBaseDomElement(doc);
+    createBaseDomElement(writer);
 
-    foreachKeyFrame([&doc, &layerElem](KeyFrame* pKeyFrame)
+    foreachKeyFrame([&writer](KeyFrame* pKeyFrame)
     {
         SoundClip* clip = static_cast<SoundClip*>(pKeyFrame);
 
-        QDomElement imageTag = doc.createElement("sound");
-        imageTag.setAttribute("frame", clip->pos());
-        imageTag.setAttribute("name", clip->soundClipName());
+        writer.writeEmptyElement("sound");
+        writer.writeAttribute("frame", QString::number(clip->pos()));
+        writer.writeAttribute("name", clip->soundClipName());
 
         QFileInfo info(clip->fileName());
         //qDebug() << "Save=" << info.fileName();
-        imageTag.setAttribute("src", info.fileName());
-        layerElem.appendChild(imageTag);
+        writer.writeAttribute("src", info.fileName());
     });
 
-    return layerElem;
+    writer.writeEndElement(); // layer
 }
 
-void LayerSound::loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep)
+void LayerSound::loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep)
 {
-    this->loadBaseDomElement(element);
+    this->loadBaseDomElement(reader.attributes());
 
-    QDomNode soundTag = element.firstChild();
-    while (!soundTag.isNull())
+    while (reader.readNextStartElement())
     {
-        QDomElement soundElement = soundTag.toElement();
-
-        if (!soundElement.isNull() && soundElement.tagName() == "sound")
+        if (reader.name() == QLatin1String("sound"))
         {
-            const QString soundFile = soundElement.attribute("src");
-            const QString sSoundClipName = soundElement.attribute("name", "My Sound Clip");
+            const QXmlStreamAttributes attributes = reader.attributes();
+            const QString soundFile = xmlAttribute(attributes, "src");
+            const QString sSoundClipName = xmlAttribute(attributes, "name", "My Sound Clip");
 
             if (!soundFile.isEmpty())
             {
                 QString path = validateDataPath(soundFile, dataDirPath);
                 if (!path.isEmpty())
                 {
-                    int position = soundElement.attribute("frame").toInt();
+                    int position = attributes.value("frame").toInt();
                     Status st = loadSoundClipAtFrame(sSoundClipName, path, position);
                     Q_ASSERT(st.ok());
                 }
             }
             progressStep();
         }
-
-        soundTag = soundTag.nextSibling();
+        reader.skipCurrentElement();
     }
 }
 
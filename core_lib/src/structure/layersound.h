@@ -29,8 +29,8 @@ class LayerSound : public Layer
 public:
     explicit LayerSound(int id);
     ~LayerSound();
-    QDomElement createDomElement(QDomDocument& doc) const override;
-    void loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep) override;
+    void createDomElement(QXmlStreamWriter& writer) const override;
+    void loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep) override;
 
     void replaceKeyFrame(const KeyFrame* soundClip) override;
 
@@ -22,6 +22,40 @@ GNU General Public License for more details.
 #include <QFileInfo>
 #include "util/util.h"
 
+namespace
+{
+// The color usage of a frame is saved with its image tag as "color:count" pairs, e.g. "0:12 3:2"
+QString colorUsageToString(const QMap<int, int>& usage)
+{
+    QStringList pairs;
+    for (auto it = usage.cbegin(); it != usage.cend(); ++it)
+    {
+        pairs.append(QString("%1:%2").arg(it.key()).arg(it.value()));
+    }
+    return pairs.join(' ');
+}
+
+bool colorUsageFromString(const QString& text, QMap<int, int>& usage)
+{
+    usage.clear();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QStringList pairs = text.split(' ', Qt::SkipEmptyParts);
+#else
+    const QStringList pairs = text.split(' ', QString::SkipEmptyParts);
+#endif
+    for (const QString& pair : pairs)
+    {
+        const int colon = pair.indexOf(':');
+        bool colorOk = false, countOk = false;
+        const int color = pair.left(colon).toInt(&colorOk);
+        const int count = pair.mid(colon + 1).toInt(&countOk);
+        if (colon < 0 || !colorOk || !countOk) { return false; }
+        usage.insert(color, count);
+    }
+    return true;
+}
+}
+
 LayerVector::LayerVector(int id) : Layer(id, Layer::VECTOR)
 {
     setName(tr("Vector Layer"));
@@ -33,6 +67,7 @@ LayerVector::~LayerVector()
 
 bool LayerVector::usesColor(int colorIndex)
 {
+    // The keyframes know which colors they use without being read, see VectorImage::colorUsage()
     bool bUseColor = false;
     foreachKeyFrame([&](KeyFrame* pKeyFrame)
     {
@@ -49,7 +84,11 @@ void LayerVector::removeColor(int colorIndex)
     foreachKeyFrame([=](KeyFrame* pKeyFrame)
     {
         auto pVecImage = static_cast<VectorImage*>(pKeyFrame);
-        pVecImage->removeColor(colorIndex);
+        const QMap<int, int> usage = pVecImage->colorUsage();
+        if (!usage.isEmpty() && usage.lastKey() >= colorIndex && usage.lastKey() > 0)
+        {
+            pVecImage->removeColor(colorIndex);
+        }
     });
 }
 
@@ -58,7 +97,10 @@ void LayerVector::moveColor(int start, int end)
     foreachKeyFrame( [=] (KeyFrame* pKeyFrame)
     {
         auto pVecImage = static_cast<VectorImage*>(pKeyFrame);
-        pVecImage->moveColor(start, end);
+        if (pVecImage->usesColor(start))
+        {
+            pVecImage->moveColor(start, end);
+        }
     });
 }
 
@@ -70,7 +112,10 @@ void LayerVector::loadImageAtFrame(QString path, int frameNumber)
     }
     VectorImage* vecImg = new VectorImage;
     vecImg->setPos(frameNumber);
-    vecImg->read(path);
+    vecImg->setFileName(path);
+    vecImg->setModified(false);
+    // Nothing is read until the frame is used, like bitmap frames
+    vecImg->unloadFile();
     addKeyFrame(frameNumber, vecImg);
 }
 
@@ -105,6 +150,35 @@ Status LayerVector::saveKeyFrameFile(KeyFrame* keyFrame, QString path)
     return Status::OK;
 }
 
+Status LayerVector::presave(const QString& sDataFolder)
+{
+    // Frames that were moved or come from a .vecb file are rewritten under a new name,
+    // read them before anything is written in case the new name belongs to another frame's file
+    QDir dataFolder(sDataFolder);
+    DebugDetails dd;
+    dd << "LayerVector::presave";
+    bool readOK = true;
+    foreachKeyFrame([this, &dataFolder, &dd, &readOK](KeyFrame* key)
+    {
+        if (!key->isLoaded() && key->fileName() != dataFolder.filePath(fileName(key)))
+        {
+            Status st = static_cast<VectorImage*>(key)->load();
+            if (!st.ok())
+            {
+                readOK = false;
+                dd << QString("  KeyFrame.pos() = %1").arg(key->pos());
+                dd.collect(st.details());
+            }
+        }
+    });
+    if (!readOK)
+    {
+        dd << "Error: Failed to read VectorImage";
+        return Status(Status::FAIL, dd);
+    }
+    return Status::SAFE;
+}
+
 KeyFrame* LayerVector::createKeyFrame(int position)
 {
     VectorImage* v = new VectorImage;
@@ -128,60 +202,71 @@ bool LayerVector::needSaveFrame(KeyFrame* key, const QString& strSavePath)
     return false;
 }
 
-QDomElement LayerVector::createDomElement(QDomDocument& doc) const
+void LayerVector::createDomElement(QXmlStreamWriter& writer) const
 {
-    QDomElement layerElem = createBaseDomElement(doc);
+    createBaseDomElement(writer);
 
     foreachKeyFrame([&](KeyFrame* keyframe)
     {
-        QDomElement imageTag = doc.createElement("image");
-        imageTag.setAttribute("frame", keyframe->pos());
-        imageTag.setAttribute("src", fileName(keyframe));
+        writer.writeEmptyElement("image");
+        writer.writeAttribute("frame", QString::number(keyframe->pos()));
+        writer.writeAttribute("src", fileName(keyframe));
         VectorImage* image = getVectorImageAtFrame(keyframe->pos());
-        imageTag.setAttribute("opacity", image->getOpacity());
-        layerElem.appendChild(imageTag);
+        writer.writeAttribute("opacity", xmlNumber(image->getOpacity()));
+        // Frames that aren't in memory aren't read only to count their colors
+        if (image->isLoaded() || image->colorUsageKnown())
+        {
+            writer.writeAttribute("colors", colorUsageToString(image->colorUsage()));
+        }
 
         Q_ASSERT(QFileInfo(keyframe->fileName()).fileName() == fileName(keyframe));
     });
 
-    return layerElem;
+    writer.writeEndElement(); // layer
 }
 
-void LayerVector::loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep)
+void LayerVector::loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep)
 {
-    this->loadBaseDomElement(element);
+    this->loadBaseDomElement(reader.attributes());
 
-    QDomNode imageTag = element.firstChild();
-    while (!imageTag.isNull())
+    while (reader.readNextStartElement())
     {
-        QDomElement imageElement = imageTag.toElement();
-        if (!imageElement.isNull() && imageElement.tagName() == "image")
+        if (reader.name() != QLatin1String("image"))
         {
-            int position;
-            QString rawPath = imageElement.attribute("src");
-            if (!rawPath.isNull())
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        const QXmlStreamAttributes attributes = reader.attributes();
+        const int position = attributes.value("frame").toInt();
+        const qreal opacity = xmlAttribute(attributes, "opacity", "1.0").toDouble();
+        QString rawPath = xmlAttribute(attributes, "src");
+        if (!rawPath.isNull())
+        {
+            QString path = validateDataPath(rawPath, dataDirPath);
+            if (!path.isEmpty())
             {
-                QString path = validateDataPath(rawPath, dataDirPath);
-                if (!path.isEmpty())
+                loadImageAtFrame(path, position);
+                getVectorImageAtFrame(position)->setOpacity(opacity);
+
+                // Projects saved before the color usage was kept have the frames read on the first palette edit
+                QMap<int, int> usage;
+                if (attributes.hasAttribute("colors") && colorUsageFromString(xmlAttribute(attributes, "colors"), usage))
                 {
-                    position = imageElement.attribute("frame").toInt();
-                    loadImageAtFrame(path, position);
-                    getVectorImageAtFrame(position)->setOpacity(imageElement.attribute("opacity", "1.0").toDouble());
+                    getVectorImageAtFrame(position)->setColorUsage(usage);
                 }
             }
-            else
-            {
-                position = imageElement.attribute("frame").toInt();
-                addNewKeyFrameAt(position);
-                getVectorImageAtFrame(position)->loadDomElement(imageElement);
-                getVectorImageAtFrame(position)->setOpacity(imageElement.attribute("opacity", "1.0").toDouble());
-            }
-
-
-
-            progressStep();
+            reader.skipCurrentElement();
         }
-        imageTag = imageTag.nextSibling();
+        else
+        {
+            // The curves of old projects are kept in the image element itself
+            addNewKeyFrameAt(position);
+            getVectorImageAtFrame(position)->loadDomElement(reader);
+            getVectorImageAtFrame(position)->setOpacity(opacity);
+        }
+
+        progressStep();
     }
 }
 
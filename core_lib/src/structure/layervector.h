@@ -33,8 +33,8 @@ public:
     // method from layerImage
     void loadImageAtFrame(QString strFileName, int);
 
-    QDomElement createDomElement(QDomDocument& doc) const override;
-    void loadDomElement(const QDomElement& element, QString dataDirPath, ProgressCallback progressStep) override;
+    void createDomElement(QXmlStreamWriter& writer) const override;
+    void loadDomElement(QXmlStreamReader& reader, QString dataDirPath, ProgressCallback progressStep) override;
 
     VectorImage* getVectorImageAtFrame(int frameNumber) const;
     VectorImage* getLastVectorImageAtFrame(int frameNumber, int increment) const;
@@ -44,6 +44,8 @@ public:
     void removeColor(int index);
     void moveColor(int start, int end);
 
+    Status presave(const QString& sDataFolder) override;
+
 protected:
     Status saveKeyFrameFile(KeyFrame*, QString path) override;
     KeyFrame* createKeyFrame(int position) override;
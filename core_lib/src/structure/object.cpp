@@ -26,6 +26,7 @@ GNU General Public License for more details.
 #include <QDebug>
 #include <QDateTime>
 #include <QRegularExpression>
+#include <QThread>
 
 #include "layer.h"
 #include "layerbitmap.h"
@@ -38,6 +39,7 @@ GNU General Public License for more details.
 #include "vectorimage.h"
 #include "fileformat.h"
 #include "activeframepool.h"
+#include "vectorrasterizer.h"
 
 
 Object::Object()
@@ -64,37 +66,36 @@ void Object::init()
     loadDefaultPalette();
 }
 
-QDomElement Object::saveXML(QDomDocument& doc) const
+void Object::saveXML(QXmlStreamWriter& writer) const
 {
-    QDomElement objectTag = doc.createElement("object");
+    writer.writeStartElement("object");
 
     for (Layer* layer : mLayers)
     {
-        QDomElement layerTag = layer->createDomElement(doc);
-        objectTag.appendChild(layerTag);
+        layer->createDomElement(writer);
     }
-    return objectTag;
+    writer.writeEndElement(); // object
 }
 
-bool Object::loadXML(const QDomElement& docElem, ProgressCallback progressForward)
+bool Object::loadXML(QXmlStreamReader& reader, ProgressCallback progressForward)
 {
-    if (docElem.isNull())
+    if (!reader.isStartElement())
     {
         return false;
     }
 
     const QString dataDirPath = mDataDirPath;
 
-    for (QDomNode node = docElem.firstChild(); !node.isNull(); node = node.nextSibling())
+    while (reader.readNextStartElement())
     {
-        QDomElement element = node.toElement(); // try to convert the node to an element.
-        if (element.tagName() != "layer")
+        if (reader.name() != QLatin1String("layer"))
         {
+            reader.skipCurrentElement();
             continue;
         }
 
         Layer* newLayer;
-        switch (element.attribute("type").toInt())
+        switch (reader.attributes().value("type").toInt())
         {
         case Layer::BITMAP:
             newLayer = new LayerBitmap(getUniqueLayerID());
@@ -112,9 +113,9 @@ bool Object::loadXML(const QDomElement& docElem, ProgressCallback progressForwar
             Q_UNREACHABLE();
         }
         mLayers.append(newLayer);
-        newLayer->loadDomElement(element, dataDirPath, progressForward);
+        newLayer->loadDomElement(reader, dataDirPath, progressForward);
     }
-    return true;
+    return !reader.hasError();
 }
 
 LayerBitmap* Object::addNewBitmapLayer()
@@ -393,6 +394,17 @@ ColorRef Object::getColor(int index) const
     return result;
 }
 
+QVector<QColor> Object::paletteColors() const
+{
+    QVector<QColor> colors;
+    colors.reserve(mPalette.size());
+    for (const ColorRef& colorRef : mPalette)
+    {
+        colors.append(colorRef.color);
+    }
+    return colors;
+}
+
 void Object::setColor(int index, const QColor& newColor)
 {
     Q_ASSERT(index >= 0);
@@ -706,7 +718,8 @@ void Object::loadDefaultPalette()
 
 void Object::paintImage(QPainter& painter,int frameNumber,
                         bool background,
-                        bool antialiasing) const
+                        bool antialiasing,
+                        VectorRasterizer* rasterizer) const
 {
     updateActiveFrames(frameNumber);
 
@@ -724,6 +737,14 @@ void Object::paintImage(QPainter& painter,int frameNumber,
         painter.setWorldMatrixEnabled(true);
     }
 
+    VectorRasterizer::Request rasterRequest;
+    if (rasterizer)
+    {
+        rasterRequest = VectorRasterizer::frameRequest(this, painter.combinedTransform(),
+                                                       QSize(painter.device()->width(), painter.device()->height()),
+                                                       antialiasing);
+    }
+
     for (Layer* layer : mLayers)
     {
         if (!layer->visible())
@@ -753,7 +774,19 @@ void Object::paintImage(QPainter& painter,int frameNumber,
             if (vec)
             {
                 painter.setOpacity(vec->getOpacity());
-                vec->paintImage(painter, *this, false, false, antialiasing);
+                if (rasterizer)
+                {
+                    // The image has been rendered with the whole transform of the painter already
+                    const QImage image = rasterizer->rasterize(vec, rasterRequest);
+                    painter.save();
+                    painter.resetTransform();
+                    painter.drawImage(QPoint(0, 0), image);
+                    painter.restore();
+                }
+                else
+                {
+                    vec->paintImage(painter, *this, false, false, antialiasing);
+                }
             }
         }
     }
@@ -840,8 +873,35 @@ bool Object::exportFrames(int frameStart, int frameEnd,
         << frameEnd
         << "at size " << exportSize;
 
+    Layer* layer = findLayerByName(layerName);
+    const QSize camSize = cameraLayer->getViewSize();
+
+    // The vector keyframes of the next frames are rendered on the workers of the rasterizer
+    // while the current frame is being saved
+    VectorRasterizer rasterizer;
+    const int lookAhead = qMax(1, QThread::idealThreadCount());
+    int prefetchedFrame = frameStart - 1;
+
     for (int currentFrame = frameStart; currentFrame <= frameEnd; currentFrame++)
     {
+        while (prefetchedFrame < qMin(currentFrame + lookAhead, frameEnd))
+        {
+            const int frame = prefetchedFrame + 1;
+            if (!exportKeyframesOnly || layer->keyExists(frame))
+            {
+                // The same transform exportIm() sets up on its painter
+                const QTransform transform = cameraLayer->getViewAtFrame(frame)
+                    * QTransform::fromTranslate(camSize.width() / 2, camSize.height() / 2)
+                    * VectorRasterizer::windowTransform(camSize, exportSize);
+                if (!rasterizer.prefetchFrame(this, frame,
+                                              VectorRasterizer::frameRequest(this, transform, exportSize, antialiasing)))
+                {
+                    break; // No room for more images, the rest is prefetched as frames are saved
+                }
+            }
+            prefetchedFrame = frame;
+        }
+
         if (progress != nullptr)
         {
             int totalFramesToExport = (frameEnd - frameStart) + 1;
@@ -858,7 +918,6 @@ bool Object::exportFrames(int frameStart, int frameEnd,
         }
 
         QTransform view = cameraLayer->getViewAtFrame(currentFrame);
-        QSize camSize = cameraLayer->getViewSize();
 
         QString frameNumberString = QString::number(currentFrame);
         while (frameNumberString.length() < 4)
@@ -866,22 +925,22 @@ bool Object::exportFrames(int frameStart, int frameEnd,
             frameNumberString.prepend("0");
         }
         QString sFileName = filePath + frameNumberString + extension;
-        Layer* layer = findLayerByName(layerName);
         if (exportKeyframesOnly)
         {
             if (layer->keyExists(currentFrame))
-                exportIm(currentFrame, view, camSize, exportSize, sFileName, format, antialiasing, transparency);
+                exportIm(currentFrame, view, camSize, exportSize, sFileName, format, antialiasing, transparency, &rasterizer);
         }
         else
         {
-            exportIm(currentFrame, view, camSize, exportSize, sFileName, format, antialiasing, transparency);
+            exportIm(currentFrame, view, camSize, exportSize, sFileName, format, antialiasing, transparency, &rasterizer);
         }
     }
 
     return true;
 }
 
-bool Object::exportIm(int frame, const QTransform& view, QSize cameraSize, QSize exportSize, const QString& filePath, const QString& format, bool antialiasing, bool transparency) const
+bool Object::exportIm(int frame, const QTransform& view, QSize cameraSize, QSize exportSize, const QString& filePath, const QString& format, bool antialiasing, bool transparency,
+                      VectorRasterizer* rasterizer) const
 {
     QImage imageToExport(exportSize, QImage::Format_ARGB32_Premultiplied);
 
@@ -897,7 +956,7 @@ bool Object::exportIm(int frame, const QTransform& view, QSize cameraSize, QSize
     painter.setWorldTransform(view * centralizeCamera);
     painter.setWindow(QRect(0, 0, cameraSize.width(), cameraSize.height()));
 
-    paintImage(painter, frame, false, antialiasing);
+    paintImage(painter, frame, false, antialiasing, rasterizer);
 
     return imageToExport.save(filePath, format.toStdString().c_str());
 }
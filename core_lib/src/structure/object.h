@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include <QCoreApplication>
 #include <QObject>
 #include <QList>
+#include <QVector>
 #include <QColor>
 #include "layer.h"
 #include "colorref.h"
@@ -36,6 +37,7 @@ class LayerCamera;
 class LayerSound;
 class ObjectData;
 class ActiveFramePool;
+class VectorRasterizer;
 
 
 class Object final
@@ -66,15 +68,21 @@ public:
     QString mainXMLFile() const { return mMainXMLFile; }
     void    setMainXMLFile(const QString& file) { mMainXMLFile = file; }
 
-    QDomElement saveXML(QDomDocument& doc) const;
-    bool loadXML(const QDomElement& element, ProgressCallback progressForward);
+    void saveXML(QXmlStreamWriter& writer) const;
+    /** Reads the layers of the object element the reader is on, and leaves the reader at the end of it */
+    bool loadXML(QXmlStreamReader& reader, ProgressCallback progressForward);
 
-    void paintImage(QPainter& painter, int frameNumber, bool background, bool antialiasing) const;
+    /** Paints the frame, vector keyframes go through the rasterizer when one is given, so that they can be
+     *  rendered ahead on its worker threads */
+    void paintImage(QPainter& painter, int frameNumber, bool background, bool antialiasing,
+                    VectorRasterizer* rasterizer = nullptr) const;
 
     QString copyFileToDataFolder(const QString& strFilePath);
 
     // Color palette
     ColorRef getColor(int index) const;
+    /** The colors of the palette by index, for painting vector images away from the object */
+    QVector<QColor> paletteColors() const;
     void setColor(int index, const QColor& newColor);
     void setColorRef(int index, const ColorRef& newColorRef);
     void movePaletteColor(int start, int end);
@@ -150,7 +158,8 @@ public:
     bool exportFrames(int frameStart, int frameEnd, const LayerCamera* cameraLayer, QSize exportSize, QString filePath, QString format,
                       bool transparency, bool exportKeyframesOnly, const QString& layerName, bool antialiasing, QProgressDialog* progress, int progressMax) const;
 
-    bool exportIm(int frameStart, const QTransform& view, QSize cameraSize, QSize exportSize, const QString& filePath, const QString& format, bool antialiasing, bool transparency) const;
+    bool exportIm(int frameStart, const QTransform& view, QSize cameraSize, QSize exportSize, const QString& filePath, const QString& format, bool antialiasing, bool transparency,
+                  VectorRasterizer* rasterizer = nullptr) const;
 
     void modification() { modified = true; }
     bool isModified() const { return modified; }
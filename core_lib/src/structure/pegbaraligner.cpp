@@ -16,13 +16,59 @@ GNU General Public License for more details.
 */
 #include "pegbaraligner.h"
 
-#include <QDebug>
+#include <algorithm>
+#include <memory>
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThreadPool>
 #include <editor.h>
 #include <pencilerror.h>
 
 #include <bitmapimage.h>
 #include <layerbitmap.h>
 #include <layermanager.h>
+#include <object.h>
+#include <undoredomanager.h>
+
+namespace
+{
+    struct PegSearch
+    {
+        QAtomicInt searched;
+        QAtomicInt stopped;
+    };
+
+    /** Searches the pegs on its own copy of a keyframe, so the keyframe itself is never loaded or cropped */
+    class PegSearchTask : public QRunnable
+    {
+    public:
+        PegSearchTask(const PegBarAligner& aligner, const BitmapImage& keyFrame, PegStatus& result, PegSearch& search)
+            : mAligner(aligner), mImage(keyFrame), mResult(result), mSearch(search)
+        {
+            mImage.enableAutoCrop(false);
+        }
+
+        void run() override
+        {
+            if (!mSearch.stopped.loadAcquire())
+            {
+                mResult = mAligner.findPoint(mImage);
+                if (!mResult.ok())
+                {
+                    // No point in searching the remaining keyframes
+                    mSearch.stopped.storeRelease(1);
+                }
+            }
+            mSearch.searched.fetchAndAddOrdered(1);
+        }
+
+    private:
+        const PegBarAligner& mAligner;
+        BitmapImage mImage;
+        PegStatus& mResult;
+        PegSearch& mSearch;
+    };
+}
 
 PegStatus::PegStatus(ErrorCode code, QPoint point)
     : Status(code), point(point)
@@ -37,90 +83,200 @@ PegBarAligner::PegBarAligner(Editor* editor, QRect searchRect) :
 
 Status PegBarAligner::align(const QStringList& layers)
 {
-    LayerBitmap* layerBitmap = static_cast<LayerBitmap*>(mEditor->layers()->currentLayer());
-    BitmapImage* img = layerBitmap->getBitmapImageAtFrame(mEditor->currentFrame());
-    PegStatus result = findPoint(*img);
+    std::vector<PegOffset> offsets;
+    Status result = findOffsets(layers, offsets);
+    if (!result.ok())
+    {
+        return result;
+    }
+
+    result = applyOffsets(offsets);
+    mEditor->deselectAll();
+
+    return result;
+}
+
+Status PegBarAligner::findOffsets(const QStringList& layers,
+                                  std::vector<PegOffset>& offsets,
+                                  const std::function<void(int)>& progressChanged,
+                                  const std::function<bool()>& wasCanceled) const
+{
+    offsets.clear();
+
+    Layer* currentLayer = mEditor->layers()->currentLayer();
+    BitmapImage* reference = nullptr;
+    if (currentLayer->type() == Layer::BITMAP)
+    {
+        reference = static_cast<LayerBitmap*>(currentLayer)->getLastBitmapImageAtFrame(mEditor->currentFrame());
+    }
+
+    PegStatus result = Status::FAIL;
+    if (reference != nullptr)
+    {
+        BitmapImage referenceCopy(*reference);
+        referenceCopy.enableAutoCrop(false);
+        result = findPoint(referenceCopy);
+    }
 
     if (!result.ok())
     {
         return Status(Status::FAIL, tr("Peg hole not found!\nCheck selection, and please try again.", "PegBar error message"));
     }
 
-    const int pegX = result.point.x();
-    const int pegY = result.point.y();
+    const QPoint pegPoint = result.point;
 
-    for (int i = 0; i < layers.count(); i++)
+    // Only the existing keyframes are searched, in the order of the layers and then of their positions
+    std::vector<LayerBitmap*> keyFrameLayers;
+    std::vector<BitmapImage*> keyFrames;
+    for (const QString& layerName : layers)
     {
-        layerBitmap = static_cast<LayerBitmap*>(mEditor->layers()->findLayerByName(layers.at(i)));
-        for (int k = layerBitmap->firstKeyFramePosition(); k <= layerBitmap->getMaxKeyFramePosition(); k++)
+        Layer* layer = mEditor->layers()->findLayerByName(layerName, Layer::BITMAP);
+        if (layer == nullptr) { continue; }
+
+        LayerBitmap* layerBitmap = static_cast<LayerBitmap*>(layer);
+        const size_t first = keyFrames.size();
+        layerBitmap->foreachKeyFrame([&](KeyFrame* key)
         {
-            if (!layerBitmap->keyExists(k)) { continue; }
+            keyFrameLayers.push_back(layerBitmap);
+            keyFrames.push_back(static_cast<BitmapImage*>(key));
+        });
+        // Keyframes are stored in descending order
+        std::reverse(keyFrames.begin() + first, keyFrames.end());
+    }
 
-            img = layerBitmap->getBitmapImageAtFrame(k);
-            img->enableAutoCrop(false);
+    std::vector<PegStatus> results(keyFrames.size(), PegStatus(Status::CANCELED));
+    PegSearch search;
+    bool canceled = false;
 
-            result = findPoint(*img);
-            if (!result.ok())
-            {
-                const QString errorDescription = tr("Peg bar not found at %2, %1").arg(k).arg(layerBitmap->name());
-                return Status(result.code(), errorDescription);
-            }
-            img->moveTopLeft(QPoint(img->left() + (pegX - result.point.x()), img->top() + (pegY - result.point.y())));
+    // The tasks only hold shallow copies of the keyframes, which are loaded from their file as they are searched
+    QThreadPool threadPool;
+    for (size_t i = 0; i < keyFrames.size(); i++)
+    {
+        threadPool.start(new PegSearchTask(*this, *keyFrames[i], results[i], search));
+    }
 
-            emit mEditor->frameModified(img->pos());
+    while (!threadPool.waitForDone(50))
+    {
+        progressChanged(search.searched.loadAcquire());
+        if (!canceled && wasCanceled())
+        {
+            canceled = true;
+            search.stopped.storeRelease(1);
         }
     }
+    progressChanged(search.searched.loadAcquire());
 
-    mEditor->deselectAll();
+    offsets.reserve(keyFrames.size());
+    for (size_t i = 0; i < keyFrames.size(); i++)
+    {
+        if (results[i].code() == Status::CANCELED)
+        {
+            continue;
+        }
+
+        LayerBitmap* layerBitmap = keyFrameLayers[i];
+        if (!results[i].ok())
+        {
+            offsets.clear();
+            const QString errorDescription = tr("Peg bar not found at %2, %1").arg(keyFrames[i]->pos()).arg(layerBitmap->name());
+            return Status(results[i].code(), errorDescription);
+        }
 
+        PegOffset pegOffset;
+        pegOffset.layerId = layerBitmap->id();
+        pegOffset.position = keyFrames[i]->pos();
+        pegOffset.offset = pegPoint - results[i].point;
+        offsets.push_back(pegOffset);
+    }
+
+    if (canceled)
+    {
+        offsets.clear();
+        return Status::CANCELED;
+    }
     return Status::OK;
 }
 
-
-PegStatus PegBarAligner::findPoint(const BitmapImage& image) const
+Status PegBarAligner::applyOffsets(const std::vector<PegOffset>& offsets)
 {
-    QPoint point;
-    const int left = mPegSearchRect.left();
-    const int right = mPegSearchRect.right();
-    const int top = mPegSearchRect.top();
-    const int bottom = mPegSearchRect.bottom();
-    const int grayValue = mGrayThreshold;
+    std::vector<std::unique_ptr<KeyFramesSaveState>> undoStates;
+    for (const PegOffset& pegOffset : offsets)
+    {
+        if (pegOffset.offset.isNull()) { continue; }
 
-    bool foundX = false;
+        Layer* layer = mEditor->object()->findLayerById(pegOffset.layerId);
+        if (layer == nullptr || layer->type() != Layer::BITMAP) { continue; }
 
-    for (int x = left; x <= right && !foundX; x++)
-    {
-        for (int y = top; y <= bottom; y++)
-        {
-            const QRgb& scan = image.constScanLine(x,y);
-            if (qAlpha(scan) == 255 && qGray(scan) < grayValue)
-            {
-                foundX = true;
-                point.setX(x);
+        BitmapImage* img = static_cast<LayerBitmap*>(layer)->getBitmapImageAtFrame(pegOffset.position);
+        if (img == nullptr) { continue; }
 
-                break;
-            }
+        if (undoStates.empty() || undoStates.back()->layerId != layer->id())
+        {
+            undoStates.emplace_back(new KeyFramesSaveState);
+            undoStates.back()->layerId = layer->id();
         }
+        undoStates.back()->remember(layer, pegOffset.position);
+
+        // Frames which aren't loaded are only moved, their pixels stay on disk
+        img->enableAutoCrop(false);
+        img->moveTopLeft(img->topLeft() + pegOffset.offset);
+        layer->markFrameAsDirty(pegOffset.position);
+    }
+
+    if (undoStates.empty()) { return Status::SAFE; }
+
+    mEditor->undoRedo()->recordKeyFrames(std::move(undoStates), tr("Align Pegs"));
+
+    // Repaint once for all the keyframes
+    emit mEditor->framesModified();
+    return Status::OK;
+}
+
+
+PegStatus PegBarAligner::findPoint(BitmapImage& image) const
+{
+    const QImage* pixels = image.image();
+    const QRect bounds = image.bounds();
+
+    // Pixels outside of the image are transparent and can never be part of a peg hole
+    const QRect searchRect = mPegSearchRect.intersected(bounds);
+    if (searchRect.isEmpty() || pixels->isNull())
+    {
+        return Status::FAIL;
     }
 
-    bool foundY = false;
-    for (int y = top; y <= bottom && !foundY; y++)
+    const int left = searchRect.left();
+    const int top = searchRect.top();
+    const int bottom = searchRect.bottom();
+    const int grayValue = mGrayThreshold;
+
+    // The peg point is made of the leftmost column and the topmost row which contain a dark opaque pixel.
+    // Scanning row by row, only the part of each row left of the best column so far can still move it.
+    int pegX = searchRect.right() + 1;
+    int pegY = top;
+    bool found = false;
+
+    for (int y = top; y <= bottom && pegX > left; y++)
     {
-        for (int x = left; x <= right; x++)
+        const QRgb* row = reinterpret_cast<const QRgb*>(pixels->constScanLine(y - bounds.top()));
+        for (int x = left; x < pegX; x++)
         {
-            const QRgb& scan = image.constScanLine(x,y);
+            const QRgb scan = row[x - bounds.left()];
             if (qAlpha(scan) == 255 && qGray(scan) < grayValue)
             {
-                foundY = true;
-                point.setY(y);
-
+                if (!found)
+                {
+                    found = true;
+                    pegY = y;
+                }
+                pegX = x;
                 break;
             }
         }
     }
 
-    if (foundX && foundY) {
-        return PegStatus(Status::OK, point);
+    if (found) {
+        return PegStatus(Status::OK, QPoint(pegX, pegY));
     }
     return Status::FAIL;
 }
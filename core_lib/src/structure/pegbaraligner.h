@@ -19,6 +19,8 @@ GNU General Public License for more details.
 
 #include <pencilerror.h>
 
+#include <functional>
+#include <vector>
 #include <QPoint>
 #include <QRectF>
 
@@ -32,16 +34,40 @@ public:
     QPoint point;
 };
 
+/** How far the keyframe at a position has to move for its pegs to line up with the reference */
+struct PegOffset
+{
+    int layerId = 0;
+    int position = 0;
+    QPoint offset;
+};
+
 class PegBarAligner
 {
     Q_DECLARE_TR_FUNCTIONS(PegBarAligner)
 public:
     PegBarAligner(Editor* editor, QRect searchRect);
 
+    /** Finds the pegs on every keyframe of the given layers and moves them all in line with
+     *  the current keyframe, as a single undo step. */
     Status align(const QStringList& layers);
 
+    /** Finds how far each keyframe of the given layers is off from the pegs of the current keyframe.
+     *  The keyframes are searched on a pool of worker threads and are left untouched.
+     *  @param progressChanged is called with the number of keyframes searched so far
+     *  @param wasCanceled is polled while searching, returning true stops the search */
+    Status findOffsets(const QStringList& layers,
+                       std::vector<PegOffset>& offsets,
+                       const std::function<void(int)>& progressChanged = [](int) {},
+                       const std::function<bool()>& wasCanceled = [] { return false; }) const;
+
+    /** Moves the keyframes by the given offsets, as a single undo step */
+    Status applyOffsets(const std::vector<PegOffset>& offsets);
+
+    /** Finds the top left corner of the dark peg holes within the search rect, loading the image if needed */
+    PegStatus findPoint(BitmapImage& image) const;
+
 private:
-    PegStatus findPoint(const BitmapImage& image) const;
 
     Editor* mEditor = nullptr;
 
@@ -23,7 +23,6 @@ GNU General Public License for more details.
 #include <QPainter>
 #include <QColor>
 
-#include "beziercurve.h"
 #include "vectorimage.h"
 #include "editor.h"
 #include "colormanager.h"
@@ -31,6 +30,7 @@ GNU General Public License for more details.
 #include "viewmanager.h"
 #include "selectionmanager.h"
 #include "undoredomanager.h"
+#include "vectorstrokefinalizer.h"
 #include "scribblearea.h"
 #include "pointerevent.h"
 
@@ -302,28 +302,23 @@ void BrushTool::paintVectorStroke(Layer* layer)
 
     if (layer->type() == Layer::VECTOR && mStrokePoints.size() > -1)
     {
-        // Clear the temporary pixel path
-        mScribbleArea->clearDrawingBuffer();
-        qreal tol = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
-
-        BezierCurve curve(mStrokePoints, mStrokePressures, tol);
-        curve.setWidth(properties.width);
-        curve.setFeather(properties.feather);
-        curve.setFilled(false);
-        curve.setInvisibility(properties.invisibility);
-        curve.setVariableWidth(properties.pressure);
-        curve.setColorNumber(mEditor->color()->frontColorNumber());
-
-        VectorImage* vectorImage = static_cast<VectorImage*>(layer->getLastKeyFrameAtPosition(mEditor->currentFrame()));
-        vectorImage->addCurve(curve, mEditor->view()->scaling(), false);
-
-        if (vectorImage->isAnyCurveSelected() || mEditor->select()->somethingSelected())
-        {
-            mEditor->deselectAll();
-        }
-
-        vectorImage->setSelected(vectorImage->getLastCurveNumber(), true);
-
-        mEditor->setModified(mEditor->layers()->currentLayerIndex(), mEditor->currentFrame());
+        // The temporary pixel path stays on screen until the stroke has been finalized
+        VectorStroke stroke;
+        stroke.layerId = layer->id();
+        stroke.frame = mEditor->currentFrame();
+        stroke.keyFrame = static_cast<VectorImage*>(layer->getLastKeyFrameAtPosition(mEditor->currentFrame()));
+        stroke.points = mStrokePoints;
+        stroke.pressures = mStrokePressures;
+        stroke.tolerance = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
+        stroke.width = properties.width;
+        stroke.feather = properties.feather;
+        stroke.invisible = properties.invisibility;
+        stroke.variableWidth = properties.pressure;
+        stroke.colorNumber = mEditor->color()->frontColorNumber();
+        stroke.selectionFactor = mEditor->view()->scaling();
+
+        // The undo step is recorded once the stroke is committed
+        mEditor->vectorStrokes()->submit(stroke, mUndoSaveState, typeName());
+        mUndoSaveState = nullptr;
     }
 }
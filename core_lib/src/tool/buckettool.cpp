@@ -234,7 +234,12 @@ void BucketTool::paintVector(Layer* layer)
     VectorImage* vectorImage = static_cast<LayerVector*>(layer)->getLastVectorImageAtFrame(mEditor->currentFrame(), 0);
     if (vectorImage == nullptr) { return; } // Can happen if the first frame is deleted while drawing
 
-    if (!vectorImage->isPathFilled())
+    if (!vectorImage->isAnyCurveSelected())
+    {
+        // Nothing selected, fill the region the click is in
+        vectorImage->fillArea(getCurrentPoint(), mEditor->color()->frontColorNumber());
+    }
+    else if (!vectorImage->isPathFilled())
     {
         vectorImage->fillSelectedPath(mEditor->color()->frontColorNumber());
     }
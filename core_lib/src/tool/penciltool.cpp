@@ -31,6 +31,7 @@ GNU General Public License for more details.
 #include "scribblearea.h"
 #include "layervector.h"
 #include "vectorimage.h"
+#include "vectorstrokefinalizer.h"
 
 
 PencilTool::PencilTool(QObject* parent) : StrokeTool(parent)
@@ -290,36 +291,32 @@ void PencilTool::paintVectorStroke(Layer* layer)
     if (mStrokePoints.empty())
         return;
 
-    // Clear the temporary pixel path
-    mScribbleArea->clearDrawingBuffer();
-    qreal tol = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
-
-    BezierCurve curve(mStrokePoints, mStrokePressures, tol);
-    curve.setWidth(0);
-    curve.setFeather(0);
-    curve.setFilled(false);
-    curve.setInvisibility(true);
-    curve.setVariableWidth(false);
-    curve.setColorNumber(mEditor->color()->frontColorNumber());
     VectorImage* vectorImage = static_cast<LayerVector*>(layer)->getLastVectorImageAtFrame(mEditor->currentFrame(), 0);
-    if (vectorImage == nullptr) { return; } // Can happen if the first frame is deleted while drawing
-    vectorImage->addCurve(curve, qAbs(mEditor->view()->scaling()), properties.vectorMergeEnabled);
-
-    if (properties.useFillContour)
-    {
-        vectorImage->fillContour(mStrokePoints,
-                                 mEditor->color()->frontColorNumber());
-    }
-
-    if (vectorImage->isAnyCurveSelected() || mEditor->select()->somethingSelected())
+    if (vectorImage == nullptr) // Can happen if the first frame is deleted while drawing
     {
-        mEditor->deselectAll();
+        mScribbleArea->clearDrawingBuffer();
+        return;
     }
 
-    // select last/newest curve
-    vectorImage->setSelected(vectorImage->getLastCurveNumber(), true);
-
+    // The temporary pixel path stays on screen until the stroke has been finalized
+    VectorStroke stroke;
+    stroke.layerId = layer->id();
+    stroke.frame = mEditor->currentFrame();
+    stroke.keyFrame = vectorImage;
+    stroke.points = mStrokePoints;
+    stroke.pressures = mStrokePressures;
+    stroke.tolerance = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
+    stroke.width = 0;
+    stroke.feather = 0;
+    stroke.invisible = true;
+    stroke.variableWidth = false;
+    stroke.colorNumber = mEditor->color()->frontColorNumber();
+    stroke.selectionFactor = qAbs(mEditor->view()->scaling());
+    stroke.interacts = properties.vectorMergeEnabled;
+    stroke.fillContour = properties.useFillContour;
+
+    // The undo step is recorded once the stroke is committed, the newest curve gets selected then
     // TODO: selection doesn't apply on enter
-
-    mEditor->setModified(mEditor->layers()->currentLayerIndex(), mEditor->currentFrame());
+    mEditor->vectorStrokes()->submit(stroke, mUndoSaveState, typeName());
+    mUndoSaveState = nullptr;
 }
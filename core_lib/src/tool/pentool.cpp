@@ -30,6 +30,7 @@ GNU General Public License for more details.
 #include "scribblearea.h"
 #include "blitrect.h"
 #include "pointerevent.h"
+#include "vectorstrokefinalizer.h"
 
 
 PenTool::PenTool(QObject* parent) : StrokeTool(parent)
@@ -259,29 +260,30 @@ void PenTool::paintVectorStroke(Layer* layer)
     if (mStrokePoints.empty())
         return;
 
-    // Clear the temporary pixel path
-    mScribbleArea->clearDrawingBuffer();
-    qreal tol = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
-
-    BezierCurve curve(mStrokePoints, mStrokePressures, tol);
-    curve.setWidth(properties.width);
-    curve.setFeather(properties.feather);
-    curve.setFilled(false);
-    curve.setInvisibility(properties.invisibility);
-    curve.setVariableWidth(properties.pressure);
-    curve.setColorNumber(mEditor->color()->frontColorNumber());
-
     auto pLayerVector = static_cast<LayerVector*>(layer);
     VectorImage* vectorImage = pLayerVector->getLastVectorImageAtFrame(mEditor->currentFrame(), 0);
-    if (vectorImage == nullptr) { return; } // Can happen if the first frame is deleted while drawing
-    vectorImage->addCurve(curve, mEditor->view()->scaling(), false);
-
-    if (vectorImage->isAnyCurveSelected() || mEditor->select()->somethingSelected())
+    if (vectorImage == nullptr) // Can happen if the first frame is deleted while drawing
     {
-        mEditor->deselectAll();
+        mScribbleArea->clearDrawingBuffer();
+        return;
     }
 
-    vectorImage->setSelected(vectorImage->getLastCurveNumber(), true);
-
-    mEditor->setModified(mEditor->layers()->currentLayerIndex(), mEditor->currentFrame());
+    // The temporary pixel path stays on screen until the stroke has been finalized
+    VectorStroke stroke;
+    stroke.layerId = layer->id();
+    stroke.frame = mEditor->currentFrame();
+    stroke.keyFrame = vectorImage;
+    stroke.points = mStrokePoints;
+    stroke.pressures = mStrokePressures;
+    stroke.tolerance = mScribbleArea->getCurveSmoothing() / mEditor->view()->scaling();
+    stroke.width = properties.width;
+    stroke.feather = properties.feather;
+    stroke.invisible = properties.invisibility;
+    stroke.variableWidth = properties.pressure;
+    stroke.colorNumber = mEditor->color()->frontColorNumber();
+    stroke.selectionFactor = mEditor->view()->scaling();
+
+    // The undo step is recorded once the stroke is committed
+    mEditor->vectorStrokes()->submit(stroke, mUndoSaveState, typeName());
+    mUndoSaveState = nullptr;
 }
@@ -0,0 +1,285 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "vectorstrokefinalizer.h"
+
+#include <QMutex>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include "editor.h"
+#include "object.h"
+#include "layer.h"
+#include "vectorimage.h"
+#include "selectionmanager.h"
+#include "undoredomanager.h"
+
+struct VectorStrokeFinalizer::Job
+{
+    ~Job() { delete undoState; }
+
+    int requestId = 0;
+    VectorStroke stroke;
+    const UndoSaveState* undoState = nullptr;
+    QString undoText;
+
+    int baseVersion = 0;                // the version of the keyframe the snapshot was taken from
+    std::unique_ptr<VectorImage> image; // the snapshot, with the stroke once finalized
+
+    QMutex mutex;
+    QWaitCondition finalized;
+    bool done = false;
+};
+
+class VectorStrokeFinalizer::FinalizeTask : public QRunnable
+{
+public:
+    VectorStrokeFinalizer* finalizer = nullptr;
+    std::shared_ptr<Job> job;
+
+    void run() override
+    {
+        VectorStrokeFinalizer::finalize(*job->image, job->stroke);
+
+        {
+            QMutexLocker locker(&job->mutex);
+            job->done = true;
+            job->finalized.wakeAll();
+        }
+        emit finalizer->strokeFinalized(job->requestId);
+    }
+};
+
+VectorStrokeFinalizer::VectorStrokeFinalizer(Editor* editor) : QObject(editor), mEditor(editor)
+{
+    // One stroke at a time, each one is merged into the result of the previous one
+    mThreadPool.setMaxThreadCount(1);
+
+    connect(this, &VectorStrokeFinalizer::strokeFinalized,
+            this, &VectorStrokeFinalizer::onStrokeFinalized, Qt::QueuedConnection);
+}
+
+VectorStrokeFinalizer::~VectorStrokeFinalizer()
+{
+    mThreadPool.clear();
+    mThreadPool.waitForDone();
+
+    if (mCurrent)
+    {
+        stopListening(mCurrent->stroke.keyFrame);
+    }
+    for (const std::shared_ptr<Job>& job : mQueue)
+    {
+        stopListening(job->stroke.keyFrame);
+    }
+}
+
+void VectorStrokeFinalizer::submit(const VectorStroke& stroke, const UndoSaveState* undoState, const QString& undoText)
+{
+    if (stroke.keyFrame == nullptr || stroke.points.isEmpty())
+    {
+        delete undoState;
+        return;
+    }
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->requestId = ++mNextRequestId;
+    job->stroke = stroke;
+    job->undoState = undoState;
+    job->undoText = undoText;
+
+    stroke.keyFrame->addEventListener(this);
+    mQueue.enqueue(job);
+    startNext();
+}
+
+void VectorStrokeFinalizer::finish()
+{
+    if (mCurrent)
+    {
+        std::shared_ptr<Job> job = mCurrent;
+        {
+            QMutexLocker locker(&job->mutex);
+            while (!job->done)
+            {
+                job->finalized.wait(&job->mutex);
+            }
+        }
+        mCurrent.reset();
+        commit(*job);
+    }
+
+    // The queued strokes are finalized in place, no need for a snapshot
+    while (!mQueue.isEmpty())
+    {
+        std::shared_ptr<Job> job = mQueue.dequeue();
+        commit(*job);
+    }
+}
+
+bool VectorStrokeFinalizer::hasPendingStrokes(const KeyFrame* keyFrame) const
+{
+    if (keyFrame == nullptr) { return false; }
+
+    if (mCurrent && mCurrent->stroke.keyFrame == keyFrame) { return true; }
+    for (const std::shared_ptr<Job>& job : mQueue)
+    {
+        if (job->stroke.keyFrame == keyFrame) { return true; }
+    }
+    return false;
+}
+
+void VectorStrokeFinalizer::onKeyFrameDestroy(KeyFrame* keyFrame)
+{
+    // The listener list of the keyframe is being walked, it must be left alone here
+    if (mCurrent && mCurrent->stroke.keyFrame == keyFrame)
+    {
+        // The worker keeps its own reference to the job, its result is dropped
+        mCurrent.reset();
+    }
+    for (int i = mQueue.size() - 1; i >= 0; i--)
+    {
+        if (mQueue.at(i)->stroke.keyFrame == keyFrame)
+        {
+            mQueue.removeAt(i);
+        }
+    }
+    startNext();
+}
+
+void VectorStrokeFinalizer::finalize(VectorImage& image, const VectorStroke& stroke)
+{
+    BezierCurve curve(stroke.points, stroke.pressures, stroke.tolerance);
+    curve.setWidth(stroke.width);
+    curve.setFeather(stroke.feather);
+    curve.setFilled(false);
+    curve.setInvisibility(stroke.invisible);
+    curve.setVariableWidth(stroke.variableWidth);
+    curve.setColorNumber(stroke.colorNumber);
+
+    image.addCurve(curve, stroke.selectionFactor, stroke.interacts);
+
+    if (stroke.fillContour)
+    {
+        image.fillContour(image.getLastCurveNumber(), stroke.colorNumber);
+    }
+}
+
+const UndoSaveState* VectorStrokeFinalizer::undoStateBefore(const UndoSaveState& drawnState, const VectorImage& keyFrame)
+{
+    UndoSaveState* state = new UndoSaveState;
+    state->layerId = drawnState.layerId;
+    state->layerType = drawnState.layerType;
+    state->recordType = drawnState.recordType;
+    if (drawnState.keyframe)
+    {
+        state->keyframe.reset(keyFrame.clone());
+    }
+    if (drawnState.selectionState)
+    {
+        state->selectionState.reset(new SelectionSaveState(*drawnState.selectionState));
+    }
+    return state;
+}
+
+void VectorStrokeFinalizer::onStrokeFinalized(int requestId)
+{
+    if (!mCurrent || mCurrent->requestId != requestId)
+    {
+        // Committed by finish() already, or its keyframe is gone
+        return;
+    }
+
+    std::shared_ptr<Job> job = mCurrent;
+    mCurrent.reset();
+    commit(*job);
+    startNext();
+}
+
+void VectorStrokeFinalizer::startNext()
+{
+    if (mCurrent || mQueue.isEmpty()) { return; }
+
+    mCurrent = mQueue.dequeue();
+    VectorImage* keyFrame = mCurrent->stroke.keyFrame;
+    mCurrent->baseVersion = keyFrame->version();
+    mCurrent->image.reset(keyFrame->snapshot());
+
+    FinalizeTask* task = new FinalizeTask;
+    task->finalizer = this;
+    task->job = mCurrent;
+    mThreadPool.start(task);
+}
+
+void VectorStrokeFinalizer::commit(Job& job)
+{
+    VectorImage* keyFrame = job.stroke.keyFrame;
+
+    // The strokes before this one were committed after it was drawn, its undo step begins with them
+    const UndoSaveState* undoState = nullptr;
+    if (job.undoState)
+    {
+        undoState = undoStateBefore(*job.undoState, *keyFrame);
+    }
+
+    if (job.image && job.done && keyFrame->version() == job.baseVersion)
+    {
+        keyFrame->replaceDrawing(*job.image);
+    }
+    else
+    {
+        // Not started yet, or the keyframe has been changed since the snapshot was taken
+        finalize(*keyFrame, job.stroke);
+    }
+    job.image.reset();
+
+    // Like drawing used to do right away, the new curve becomes the selection
+    if (keyFrame->isAnyCurveSelected() || mEditor->select()->somethingSelected())
+    {
+        mEditor->deselectAll();
+    }
+    keyFrame->setSelected(keyFrame->getLastCurveNumber(), true);
+
+    Object* object = mEditor->object();
+    for (int i = 0; i < object->getLayerCount(); i++)
+    {
+        if (object->getLayer(i)->id() == job.stroke.layerId)
+        {
+            mEditor->setModified(i, job.stroke.frame);
+            break;
+        }
+    }
+
+    if (undoState)
+    {
+        // Taken over unless the legacy undo system is on, which has backed up the keyframe already
+        mEditor->undoRedo()->record(undoState, job.undoText);
+        delete undoState;
+    }
+
+    stopListening(keyFrame);
+    emit strokeCommitted(job.stroke.layerId, job.stroke.frame);
+}
+
+void VectorStrokeFinalizer::stopListening(VectorImage* keyFrame)
+{
+    if (mCurrent && mCurrent->stroke.keyFrame == keyFrame) { return; }
+    for (const std::shared_ptr<Job>& job : mQueue)
+    {
+        if (job->stroke.keyFrame == keyFrame) { return; }
+    }
+    keyFrame->removeEventListner(this);
+}
@@ -0,0 +1,119 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef VECTORSTROKEFINALIZER_H
+#define VECTORSTROKEFINALIZER_H
+
+#include <memory>
+#include <QObject>
+#include <QList>
+#include <QPointF>
+#include <QQueue>
+#include <QThreadPool>
+#include "keyframe.h"
+
+class Editor;
+class VectorImage;
+struct UndoSaveState;
+
+/** A vector stroke as drawn by the user, before it's fitted and added to its keyframe */
+struct VectorStroke
+{
+    int layerId = 0;
+    int frame = 0;
+    VectorImage* keyFrame = nullptr;
+
+    QList<QPointF> points;
+    QList<qreal> pressures;
+    qreal tolerance = 0;       // how far the fitted curve may be from the points
+
+    qreal width = 0;
+    qreal feather = 0;
+    bool invisible = false;
+    bool variableWidth = false;
+    int colorNumber = 0;
+
+    qreal selectionFactor = 1; // see VectorImage::addCurve()
+    bool interacts = false;
+    bool fillContour = false;
+};
+
+/**
+ * VectorStrokeFinalizer fits finished vector strokes and merges them into their keyframe on a worker thread.
+ *
+ * Fitting a stroke and intersecting it with every curve of a dense frame can take long enough to delay
+ * the next input events. A submitted stroke is worked on against a snapshot of its keyframe, and the
+ * result replaces the drawing of the keyframe in one go back on the UI thread. If the keyframe has been
+ * changed in the meantime, the fitted curve is added to it there instead.
+ *
+ * Strokes are finalized one at a time in the order they were submitted, so that each one sees the
+ * strokes before it. The raw stroke stays in the drawing buffer of the canvas until the queue is empty.
+ *
+ * finish() commits the remaining strokes right away. The editor calls it before anything else
+ * reads or records the keyframes, e.g. undo backups, frame and layer changes and saving.
+ */
+class VectorStrokeFinalizer : public QObject, public KeyFrameEventListener
+{
+    Q_OBJECT
+public:
+    explicit VectorStrokeFinalizer(Editor* editor);
+    ~VectorStrokeFinalizer() override;
+
+    /** Queues the stroke. The undo state, if any, is recorded once the stroke has been committed. */
+    void submit(const VectorStroke& stroke, const UndoSaveState* undoState, const QString& undoText);
+
+    /** Waits for the stroke being worked on and commits all the queued ones */
+    void finish();
+
+    bool hasPendingStrokes() const { return mCurrent || !mQueue.isEmpty(); }
+    /** Whether strokes are still to be added to the keyframe */
+    bool hasPendingStrokes(const KeyFrame* keyFrame) const;
+
+    void onKeyFrameDestroy(KeyFrame* keyFrame) override;
+
+    /** Fits the stroke and adds it to the image, the work done for every stroke */
+    static void finalize(VectorImage& image, const VectorStroke& stroke);
+
+    /** The undo state of a stroke as it is recorded, with the keyframe as it is right before the stroke is added.
+     *  The state taken when the stroke was drawn misses the strokes committed since. */
+    static const UndoSaveState* undoStateBefore(const UndoSaveState& drawnState, const VectorImage& keyFrame);
+
+signals:
+    /** A stroke has been added to its keyframe */
+    void strokeCommitted(int layerId, int frame);
+
+    /** Emitted from the worker thread, delivered to onStrokeFinalized() on the owner thread */
+    void strokeFinalized(int requestId);
+
+private slots:
+    void onStrokeFinalized(int requestId);
+
+private:
+    struct Job;
+    class FinalizeTask;
+
+    void startNext();
+    void commit(Job& job);
+    void stopListening(VectorImage* keyFrame);
+
+    Editor* mEditor = nullptr;
+    QQueue<std::shared_ptr<Job>> mQueue;
+    std::shared_ptr<Job> mCurrent;
+    QThreadPool mThreadPool;
+    int mNextRequestId = 0;
+};
+
+#endif // VECTORSTROKEFINALIZER_H
@@ -0,0 +1,74 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "framerangeset.h"
+
+bool FrameRangeSet::contains(int position) const
+{
+    auto it = mRanges.upper_bound(position);
+    if (it == mRanges.begin()) { return false; }
+    --it;
+    return position <= it->second;
+}
+
+void FrameRangeSet::insert(int first, int last)
+{
+    if (last < first) { std::swap(first, last); }
+
+    // Merge with a range that overlaps or touches the new one from the left
+    auto it = mRanges.upper_bound(first);
+    if (it != mRanges.begin())
+    {
+        auto previous = std::prev(it);
+        if (previous->second >= first - 1)
+        {
+            if (previous->second >= last) { return; }
+            first = previous->first;
+            it = previous;
+        }
+    }
+
+    // Swallow all the ranges that start within or right after the new one
+    while (it != mRanges.end() && it->first <= last + 1)
+    {
+        last = qMax(last, it->second);
+        it = mRanges.erase(it);
+    }
+    mRanges.emplace_hint(it, first, last);
+}
+
+QList<int> FrameRangeSet::positions() const
+{
+    QList<int> result;
+    for (const auto& range : mRanges)
+    {
+        for (int position = range.first; position <= range.second; position++)
+        {
+            result.append(position);
+        }
+    }
+    return result;
+}
+
+QList<std::pair<int, int>> FrameRangeSet::ranges() const
+{
+    QList<std::pair<int, int>> result;
+    for (const auto& range : mRanges)
+    {
+        result.append(range);
+    }
+    return result;
+}
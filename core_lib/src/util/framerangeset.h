@@ -0,0 +1,47 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef FRAMERANGESET_H
+#define FRAMERANGESET_H
+
+#include <map>
+#include <QList>
+
+/**
+ * A set of frame positions, stored as ordered ranges that never overlap or touch.
+ * Marking the same frames many times costs no extra memory.
+ */
+class FrameRangeSet
+{
+public:
+    bool isEmpty() const { return mRanges.empty(); }
+    bool contains(int position) const;
+
+    void insert(int position) { insert(position, position); }
+    /** Inserts all the positions from first to last, inclusive */
+    void insert(int first, int last);
+    void clear() { mRanges.clear(); }
+
+    /** Every position in the set once, lowest first */
+    QList<int> positions() const;
+    /** The ranges as (first, last) pairs, lowest first */
+    QList<std::pair<int, int>> ranges() const;
+
+private:
+    std::map<int, int> mRanges; // first -> last
+};
+
+#endif // FRAMERANGESET_H
@@ -263,6 +263,7 @@ const static int MaxFramesBound = 9999;
 #define SETTING_TIMELINE_SIZE       "TimelineSize"
 #define SETTING_LABEL_FONT_SIZE     "LabelFontSize"
 #define SETTING_DRAW_LABEL          "DrawLabel"
+#define SETTING_TIMELINE_THUMBNAILS "TimelineThumbnails"
 #define SETTING_QUICK_SIZING        "QuickSizing"
 #define SETTING_LAYOUT_LOCK         "LayoutLock"
 #define SETTING_ROTATION_INCREMENT  "RotationIncrement"
@@ -91,6 +91,7 @@ enum class SETTING
     LOAD_MOST_RECENT,
     LOAD_DEFAULT_PRESET,
     DEFAULT_PRESET,
+    TIMELINE_THUMBNAILS,
     COUNT, // COUNT must always be the last one.
 };
 
@@ -0,0 +1,246 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "profiler.h"
+
+#include <atomic>
+#include <vector>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+#include "pencilerror.h"
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        qint64 start;
+        qint64 duration;
+        quintptr thread;
+    };
+
+    // Enough for a few minutes of drawing, older timings are overwritten
+    const size_t MAX_TRACE_EVENTS = 1 << 16;
+
+    struct ProfilerState
+    {
+        ProfilerState()
+        {
+            clock.start();
+            for (std::atomic<qint64>& counter : counters)
+            {
+                counter = 0;
+            }
+        }
+
+        std::atomic<bool> enabled { false };
+        std::atomic<qint64> counters[Profiler::COUNTER_COUNT];
+        QElapsedTimer clock;
+
+        QMutex mutex;
+        std::vector<TraceEvent> events;
+        size_t nextEvent = 0;
+        QHash<QByteArray, qint64> lastDurations;
+    };
+
+    ProfilerState& state()
+    {
+        static ProfilerState profilerState;
+        return profilerState;
+    }
+}
+
+bool Profiler::isEnabled()
+{
+    return state().enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    state().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::clear()
+{
+    ProfilerState& s = state();
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        // The resident bytes are a level rather than a tally, resetting them would make them wrong
+        if (i != FRAME_POOL_BYTES)
+        {
+            s.counters[i] = 0;
+        }
+    }
+
+    QMutexLocker locker(&s.mutex);
+    s.events.clear();
+    s.nextEvent = 0;
+    s.lastDurations.clear();
+}
+
+qint64 Profiler::now()
+{
+    return state().clock.nsecsElapsed();
+}
+
+void Profiler::record(const char* name, qint64 startNs, qint64 durationNs)
+{
+    const TraceEvent event { name, startNs, durationNs, reinterpret_cast<quintptr>(QThread::currentThreadId()) };
+
+    ProfilerState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (s.events.size() < MAX_TRACE_EVENTS)
+    {
+        s.events.push_back(event);
+    }
+    else
+    {
+        s.events[s.nextEvent] = event;
+    }
+    s.nextEvent = (s.nextEvent + 1) % MAX_TRACE_EVENTS;
+
+    // The name is a string literal, so there's no need to copy it
+    s.lastDurations[QByteArray::fromRawData(name, static_cast<int>(qstrlen(name)))] = durationNs;
+}
+
+bool Profiler::hasEvents()
+{
+    ProfilerState& s = state();
+    QMutexLocker locker(&s.mutex);
+    return !s.events.empty();
+}
+
+qint64 Profiler::lastDuration(const char* name)
+{
+    ProfilerState& s = state();
+    QMutexLocker locker(&s.mutex);
+    return s.lastDurations.value(QByteArray::fromRawData(name, static_cast<int>(qstrlen(name))), -1);
+}
+
+void Profiler::addToCounter(Counter counter, qint64 delta)
+{
+    state().counters[counter].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void Profiler::setCounter(Counter counter, qint64 value)
+{
+    state().counters[counter].store(value, std::memory_order_relaxed);
+}
+
+qint64 Profiler::counter(Counter counter)
+{
+    return state().counters[counter].load(std::memory_order_relaxed);
+}
+
+const char* Profiler::counterName(Counter counter)
+{
+    switch (counter)
+    {
+    case FRAME_POOL_HITS: return "Frame pool hits";
+    case FRAME_POOL_MISSES: return "Frame pool misses";
+    case FRAME_POOL_EVICTIONS: return "Frame pool evictions";
+    case FRAME_POOL_BYTES: return "Frame pool bytes";
+    case CANVAS_CACHE_HITS: return "Canvas cache hits";
+    case CANVAS_CACHE_MISSES: return "Canvas cache misses";
+    case COUNTER_COUNT: break;
+    }
+    return "";
+}
+
+Status Profiler::exportChromeTrace(const QString& filePath)
+{
+    std::vector<TraceEvent> events;
+    {
+        ProfilerState& s = state();
+        QMutexLocker locker(&s.mutex);
+
+        // Oldest first, once the ring buffer has wrapped around the oldest one is the next to be overwritten
+        events.reserve(s.events.size());
+        const size_t first = (s.events.size() < MAX_TRACE_EVENTS) ? 0 : s.nextEvent;
+        for (size_t i = 0; i < s.events.size(); i++)
+        {
+            events.push_back(s.events[(first + i) % s.events.size()]);
+        }
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    QHash<quintptr, int> threadIndexes;
+    for (const TraceEvent& event : events)
+    {
+        auto it = threadIndexes.find(event.thread);
+        if (it == threadIndexes.end())
+        {
+            it = threadIndexes.insert(event.thread, threadIndexes.size() + 1);
+
+            QJsonObject threadName;
+            threadName["name"] = "thread_name";
+            threadName["ph"] = "M";
+            threadName["pid"] = pid;
+            threadName["tid"] = it.value();
+            threadName["args"] = QJsonObject { { "name", QString("Thread %1").arg(it.value()) } };
+            traceEvents.append(threadName);
+        }
+
+        // Trace timestamps are in microseconds
+        QJsonObject traceEvent;
+        traceEvent["name"] = QString::fromLatin1(event.name);
+        traceEvent["cat"] = "pencil2d";
+        traceEvent["ph"] = "X";
+        traceEvent["ts"] = event.start / 1000.0;
+        traceEvent["dur"] = event.duration / 1000.0;
+        traceEvent["pid"] = pid;
+        traceEvent["tid"] = it.value();
+        traceEvents.append(traceEvent);
+    }
+
+    const double timestamp = (events.empty() ? now() : events.back().start + events.back().duration) / 1000.0;
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        const Counter c = static_cast<Counter>(i);
+
+        QJsonObject counterEvent;
+        counterEvent["name"] = QString::fromLatin1(counterName(c));
+        counterEvent["ph"] = "C";
+        counterEvent["ts"] = timestamp;
+        counterEvent["pid"] = pid;
+        counterEvent["args"] = QJsonObject { { "value", counter(c) } };
+        traceEvents.append(counterEvent);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(filePath);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return Status(Status::ERROR_FILE_CANNOT_OPEN, QCoreApplication::translate("Profiler", "Could not open %1 for writing.").arg(filePath));
+    }
+    if (file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0)
+    {
+        return Status(Status::FAIL, QCoreApplication::translate("Profiler", "Could not write the trace to %1.").arg(filePath));
+    }
+    return Status::OK;
+}
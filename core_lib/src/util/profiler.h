@@ -0,0 +1,112 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QtGlobal>
+
+class QString;
+class Status;
+
+/**
+ * Profiler collects timings of the hot paths and a handful of counters, so a slow scene
+ * can be looked into without rebuilding Pencil2D.
+ *
+ * It is off by default. While off, a PROFILE_SCOPE costs a single atomic load.
+ * While on, the most recent timings are kept in a bounded ring buffer, which can be
+ * exported as a Chrome trace and opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * The counters are kept even while it is off, they only cost an atomic add.
+ *
+ * Everything here can be called from any thread.
+ */
+class Profiler
+{
+public:
+    enum Counter
+    {
+        FRAME_POOL_HITS,
+        FRAME_POOL_MISSES,
+        FRAME_POOL_EVICTIONS,
+        FRAME_POOL_BYTES,
+        CANVAS_CACHE_HITS,
+        CANVAS_CACHE_MISSES,
+        COUNTER_COUNT // must always be the last one
+    };
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    /** Drops the recorded timings and resets the counters, apart from the resident bytes */
+    static void clear();
+
+    /** Time since the profiler was first used, in nanoseconds */
+    static qint64 now();
+
+    /** Records a timing, the name must outlive the profiler (a string literal) */
+    static void record(const char* name, qint64 startNs, qint64 durationNs);
+
+    /** Whether any timing has been recorded since the last clear, the profiler may have been turned off since */
+    static bool hasEvents();
+
+    /** The duration of the latest recorded scope with the given name, in nanoseconds, or -1 */
+    static qint64 lastDuration(const char* name);
+
+    static void addToCounter(Counter counter, qint64 delta);
+    static void setCounter(Counter counter, qint64 value);
+    static qint64 counter(Counter counter);
+    static const char* counterName(Counter counter);
+
+    /** Writes the recorded timings and the current counters in the Chrome trace event format */
+    static Status exportChromeTrace(const QString& filePath);
+};
+
+/** Records how long the enclosing scope takes, while the profiler is enabled */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name)
+    {
+        if (Profiler::isEnabled())
+        {
+            mName = name;
+            mStart = Profiler::now();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (mName != nullptr)
+        {
+            Profiler::record(mName, mStart, Profiler::now() - mStart);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(ProfileScope)
+
+    const char* mName = nullptr;
+    qint64 mStart = 0;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+/** Times the rest of the enclosing scope under the given name */
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include <QDir>
 #include <QFileInfo>
 #include <QStandardPaths>
+#include <QXmlStreamReader>
 
 static inline bool clipLineToEdge(qreal& t0, qreal& t1, qreal p, qreal q)
 {
@@ -176,3 +177,30 @@ QString validateDataPath(QString filePath, QString dataDirPath)
         return QString();
     }
 }
+
+QString xmlAttribute(const QXmlStreamAttributes& attributes, const QString& name, const QString& defaultValue)
+{
+    if (!attributes.hasAttribute(name))
+    {
+        return defaultValue;
+    }
+    return attributes.value(name).toString();
+}
+
+QString readXmlDocType(QXmlStreamReader& reader)
+{
+    QString docType;
+    while (!reader.atEnd() && reader.readNext() != QXmlStreamReader::StartElement)
+    {
+        if (reader.tokenType() == QXmlStreamReader::DTD)
+        {
+            docType = reader.dtdName().toString();
+        }
+    }
+    return docType;
+}
+
+QString xmlNumber(qreal value)
+{
+    return QString::number(value, 'g', 16);
+}
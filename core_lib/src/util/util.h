@@ -26,6 +26,8 @@ class QLineF;
 class QRect;
 class QImage;
 class QString;
+class QXmlStreamAttributes;
+class QXmlStreamReader;
 
 /**
  * Clips a given line to a clipping window using the Liang-Barsky algorithm.
@@ -112,4 +114,11 @@ QString closestCanonicalPath(QString path);
  */
 QString validateDataPath(QString filePath, QString dataDirPath);
 
+/** Returns the value of an XML attribute, or defaultValue if the attribute is missing, like QDomElement::attribute */
+QString xmlAttribute(const QXmlStreamAttributes& attributes, const QString& name, const QString& defaultValue = QString());
+/** Reads up to the root element of an XML document and returns the name of its doctype */
+QString readXmlDocType(QXmlStreamReader& reader);
+/** Formats a number for an XML attribute with the precision QDomElement::setAttribute used for it */
+QString xmlNumber(qreal value);
+
 #endif // UTIL_H
@@ -22,5 +22,15 @@ NO_TESTS {
   SUBDIRS -= tests
 }
 
+# Benchmarks and the stress project generator are only built on request: qmake CONFIG+=BENCHMARKS
+BENCHMARKS {
+  SUBDIRS += bench
+  bench.subdir = tests/bench
+  bench.depends = core_lib
+  SUBDIRS += stressgen
+  stressgen.subdir = tests/stressgen
+  stressgen.depends = core_lib
+}
+
 TRANSLATIONS += $$PWD/translations/pencil.ts
 
@@ -0,0 +1,67 @@
+#-------------------------------------------------
+#
+# Benchmarks of Pencil2D
+#
+# Run headless with machine-readable results, e.g.
+#   ./bench -r xml -o results.xml
+#
+#-------------------------------------------------
+
+! include( ../../util/common.pri ) { error( Could not find the common.pri file! ) }
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+QT += core widgets gui xml multimedia svg
+
+TARGET = bench
+
+DEFINES += CATCH_CONFIG_ENABLE_BENCHMARKING
+
+INCLUDEPATH += \
+    ../src \
+    ../../core_lib/src \
+    ../../core_lib/src/graphics \
+    ../../core_lib/src/graphics/bitmap \
+    ../../core_lib/src/graphics/vector \
+    ../../core_lib/src/interface \
+    ../../core_lib/src/structure \
+    ../../core_lib/src/tool \
+    ../../core_lib/src/util \
+    ../../core_lib/ui \
+    ../../core_lib/src/managers
+
+HEADERS += \
+    ../src/catch.hpp \
+    src/benchmark.h \
+    src/syntheticproject.h
+
+SOURCES += \
+    src/main.cpp \
+    src/syntheticproject.cpp \
+    src/bench_bitmap.cpp \
+    src/bench_canvas.cpp \
+    src/bench_vector.cpp \
+    src/bench_file.cpp
+
+# --- core_lib ---
+
+BUILDTYPE =
+debug_and_release:CONFIG(debug,debug|release) BUILDTYPE = debug
+debug_and_release:CONFIG(release,debug|release) BUILDTYPE = release
+
+win32-msvc* {
+    LIBS += -L$$OUT_PWD/../../core_lib/$$BUILDTYPE/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/$$BUILDTYPE/core_lib.lib
+}
+
+win32-g++ {
+    LIBS += -L$$OUT_PWD/../../core_lib/$$BUILDTYPE/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/$$BUILDTYPE/libcore_lib.a
+}
+
+# --- mac os and linux
+unix {
+    LIBS += -L$$OUT_PWD/../../core_lib/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/libcore_lib.a
+}
@@ -0,0 +1,108 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <memory>
+#include <QPainter>
+
+#include "bitmapimage.h"
+#include "tiledbuffer.h"
+#include "syntheticproject.h"
+
+TEST_CASE("Bitmap flood fill", "[bitmap][fill]")
+{
+    // A grid of closed cells, the fill has to find the borders of the one in the middle
+    BitmapImage lineArt(QRect(-512, -512, 1024, 1024), Qt::transparent);
+    const QPen pen(Qt::black, 3);
+    for (int i = -512; i <= 512; i += 128)
+    {
+        lineArt.drawLine(QPointF(i, -512), QPointF(i, 512), pen, QPainter::CompositionMode_SourceOver, false);
+        lineArt.drawLine(QPointF(-512, i), QPointF(512, i), pen, QPainter::CompositionMode_SourceOver, false);
+    }
+    const QRect fillRegion(-600, -600, 1200, 1200);
+
+    BENCHMARK("Closed cell")
+    {
+        BitmapImage* result = nullptr;
+        BitmapImage::floodFill(&result, &lineArt, fillRegion, QPoint(64, 64), qRgb(255, 0, 0), 32, 0);
+        std::unique_ptr<BitmapImage> filled(result);
+        return filled != nullptr;
+    };
+
+    BENCHMARK("Open area")
+    {
+        BitmapImage empty(QRect(-512, -512, 1024, 1024), Qt::transparent);
+        BitmapImage* result = nullptr;
+        BitmapImage::floodFill(&result, &empty, fillRegion, QPoint(0, 0), qRgb(255, 0, 0), 32, 0);
+        std::unique_ptr<BitmapImage> filled(result);
+        return filled != nullptr;
+    };
+
+    BENCHMARK("Closed cell with expansion")
+    {
+        BitmapImage* result = nullptr;
+        BitmapImage::floodFill(&result, &lineArt, fillRegion, QPoint(64, 64), qRgb(255, 0, 0), 32, 4);
+        std::unique_ptr<BitmapImage> filled(result);
+        return filled != nullptr;
+    };
+}
+
+TEST_CASE("Brush dabs", "[bitmap][brush]")
+{
+    SyntheticRandom random(7);
+    QList<QPointF> points;
+    for (int i = 0; i < 1000; i++)
+    {
+        points.append(random.nextPoint(QSize(1920, 1080)));
+    }
+
+    const QPen pen(Qt::NoPen);
+
+    BENCHMARK("1000 dabs of 8px")
+    {
+        TiledBuffer buffer;
+        for (const QPointF& point : points)
+        {
+            buffer.drawBrush(point, 8, pen, QBrush(Qt::black), QPainter::CompositionMode_SourceOver, true);
+        }
+        return buffer.bounds();
+    };
+
+    BENCHMARK("1000 dabs of 64px")
+    {
+        TiledBuffer buffer;
+        for (const QPointF& point : points)
+        {
+            buffer.drawBrush(point, 64, pen, QBrush(Qt::black), QPainter::CompositionMode_SourceOver, true);
+        }
+        return buffer.bounds();
+    };
+
+    BENCHMARK_ADVANCED("Paste a stroke onto a keyframe")(Catch::Benchmark::Chronometer meter)
+    {
+        TiledBuffer buffer;
+        for (const QPointF& point : points)
+        {
+            buffer.drawBrush(point, 16, pen, QBrush(Qt::black), QPainter::CompositionMode_SourceOver, true);
+        }
+
+        std::vector<BitmapImage> images(static_cast<size_t>(meter.runs()), BitmapImage(QRect(-960, -540, 1920, 1080), Qt::white));
+        meter.measure([&](int i)
+        {
+            images[static_cast<size_t>(i)].paste(&buffer, QPainter::CompositionMode_SourceOver);
+        });
+    };
+}
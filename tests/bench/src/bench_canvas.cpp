@@ -0,0 +1,101 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <memory>
+#include <QPainter>
+#include <QPixmap>
+
+#include "object.h"
+#include "canvaspainter.h"
+#include "tiledbuffer.h"
+#include "benchmark.h"
+
+TEST_CASE("Canvas composition", "[canvas]")
+{
+    const SyntheticProjectOptions& options = benchmarkProjectOptions();
+    std::unique_ptr<Object> object(createSyntheticProject(options));
+
+    QPixmap canvas(options.imageSize);
+    CanvasPainter painter(canvas);
+    painter.reset();
+
+    // The view is centered on the origin, where the drawings are
+    const QTransform view = QTransform::fromTranslate(options.imageSize.width() / 2.0, options.imageSize.height() / 2.0);
+    painter.setViewTransform(view, view.inverted());
+
+    CanvasPainterOptions painterOptions;
+    painterOptions.bAntiAlias = true;
+    painter.setOptions(painterOptions);
+
+    TiledBuffer tiledBuffer;
+    const QRect blitRect(QPoint(0, 0), options.imageSize);
+    const int currentLayer = object->getLayerCount() - 1;
+
+    BENCHMARK("Full frame")
+    {
+        painter.setPaintSettings(object.get(), currentLayer, 1, &tiledBuffer);
+        painter.paint(blitRect);
+        return canvas.cacheKey();
+    };
+
+    BENCHMARK("Full frame with onion skins")
+    {
+        OnionSkinPainterOptions onionSkinOptions;
+        onionSkinOptions.skinPrevFrames = true;
+        onionSkinOptions.skinNextFrames = true;
+        onionSkinOptions.framesToSkinPrev = 3;
+        onionSkinOptions.framesToSkinNext = 3;
+        painter.setOnionSkinOptions(onionSkinOptions);
+
+        painter.setPaintSettings(object.get(), currentLayer, qMax(1, options.keyFrames / 2), &tiledBuffer);
+        painter.paint(blitRect);
+        painter.setOnionSkinOptions(OnionSkinPainterOptions());
+        return canvas.cacheKey();
+    };
+
+    BENCHMARK("While drawing, other layers cached")
+    {
+        painter.setPaintSettings(object.get(), currentLayer, 1, &tiledBuffer);
+        painter.paintCached(blitRect);
+        return canvas.cacheKey();
+    };
+}
+
+TEST_CASE("Movie export frame rendering", "[export]")
+{
+    const SyntheticProjectOptions& options = benchmarkProjectOptions();
+    std::unique_ptr<Object> object(createSyntheticProject(options));
+
+    // Rendered the same way as MovieExporter does for every frame it hands to ffmpeg
+    QImage frame(options.imageSize, QImage::Format_ARGB32_Premultiplied);
+    const QTransform centralizeCamera = QTransform::fromTranslate(options.imageSize.width() / 2.0, options.imageSize.height() / 2.0);
+
+    BENCHMARK_ADVANCED("Every keyframe")(Catch::Benchmark::Chronometer meter)
+    {
+        meter.measure([&]
+        {
+            for (int k = 0; k < options.keyFrames; k++)
+            {
+                frame.fill(Qt::white);
+                QPainter painter(&frame);
+                painter.setWorldTransform(centralizeCamera);
+                object->paintImage(painter, 1 + k * options.keyFrameSpacing, false, true);
+            }
+            return frame.cacheKey();
+        });
+    };
+}
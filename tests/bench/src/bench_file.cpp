@@ -0,0 +1,49 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <memory>
+#include <QTemporaryDir>
+
+#include "object.h"
+#include "filemanager.h"
+#include "benchmark.h"
+
+TEST_CASE("Project save and load", "[file]")
+{
+    const SyntheticProjectOptions& options = benchmarkProjectOptions();
+    std::unique_ptr<Object> object(createSyntheticProject(options));
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath("bench.pclx");
+
+    BENCHMARK("Save")
+    {
+        FileManager fm;
+        return fm.save(object.get(), path).ok();
+    };
+
+    FileManager fm;
+    REQUIRE(fm.save(object.get(), path).ok());
+
+    BENCHMARK("Load")
+    {
+        FileManager loader;
+        std::unique_ptr<Object> loaded(loader.load(path));
+        return loaded != nullptr;
+    };
+}
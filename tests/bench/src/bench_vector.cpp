@@ -0,0 +1,161 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <limits>
+
+#include "beziercurve.h"
+#include "vectorimage.h"
+#include "syntheticproject.h"
+
+namespace
+{
+// The sampler findIntersection used before the subdivision solver, kept as a baseline:
+// each section is cut into 24 lines and every pair of lines is intersected
+void sampledIntersections(const BezierCurve& curve1, int i1, const BezierCurve& curve2, int i2, QList<Intersection>& intersections)
+{
+    const int nSteps = 24;
+    QPointF P1 = curve1.getVertex(i1 - 1);
+    for (int i = 1; i <= nSteps; i++)
+    {
+        const qreal s = qreal(i) / nSteps;
+        const QPointF Q1 = curve1.getPointOnCubic(i1, s);
+        QPointF P2 = curve2.getVertex(i2 - 1);
+        for (int j = 1; j <= nSteps; j++)
+        {
+            const qreal t = qreal(j) / nSteps;
+            const QPointF Q2 = curve2.getPointOnCubic(i2, t);
+            QPointF point;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+            if (QLineF(P2, Q2).intersects(QLineF(P1, Q1), &point) == QLineF::BoundedIntersection)
+#else
+            if (QLineF(P2, Q2).intersect(QLineF(P1, Q1), &point) == QLineF::BoundedIntersection)
+#endif
+            {
+                Intersection intersection;
+                intersection.point = point;
+                intersection.t1 = (i - BezierCurve::eLength(point - Q1) / BezierCurve::eLength(Q1 - P1)) / nSteps;
+                intersection.t2 = (j - BezierCurve::eLength(point - Q2) / BezierCurve::eLength(Q2 - P2)) / nSteps;
+                intersections.append(intersection);
+            }
+            P2 = Q2;
+        }
+        P1 = Q1;
+    }
+}
+}
+
+TEST_CASE("Vector curve intersection", "[vector]")
+{
+    SyntheticRandom random(11);
+    const QSize area(1024, 1024);
+
+    QList<BezierCurve> curves;
+    for (int i = 0; i < 32; i++)
+    {
+        curves.append(createSyntheticCurve(random, area, 24));
+    }
+
+    SECTION("Agrees with the sampler")
+    {
+        for (int a = 0; a < 8; a++)
+        {
+            for (int i = 0; i < curves[a].getVertexSize(); i++)
+            {
+                for (int j = 0; j < curves[a + 1].getVertexSize(); j++)
+                {
+                    QList<Intersection> solved;
+                    BezierCurve::findIntersection(curves[a], i, curves[a + 1], j, solved);
+                    for (const Intersection& intersection : solved)
+                    {
+                        const QPointF onCurve2 = curves[a + 1].getPointOnCubic(j, intersection.t2);
+                        REQUIRE(BezierCurve::eLength(intersection.point - onCurve2) < 1e-3);
+                    }
+
+                    // Every crossing of the sampled lines lies near a solved one, away from the section ends
+                    QList<Intersection> sampled;
+                    sampledIntersections(curves[a], i, curves[a + 1], j, sampled);
+                    for (const Intersection& intersection : sampled)
+                    {
+                        if (BezierCurve::eLength(intersection.point - curves[a].getVertex(i - 1)) < 1.0 ||
+                            BezierCurve::eLength(intersection.point - curves[a].getVertex(i)) < 1.0)
+                        {
+                            continue;
+                        }
+                        qreal nearest = std::numeric_limits<qreal>::max();
+                        for (const Intersection& other : solved)
+                        {
+                            nearest = qMin(nearest, BezierCurve::eLength(other.point - intersection.point));
+                        }
+                        CHECK(nearest < 1.0);
+                    }
+                }
+            }
+        }
+    }
+
+    BENCHMARK("All segment pairs of 32 curves, sampled")
+    {
+        int count = 0;
+        for (int a = 0; a < curves.size(); a++)
+        {
+            for (int b = a + 1; b < curves.size(); b++)
+            {
+                for (int i = 0; i < curves[a].getVertexSize(); i++)
+                {
+                    for (int j = 0; j < curves[b].getVertexSize(); j++)
+                    {
+                        QList<Intersection> intersections;
+                        sampledIntersections(curves[a], i, curves[b], j, intersections);
+                        count += intersections.size();
+                    }
+                }
+            }
+        }
+        return count;
+    };
+
+    BENCHMARK("All segment pairs of 32 curves")
+    {
+        int count = 0;
+        for (int a = 0; a < curves.size(); a++)
+        {
+            for (int b = a + 1; b < curves.size(); b++)
+            {
+                for (int i = 0; i < curves[a].getVertexSize(); i++)
+                {
+                    for (int j = 0; j < curves[b].getVertexSize(); j++)
+                    {
+                        QList<Intersection> intersections;
+                        BezierCurve::findIntersection(curves[a], i, curves[b], j, intersections);
+                        count += intersections.size();
+                    }
+                }
+            }
+        }
+        return count;
+    };
+
+    BENCHMARK("Add 32 interacting curves")
+    {
+        VectorImage image;
+        for (BezierCurve curve : curves)
+        {
+            image.addCurve(curve, 1.0, true);
+        }
+        return image.getCurveSize(0);
+    };
+}
@@ -0,0 +1,68 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#define CATCH_CONFIG_RUNNER
+#include "catch.hpp"
+
+#include <QApplication>
+
+#include "benchmark.h"
+
+namespace
+{
+    SyntheticProjectOptions gProjectOptions;
+}
+
+const SyntheticProjectOptions& benchmarkProjectOptions()
+{
+    return gProjectOptions;
+}
+
+int main(int argc, char* argv[])
+{
+    // The benchmarks never show a window, so they can run on build machines without a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication a(argc, argv);
+
+    Catch::Session session;
+
+    int width = gProjectOptions.imageSize.width();
+    int height = gProjectOptions.imageSize.height();
+
+    using namespace Catch::clara;
+    auto cli = session.cli()
+        | Opt(gProjectOptions.keyFrames, "count")["--keyframes"]("keyframes per generated layer")
+        | Opt(gProjectOptions.bitmapLayers, "count")["--bitmap-layers"]("generated bitmap layers")
+        | Opt(gProjectOptions.vectorLayers, "count")["--vector-layers"]("generated vector layers")
+        | Opt(gProjectOptions.strokesPerFrame, "count")["--strokes"]("shapes per bitmap keyframe")
+        | Opt(gProjectOptions.curvesPerFrame, "count")["--curves"]("curves per vector keyframe")
+        | Opt(width, "pixels")["--width"]("width of the generated drawings")
+        | Opt(height, "pixels")["--height"]("height of the generated drawings")
+        | Opt(gProjectOptions.seed, "seed")["--project-seed"]("seed of the generated content");
+    session.cli(cli);
+
+    int result = session.applyCommandLine(argc, argv);
+    if (result != 0)
+    {
+        return result;
+    }
+    gProjectOptions.imageSize = QSize(width, height);
+
+    return session.run();
+}
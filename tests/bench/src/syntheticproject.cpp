@@ -0,0 +1,204 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "syntheticproject.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QPainter>
+#include <QtMath>
+
+#include "object.h"
+#include "layerbitmap.h"
+#include "layervector.h"
+#include "layercamera.h"
+#include "layersound.h"
+#include "camera.h"
+#include "bitmapimage.h"
+#include "vectorimage.h"
+#include "beziercurve.h"
+
+quint32 SyntheticRandom::next()
+{
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    return mState;
+}
+
+int SyntheticRandom::nextInt(int low, int high)
+{
+    return low + static_cast<int>(next() % static_cast<quint32>(high - low + 1));
+}
+
+qreal SyntheticRandom::nextReal(qreal low, qreal high)
+{
+    return low + (high - low) * (next() / 4294967296.0);
+}
+
+QPointF SyntheticRandom::nextPoint(const QSize& area)
+{
+    // The canvas is centered on the origin, like the camera
+    return QPointF(nextReal(-area.width() / 2.0, area.width() / 2.0),
+                   nextReal(-area.height() / 2.0, area.height() / 2.0));
+}
+
+BezierCurve createSyntheticCurve(SyntheticRandom& random, const QSize& area, int pointCount)
+{
+    QList<QPointF> points;
+    QList<qreal> pressures;
+    QPointF point = random.nextPoint(area);
+    const qreal step = qMax(area.width(), area.height()) / 16.0;
+    for (int i = 0; i < pointCount; i++)
+    {
+        points.append(point);
+        pressures.append(random.nextReal(0.3, 1.0));
+        point += QPointF(random.nextReal(-step, step), random.nextReal(-step, step));
+    }
+
+    BezierCurve curve(points, pressures, 0.5);
+    curve.setWidth(random.nextReal(1.0, 4.0));
+    curve.setColorNumber(0);
+    curve.setVariableWidth(true);
+    return curve;
+}
+
+namespace
+{
+    void drawBitmapFrame(BitmapImage* image, SyntheticRandom& random, const SyntheticProjectOptions& options)
+    {
+        for (int i = 0; i < options.strokesPerFrame; i++)
+        {
+            const QColor color = QColor::fromHsv(random.nextInt(0, 359), random.nextInt(64, 255), random.nextInt(32, 255));
+            const QPen pen(color, random.nextReal(1.0, 8.0), Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+            const QPointF from = random.nextPoint(options.imageSize);
+
+            switch (i % 3)
+            {
+            case 0:
+                image->drawLine(from, random.nextPoint(options.imageSize), pen, QPainter::CompositionMode_SourceOver, true);
+                break;
+            case 1:
+            {
+                const QSizeF size(random.nextReal(8, options.imageSize.width() / 4.0), random.nextReal(8, options.imageSize.height() / 4.0));
+                image->drawEllipse(QRectF(from, size), pen, Qt::NoBrush, QPainter::CompositionMode_SourceOver, true);
+                break;
+            }
+            default:
+            {
+                const QSizeF size(random.nextReal(8, options.imageSize.width() / 6.0), random.nextReal(8, options.imageSize.height() / 6.0));
+                image->drawRect(QRectF(from, size), pen, QBrush(color), QPainter::CompositionMode_SourceOver, true);
+                break;
+            }
+            }
+        }
+    }
+
+    void drawVectorFrame(VectorImage* image, SyntheticRandom& random, const SyntheticProjectOptions& options)
+    {
+        for (int i = 0; i < options.curvesPerFrame; i++)
+        {
+            BezierCurve curve = createSyntheticCurve(random, options.imageSize);
+            image->addCurve(curve, 1.0, false);
+        }
+    }
+}
+
+bool writeSyntheticTone(const QString& filePath, int milliseconds, qreal frequency)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) { return false; }
+
+    const quint32 sampleRate = 44100;
+    const quint32 sampleCount = sampleRate * static_cast<quint32>(qMax(1, milliseconds)) / 1000;
+    const quint32 dataSize = sampleCount * 2;
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + dataSize);
+    out.writeRawData("WAVEfmt ", 8);
+    out << quint32(16) << quint16(1) << quint16(1) << sampleRate << quint32(sampleRate * 2) << quint16(2) << quint16(16);
+    out.writeRawData("data", 4);
+    out << dataSize;
+    for (quint32 i = 0; i < sampleCount; i++)
+    {
+        out << qint16(qRound(8000 * qSin(2 * M_PI * frequency * i / sampleRate)));
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+Object* createSyntheticProject(const SyntheticProjectOptions& options, const std::function<void(Object*, Layer*)>& layerGenerated)
+{
+    SyntheticRandom random(options.seed);
+
+    Object* object = new Object;
+    object->init();
+
+    const int spacing = qMax(1, options.keyFrameSpacing);
+    const int lastFrame = 1 + (qMax(1, options.keyFrames) - 1) * spacing;
+
+    LayerCamera* camera = object->addNewCameraLayer();
+    for (int k = 0; k < options.cameraKeys; k++)
+    {
+        // A slow pan and zoom over the whole animation
+        const int position = 1 + (options.cameraKeys > 1 ? k * (lastFrame - 1) / (options.cameraKeys - 1) : 0);
+        if (!camera->keyExists(position)) { camera->addNewKeyFrameAt(position); }
+        Camera* cam = camera->getCameraAtFrame(position);
+        cam->translate(random.nextPoint(options.imageSize / 8));
+        cam->scale(random.nextReal(0.8, 1.25));
+    }
+    if (layerGenerated) { layerGenerated(object, camera); }
+    for (int l = 0; l < options.bitmapLayers; l++)
+    {
+        LayerBitmap* layer = object->addNewBitmapLayer();
+        for (int k = 0; k < options.keyFrames; k++)
+        {
+            const int position = 1 + k * spacing;
+            if (!layer->keyExists(position)) { layer->addNewKeyFrameAt(position); }
+            drawBitmapFrame(layer->getBitmapImageAtFrame(position), random, options);
+        }
+        if (layerGenerated) { layerGenerated(object, layer); }
+    }
+
+    for (int l = 0; l < options.vectorLayers; l++)
+    {
+        LayerVector* layer = object->addNewVectorLayer();
+        for (int k = 0; k < options.keyFrames; k++)
+        {
+            const int position = 1 + k * spacing;
+            if (!layer->keyExists(position)) { layer->addNewKeyFrameAt(position); }
+            drawVectorFrame(layer->getVectorImageAtFrame(position), random, options);
+        }
+        if (layerGenerated) { layerGenerated(object, layer); }
+    }
+
+    if (options.soundClips > 0)
+    {
+        const QString tonePath = QDir(object->workingDir()).filePath("synthetic-tone.wav");
+        if (writeSyntheticTone(tonePath, 1000, 440))
+        {
+            LayerSound* layer = object->addNewSoundLayer();
+            const int clipSpacing = qMax(1, lastFrame / options.soundClips);
+            for (int c = 0; c < options.soundClips; c++)
+            {
+                layer->loadSoundClipAtFrame(QString("Tone %1").arg(c + 1), tonePath, 1 + c * clipSpacing);
+            }
+            if (layerGenerated) { layerGenerated(object, layer); }
+        }
+    }
+    return object;
+}
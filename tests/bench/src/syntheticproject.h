@@ -0,0 +1,75 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#ifndef SYNTHETICPROJECT_H
+#define SYNTHETICPROJECT_H
+
+#include <functional>
+#include <QList>
+#include <QPointF>
+#include <QSize>
+
+class Object;
+class Layer;
+class BezierCurve;
+class QString;
+
+/** Describes a generated project. The same options always generate the same pixels and curves. */
+struct SyntheticProjectOptions
+{
+    int bitmapLayers = 2;
+    int vectorLayers = 1;
+    int keyFrames = 24;           // per layer
+    int keyFrameSpacing = 1;
+    QSize imageSize = QSize(1280, 720);
+    int strokesPerFrame = 16;     // shapes drawn on each bitmap keyframe
+    int curvesPerFrame = 16;      // curves added to each vector keyframe
+    int soundClips = 0;           // clips on a sound layer, all playing the same generated tone
+    int cameraKeys = 0;           // camera keyframes spread over the timeline
+    quint32 seed = 1;
+};
+
+/**
+ * A small xorshift generator. Unlike the standard distributions,
+ * it gives the same sequence with every compiler and standard library.
+ */
+class SyntheticRandom
+{
+public:
+    explicit SyntheticRandom(quint32 seed) : mState(seed != 0 ? seed : 1) {}
+
+    quint32 next();
+    /** A number in [low, high] */
+    int nextInt(int low, int high);
+    /** A number in [low, high) */
+    qreal nextReal(qreal low, qreal high);
+    QPointF nextPoint(const QSize& area);
+
+private:
+    quint32 mState;
+};
+
+/** Creates a project with a camera layer followed by the generated bitmap, vector and sound layers.
+ *  @param layerGenerated is called after each layer is filled in, e.g. to flush its keyframes to disk */
+Object* createSyntheticProject(const SyntheticProjectOptions& options,
+                               const std::function<void(Object*, Layer*)>& layerGenerated = nullptr);
+
+/** Writes a mono 16-bit WAV file with a sine tone */
+bool writeSyntheticTone(const QString& filePath, int milliseconds, qreal frequency);
+
+/** A wavy stroke across the area, the kind of curve drawn with the pen tool */
+BezierCurve createSyntheticCurve(SyntheticRandom& random, const QSize& area, int pointCount = 12);
+
+#endif // SYNTHETICPROJECT_H
@@ -0,0 +1,101 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QImage>
+#include <QTransform>
+#include "affinesampler.h"
+
+namespace
+{
+    QImage numberedImage(int width, int height)
+    {
+        QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                image.setPixel(x, y, qRgba(x * 10, y * 10, 0, 255));
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE("AffineSampler::sample()")
+{
+    const QImage source = numberedImage(4, 4);
+    QImage target(4, 4, QImage::Format_ARGB32_Premultiplied);
+
+    SECTION("Identity copies the source")
+    {
+        REQUIRE(AffineSampler::sample(source, QTransform(), target, QPoint(), AffineSampler::Filter::Nearest));
+        REQUIRE(target == source);
+
+        REQUIRE(AffineSampler::sample(source, QTransform(), target, QPoint(), AffineSampler::Filter::Bilinear));
+        REQUIRE(target == source);
+    }
+
+    SECTION("Translation clears the uncovered pixels")
+    {
+        REQUIRE(AffineSampler::sample(source, QTransform::fromTranslate(2, 1), target, QPoint(), AffineSampler::Filter::Nearest));
+        REQUIRE(target.pixel(2, 1) == source.pixel(0, 0));
+        REQUIRE(target.pixel(3, 3) == source.pixel(1, 2));
+        REQUIRE(target.pixel(0, 0) == 0);
+        REQUIRE(target.pixel(1, 3) == 0);
+    }
+
+    SECTION("Target offset")
+    {
+        REQUIRE(AffineSampler::sample(source, QTransform::fromTranslate(2, 1), target, QPoint(2, 1), AffineSampler::Filter::Nearest));
+        REQUIRE(target == source);
+    }
+
+    SECTION("Scale and rotation")
+    {
+        QImage scaled(8, 8, QImage::Format_ARGB32_Premultiplied);
+        REQUIRE(AffineSampler::sample(source, QTransform::fromScale(2, 2), scaled, QPoint(), AffineSampler::Filter::Nearest));
+        REQUIRE(scaled.pixel(1, 1) == source.pixel(0, 0));
+        REQUIRE(scaled.pixel(2, 0) == source.pixel(1, 0));
+        REQUIRE(scaled.pixel(7, 7) == source.pixel(3, 3));
+
+        QTransform rotation;
+        rotation.translate(4, 0);
+        rotation.rotate(90);
+        REQUIRE(AffineSampler::sample(source, rotation, target, QPoint(), AffineSampler::Filter::Nearest));
+        REQUIRE(target.pixel(3, 0) == source.pixel(0, 0));
+        REQUIRE(target.pixel(0, 3) == source.pixel(3, 3));
+        REQUIRE(target.pixel(2, 1) == source.pixel(1, 1));
+    }
+
+    SECTION("Bilinear blends neighbouring pixels and fades out over the edges")
+    {
+        QImage pair(2, 1, QImage::Format_ARGB32_Premultiplied);
+        pair.setPixel(0, 0, qRgba(0, 0, 0, 255));
+        pair.setPixel(1, 0, qRgba(254, 254, 254, 255));
+
+        QImage blended(3, 1, QImage::Format_ARGB32_Premultiplied);
+        REQUIRE(AffineSampler::sample(pair, QTransform::fromTranslate(0.5, 0), blended, QPoint(), AffineSampler::Filter::Bilinear));
+        REQUIRE(qAlpha(blended.pixel(0, 0)) == 127);
+        REQUIRE(blended.pixel(1, 0) == qRgba(127, 127, 127, 255));
+        REQUIRE(qAlpha(blended.pixel(2, 0)) == 127);
+    }
+
+    SECTION("Singular transforms are refused")
+    {
+        REQUIRE_FALSE(AffineSampler::sample(source, QTransform::fromScale(0, 1), target, QPoint(), AffineSampler::Filter::Nearest));
+    }
+}
@@ -0,0 +1,239 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <cmath>
+#include "beziercurve.h"
+
+namespace
+{
+// A single arch from (0, 0) to (10, 0) whose control points reach y = 10
+BezierCurve createArch()
+{
+    BezierCurve curve;
+    curve.setOrigin(QPointF(0, 0));
+    curve.appendCubic(QPointF(0, 10), QPointF(10, 10), QPointF(10, 0), 0.5);
+    return curve;
+}
+}
+
+TEST_CASE("BezierCurve bounding rect")
+{
+    BezierCurve curve = createArch();
+
+    SECTION("Bounds are those of the curve, not of its control points")
+    {
+        QRectF bounds = curve.getBoundingRect();
+        REQUIRE(bounds.left() == Approx(0));
+        REQUIRE(bounds.right() == Approx(10));
+        REQUIRE(bounds.top() == Approx(0));
+        REQUIRE(bounds.bottom() == Approx(7.5));
+    }
+
+    SECTION("Bounds include the stroke width")
+    {
+        curve.setWidth(2);
+        QRectF bounds = curve.getBoundingRect();
+        REQUIRE(bounds.left() == Approx(-1));
+        REQUIRE(bounds.bottom() == Approx(8.5));
+    }
+
+    SECTION("Bounds follow geometry changes")
+    {
+        curve.getBoundingRect();
+        curve.setVertex(0, QPointF(20, 0));
+        REQUIRE(curve.getBoundingRect().right() == Approx(20));
+
+        curve.transform(QTransform::fromTranslate(5, 5));
+        REQUIRE(curve.getBoundingRect().right() == Approx(20));
+
+        curve.setSelected(true);
+        curve.transform(QTransform::fromTranslate(5, 5));
+        REQUIRE(curve.getBoundingRect().right() == Approx(25));
+        REQUIRE(curve.getBoundingRect().top() == Approx(5));
+    }
+}
+
+TEST_CASE("BezierCurve vertices")
+{
+    BezierCurve curve = createArch();
+
+    SECTION("Splitting a segment keeps its shape")
+    {
+        QPointF middle = curve.getPointOnCubic(0, 0.5);
+        curve.addPoint(0, 0.5);
+
+        REQUIRE(curve.getVertexSize() == 2);
+        REQUIRE(curve.getVertex(0) == middle);
+        REQUIRE(curve.getVertex(1) == QPointF(10, 0));
+        REQUIRE(curve.getPointOnCubic(0, 0.5).x() == Approx(createArch().getPointOnCubic(0, 0.25).x()));
+    }
+
+    SECTION("Removing the origin promotes the first vertex")
+    {
+        curve.addPoint(0, 0.5);
+        QPointF first = curve.getVertex(0);
+        curve.removeVertex(-1);
+
+        REQUIRE(curve.getVertexSize() == 1);
+        REQUIRE(curve.getOrigin() == first);
+        REQUIRE(curve.getVertex(0) == QPointF(10, 0));
+    }
+
+    SECTION("Removing an inner vertex joins the neighbouring segments")
+    {
+        curve.addPoint(0, 0.5);
+        QPointF c1 = curve.getC1(0);
+        curve.removeVertex(0);
+
+        REQUIRE(curve.getVertexSize() == 1);
+        REQUIRE(curve.getC1(0) == c1);
+        REQUIRE(curve.getVertex(0) == QPointF(10, 0));
+    }
+
+    SECTION("Copies don't share edits")
+    {
+        BezierCurve copy = curve;
+        copy.setVertex(0, QPointF(30, 0));
+        copy.setSelected(true);
+
+        REQUIRE(curve.getVertex(0) == QPointF(10, 0));
+        REQUIRE_FALSE(curve.isPartlySelected());
+        REQUIRE(curve.getBoundingRect().right() == Approx(10));
+    }
+}
+
+TEST_CASE("BezierCurve intersections")
+{
+    BezierCurve arch = createArch();
+
+    SECTION("Crossings are exact")
+    {
+        BezierCurve line;
+        line.setOrigin(QPointF(-1, 5));
+        line.appendCubic(QPointF(3, 5), QPointF(7, 5), QPointF(11, 5), 0.5);
+
+        QList<Intersection> intersections;
+        REQUIRE(BezierCurve::findIntersection(arch, 0, line, 0, intersections));
+        REQUIRE(intersections.size() == 2);
+
+        // The arch is at y = 30t(1-t)
+        const qreal root = std::sqrt(1.0 / 3.0);
+        REQUIRE(intersections[0].t1 == Approx((1 - root) / 2).margin(1e-9));
+        REQUIRE(intersections[1].t1 == Approx((1 + root) / 2).margin(1e-9));
+        for (const Intersection& intersection : intersections)
+        {
+            REQUIRE(intersection.point.y() == Approx(5).margin(1e-9));
+            REQUIRE(line.getPointOnCubic(0, intersection.t2).x() == Approx(intersection.point.x()).margin(1e-9));
+        }
+    }
+
+    SECTION("All crossings are found, in order along the first section")
+    {
+        BezierCurve wave;
+        wave.setOrigin(QPointF(0, 0.5));
+        wave.appendCubic(QPointF(3, 40), QPointF(7, -40), QPointF(10, 0.5), 0.5);
+        BezierCurve line;
+        line.setOrigin(QPointF(0, 0));
+        line.appendCubic(QPointF(3, 0), QPointF(7, 0), QPointF(10, 0), 0.5);
+
+        QList<Intersection> intersections;
+        BezierCurve::findIntersection(line, 0, wave, 0, intersections);
+        REQUIRE(intersections.size() == 2);
+        for (const Intersection& intersection : intersections)
+        {
+            REQUIRE(wave.getPointOnCubic(0, intersection.t2).y() == Approx(0).margin(1e-9));
+        }
+
+        intersections.clear();
+        BezierCurve::findIntersection(arch, 0, wave, 0, intersections);
+        REQUIRE(intersections.size() == 4);
+        for (int i = 1; i < intersections.size(); i++)
+        {
+            REQUIRE(intersections[i - 1].t1 < intersections[i].t1);
+        }
+    }
+
+    SECTION("Sections meeting at a vertex don't intersect there")
+    {
+        BezierCurve curve = createArch();
+        curve.appendCubic(QPointF(10, -10), QPointF(20, -10), QPointF(20, 0), 0.5);
+
+        QList<Intersection> intersections;
+        REQUIRE_FALSE(BezierCurve::findIntersection(curve, 0, curve, 1, intersections));
+        REQUIRE(intersections.isEmpty());
+    }
+
+    SECTION("Sections far apart")
+    {
+        BezierCurve other = createArch();
+        other.setSelected(true);
+        other.transform(QTransform::fromTranslate(100, 100));
+
+        QList<Intersection> intersections;
+        REQUIRE_FALSE(BezierCurve::findIntersection(arch, 0, other, 0, intersections));
+    }
+}
+
+TEST_CASE("BezierCurve stroked path")
+{
+    // The arch followed by its reflection, at full pressure
+    BezierCurve curve;
+    curve.setOrigin(QPointF(0, 0), 1.0, false);
+    curve.appendCubic(QPointF(0, 10), QPointF(10, 10), QPointF(10, 0), 1.0);
+    curve.appendCubic(QPointF(10, -10), QPointF(20, -10), QPointF(20, 0), 1.0);
+    curve.setWidth(4);
+
+    SECTION("The outline is half the width away from the curve")
+    {
+        QPainterPath outline = curve.getStrokedPath();
+        REQUIRE(outline.contains(QPointF(5, 7.5)));
+        REQUIRE(outline.contains(QPointF(5, 9.4)));
+        REQUIRE(outline.contains(QPointF(5, 5.6)));
+        REQUIRE_FALSE(outline.contains(QPointF(5, 9.6)));
+        REQUIRE_FALSE(outline.contains(QPointF(5, 5.4)));
+
+        // Round caps
+        REQUIRE(outline.contains(QPointF(0, -1.9)));
+        REQUIRE_FALSE(outline.contains(QPointF(0, -2.1)));
+        REQUIRE(outline.contains(QPointF(20, 1.9)));
+        REQUIRE_FALSE(outline.contains(QPointF(20, 2.1)));
+    }
+
+    SECTION("The outline is kept until the curve changes")
+    {
+        QPainterPath outline = curve.getStrokedPath();
+        REQUIRE(curve.getStrokedPath() == outline);
+
+        BezierCurve copy = curve;
+        REQUIRE(copy.getStrokedPath() == outline);
+
+        curve.setWidth(8);
+        REQUIRE(curve.getStrokedPath().contains(QPointF(5, 11)));
+        REQUIRE_FALSE(outline.contains(QPointF(5, 11)));
+
+        curve.setOrigin(QPointF(0, 0), 0.0, false);
+        REQUIRE_FALSE(curve.getStrokedPath().contains(QPointF(-1, 0)));
+    }
+
+    SECTION("The simple path follows the curve")
+    {
+        QPainterPath path = curve.getSimplePath();
+        curve.setVertex(1, QPointF(30, 0));
+        REQUIRE(curve.getSimplePath().currentPosition() == QPointF(30, 0));
+        REQUIRE(path.currentPosition() == QPointF(20, 0));
+    }
+}
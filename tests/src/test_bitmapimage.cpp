@@ -364,3 +364,27 @@ TEST_CASE("BitmapImage autoCrop")
         REQUIRE(b->top() == 20);
     }
 }
+
+TEST_CASE("BitmapImage version")
+{
+    SECTION("Modifying the image bumps the version")
+    {
+        auto b = std::make_shared<BitmapImage>(QRect(0, 0, 10, 10), Qt::red);
+        int version = b->version();
+
+        b->setPixel(1, 1, qRgba(0, 0, 255, 255));
+        REQUIRE(b->version() > version);
+
+        version = b->version();
+        b->clear();
+        REQUIRE(b->version() > version);
+    }
+
+    SECTION("Saving the image doesn't bump the version")
+    {
+        auto b = std::make_shared<BitmapImage>(QRect(0, 0, 10, 10), Qt::red);
+        const int version = b->version();
+        b->setModified(false);
+        REQUIRE(b->version() == version);
+    }
+}
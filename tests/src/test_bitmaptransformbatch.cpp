@@ -0,0 +1,141 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QAction>
+#include "bitmaptransformbatch.h"
+#include "bitmapimage.h"
+#include "editor.h"
+#include "layerbitmap.h"
+#include "object.h"
+#include "scribblearea.h"
+#include "undoredomanager.h"
+
+TEST_CASE("BitmapTransformBatch::apply()")
+{
+    SECTION("Whole keyframe by whole pixels")
+    {
+        BitmapImage image(QRect(0, 0, 10, 10), Qt::red);
+        BitmapTransformBatch::apply(image, QRect(), QTransform::fromTranslate(5, -3), false);
+        REQUIRE(image.bounds() == QRect(5, -3, 10, 10));
+    }
+
+    SECTION("Within a selection")
+    {
+        BitmapImage image(QRect(0, 0, 20, 10), Qt::red);
+        BitmapTransformBatch::apply(image, QRect(0, 0, 10, 10), QTransform::fromTranslate(0, 20), false);
+        REQUIRE(qAlpha(image.pixel(5, 5)) == 0);
+        REQUIRE(image.pixel(15, 5) == qRgb(255, 0, 0));
+        REQUIRE(image.pixel(5, 25) == qRgb(255, 0, 0));
+    }
+}
+
+TEST_CASE("BitmapTransformBatch::run()")
+{
+    std::vector<std::unique_ptr<BitmapImage>> images;
+    std::vector<const BitmapImage*> keyFrames;
+    for (int i = 0; i < 20; i++)
+    {
+        images.emplace_back(new BitmapImage(QRect(i, 0, 4, 4), Qt::blue));
+        keyFrames.push_back(images.back().get());
+    }
+
+    BitmapTransformBatch batch(QRect(), QTransform::fromTranslate(0, 10), false);
+
+    SECTION("Transformed copies are handed back in order")
+    {
+        std::vector<int> indexes;
+        batch.run(keyFrames, [&](int index, std::unique_ptr<BitmapImage> transformed)
+        {
+            indexes.push_back(index);
+            REQUIRE(transformed->bounds() == QRect(index, 10, 4, 4));
+            return true;
+        });
+
+        REQUIRE(indexes.size() == keyFrames.size());
+        for (int i = 0; i < static_cast<int>(indexes.size()); i++)
+        {
+            REQUIRE(indexes[i] == i);
+            REQUIRE(images[i]->bounds() == QRect(i, 0, 4, 4));
+        }
+    }
+
+    SECTION("Stopping early")
+    {
+        int count = 0;
+        batch.run(keyFrames, [&](int, std::unique_ptr<BitmapImage>)
+        {
+            return ++count < 3;
+        });
+        REQUIRE(count == 3);
+    }
+}
+
+TEST_CASE("Editor::transformBitmapKeyFrames()")
+{
+    Object* object = new Object;
+    LayerBitmap* layer1 = object->addNewBitmapLayer();
+    LayerBitmap* layer2 = object->addNewBitmapLayer();
+    for (LayerBitmap* layer : { layer1, layer2 })
+    {
+        layer->addOrReplaceKeyFrame(1, new BitmapImage(QRect(0, 0, 10, 10), Qt::red));
+        layer->addOrReplaceKeyFrame(3, new BitmapImage(QRect(0, 0, 10, 10), Qt::blue));
+    }
+
+    ScribbleArea* scribbleArea = new ScribbleArea(nullptr);
+    Editor* editor = new Editor;
+    editor->setScribbleArea(scribbleArea);
+    editor->setObject(object);
+    editor->init();
+
+    SECTION("Every keyframe moves in a single undo step")
+    {
+        QMap<int, QList<int>> keyFramesByLayer;
+        keyFramesByLayer.insert(layer1->id(), { 1, 3 });
+        keyFramesByLayer.insert(layer2->id(), { 1, 3 });
+
+        int progressCount = 0;
+        Status status = editor->transformBitmapKeyFrames(keyFramesByLayer, QRect(), QTransform::fromTranslate(5, 0), false,
+                                                         [&progressCount](int count) { progressCount = count; },
+                                                         [] { return false; });
+        REQUIRE(status.ok());
+        REQUIRE(progressCount == 4);
+        for (LayerBitmap* layer : { layer1, layer2 })
+        {
+            REQUIRE(layer->getBitmapImageAtFrame(1)->bounds() == QRect(5, 0, 10, 10));
+            REQUIRE(layer->getBitmapImageAtFrame(3)->bounds() == QRect(5, 0, 10, 10));
+        }
+
+        QAction* undoAction = editor->undoRedo()->createUndoAction(nullptr, QIcon());
+        editor->undoRedo()->updateUndoAction(undoAction);
+        REQUIRE(undoAction->isEnabled());
+
+        undoAction->trigger();
+        for (LayerBitmap* layer : { layer1, layer2 })
+        {
+            REQUIRE(layer->getBitmapImageAtFrame(1)->bounds() == QRect(0, 0, 10, 10));
+            REQUIRE(layer->getBitmapImageAtFrame(3)->bounds() == QRect(0, 0, 10, 10));
+        }
+
+        // Nothing left to undo, the transform was the only step
+        editor->undoRedo()->updateUndoAction(undoAction);
+        REQUIRE_FALSE(undoAction->isEnabled());
+        delete undoAction;
+    }
+
+    delete editor;
+    delete scribbleArea;
+}
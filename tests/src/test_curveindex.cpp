@@ -0,0 +1,130 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include "curveindex.h"
+#include "beziercurve.h"
+#include "vectorimage.h"
+
+namespace
+{
+// A curve of straight sections through the points
+BezierCurve createPolyline(const QList<QPointF>& points)
+{
+    return BezierCurve(points, false);
+}
+}
+
+TEST_CASE("CurveIndex")
+{
+    CurveIndex index;
+    QVector<BezierCurve> curves;
+
+    SECTION("Finds the sections around a point among many")
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            curves.append(createPolyline({ { 0, i * 10.0 }, { 50, i * 10.0 }, { 100, i * 10.0 } }));
+        }
+        index.build(curves);
+        REQUIRE(index.isBuilt());
+        REQUIRE(index.itemCount() == 200);
+
+        const QVector<CurveIndex::Item> items = index.itemsNear(QPointF(75, 302), 3);
+        REQUIRE(items.size() == 1);
+        REQUIRE(items.first().curve == 30);
+        REQUIRE(items.first().section == 1);
+
+        REQUIRE(index.itemsIn(QRectF(-10, -10, 200, 25)).size() == 4);
+        REQUIRE(index.itemsNear(QPointF(200, 200), 3).isEmpty());
+    }
+
+    SECTION("Horizontal sections and single vertices are found")
+    {
+        BezierCurve dot;
+        dot.setOrigin(QPointF(20, 20));
+        curves.append(dot);
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 } }));
+        index.build(curves);
+
+        REQUIRE(index.itemsNear(QPointF(20, 21), 2).size() == 1);
+        REQUIRE(index.itemsNear(QPointF(20, 21), 2).first().section == -1);
+        REQUIRE(index.itemsNear(QPointF(5, 1), 2).size() == 1);
+    }
+
+    SECTION("Clear")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 } }));
+        index.build(curves);
+        index.clear();
+        REQUIRE_FALSE(index.isBuilt());
+        REQUIRE(index.itemsNear(QPointF(5, 0), 2).isEmpty());
+    }
+}
+
+TEST_CASE("VectorImage hit testing")
+{
+    VectorImage image;
+    for (int i = 0; i < 20; i++)
+    {
+        BezierCurve curve = createPolyline({ { 0, i * 10.0 }, { 100, i * 10.0 } });
+        image.addCurve(curve, 1.0, false);
+    }
+
+    SECTION("Curves close to a point")
+    {
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 41), 2) == QList<int>({ 4 }));
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 45), 6) == QList<int>({ 4, 5 }));
+        REQUIRE(image.getCurvesCloseTo(QPointF(150, 40), 2).isEmpty());
+    }
+
+    SECTION("A curve between its vertices")
+    {
+        BezierCurve arc = createPolyline({ { 0, 500 }, { 400, 500 } });
+        image.addCurve(arc, 1.0, false);
+        REQUIRE(image.getCurvesCloseTo(QPointF(200, 501), 2) == QList<int>({ 20 }));
+    }
+
+    SECTION("Vertices close to a point")
+    {
+        const QList<VertexRef> vertices = image.getVerticesCloseTo(QPointF(99, 31), 3);
+        REQUIRE(vertices.size() == 1);
+        REQUIRE(vertices.first() == VertexRef(3, 0));
+
+        REQUIRE(image.getVerticesCloseTo(QPointF(1, 0), 3) == QList<VertexRef>({ VertexRef(0, -1) }));
+    }
+
+    SECTION("The index follows removed curves")
+    {
+        image.removeCurveAt(4);
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 41), 2).isEmpty());
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 51), 2) == QList<int>({ 4 }));
+    }
+
+    SECTION("Curves being moved are found where they are shown")
+    {
+        image.setSelected(2, true);
+        image.setSelectionTransformation(QTransform::fromTranslate(0, 1000));
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 1020), 2) == QList<int>({ 2 }));
+        REQUIRE(image.getCurvesCloseTo(QPointF(50, 20), 2).isEmpty());
+    }
+
+    SECTION("Select a rectangle")
+    {
+        image.select(QRectF(90, 15, 20, 20));
+        REQUIRE(image.getSelectedCurveNumbers() == QList<int>({ 2, 3 }));
+    }
+}
@@ -17,6 +17,7 @@ GNU General Public License for more details.
 
 #include <QTemporaryDir>
 #include <QTemporaryFile>
+#include <QFileInfo>
 #include <QImage>
 #include "qminiz.h"
 #include "fileformat.h"
@@ -25,6 +26,10 @@ GNU General Public License for more details.
 #include "object.h"
 #include "bitmapimage.h"
 #include "layerbitmap.h"
+#include "layercamera.h"
+#include "camera.h"
+#include "layervector.h"
+#include "vectorimage.h"
 
 
 TEST_CASE("FileManager Initial Test")
@@ -211,6 +216,67 @@ TEST_CASE("FileManager Loading XML Tests")
         REQUIRE(layer->getKeyFrameAt(1) != nullptr);
         delete obj;
     }
+
+    SECTION("Vector curves kept inside the main xml")
+    {
+        QTemporaryFile tmpFile;
+        if (!tmpFile.open())
+        {
+            REQUIRE(false);
+        }
+        QFile theXML(tmpFile.fileName());
+        theXML.open(QIODevice::WriteOnly);
+
+        QTextStream fout(&theXML);
+        fout << "<!DOCTYPE PencilDocument><document>";
+        fout << "  <object>";
+        fout << "    <layer name='OldLayer' id='2' visibility='1' type='2' >";
+        fout << "      <image frame='3' opacity='0.5'>";
+        fout << "        <curve width='2' variableWidth='false' invisible='false' filled='false' colourNumber='1' originX='0' originY='0' originPressure='1'>";
+        fout << "          <segment c1x='0' c1y='0' c2x='10' c2y='10' vx='10' vy='10' pressure='1' />";
+        fout << "        </curve>";
+        fout << "      </image>";
+        fout << "    </layer>";
+        fout << "  </object>";
+        fout << "</document>";
+        theXML.close();
+
+        FileManager fm;
+        Object* obj = fm.load(theXML.fileName());
+        REQUIRE(obj != nullptr);
+
+        LayerVector* layer = static_cast<LayerVector*>(obj->getLayer(0));
+        REQUIRE(layer->name() == "OldLayer");
+        VectorImage* image = layer->getVectorImageAtFrame(3);
+        REQUIRE(image != nullptr);
+        REQUIRE(image->getOpacity() == 0.5);
+        REQUIRE(image->getLastCurveNumber() == 0);
+        REQUIRE(image->getCurvesColor(0) == 1);
+        delete obj;
+    }
+
+    SECTION("Xml cut off in the middle")
+    {
+        QTemporaryFile tmpFile;
+        if (!tmpFile.open())
+        {
+            REQUIRE(false);
+        }
+        QFile theXML(tmpFile.fileName());
+        theXML.open(QIODevice::WriteOnly);
+
+        QTextStream fout(&theXML);
+        fout << "<!DOCTYPE PencilDocument><document>";
+        fout << "  <object>";
+        fout << "    <layer name='MyLayer' id='5' visibility='1' type='1' >";
+        fout << "      <image frame='1' topLeftY='0' src='003.001.png' topLeftX='0' />";
+        theXML.close();
+
+        FileManager fm;
+        Object* obj = fm.load(theXML.fileName());
+        REQUIRE(obj == nullptr);
+        REQUIRE(fm.error().code() == Status::ERROR_INVALID_XML_FILE);
+    }
 }
 
 // Turn a Qt resource file into an actual file on disk
@@ -399,6 +465,89 @@ TEST_CASE("FileManager File-saving")
         }
         delete o3;
     }
+
+    SECTION("Vector frames moved without being loaded keep their curves")
+    {
+        FileManager fm;
+
+        Object* o1 = new Object;
+        o1->init();
+        o1->addNewCameraLayer();
+        LayerVector* layer = o1->addNewVectorLayer();
+        for (int i = 100; i < 150; ++i)
+        {
+            layer->addNewKeyFrameAt(i);
+            BezierCurve curve({ QPointF(i, 0), QPointF(i, 50) });
+            curve.setWidth(2);
+            layer->getVectorImageAtFrame(i)->addCurve(curve, 1.0, false);
+        }
+
+        QTemporaryDir testDir("PENCIL_TEST_XXXXXXXX");
+        QString animationPath = testDir.path() + "/abc.pclx";
+        REQUIRE(fm.save(o1, animationPath).ok());
+        delete o1;
+
+        // Frames are only read when used, so these move as files; each lands on another frame's file
+        Object* o2 = fm.load(animationPath);
+        layer = static_cast<LayerVector*>(o2->getLayer(1));
+        REQUIRE_FALSE(layer->getVectorImageAtFrame(120)->isLoaded());
+        for (int i = 100; i < 150; ++i)
+            layer->setFrameSelected(i, true);
+
+        layer->moveSelectedFrames(10);
+        REQUIRE(fm.save(o2, animationPath).ok());
+        delete o2;
+
+        Object* o3 = fm.load(animationPath);
+        layer = static_cast<LayerVector*>(o3->getLayer(1));
+        for (int i = 110; i < 160; ++i)
+        {
+            VectorImage* image = layer->getVectorImageAtFrame(i);
+            REQUIRE(image != nullptr);
+            REQUIRE(QFileInfo(image->fileName()).suffix() == "vec");
+            REQUIRE_FALSE(image->isEmpty());
+            REQUIRE(image->curve(0).getOrigin().x() == i - 10);
+        }
+        delete o3;
+    }
+
+    SECTION("Project data and layer settings survive a save")
+    {
+        FileManager fm;
+
+        Object* o1 = new Object;
+        o1->init();
+        LayerCamera* camera = o1->addNewCameraLayer();
+        camera->setName("Camera <1> & \"2\"");
+        camera->addNewKeyFrameAt(5);
+        camera->getCameraAtFrame(5)->translate(12.25, -3.5);
+        camera->getCameraAtFrame(5)->rotate(33.3);
+        o1->addNewBitmapLayer()->setVisible(false);
+        o1->data()->setFrameRate(24);
+        o1->data()->setCurrentFrame(7);
+        o1->data()->setLooping(true);
+
+        QTemporaryDir testDir("PENCIL_TEST_XXXXXXXX");
+        QString animationPath = testDir.path() + "/abc.pclx";
+        REQUIRE(fm.save(o1, animationPath).ok());
+        delete o1;
+
+        Object* o2 = fm.load(animationPath);
+        REQUIRE(o2 != nullptr);
+        REQUIRE(o2->getLayerCount() == 2);
+        REQUIRE(o2->data()->getFrameRate() == 24);
+        REQUIRE(o2->data()->getCurrentFrame() == 7);
+        REQUIRE(o2->data()->isLooping());
+
+        camera = static_cast<LayerCamera*>(o2->getLayer(0));
+        REQUIRE(camera->name() == "Camera <1> & \"2\"");
+        Camera* key = camera->getCameraAtFrame(5);
+        REQUIRE(key != nullptr);
+        REQUIRE(key->translation() == QPointF(12.25, -3.5));
+        REQUIRE(key->rotation() == Approx(33.3));
+        REQUIRE_FALSE(o2->getLayer(1)->visible());
+        delete o2;
+    }
 }
 
 TEST_CASE("Empty Sound Frames")
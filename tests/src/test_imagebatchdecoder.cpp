@@ -0,0 +1,242 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QAction>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include "imagebatchdecoder.h"
+#include "editor.h"
+#include "layer.h"
+#include "object.h"
+#include "scribblearea.h"
+#include "undoredomanager.h"
+
+namespace
+{
+    QString writeImage(const QTemporaryDir& dir, const QString& name, const QSize& size, const QColor& color)
+    {
+        QImage image(size, QImage::Format_ARGB32);
+        image.fill(color);
+        const QString path = dir.filePath(name);
+        image.save(path, "PNG");
+        return path;
+    }
+}
+
+TEST_CASE("ImageBatchDecoder::decode()")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = writeImage(dir, "a.png", QSize(40, 20), Qt::black);
+
+    SECTION("Original size")
+    {
+        DecodedImage decoded = ImageBatchDecoder::decode(path, ImageImportOptions());
+        REQUIRE_FALSE(decoded.failed);
+        REQUIRE(decoded.image.size() == QSize(40, 20));
+        REQUIRE(decoded.image.format() == QImage::Format_ARGB32_Premultiplied);
+    }
+
+    SECTION("Downscaled")
+    {
+        ImageImportOptions options;
+        options.scale = 0.5;
+        REQUIRE(ImageBatchDecoder::decode(path, options).image.size() == QSize(20, 10));
+    }
+
+    SECTION("Missing file")
+    {
+        DecodedImage decoded = ImageBatchDecoder::decode(dir.filePath("missing.png"), ImageImportOptions());
+        REQUIRE(decoded.failed);
+        REQUIRE(decoded.error == QImageReader::FileNotFoundError);
+    }
+}
+
+TEST_CASE("ImageBatchDecoder::prepare()")
+{
+    QImage paper(QSize(8, 8), QImage::Format_ARGB32);
+    paper.fill(Qt::white);
+
+    ImageImportOptions options;
+
+    SECTION("Scan to transparent")
+    {
+        REQUIRE(qAlpha(ImageBatchDecoder::prepare(paper, options).image.pixel(4, 4)) == 255);
+
+        options.scanToTransparent = true;
+        REQUIRE(qAlpha(ImageBatchDecoder::prepare(paper, options).image.pixel(4, 4)) == 0);
+    }
+
+    SECTION("Autocrop")
+    {
+        QImage image(QSize(10, 10), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        image.setPixel(3, 4, qRgb(0, 0, 0));
+        image.setPixel(5, 6, qRgb(0, 0, 0));
+
+        options.autoCrop = true;
+        DecodedImage prepared = ImageBatchDecoder::prepare(image, options);
+        REQUIRE(prepared.frameSize == QSize(10, 10));
+        REQUIRE(prepared.offset == QPoint(3, 4));
+        REQUIRE(prepared.image.size() == QSize(3, 3));
+    }
+}
+
+TEST_CASE("ImageBatchDecoder::run()")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    QStringList paths;
+    for (int i = 1; i <= 20; i++)
+    {
+        paths.append(writeImage(dir, QString("%1.png").arg(i), QSize(i, 1), Qt::black));
+    }
+
+    ImageBatchDecoder decoder(ImageImportOptions{});
+
+    SECTION("Images arrive in order")
+    {
+        QList<int> widths;
+        decoder.run(paths, [&widths](int index, const DecodedImage& decoded)
+        {
+            REQUIRE(widths.count() == index);
+            widths.append(decoded.image.width());
+            return true;
+        });
+
+        REQUIRE(widths.count() == 20);
+        for (int i = 0; i < widths.count(); i++)
+        {
+            REQUIRE(widths[i] == i + 1);
+        }
+    }
+
+    SECTION("Stops when asked to")
+    {
+        int calls = 0;
+        decoder.run(paths, [&calls](int, const DecodedImage&)
+        {
+            return ++calls < 3;
+        });
+        REQUIRE(calls == 3);
+    }
+}
+
+TEST_CASE("ImageBatchDecoder::runAnimation()")
+{
+    ImageBatchDecoder decoder(ImageImportOptions{});
+
+    SECTION("Identical frames in a row are handed over once")
+    {
+        // Red, red, blue, blue, blue, red
+        QList<int> frameCounts;
+        QList<QColor> colors;
+        decoder.runAnimation(":/animated/repeated-frames.gif", [&](int index, const DecodedImage& decoded)
+        {
+            REQUIRE_FALSE(decoded.failed);
+            REQUIRE(frameCounts.count() == index);
+            frameCounts.append(decoded.frameCount);
+            colors.append(decoded.image.pixelColor(0, 0));
+            return true;
+        });
+
+        REQUIRE(frameCounts == QList<int>({ 2, 3, 1 }));
+        REQUIRE(colors == QList<QColor>({ Qt::red, Qt::blue, Qt::red }));
+    }
+
+    SECTION("Frames arrive in order")
+    {
+        int calls = 0;
+        decoder.runAnimation(":/animated/alternating-frames.gif", [&calls](int index, const DecodedImage& decoded)
+        {
+            REQUIRE(index == calls);
+            REQUIRE(decoded.frameCount == 1);
+            REQUIRE(decoded.image.pixelColor(0, 0) == QColor((index % 2 == 0) ? Qt::red : Qt::blue));
+            calls++;
+            return true;
+        });
+        REQUIRE(calls == 24);
+    }
+
+    SECTION("Stops when asked to, while the worker waits on a full queue")
+    {
+        int calls = 0;
+        decoder.runAnimation(":/animated/alternating-frames.gif", [&calls](int, const DecodedImage&)
+        {
+            // Give the worker time to fill the queue up to its bound and block on it
+            if (calls == 0) { QThread::msleep(50); }
+            return ++calls < 3;
+        });
+        REQUIRE(calls == 3);
+    }
+
+    SECTION("Not an image")
+    {
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        QFile file(dir.filePath("broken.gif"));
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("GIF89a");
+        file.close();
+
+        int calls = 0;
+        decoder.runAnimation(file.fileName(), [&calls](int, const DecodedImage& decoded)
+        {
+            REQUIRE(decoded.failed);
+            calls++;
+            return true;
+        });
+        REQUIRE(calls == 1);
+    }
+}
+
+TEST_CASE("Editor::importAnimatedImage()")
+{
+    Object* object = new Object;
+    Layer* layer = object->addNewBitmapLayer();
+    Editor* editor = new Editor;
+    ScribbleArea* scribbleArea = new ScribbleArea(nullptr);
+    editor->setScribbleArea(scribbleArea);
+    editor->setObject(object);
+    editor->init();
+    editor->scrubTo(1);
+
+    SECTION("Repeated frames become longer exposures in one undo step")
+    {
+        const int frameSpacing = 2;
+        Status status = editor->importAnimatedImage(":/animated/repeated-frames.gif", frameSpacing,
+                                                    [](int) {}, [] { return false; });
+        REQUIRE(status.ok());
+
+        // Frame counts of 2, 3 and 1
+        REQUIRE(layer->keyFrameCount() == 3);
+        REQUIRE(layer->keyExists(1));
+        REQUIRE(layer->keyExists(1 + frameSpacing * 2));
+        REQUIRE(layer->keyExists(1 + frameSpacing * (2 + 3)));
+
+        QAction* undoAction = editor->undoRedo()->createUndoAction(nullptr, QIcon());
+        undoAction->trigger();
+        delete undoAction;
+
+        REQUIRE(layer->keyFrameCount() == 1);
+        REQUIRE(layer->keyExists(1));
+    }
+
+    delete editor;
+}
@@ -0,0 +1,120 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include "keyframeselection.h"
+#include "framerangeset.h"
+
+TEST_CASE("KeyFrameSelection")
+{
+    KeyFrameSelection selection;
+    selection.insert(5);
+    selection.insert(1);
+    selection.insert(9);
+
+    SECTION("Ordered by position and by recency")
+    {
+        REQUIRE(selection.byPosition() == QList<int>({ 1, 5, 9 }));
+        REQUIRE(selection.byRecency() == QList<int>({ 9, 1, 5 }));
+        REQUIRE(selection.mostRecent() == 9);
+        REQUIRE(selection.first() == 1);
+        REQUIRE(selection.last() == 9);
+    }
+
+    SECTION("Selecting twice keeps the original order")
+    {
+        selection.insert(5);
+        REQUIRE(selection.count() == 3);
+        REQUIRE(selection.mostRecent() == 9);
+    }
+
+    SECTION("Remove")
+    {
+        selection.remove(9);
+        REQUIRE_FALSE(selection.contains(9));
+        REQUIRE(selection.mostRecent() == 1);
+    }
+
+    SECTION("Shift")
+    {
+        selection.shift(3);
+        REQUIRE(selection.byPosition() == QList<int>({ 4, 8, 12 }));
+        REQUIRE(selection.byRecency() == QList<int>({ 12, 4, 8 }));
+    }
+
+    SECTION("Swap")
+    {
+        selection.swap(1, 9);
+        REQUIRE(selection.byRecency() == QList<int>({ 1, 9, 5 }));
+
+        selection.swap(5, 6);
+        REQUIRE(selection.byPosition() == QList<int>({ 1, 6, 9 }));
+        REQUIRE(selection.byRecency() == QList<int>({ 1, 9, 6 }));
+    }
+
+    SECTION("Remap")
+    {
+        selection.remap({ { 1, 2 }, { 9, 10 }, { 20, 21 } });
+        REQUIRE(selection.byPosition() == QList<int>({ 2, 5, 10 }));
+        REQUIRE(selection.byRecency() == QList<int>({ 10, 2, 5 }));
+    }
+
+    SECTION("Clear")
+    {
+        selection.clear();
+        REQUIRE(selection.isEmpty());
+        REQUIRE(selection.mostRecent() == -1);
+    }
+}
+
+TEST_CASE("FrameRangeSet")
+{
+    FrameRangeSet set;
+
+    SECTION("Duplicates are stored once")
+    {
+        set.insert(3);
+        set.insert(3);
+        REQUIRE(set.positions() == QList<int>({ 3 }));
+    }
+
+    SECTION("Adjacent and overlapping ranges are merged")
+    {
+        set.insert(1, 3);
+        set.insert(7, 9);
+        set.insert(4);
+        REQUIRE(set.ranges() == QList<std::pair<int, int>>({ { 1, 4 }, { 7, 9 } }));
+
+        set.insert(5, 8);
+        REQUIRE(set.ranges() == QList<std::pair<int, int>>({ { 1, 9 } }));
+    }
+
+    SECTION("Contains")
+    {
+        set.insert(10, 20);
+        REQUIRE(set.contains(10));
+        REQUIRE(set.contains(20));
+        REQUIRE_FALSE(set.contains(9));
+        REQUIRE_FALSE(set.contains(21));
+    }
+
+    SECTION("A range inside another one")
+    {
+        set.insert(1, 10);
+        set.insert(4, 6);
+        REQUIRE(set.ranges() == QList<std::pair<int, int>>({ { 1, 10 } }));
+    }
+}
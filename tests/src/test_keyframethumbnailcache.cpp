@@ -0,0 +1,229 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include "keyframethumbnailcache.h"
+#include "bitmapimage.h"
+#include "layer.h"
+#include "object.h"
+
+namespace
+{
+    BitmapImage* createBitmap(QColor color)
+    {
+        return new BitmapImage(QRect(0, 0, 8, 8), color);
+    }
+
+    QImage waitForThumbnail(KeyFrameThumbnailCache& cache, const Layer* layer, int position)
+    {
+        KeyFrame* key = layer->getKeyFrameAt(position);
+        QElapsedTimer timer;
+        timer.start();
+
+        QImage thumbnail = cache.thumbnail(layer, key, nullptr);
+        while (thumbnail.isNull() && timer.elapsed() < 5000)
+        {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            thumbnail = cache.thumbnail(layer, key, nullptr);
+        }
+        REQUIRE_FALSE(thumbnail.isNull());
+        return thumbnail;
+    }
+
+    bool isCached(KeyFrameThumbnailCache& cache, const Layer* layer, int position)
+    {
+        // A thumbnail that isn't cached gets requested and comes back null meanwhile
+        return !cache.thumbnail(layer, layer->getKeyFrameAt(position), nullptr).isNull();
+    }
+
+    int cachedFileCount(const QString& dirPath)
+    {
+        return QDir(dirPath).entryList({ "*.png" }, QDir::Files).count();
+    }
+}
+
+TEST_CASE("KeyFrameThumbnailCache eviction")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    for (int position = 2; position <= 6; position++)
+    {
+        layer->addKeyFrame(position, createBitmap(Qt::red));
+    }
+
+    // 16 MB per thumbnail, four of them fill the memory budget
+    KeyFrameThumbnailCache cache;
+    cache.setThumbnailSize(QSize(2048, 2048));
+
+    SECTION("The least recently used thumbnail goes first")
+    {
+        for (int position = 2; position <= 5; position++)
+        {
+            waitForThumbnail(cache, layer, position);
+        }
+        REQUIRE(isCached(cache, layer, 2));
+
+        waitForThumbnail(cache, layer, 6);
+
+        REQUIRE_FALSE(isCached(cache, layer, 3));
+        REQUIRE(isCached(cache, layer, 2));
+        REQUIRE(isCached(cache, layer, 4));
+        REQUIRE(isCached(cache, layer, 5));
+        REQUIRE(isCached(cache, layer, 6));
+    }
+
+    delete obj;
+}
+
+TEST_CASE("KeyFrameThumbnailCache::invalidateDirtyFrames()")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    Layer* otherLayer = obj->addNewBitmapLayer();
+    layer->addKeyFrame(2, createBitmap(Qt::red));
+    layer->addKeyFrame(3, createBitmap(Qt::red));
+    layer->addKeyFrame(8, createBitmap(Qt::red));
+    otherLayer->addKeyFrame(3, createBitmap(Qt::red));
+
+    KeyFrameThumbnailCache cache;
+    waitForThumbnail(cache, layer, 2);
+    waitForThumbnail(cache, layer, 3);
+    waitForThumbnail(cache, layer, 8);
+    waitForThumbnail(cache, otherLayer, 3);
+    layer->clearDirtyFrames();
+
+    SECTION("Dirty frames, one by one")
+    {
+        layer->markFramesAsDirty(2, 3);
+        cache.invalidateDirtyFrames(layer);
+
+        REQUIRE(isCached(cache, layer, 8));
+        REQUIRE(isCached(cache, otherLayer, 3));
+        REQUIRE_FALSE(isCached(cache, layer, 2));
+        REQUIRE_FALSE(isCached(cache, layer, 3));
+    }
+
+    SECTION("Dirty range wider than the cache")
+    {
+        layer->markFramesAsDirty(3, 1000000);
+        cache.invalidateDirtyFrames(layer);
+
+        REQUIRE(isCached(cache, layer, 2));
+        REQUIRE(isCached(cache, otherLayer, 3));
+        REQUIRE_FALSE(isCached(cache, layer, 3));
+        REQUIRE_FALSE(isCached(cache, layer, 8));
+    }
+
+    delete obj;
+}
+
+TEST_CASE("KeyFrameThumbnailCache drops stale requests")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addKeyFrame(2, createBitmap(Qt::transparent));
+
+    QImage staleImage(64, 48, QImage::Format_ARGB32_Premultiplied);
+    staleImage.fill(Qt::red);
+
+    KeyFrameThumbnailCache cache;
+    int readyCount = 0;
+    QObject::connect(&cache, &KeyFrameThumbnailCache::thumbnailReady, [&readyCount](int, int) { readyCount++; });
+
+    SECTION("Result nobody asked for")
+    {
+        emit cache.thumbnailGenerated(layer->id(), 2, 1, staleImage);
+        QCoreApplication::processEvents();
+
+        REQUIRE(readyCount == 0);
+        REQUIRE_FALSE(isCached(cache, layer, 2));
+    }
+
+    SECTION("Result of an older request")
+    {
+        REQUIRE(cache.thumbnail(layer, layer->getKeyFrameAt(2), nullptr).isNull());
+
+        // Whichever arrives first, only the result of the pending request is kept
+        emit cache.thumbnailGenerated(layer->id(), 2, 0, staleImage);
+
+        QImage thumbnail = waitForThumbnail(cache, layer, 2);
+        REQUIRE(thumbnail.pixelColor(0, 0) != QColor(Qt::red));
+        REQUIRE(readyCount == 1);
+    }
+
+    delete obj;
+}
+
+TEST_CASE("KeyFrameThumbnailCache disk cache")
+{
+    QTemporaryDir tempDir;
+    REQUIRE(tempDir.isValid());
+
+    const QString pathA = tempDir.filePath("a.png");
+    const QString pathB = tempDir.filePath("b.png");
+    const QString pathC = tempDir.filePath("c.png");
+    QImage source(8, 8, QImage::Format_ARGB32_Premultiplied);
+    source.fill(Qt::red);
+    REQUIRE(source.save(pathA));
+    REQUIRE(QFile::copy(pathA, pathB));
+    source.fill(Qt::green);
+    REQUIRE(source.save(pathC));
+
+    // Frames which are not loaded are decoded from their file
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addKeyFrame(2, new BitmapImage(QPoint(0, 0), pathA));
+    layer->addKeyFrame(3, new BitmapImage(QPoint(0, 0), pathB));
+    layer->addKeyFrame(4, new BitmapImage(QPoint(0, 0), pathC));
+
+    const QString cacheDir = tempDir.filePath("thumbnails");
+    KeyFrameThumbnailCache cache;
+    cache.setCacheDir(cacheDir);
+
+    waitForThumbnail(cache, layer, 2);
+    const QStringList cachedFiles = QDir(cacheDir).entryList({ "*.png" }, QDir::Files);
+    REQUIRE(cachedFiles.count() == 1);
+
+    // Tag the thumbnail on disk to tell it apart from a freshly generated one
+    QImage tagged(cache.thumbnailSize(), QImage::Format_ARGB32_Premultiplied);
+    tagged.fill(Qt::blue);
+    REQUIRE(tagged.save(QDir(cacheDir).filePath(cachedFiles.first()), "PNG"));
+    cache.clear();
+
+    SECTION("Hit for the same file")
+    {
+        REQUIRE(waitForThumbnail(cache, layer, 2).pixelColor(0, 0) == QColor(Qt::blue));
+    }
+
+    SECTION("Hit for another file with the same content")
+    {
+        REQUIRE(waitForThumbnail(cache, layer, 3).pixelColor(0, 0) == QColor(Qt::blue));
+        REQUIRE(cachedFileCount(cacheDir) == 1);
+    }
+
+    SECTION("Miss for different content")
+    {
+        REQUIRE(waitForThumbnail(cache, layer, 4).pixelColor(0, 0) != QColor(Qt::blue));
+        REQUIRE(cachedFileCount(cacheDir) == 2);
+    }
+
+    delete obj;
+}
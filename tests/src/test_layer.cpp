@@ -322,6 +322,40 @@ TEST_CASE("Layer::getNextKeyFramePosition()")
     delete obj;
 }
 
+TEST_CASE("Layer::foreachKeyFrameInRange()")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addNewKeyFrameAt(5);
+    layer->addNewKeyFrameAt(10);
+    layer->addNewKeyFrameAt(20);
+
+    auto positionsInRange = [layer](int start, int end)
+    {
+        QList<int> positions;
+        layer->foreachKeyFrameInRange(start, end, [&positions](KeyFrame* key)
+        {
+            positions.append(key->pos());
+        });
+        return positions;
+    };
+
+    SECTION("Range covering all keys")
+    {
+        REQUIRE(positionsInRange(1, 100) == QList<int>({ 20, 10, 5, 1 }));
+    }
+    SECTION("Bounds are inclusive")
+    {
+        REQUIRE(positionsInRange(5, 10) == QList<int>({ 10, 5 }));
+    }
+    SECTION("Range between keys")
+    {
+        REQUIRE(positionsInRange(11, 19).isEmpty());
+        REQUIRE(positionsInRange(21, 100).isEmpty());
+    }
+    delete obj;
+}
+
 TEST_CASE("Layer::getPreviousFrameNumber()")
 {
     Object* obj = new Object;
@@ -679,5 +713,116 @@ TEST_CASE("layer::insertExposureAt(int position)") {
     delete obj;
 }
 
+TEST_CASE("Layer::restoreKeyFrames()")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addNewKeyFrameAt(3);
+
+    // The state before keys were added at 3 and 5
+    std::vector<std::unique_ptr<KeyFrame>> before;
+    before.emplace_back(layer->getKeyFrameAt(3)->clone());
+
+    BitmapImage red(QRect(0, 0, 10, 10), Qt::red);
+    static_cast<BitmapImage*>(layer->getKeyFrameAt(3))->paste(&red);
+    layer->addNewKeyFrameAt(5);
+
+    layer->restoreKeyFrames({ 3, 5 }, before);
+
+    REQUIRE(layer->keyExists(1));
+    REQUIRE(layer->keyExists(3));
+    REQUIRE_FALSE(layer->keyExists(5));
+    REQUIRE(static_cast<BitmapImage*>(layer->getKeyFrameAt(3))->bounds().isEmpty());
+    REQUIRE(layer->keyFrameCount() == 2);
+
+    delete obj;
+}
+
+TEST_CASE("Layer::retimeKeyFrames()")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addNewKeyFrameAt(3);
+    layer->addNewKeyFrameAt(4);
+    layer->addNewKeyFrameAt(8);
+    layer->clearDirtyFrames();
+
+    SECTION("Keyframes swap and shift onto each other in one step")
+    {
+        KeyFrame* key3 = layer->getKeyFrameAt(3);
+        KeyFrame* key4 = layer->getKeyFrameAt(4);
+        layer->setFrameSelected(4, true);
+        layer->setFrameSelected(3, true);
+
+        REQUIRE(layer->retimeKeyFrames({ { 3, 4 }, { 4, 6 } }));
+
+        REQUIRE(layer->getKeyFrameAt(4) == key3);
+        REQUIRE(layer->getKeyFrameAt(6) == key4);
+        REQUIRE(key4->pos() == 6);
+        REQUIRE_FALSE(layer->keyExists(3));
+        REQUIRE(layer->keyFrameCount() == 4);
+
+        REQUIRE(layer->selectedKeyFramesByLast() == QList<int>({ 4, 6 }));
+        REQUIRE(layer->dirtyFrameRanges() == QList<std::pair<int, int>>({ { 3, 6 } }));
+    }
+
+    SECTION("Landing on a keyframe that stays leaves the layer untouched")
+    {
+        REQUIRE_FALSE(layer->retimeKeyFrames({ { 3, 4 } }));
+        REQUIRE_FALSE(layer->retimeKeyFrames({ { 3, 5 }, { 4, 5 } }));
+        REQUIRE_FALSE(layer->retimeKeyFrames({ { 3, 0 } }));
+        REQUIRE_FALSE(layer->retimeKeyFrames({ { 5, 6 } }));
+
+        REQUIRE(layer->keyExists(3));
+        REQUIRE(layer->keyExists(4));
+        REQUIRE(layer->dirtyFrameRanges().isEmpty());
+    }
+
+    delete obj;
+}
+
+TEST_CASE("Layer::moveSelectedFrames()")
+{
+    Object* obj = new Object;
+    Layer* layer = obj->addNewBitmapLayer();
+    layer->addNewKeyFrameAt(2);
+    layer->addNewKeyFrameAt(5);
+    layer->addNewKeyFrameAt(6);
+
+    SECTION("Skips over keyframes that aren't selected")
+    {
+        layer->setFrameSelected(1, true);
+        layer->setFrameSelected(2, true);
+
+        REQUIRE(layer->moveSelectedFrames(3));
+        REQUIRE(layer->selectedKeyFramesPositions() == QList<int>({ 7, 8 }));
+        REQUIRE(layer->keyExists(5));
+        REQUIRE(layer->keyExists(6));
+    }
+
+    SECTION("Keeps selected frames that sit between keyframes clear of them")
+    {
+        layer->setFrameSelected(1, true);
+        layer->setFrameSelected(5, true);
+
+        REQUIRE(layer->moveSelectedFrames(1));
+        REQUIRE(layer->selectedKeyFramesPositions() == QList<int>({ 3, 7 }));
+        REQUIRE(layer->keyExists(2));
+        REQUIRE(layer->keyExists(6));
+    }
+
+    SECTION("Stops at the start of the timeline")
+    {
+        layer->setFrameSelected(5, true);
+        layer->setFrameSelected(6, true);
+
+        REQUIRE(layer->moveSelectedFrames(-10));
+        REQUIRE(layer->selectedKeyFramesPositions() == QList<int>({ 3, 4 }));
+        REQUIRE(layer->keyExists(1));
+        REQUIRE(layer->keyExists(2));
+    }
+
+    delete obj;
+}
 
 //TEST_CASE("Layer::")
@@ -23,6 +23,7 @@ GNU General Public License for more details.
 #include <QDir>
 #include <QDomElement>
 #include <QTemporaryDir>
+#include <QXmlStreamReader>
 
 TEST_CASE("Load bitmap layer from XML")
 {
@@ -34,6 +35,14 @@ TEST_CASE("Load bitmap layer from XML")
     QDomElement layerElem = doc.documentElement();
     ProgressCallback nullCallback = []() {};
 
+    // Read the layer element the way FileManager streams it from main.xml
+    auto loadLayer = [&](ProgressCallback progressStep)
+    {
+        QXmlStreamReader reader(doc.toString());
+        REQUIRE(reader.readNextStartElement());
+        bitmapLayer->loadDomElement(reader, dataDir.path(), progressStep);
+    };
+
     auto createFrame = [&layerElem, &doc](QString src = "001.001.png", int frame = 1, int topLeftX = 0, int topLeftY = 0)
     {
         QDomElement frameElem = doc.createElement("image");
@@ -46,7 +55,7 @@ TEST_CASE("Load bitmap layer from XML")
 
     SECTION("No frames")
     {
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), []() {});
+        loadLayer([]() {});
 
         REQUIRE(bitmapLayer->keyFrameCount() == 0);
     }
@@ -55,7 +64,7 @@ TEST_CASE("Load bitmap layer from XML")
     {
         createFrame("001.001.png", 1, 0, 0);
 
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(bitmapLayer->keyFrameCount() == 1);
         BitmapImage* frame = static_cast<BitmapImage*>(bitmapLayer->getKeyFrameAt(1));
@@ -70,7 +79,7 @@ TEST_CASE("Load bitmap layer from XML")
         createFrame("001.001.png", 1);
         createFrame("001.002.png", 2);
 
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(bitmapLayer->keyFrameCount() == 2);
         for (int i = 1; i <= 2; i++)
@@ -87,7 +96,7 @@ TEST_CASE("Load bitmap layer from XML")
     {
         createFrame(QDir(dataDir.filePath("001.001.png")).absolutePath());
 
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(bitmapLayer->keyFrameCount() == 0);
     }
@@ -97,7 +106,7 @@ TEST_CASE("Load bitmap layer from XML")
         QTemporaryDir otherDir;
         createFrame(QDir(dataDir.path()).relativeFilePath(QDir(otherDir.filePath("001.001.png")).absolutePath()));
 
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(bitmapLayer->keyFrameCount() == 0);
     }
@@ -106,7 +115,7 @@ TEST_CASE("Load bitmap layer from XML")
     {
         createFrame("subdir/001.001.png");
 
-        bitmapLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(bitmapLayer->keyFrameCount() == 1);
         BitmapImage* frame = static_cast<BitmapImage*>(bitmapLayer->getKeyFrameAt(1));
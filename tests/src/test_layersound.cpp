@@ -23,6 +23,7 @@ GNU General Public License for more details.
 #include <QDir>
 #include <QDomElement>
 #include <QTemporaryDir>
+#include <QXmlStreamReader>
 
 TEST_CASE("Load sound layer from XML")
 {
@@ -34,6 +35,14 @@ TEST_CASE("Load sound layer from XML")
     QDomElement layerElem = doc.documentElement();
     ProgressCallback nullCallback = []() {};
 
+    // Read the layer element the way FileManager streams it from main.xml
+    auto loadLayer = [&](ProgressCallback progressStep)
+    {
+        QXmlStreamReader reader(doc.toString());
+        REQUIRE(reader.readNextStartElement());
+        soundLayer->loadDomElement(reader, dataDir.path(), progressStep);
+    };
+
     auto createFrame = [&layerElem, &doc, &dataDir](QString src = "sound_001.wav", int frame = 1)
     {
         QDomElement clipElem = doc.createElement("sound");
@@ -50,7 +59,7 @@ TEST_CASE("Load sound layer from XML")
 
     SECTION("No clips")
     {
-        soundLayer->loadDomElement(layerElem, dataDir.path(), []() {});
+        loadLayer([]() {});
 
         REQUIRE(soundLayer->keyFrameCount() == 0);
     }
@@ -59,7 +68,7 @@ TEST_CASE("Load sound layer from XML")
     {
         createFrame("sound_001.wav", 1);
 
-        soundLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(soundLayer->keyFrameCount() == 1);
         SoundClip* frame = static_cast<SoundClip*>(soundLayer->getKeyFrameAt(1));
@@ -72,7 +81,7 @@ TEST_CASE("Load sound layer from XML")
         createFrame("sound_001.wav", 1);
         createFrame("sound_002.wav", 2);
 
-        soundLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(soundLayer->keyFrameCount() == 2);
         for (int i = 1; i <= 2; i++)
@@ -87,7 +96,7 @@ TEST_CASE("Load sound layer from XML")
     {
         createFrame(QDir(dataDir.filePath("sound_001.wav")).absolutePath());
 
-        soundLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(soundLayer->keyFrameCount() == 0);
     }
@@ -97,7 +106,7 @@ TEST_CASE("Load sound layer from XML")
         QTemporaryDir otherDir;
         createFrame(QDir(dataDir.path()).relativeFilePath(QDir(otherDir.filePath("sound_001.wav")).absolutePath()));
 
-        soundLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(soundLayer->keyFrameCount() == 0);
     }
@@ -107,7 +116,7 @@ TEST_CASE("Load sound layer from XML")
         REQUIRE(QDir(dataDir.path()).mkdir("subdir"));
         createFrame("subdir/sound_001.wav");
 
-        soundLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(soundLayer->keyFrameCount() == 1);
         SoundClip* frame = static_cast<SoundClip*>(soundLayer->getKeyFrameAt(1));
@@ -25,6 +25,7 @@ GNU General Public License for more details.
 #include <QDomElement>
 #include <QTemporaryDir>
 #include <QTextStream>
+#include <QXmlStreamReader>
 
 TEST_CASE("Load vector layer from XML")
 {
@@ -36,6 +37,14 @@ TEST_CASE("Load vector layer from XML")
     QDomElement layerElem = doc.documentElement();
     ProgressCallback nullCallback = []() {};
 
+    // Read the layer element the way FileManager streams it from main.xml
+    auto loadLayer = [&](ProgressCallback progressStep)
+    {
+        QXmlStreamReader reader(doc.toString());
+        REQUIRE(reader.readNextStartElement());
+        vectorLayer->loadDomElement(reader, dataDir.path(), progressStep);
+    };
+
     QFile vecFile(dataDir.filePath("temp.vec"));
     vecFile.open(QIODevice::WriteOnly);
 
@@ -58,7 +67,7 @@ TEST_CASE("Load vector layer from XML")
 
     SECTION("No frames")
     {
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), []() {});
+        loadLayer([]() {});
 
         REQUIRE(vectorLayer->keyFrameCount() == 0);
     }
@@ -67,7 +76,7 @@ TEST_CASE("Load vector layer from XML")
     {
         createFrame("001.001.vec", 1);
 
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(vectorLayer->keyFrameCount() == 1);
         VectorImage* frame = static_cast<VectorImage*>(vectorLayer->getKeyFrameAt(1));
@@ -80,7 +89,7 @@ TEST_CASE("Load vector layer from XML")
         createFrame("001.001.vec", 1);
         createFrame("001.002.vec", 2);
 
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(vectorLayer->keyFrameCount() == 2);
         for (int i = 1; i <= 2; i++)
@@ -95,7 +104,7 @@ TEST_CASE("Load vector layer from XML")
     {
         createFrame(QDir(dataDir.filePath("001.001.vec")).absolutePath());
 
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(vectorLayer->keyFrameCount() == 0);
     }
@@ -105,7 +114,7 @@ TEST_CASE("Load vector layer from XML")
         QTemporaryDir otherDir;
         createFrame(QDir(dataDir.path()).relativeFilePath(QDir(otherDir.filePath("001.001.vec")).absolutePath()));
 
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(vectorLayer->keyFrameCount() == 0);
     }
@@ -115,11 +124,37 @@ TEST_CASE("Load vector layer from XML")
         REQUIRE(QDir(dataDir.path()).mkdir("subdir"));
         createFrame("subdir/001.001.vec");
 
-        vectorLayer->loadDomElement(layerElem, dataDir.path(), nullCallback);
+        loadLayer(nullCallback);
 
         REQUIRE(vectorLayer->keyFrameCount() == 1);
         VectorImage* frame = static_cast<VectorImage*>(vectorLayer->getKeyFrameAt(1));
         REQUIRE(frame != nullptr);
         REQUIRE(closestCanonicalPath(frame->fileName()) == closestCanonicalPath(dataDir.filePath("subdir/001.001.vec")));
     }
+
+    SECTION("Color usage saved with the frame")
+    {
+        createFrame("001.001.vec", 1);
+        layerElem.lastChildElement("image").setAttribute("colors", "0:2 4:1");
+
+        loadLayer(nullCallback);
+
+        VectorImage* frame = static_cast<VectorImage*>(vectorLayer->getKeyFrameAt(1));
+        REQUIRE(frame->colorUsageKnown());
+        REQUIRE(static_cast<LayerVector*>(vectorLayer.get())->usesColor(4));
+        REQUIRE(frame->colorUsage() == QMap<int, int>({ { 0, 2 }, { 4, 1 } }));
+        REQUIRE_FALSE(frame->isLoaded());
+    }
+
+    SECTION("Frames saved without color usage")
+    {
+        createFrame("001.001.vec", 1);
+
+        loadLayer(nullCallback);
+
+        VectorImage* frame = static_cast<VectorImage*>(vectorLayer->getKeyFrameAt(1));
+        REQUIRE_FALSE(frame->colorUsageKnown());
+        REQUIRE_FALSE(static_cast<LayerVector*>(vectorLayer.get())->usesColor(0));
+        REQUIRE(frame->isLoaded());
+    }
 }
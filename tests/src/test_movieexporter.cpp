@@ -0,0 +1,128 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QFile>
+#include <QHash>
+#include <QTemporaryDir>
+#include "movieexporter.h"
+#include "layersound.h"
+#include "object.h"
+#include "soundclip.h"
+
+namespace
+{
+    void addClip(LayerSound* layer, int position, const QString& fileName)
+    {
+        SoundClip* clip = new SoundClip;
+        clip->setFileName(fileName);
+        layer->addKeyFrame(position, clip);
+    }
+
+    std::shared_ptr<const SoundMixer::Samples> constantSamples(qint16 value, qint64 length)
+    {
+        return std::make_shared<SoundMixer::Samples>(static_cast<int>(length * SoundMixer::CHANNEL_COUNT), value);
+    }
+
+    qint16 sampleAt(const QByteArray& data, qint64 index, int channel)
+    {
+        return reinterpret_cast<const qint16*>(data.constData())[index * SoundMixer::CHANNEL_COUNT + channel];
+    }
+}
+
+TEST_CASE("MovieExporter::assembleAudio()")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString audioPath = dir.filePath("audio.pcm");
+
+    // Half a second from frame 1 and a second from frame 3, both loud enough to clip once summed
+    Object* obj = new Object;
+    LayerSound* layer = obj->addNewSoundLayer();
+    addClip(layer, 1, "short.wav");
+    addClip(layer, 3, "long.wav");
+    addClip(layer, 40, "short.wav");
+
+    QHash<QString, std::shared_ptr<const SoundMixer::Samples>> files;
+    files.insert("short.wav", constantSamples(20000, SoundMixer::SAMPLE_RATE / 2));
+    files.insert("long.wav", constantSamples(20000, SoundMixer::SAMPLE_RATE));
+
+    QStringList decodedFiles;
+    auto decodeClip = [&files, &decodedFiles](const QString& soundFile, std::shared_ptr<const SoundMixer::Samples>& samples)
+    {
+        decodedFiles.append(soundFile);
+        samples = files.value(soundFile);
+        return Status(Status::OK);
+    };
+
+    ExportMovieDesc desc;
+    desc.fps = 12;
+    const qint64 samplesPerFrame = SoundMixer::SAMPLE_RATE / desc.fps;
+    const qint64 longClipStart = SoundMixer::frameToSample(3, desc.fps);
+    const qint64 shortClipEnd = SoundMixer::SAMPLE_RATE / 2;
+
+    MovieExporter exporter;
+
+    SECTION("Export from the first frame")
+    {
+        desc.startFrame = 1;
+        desc.endFrame = 8;
+        REQUIRE(exporter.assembleAudio(obj, desc, audioPath, decodeClip, [](float) {}).ok());
+
+        QFile file(audioPath);
+        REQUIRE(file.open(QIODevice::ReadOnly));
+        const QByteArray data = file.readAll();
+        REQUIRE(data.size() == 8 * samplesPerFrame * SoundMixer::BYTES_PER_FRAME);
+
+        // Each sound file is decoded once, even if several clips play it
+        REQUIRE(decodedFiles.count() == 2);
+
+        for (int channel = 0; channel < SoundMixer::CHANNEL_COUNT; channel++)
+        {
+            REQUIRE(sampleAt(data, 0, channel) == 20000);
+            REQUIRE(sampleAt(data, longClipStart - 1, channel) == 20000);
+            REQUIRE(sampleAt(data, longClipStart, channel) == 32767);
+            REQUIRE(sampleAt(data, shortClipEnd - 1, channel) == 32767);
+            REQUIRE(sampleAt(data, shortClipEnd, channel) == 20000);
+        }
+    }
+
+    SECTION("Export from a later frame")
+    {
+        desc.startFrame = 3;
+        desc.endFrame = 8;
+        REQUIRE(exporter.assembleAudio(obj, desc, audioPath, decodeClip, [](float) {}).ok());
+
+        QFile file(audioPath);
+        REQUIRE(file.open(QIODevice::ReadOnly));
+        const QByteArray data = file.readAll();
+        REQUIRE(data.size() == 6 * samplesPerFrame * SoundMixer::BYTES_PER_FRAME);
+
+        // The file starts with the first exported frame
+        REQUIRE(sampleAt(data, 0, 0) == 32767);
+        REQUIRE(sampleAt(data, shortClipEnd - longClipStart - 1, 0) == 32767);
+        REQUIRE(sampleAt(data, shortClipEnd - longClipStart, 0) == 20000);
+    }
+
+    SECTION("Nothing to mix")
+    {
+        layer->setVisible(false);
+        REQUIRE(exporter.assembleAudio(obj, desc, audioPath, decodeClip, [](float) {}) == Status::SAFE);
+        REQUIRE_FALSE(QFile::exists(audioPath));
+    }
+
+    delete obj;
+}
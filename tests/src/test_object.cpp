@@ -16,9 +16,8 @@ GNU General Public License for more details.
 #include "catch.hpp"
 
 #include <memory>
-#include <QDomDocument>
-#include <QDomElement>
 #include <QTemporaryDir>
+#include <QXmlStreamReader>
 #include "object.h"
 #include "layerbitmap.h"
 #include "layervector.h"
@@ -145,12 +144,11 @@ void TestObject::testLoadXML()
     sout << "</object>";
     sout.flush();
 
-    QDomDocument doc;
-    doc.setContent( strXMLContent );
-    QDomElement e = doc.firstChildElement( "object" );
-    QVERIFY( !e.isNull() );
+    QXmlStreamReader reader( strXMLContent );
+    QVERIFY( reader.readNextStartElement() );
+    QVERIFY( reader.name() == QLatin1String( "object" ) );
 
-    QVERIFY( obj->loadXML( e ) );
+    QVERIFY( obj->loadXML( reader, []() {} ) );
     
 }
 
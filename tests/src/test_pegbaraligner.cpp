@@ -0,0 +1,56 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include "pegbaraligner.h"
+#include "bitmapimage.h"
+
+TEST_CASE("PegBarAligner::findPoint()")
+{
+    BitmapImage image(QRect(10, 10, 100, 100), Qt::white);
+
+    SECTION("Leftmost column and topmost row of the dark pixels")
+    {
+        image.setPixel(30, 50, qRgb(0, 0, 0));
+        image.setPixel(20, 70, qRgb(0, 0, 0));
+        image.setPixel(25, 60, qRgb(200, 200, 200));
+
+        PegStatus result = PegBarAligner(nullptr, QRect(0, 0, 60, 100)).findPoint(image);
+        REQUIRE(result.ok());
+        REQUIRE(result.point == QPoint(20, 50));
+    }
+
+    SECTION("Only within the search rect")
+    {
+        image.setPixel(15, 15, qRgb(0, 0, 0));
+        image.setPixel(40, 40, qRgb(0, 0, 0));
+
+        PegStatus result = PegBarAligner(nullptr, QRect(30, 30, 20, 20)).findPoint(image);
+        REQUIRE(result.ok());
+        REQUIRE(result.point == QPoint(40, 40));
+    }
+
+    SECTION("Translucent pixels are not peg holes")
+    {
+        image.setPixel(40, 40, qRgba(0, 0, 0, 128));
+        REQUIRE_FALSE(PegBarAligner(nullptr, QRect(0, 0, 200, 200)).findPoint(image).ok());
+    }
+
+    SECTION("Search rect outside of the image")
+    {
+        REQUIRE_FALSE(PegBarAligner(nullptr, QRect(500, 500, 20, 20)).findPoint(image).ok());
+    }
+}
@@ -0,0 +1,128 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include "planarmap.h"
+#include "beziercurve.h"
+
+namespace
+{
+// A curve of straight sections through the points
+BezierCurve createPolyline(const QList<QPointF>& points)
+{
+    return BezierCurve(points, false);
+}
+}
+
+TEST_CASE("PlanarMap")
+{
+    PlanarMap map;
+    QVector<BezierCurve> curves;
+
+    SECTION("A closed curve encloses one face")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 } }));
+        map.update(curves);
+
+        REQUIRE(map.nodeCount() == 4);
+        REQUIRE(map.faceCount() == 1);
+        REQUIRE(map.faceAt(QPointF(5, 5)) == 0);
+        REQUIRE(map.faceAt(QPointF(15, 5)) == -1);
+        REQUIRE(map.face(0).area == Approx(100));
+        REQUIRE(map.face(0).boundary.size() == 4);
+    }
+
+    SECTION("Curves meeting at their vertices share nodes")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 } }));
+        curves.append(createPolyline({ { 10, 0 }, { 10, 10 } }));
+        curves.append(createPolyline({ { 10, 10 }, { 0, 10 } }));
+        curves.append(createPolyline({ { 0, 10 }, { 0, 0 } }));
+        map.update(curves);
+
+        REQUIRE(map.nodeCount() == 4);
+        REQUIRE(map.faceCount() == 1);
+
+        QList<int> curveNumbers;
+        for (const VertexRef& vertex : map.face(0).boundary)
+        {
+            if (!curveNumbers.contains(vertex.curveNumber)) { curveNumbers.append(vertex.curveNumber); }
+        }
+        REQUIRE(curveNumbers.size() == 4);
+    }
+
+    SECTION("A curve across a face splits it")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 5, 0 }, { 10, 0 }, { 10, 10 }, { 5, 10 }, { 0, 10 }, { 0, 0 } }));
+        curves.append(createPolyline({ { 5, 0 }, { 5, 10 } }));
+        map.update(curves);
+
+        REQUIRE(map.faceCount() == 2);
+        const int left = map.faceAt(QPointF(2, 5));
+        const int right = map.faceAt(QPointF(8, 5));
+        REQUIRE(left != -1);
+        REQUIRE(right != -1);
+        REQUIRE(left != right);
+        REQUIRE(map.face(left).area == Approx(50));
+
+        SECTION("and removing it joins them again")
+        {
+            curves.removeAt(1);
+            map.update(curves);
+            REQUIRE(map.faceCount() == 1);
+            REQUIRE(map.faceAt(QPointF(2, 5)) == map.faceAt(QPointF(8, 5)));
+        }
+    }
+
+    SECTION("A shape inside a face is a hole in it")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 } }));
+        curves.append(createPolyline({ { 4, 4 }, { 6, 4 }, { 6, 6 }, { 4, 6 }, { 4, 4 } }));
+        map.update(curves);
+
+        REQUIRE(map.faceCount() == 2);
+        const int outer = map.faceAt(QPointF(2, 2));
+        const int inner = map.faceAt(QPointF(5, 5));
+        REQUIRE(outer != inner);
+        REQUIRE_FALSE(map.face(outer).path.contains(QPointF(5, 5)));
+    }
+
+    SECTION("Open curves and lines sticking into a face")
+    {
+        curves.append(createPolyline({ { 0, 0 }, { 5, 5 }, { 10, 0 } }));
+        map.update(curves);
+        REQUIRE(map.faceCount() == 0);
+
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 } }));
+        curves.append(createPolyline({ { 5, 5 }, { 5, 1 } }));
+        map.update(curves);
+        REQUIRE(map.faceCount() == 1);
+        REQUIRE(map.faceAt(QPointF(3, 1)) == map.faceAt(QPointF(7, 1)));
+    }
+
+    SECTION("Unchanged curves are kept when others move")
+    {
+        curves.append(createPolyline({ { 20, 20 }, { 30, 20 } }));
+        curves.append(createPolyline({ { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 } }));
+        map.update(curves);
+        REQUIRE(map.face(0).boundary.first().curveNumber == 1);
+
+        curves.removeAt(0);
+        map.update(curves);
+        REQUIRE(map.nodeCount() == 4);
+        REQUIRE(map.face(0).boundary.first().curveNumber == 0);
+    }
+}
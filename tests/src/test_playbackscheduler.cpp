@@ -0,0 +1,126 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QList>
+#include "playbackscheduler.h"
+
+namespace
+{
+    const qint64 SECOND = 1000000;
+}
+
+TEST_CASE("PlaybackScheduler::advance()")
+{
+    PlaybackScheduler scheduler;
+
+    SECTION("On time")
+    {
+        scheduler.start(1, 1, 10, 10, false);
+        REQUIRE(scheduler.presentedFrame() == 1);
+        REQUIRE(scheduler.advance(SECOND / 20) == -1);
+
+        for (int frame = 2; frame <= 10; frame++)
+        {
+            REQUIRE(scheduler.advance(scheduler.timeOfStep(frame - 1)) == frame);
+        }
+        REQUIRE(scheduler.stats().droppedFrames == 0);
+    }
+
+    SECTION("Late frames are dropped")
+    {
+        scheduler.start(1, 1, 10, 10, false);
+        REQUIRE(scheduler.advance(SECOND / 2) == 6);
+        REQUIRE(scheduler.stats().droppedFrames == 4);
+        REQUIRE(scheduler.advance(SECOND * 6 / 10) == 7);
+        REQUIRE(scheduler.stats().droppedFrames == 4);
+    }
+
+    SECTION("Same clock, same frames")
+    {
+        const qint64 times[] = { 80000, 260000, 270000, 610000, 990000 };
+
+        QList<int> firstRun;
+        scheduler.start(3, 1, 20, 24, false);
+        for (qint64 time : times) { firstRun.append(scheduler.advance(time)); }
+
+        QList<int> secondRun;
+        scheduler.start(3, 1, 20, 24, false);
+        for (qint64 time : times) { secondRun.append(scheduler.advance(time)); }
+
+        REQUIRE(firstRun == secondRun);
+    }
+
+    SECTION("Stops after the last frame")
+    {
+        scheduler.start(8, 1, 10, 10, false);
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(2)) == 10);
+        REQUIRE_FALSE(scheduler.isFinished());
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(3)) == -1);
+        REQUIRE(scheduler.isFinished());
+    }
+
+    SECTION("Looping wraps around the range")
+    {
+        scheduler.start(4, 3, 5, 10, true);
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(1)) == 5);
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(2)) == 3);
+        REQUIRE(scheduler.loopOfStep(scheduler.presentedStep()) == 1);
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(6)) == 4);
+        REQUIRE(scheduler.stats().droppedFrames == 3);
+        REQUIRE_FALSE(scheduler.isFinished());
+    }
+}
+
+TEST_CASE("PlaybackScheduler::timeOfFrameInCurrentLoop()")
+{
+    PlaybackScheduler scheduler;
+    scheduler.start(1, 1, 10, 10, true);
+    REQUIRE(scheduler.timeOfFrameInCurrentLoop(5) == SECOND * 4 / 10);
+
+    scheduler.advance(scheduler.timeOfStep(12));
+    REQUIRE(scheduler.presentedFrame() == 3);
+    REQUIRE(scheduler.timeOfFrameInCurrentLoop(5) == SECOND * 14 / 10);
+}
+
+TEST_CASE("PlaybackScheduler stats")
+{
+    PlaybackScheduler scheduler;
+    scheduler.start(1, 1, 100, 10, false);
+
+    SECTION("Presentation latency")
+    {
+        REQUIRE(scheduler.recordPresentation(0));
+        REQUIRE(scheduler.advance(scheduler.timeOfStep(1)) == 2);
+        REQUIRE(scheduler.recordPresentation(scheduler.timeOfStep(1) + 20000));
+        REQUIRE_FALSE(scheduler.recordPresentation(scheduler.timeOfStep(1) + 40000));
+
+        REQUIRE(scheduler.stats().presentedFrames == 2);
+        REQUIRE(scheduler.stats().maxPresentLatency == 20000);
+        REQUIRE(scheduler.stats().averagePresentLatency() == 10000);
+    }
+
+    SECTION("Render time")
+    {
+        scheduler.recordRenderTime(1000);
+        scheduler.recordRenderTime(3000);
+        REQUIRE(scheduler.stats().averageRenderTime() == 2000);
+        REQUIRE(scheduler.stats().maxRenderTime == 3000);
+
+        scheduler.resetStats();
+        REQUIRE(scheduler.stats().renderCount == 0);
+    }
+}
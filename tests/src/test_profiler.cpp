@@ -0,0 +1,94 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include "profiler.h"
+#include "pencilerror.h"
+
+TEST_CASE("Profiler")
+{
+    Profiler::clear();
+
+    SECTION("Scopes are only recorded while enabled")
+    {
+        Profiler::setEnabled(false);
+        {
+            PROFILE_SCOPE("Test::disabled");
+        }
+        REQUIRE(Profiler::lastDuration("Test::disabled") == -1);
+        REQUIRE_FALSE(Profiler::hasEvents());
+
+        Profiler::setEnabled(true);
+        {
+            PROFILE_SCOPE("Test::enabled");
+        }
+        REQUIRE(Profiler::lastDuration("Test::enabled") >= 0);
+
+        // What was recorded can still be exported once the profiler is off
+        Profiler::setEnabled(false);
+        REQUIRE(Profiler::hasEvents());
+
+        Profiler::clear();
+        REQUIRE_FALSE(Profiler::hasEvents());
+    }
+
+    SECTION("Counters")
+    {
+        Profiler::addToCounter(Profiler::CANVAS_CACHE_HITS, 2);
+        Profiler::addToCounter(Profiler::CANVAS_CACHE_HITS, 3);
+        REQUIRE(Profiler::counter(Profiler::CANVAS_CACHE_HITS) == 5);
+
+        Profiler::clear();
+        REQUIRE(Profiler::counter(Profiler::CANVAS_CACHE_HITS) == 0);
+    }
+
+    SECTION("Chrome trace export")
+    {
+        Profiler::setEnabled(true);
+        Profiler::record("Test::export", 1000, 2000);
+
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        const QString path = dir.filePath("trace.json");
+        REQUIRE(Profiler::exportChromeTrace(path).ok());
+
+        QFile file(path);
+        REQUIRE(file.open(QFile::ReadOnly));
+        const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+
+        bool found = false;
+        for (const QJsonValue& value : events)
+        {
+            const QJsonObject event = value.toObject();
+            if (event["name"].toString() == "Test::export")
+            {
+                found = true;
+                REQUIRE(event["ph"].toString() == "X");
+                REQUIRE(event["ts"].toDouble() == 1.0);
+                REQUIRE(event["dur"].toDouble() == 2.0);
+            }
+        }
+        REQUIRE(found);
+    }
+
+    Profiler::setEnabled(false);
+}
@@ -0,0 +1,118 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QPixmap>
+#include "renderaheadqueue.h"
+
+
+static QPixmap canvasFilled(Qt::GlobalColor color)
+{
+    QPixmap canvas(4, 4);
+    canvas.fill(color);
+    return canvas;
+}
+
+TEST_CASE("RenderAheadQueue::take")
+{
+    RenderAheadQueue queue;
+
+    SECTION("Frame that was rendered ahead")
+    {
+        queue.push(2, canvasFilled(Qt::red));
+
+        QPixmap canvas;
+        REQUIRE(queue.take(2, canvas));
+        REQUIRE(canvas.toImage().pixelColor(0, 0) == QColor(Qt::red));
+        REQUIRE(queue.isEmpty());
+    }
+
+    SECTION("Frame that was not rendered ahead")
+    {
+        queue.push(2, canvasFilled(Qt::red));
+
+        QPixmap canvas;
+        REQUIRE_FALSE(queue.take(3, canvas));
+        REQUIRE(canvas.isNull());
+        REQUIRE(queue.size() == 1);
+    }
+
+    SECTION("Frames before the taken one are dropped")
+    {
+        queue.push(2, canvasFilled(Qt::red));
+        queue.push(3, canvasFilled(Qt::green));
+        queue.push(4, canvasFilled(Qt::blue));
+
+        QPixmap canvas;
+        REQUIRE(queue.take(3, canvas));
+        REQUIRE(canvas.toImage().pixelColor(0, 0) == QColor(Qt::green));
+        REQUIRE(queue.size() == 1);
+        REQUIRE_FALSE(queue.take(2, canvas));
+        REQUIRE(queue.take(4, canvas));
+    }
+}
+
+TEST_CASE("RenderAheadQueue::setCapacity")
+{
+    RenderAheadQueue queue;
+    queue.setCapacity(2);
+
+    queue.push(2, canvasFilled(Qt::red));
+    queue.push(3, canvasFilled(Qt::green));
+    queue.push(4, canvasFilled(Qt::blue));
+    REQUIRE(queue.size() == 2);
+
+    QPixmap canvas;
+    REQUIRE_FALSE(queue.take(2, canvas));
+    REQUIRE(queue.take(3, canvas));
+
+    queue.setCapacity(0);
+    REQUIRE(queue.isEmpty());
+}
+
+TEST_CASE("RenderAheadQueue generation")
+{
+    RenderAheadQueue queue;
+    queue.push(2, canvasFilled(Qt::red));
+    const int generation = queue.generation();
+
+    SECTION("Same view keeps the frames, like a scrub reports it")
+    {
+        queue.setView(QTransform());
+        REQUIRE(queue.generation() == generation);
+
+        QPixmap canvas;
+        REQUIRE(queue.take(2, canvas));
+    }
+
+    SECTION("Another view drops the frames")
+    {
+        queue.setView(QTransform::fromScale(2, 2));
+        REQUIRE(queue.generation() > generation);
+
+        QPixmap canvas;
+        REQUIRE_FALSE(queue.take(2, canvas));
+    }
+
+    SECTION("Content change drops the frames")
+    {
+        queue.invalidate();
+        REQUIRE(queue.generation() > generation);
+
+        QPixmap canvas;
+        REQUIRE_FALSE(queue.take(2, canvas));
+    }
+}
@@ -0,0 +1,120 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include "catch.hpp"
+
+#include "soundmixer.h"
+#include "audiosink.h"
+
+namespace
+{
+    SoundMixer::Track constantTrack(qint16 value, qint64 length, qint64 start)
+    {
+        SoundMixer::Track track;
+        track.samples = std::make_shared<SoundMixer::Samples>(static_cast<int>(length * SoundMixer::CHANNEL_COUNT), value);
+        track.start = start;
+        return track;
+    }
+
+    qint16 sampleAt(const QByteArray& data, qint64 index)
+    {
+        return reinterpret_cast<const qint16*>(data.constData())[index * SoundMixer::CHANNEL_COUNT];
+    }
+}
+
+TEST_CASE("SoundMixer::frameToSample()")
+{
+    REQUIRE(SoundMixer::frameToSample(1, 12) == 0);
+    REQUIRE(SoundMixer::frameToSample(13, 12) == SoundMixer::SAMPLE_RATE);
+    REQUIRE(SoundMixer::frameToSample(2, 25) == SoundMixer::SAMPLE_RATE / 25);
+}
+
+TEST_CASE("SoundMixer::resample()")
+{
+    SECTION("Mixer format is left as is")
+    {
+        const qint16 samples[] = { 1, 2, 3, 4, 5, 6 };
+        SoundMixer::Samples result = SoundMixer::resample(samples, 3, 2, SoundMixer::SAMPLE_RATE);
+        REQUIRE(result == SoundMixer::Samples({ 1, 2, 3, 4, 5, 6 }));
+    }
+
+    SECTION("Mono at half the rate")
+    {
+        const qint16 samples[] = { 0, 100, 200 };
+        SoundMixer::Samples result = SoundMixer::resample(samples, 3, 1, SoundMixer::SAMPLE_RATE / 2);
+        REQUIRE(result == SoundMixer::Samples({ 0, 0, 50, 50, 100, 100, 150, 150, 200, 200, 200, 200 }));
+    }
+
+    SECTION("Nothing to convert")
+    {
+        REQUIRE(SoundMixer::resample(nullptr, 0, 2, SoundMixer::SAMPLE_RATE).isEmpty());
+    }
+}
+
+TEST_CASE("SoundMixer mixing")
+{
+    SoundMixer mixer;
+    NullAudioSink sink;
+    REQUIRE(sink.start(&mixer));
+
+    const qint64 second = 1000000;
+    const qint64 samplesPer10ms = SoundMixer::SAMPLE_RATE / 100;
+
+    SECTION("Tracks are summed from their offsets")
+    {
+        mixer.setTracks({ constantTrack(100, samplesPer10ms * 2, 0),
+                          constantTrack(1000, samplesPer10ms * 2, samplesPer10ms) });
+
+        QByteArray data = sink.pull(second * 4 / 100);
+        REQUIRE(data.size() == samplesPer10ms * 4 * SoundMixer::BYTES_PER_FRAME);
+        REQUIRE(sampleAt(data, 0) == 100);
+        REQUIRE(sampleAt(data, samplesPer10ms) == 1100);
+        REQUIRE(sampleAt(data, samplesPer10ms * 2) == 1000);
+        REQUIRE(sampleAt(data, samplesPer10ms * 3) == 0);
+        REQUIRE(mixer.position() == samplesPer10ms * 4);
+        REQUIRE(sink.processedUSecs() == second * 4 / 100);
+    }
+
+    SECTION("Loud sums are clamped")
+    {
+        mixer.setTracks({ constantTrack(30000, samplesPer10ms, 0),
+                          constantTrack(30000, samplesPer10ms, 0) });
+        REQUIRE(sampleAt(sink.pull(second / 100), 0) == 32767);
+
+        mixer.setTracks({ constantTrack(-30000, samplesPer10ms, 0),
+                          constantTrack(-30000, samplesPer10ms, 0) });
+        mixer.setPosition(0);
+        REQUIRE(sampleAt(sink.pull(second / 100), 0) == -32768);
+    }
+
+    SECTION("Scrub windows play a limited length")
+    {
+        mixer.setTracks({ constantTrack(500, SoundMixer::SAMPLE_RATE, 0) });
+        mixer.setPosition(samplesPer10ms * 10, samplesPer10ms);
+
+        QByteArray data = sink.pull(second * 2 / 100);
+        REQUIRE(sampleAt(data, 0) == 500);
+        REQUIRE(sampleAt(data, samplesPer10ms - 1) == 500);
+        REQUIRE(sampleAt(data, samplesPer10ms) == 0);
+    }
+
+    SECTION("Stopped sinks don't pull")
+    {
+        sink.stop();
+        REQUIRE(sink.pull(second).isEmpty());
+        REQUIRE(mixer.position() == 0);
+    }
+}
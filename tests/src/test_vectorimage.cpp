@@ -1,6 +1,10 @@
 #include "vectorimage.h"
 #include "catch.hpp"
 
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryDir>
+
 TEST_CASE("VectorImage removeColor")
 {
     auto vImage = VectorImage();
@@ -25,3 +29,255 @@ TEST_CASE("VectorImage removeColor")
         REQUIRE(vImage.curve(0).getColorNumber() == 0);
     }
 }
+
+namespace
+{
+    void createDrawing(VectorImage& image)
+    {
+        BezierCurve first({ QPointF(-20.5, 10), QPointF(30, 40.25), QPointF(80, -12) });
+        first.setWidth(3.5);
+        first.setColorNumber(2);
+        first.setVariableWidth(true);
+        image.addCurve(first, 1.0, false);
+
+        BezierCurve second({ QPointF(0, 0), QPointF(-64, 32) });
+        second.setWidth(1);
+        second.setColorNumber(1);
+        second.setFilled(true);
+        image.addCurve(second, 1.0, false);
+
+        image.addArea(BezierArea({ VertexRef(0, -1), VertexRef(0, 0), VertexRef(1, 0) }, 3));
+    }
+
+    // Points are stored as floats, and with six significant digits in .vec files
+    void requireClose(QPointF a, QPointF b)
+    {
+        REQUIRE(a.x() == Approx(b.x()).margin(0.01));
+        REQUIRE(a.y() == Approx(b.y()).margin(0.01));
+    }
+
+    void requireSameDrawing(VectorImage& a, VectorImage& b)
+    {
+        REQUIRE(a.isEmpty() == b.isEmpty());
+        REQUIRE(a.getLastCurveNumber() == b.getLastCurveNumber());
+        for (int i = 0; i <= a.getLastCurveNumber() && !a.isEmpty(); i++)
+        {
+            const BezierCurve& ca = a.curve(i);
+            const BezierCurve& cb = b.curve(i);
+            REQUIRE(ca.getColorNumber() == cb.getColorNumber());
+            REQUIRE(ca.getWidth() == cb.getWidth());
+            REQUIRE(ca.getVariableWidth() == cb.getVariableWidth());
+            REQUIRE(ca.isFilled() == cb.isFilled());
+            REQUIRE(ca.getVertexSize() == cb.getVertexSize());
+            requireClose(ca.getOrigin(), cb.getOrigin());
+            for (int v = 0; v < ca.getVertexSize(); v++)
+            {
+                requireClose(ca.getC1(v), cb.getC1(v));
+                requireClose(ca.getC2(v), cb.getC2(v));
+                requireClose(ca.getVertex(v), cb.getVertex(v));
+                REQUIRE(ca.getPressure(v) == cb.getPressure(v));
+            }
+        }
+        REQUIRE(a.mArea.size() == b.mArea.size());
+        for (int i = 0; i < a.mArea.size(); i++)
+        {
+            REQUIRE(a.mArea[i].mColorNumber == b.mArea[i].mColorNumber);
+            REQUIRE(a.mArea[i].mVertex == b.mArea[i].mVertex);
+        }
+    }
+}
+
+TEST_CASE("VectorImage binary format")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    VectorImage image;
+    createDrawing(image);
+
+    SECTION("Round trip through a .vecb file")
+    {
+        const QString path = dir.filePath("001.001.vecb");
+        REQUIRE(image.write(path, "VECB").ok());
+
+        QFile file(path);
+        REQUIRE(file.open(QFile::ReadOnly));
+        REQUIRE(file.read(4) == "PVEC");
+        file.close();
+
+        VectorImage loaded;
+        REQUIRE(loaded.read(path).ok());
+        requireSameDrawing(image, loaded);
+    }
+
+    SECTION("Compressed")
+    {
+        QBuffer buffer;
+        buffer.open(QBuffer::ReadWrite);
+        REQUIRE(image.writeBinary(&buffer, true).ok());
+
+        buffer.seek(0);
+        VectorImage loaded;
+        REQUIRE(loaded.readBinary(&buffer).ok());
+        requireSameDrawing(image, loaded);
+    }
+
+    SECTION("Converting between .vec and .vecb keeps the drawing")
+    {
+        REQUIRE(image.write(dir.filePath("a.vec"), "VEC").ok());
+        VectorImage fromXml;
+        REQUIRE(fromXml.read(dir.filePath("a.vec")).ok());
+
+        REQUIRE(fromXml.write(dir.filePath("a.vecb"), "VECB").ok());
+        VectorImage fromBinary;
+        REQUIRE(fromBinary.read(dir.filePath("a.vecb")).ok());
+
+        REQUIRE(fromBinary.write(dir.filePath("b.vec"), "VEC").ok());
+        VectorImage backToXml;
+        REQUIRE(backToXml.read(dir.filePath("b.vec")).ok());
+
+        requireSameDrawing(image, fromBinary);
+        requireSameDrawing(image, backToXml);
+    }
+
+    SECTION("Truncated data is rejected")
+    {
+        QBuffer buffer;
+        buffer.open(QBuffer::ReadWrite);
+        REQUIRE(image.writeBinary(&buffer).ok());
+
+        QByteArray truncated = buffer.data();
+        truncated.chop(6);
+        QBuffer truncatedBuffer(&truncated);
+        truncatedBuffer.open(QBuffer::ReadOnly);
+
+        VectorImage loaded;
+        REQUIRE_FALSE(loaded.readBinary(&truncatedBuffer).ok());
+    }
+}
+
+TEST_CASE("VectorImage lazy loading")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath("001.001.vecb");
+
+    VectorImage image;
+    createDrawing(image);
+    REQUIRE(image.write(path, "VECB").ok());
+
+    VectorImage lazy;
+    lazy.setFileName(path);
+    lazy.setModified(false);
+    lazy.unloadFile();
+    REQUIRE_FALSE(lazy.isLoaded());
+    REQUIRE(lazy.memoryUsage() == 0);
+
+    SECTION("Read on first use")
+    {
+        REQUIRE_FALSE(lazy.isEmpty());
+        REQUIRE(lazy.isLoaded());
+        REQUIRE(lazy.memoryUsage() > 0);
+        requireSameDrawing(image, lazy);
+    }
+
+    SECTION("Unloaded again when not modified")
+    {
+        lazy.loadFile();
+        lazy.unloadFile();
+        REQUIRE_FALSE(lazy.isLoaded());
+    }
+
+    SECTION("Modified frames stay in memory")
+    {
+        lazy.removeCurveAt(0);
+        lazy.unloadFile();
+        REQUIRE(lazy.isLoaded());
+        REQUIRE(lazy.getLastCurveNumber() == 0);
+    }
+
+    SECTION("Copies are read from the file")
+    {
+        VectorImage copy(lazy);
+        requireSameDrawing(image, copy);
+    }
+
+    SECTION("Colors are counted before unloading")
+    {
+        const QMap<int, int> usage({ { 1, 1 }, { 2, 1 }, { 3, 1 } });
+        REQUIRE(image.colorUsage() == usage);
+
+        lazy.loadFile();
+        lazy.unloadFile();
+        REQUIRE(lazy.colorUsageKnown());
+        REQUIRE(lazy.usesColor(3));
+        REQUIRE_FALSE(lazy.usesColor(0));
+        REQUIRE(lazy.colorUsage() == usage);
+        REQUIRE_FALSE(lazy.isLoaded());
+    }
+
+    SECTION("A file that cannot be read is reported")
+    {
+        REQUIRE(QFile::remove(path));
+        REQUIRE_FALSE(lazy.load().ok());
+        REQUIRE(lazy.isLoaded());
+        REQUIRE(lazy.isEmpty());
+    }
+
+    SECTION("Changing a color updates the usage")
+    {
+        lazy.setColorUsage({ { 1, 1 }, { 2, 1 }, { 3, 1 } });
+        lazy.moveColor(3, 0);
+        REQUIRE(lazy.isModified());
+        REQUIRE(lazy.colorUsage() == QMap<int, int>({ { 0, 1 }, { 1, 1 }, { 2, 1 } }));
+
+        lazy.removeColor(1);
+        REQUIRE(lazy.colorUsage() == QMap<int, int>({ { 0, 2 }, { 1, 1 } }));
+    }
+}
+
+TEST_CASE("VectorImage fill")
+{
+    VectorImage image;
+    BezierCurve square(QList<QPointF>({ { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 } }), false);
+    image.addCurve(square, 1.0, false);
+
+    SECTION("Filling the region around a point")
+    {
+        REQUIRE(image.fillArea(QPointF(5, 5), 2));
+        REQUIRE(image.mArea.size() == 1);
+        REQUIRE(image.getLastAreaNumber(QPointF(5, 5)) == 0);
+        REQUIRE(image.getColorNumber(QPointF(5, 5)) == 2);
+        REQUIRE(image.getLastAreaNumber(QPointF(15, 5)) == -1);
+    }
+
+    SECTION("Filling the same region again changes its color")
+    {
+        image.fillArea(QPointF(5, 5), 2);
+        REQUIRE(image.fillArea(QPointF(2, 8), 3));
+        REQUIRE(image.mArea.size() == 1);
+        REQUIRE(image.getColorNumber(QPointF(5, 5)) == 3);
+    }
+
+    SECTION("Nothing to fill outside the curves")
+    {
+        REQUIRE_FALSE(image.fillArea(QPointF(20, 20), 2));
+        REQUIRE(image.mArea.isEmpty());
+    }
+
+    SECTION("Area paths follow the curves")
+    {
+        image.fillArea(QPointF(5, 5), 2);
+        image.setSelected(0, true);
+        image.applySelectionTransformation(QTransform::fromTranslate(100, 0));
+        REQUIRE(image.getLastAreaNumber(QPointF(105, 5)) == 0);
+        REQUIRE(image.getLastAreaNumber(QPointF(5, 5)) == -1);
+    }
+
+    SECTION("Filling a contour")
+    {
+        image.fillContour(0, 4);
+        REQUIRE(image.mArea.size() == 1);
+        REQUIRE(image.getColorNumber(QPointF(5, 5)) == 4);
+    }
+}
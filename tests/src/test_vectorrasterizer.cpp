@@ -0,0 +1,107 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include "vectorrasterizer.h"
+#include "vectorimage.h"
+
+namespace
+{
+    void createLine(VectorImage& image, int colorNumber)
+    {
+        BezierCurve line({ QPointF(-20, 0), QPointF(20, 0) });
+        line.setWidth(6);
+        line.setColorNumber(colorNumber);
+        image.addCurve(line, 1.0, false);
+    }
+
+    VectorRasterizer::Request createRequest()
+    {
+        VectorRasterizer::Request request;
+        request.transform = QTransform::fromTranslate(32, 32);
+        request.size = QSize(64, 64);
+        request.palette = { Qt::black, Qt::red, Qt::blue };
+        return request;
+    }
+}
+
+TEST_CASE("VectorRasterizer")
+{
+    VectorImage image;
+    createLine(image, 1);
+
+    VectorRasterizer rasterizer;
+    VectorRasterizer::Request request = createRequest();
+
+    SECTION("Paints with the colors of the palette")
+    {
+        QImage result = rasterizer.rasterize(&image, request);
+        REQUIRE(result.size() == QSize(64, 64));
+        REQUIRE(QColor(result.pixel(32, 32)) == QColor(Qt::red));
+        REQUIRE(qAlpha(result.pixel(32, 10)) == 0);
+
+        request.palette[1] = Qt::blue;
+        result = rasterizer.rasterize(&image, request);
+        REQUIRE(QColor(result.pixel(32, 32)) == QColor(Qt::blue));
+    }
+
+    SECTION("A color missing from the palette is painted white")
+    {
+        request.palette.resize(1);
+        QImage result = rasterizer.rasterize(&image, request);
+        REQUIRE(QColor(result.pixel(32, 32)) == QColor(Qt::white));
+    }
+
+    SECTION("Prefetched images are the same as the ones painted in place")
+    {
+        QImage inPlace = VectorRasterizer::render(image, request);
+
+        rasterizer.prefetch(&image, request);
+        QImage prefetched = rasterizer.rasterize(&image, request);
+        REQUIRE(prefetched == inPlace);
+    }
+
+    SECTION("A new version of the keyframe is painted again")
+    {
+        rasterizer.prefetch(&image, request);
+        QImage before = rasterizer.rasterize(&image, request);
+
+        image.clear();
+        QImage after = rasterizer.rasterize(&image, request);
+        REQUIRE(qAlpha(before.pixel(32, 32)) == 255);
+        REQUIRE(qAlpha(after.pixel(32, 32)) == 0);
+    }
+
+    SECTION("The transform is part of the request")
+    {
+        QImage centered = rasterizer.rasterize(&image, request);
+
+        request.transform = QTransform::fromTranslate(32, 16);
+        QImage moved = rasterizer.rasterize(&image, request);
+        REQUIRE(qAlpha(centered.pixel(32, 16)) == 0);
+        REQUIRE(QColor(moved.pixel(32, 16)) == QColor(Qt::red));
+    }
+
+    SECTION("The keyframe can go away while it's being rendered")
+    {
+        VectorImage* temporary = new VectorImage;
+        createLine(*temporary, 2);
+        rasterizer.prefetch(temporary, request);
+        delete temporary;
+
+        REQUIRE(QColor(rasterizer.rasterize(&image, request).pixel(32, 32)) == QColor(Qt::red));
+    }
+}
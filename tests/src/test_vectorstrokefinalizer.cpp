@@ -0,0 +1,198 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "catch.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include "vectorstrokefinalizer.h"
+#include "vectorimage.h"
+#include "editor.h"
+#include "layervector.h"
+#include "object.h"
+#include "scribblearea.h"
+#include "undoredomanager.h"
+
+namespace
+{
+    VectorStroke createStroke(qreal y)
+    {
+        VectorStroke stroke;
+        stroke.points = { QPointF(-20, y), QPointF(0, y), QPointF(20, y) };
+        stroke.pressures = { 1, 1, 1 };
+        stroke.tolerance = 1;
+        stroke.width = 4;
+        stroke.colorNumber = 2;
+        return stroke;
+    }
+
+    VectorStroke createStroke(LayerVector* layer, int frame, qreal y)
+    {
+        VectorStroke stroke = createStroke(y);
+        stroke.layerId = layer->id();
+        stroke.frame = frame;
+        stroke.keyFrame = layer->getVectorImageAtFrame(frame);
+        return stroke;
+    }
+}
+
+TEST_CASE("VectorStrokeFinalizer")
+{
+    VectorImage image;
+    VectorStrokeFinalizer::finalize(image, createStroke(0));
+
+    SECTION("Adds the fitted curve with the style of the stroke")
+    {
+        REQUIRE(image.getLastCurveNumber() == 0);
+
+        BezierCurve curve = image.getLastCurve();
+        REQUIRE(curve.getWidth() == 4);
+        REQUIRE(curve.getColorNumber() == 2);
+        REQUIRE_FALSE(curve.isInvisible());
+    }
+
+    SECTION("A stroke finalized on a snapshot replaces the drawing")
+    {
+        image.setFileName("001.vec");
+        std::unique_ptr<VectorImage> snapshot(image.snapshot());
+        VectorStrokeFinalizer::finalize(*snapshot, createStroke(10));
+        REQUIRE(image.getLastCurveNumber() == 0);
+
+        const int version = image.version();
+        image.replaceDrawing(*snapshot);
+
+        REQUIRE(image.getLastCurveNumber() == 1);
+        REQUIRE(image.getLastCurve().getVertex(0).y() == Approx(10));
+        REQUIRE(image.version() != version);
+        REQUIRE(image.fileName() == "001.vec");
+    }
+}
+
+TEST_CASE("VectorStrokeFinalizer queue")
+{
+    Object* object = new Object;
+    LayerVector* layer = object->addNewVectorLayer();
+    layer->addNewKeyFrameAt(1);
+    layer->addNewKeyFrameAt(5);
+    VectorImage* image1 = layer->getVectorImageAtFrame(1);
+    VectorImage* image5 = layer->getVectorImageAtFrame(5);
+
+    ScribbleArea* scribbleArea = new ScribbleArea(nullptr);
+    Editor* editor = new Editor;
+    editor->setScribbleArea(scribbleArea);
+    editor->setObject(object);
+    editor->init();
+
+    VectorStrokeFinalizer* finalizer = editor->vectorStrokes();
+    QList<int> committedFrames;
+    QObject::connect(finalizer, &VectorStrokeFinalizer::strokeCommitted, [&committedFrames](int, int frame)
+    {
+        committedFrames << frame;
+    });
+
+    SECTION("finish() commits the strokes in the order they were submitted")
+    {
+        finalizer->submit(createStroke(layer, 1, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 5, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 1, 10), nullptr, "");
+        finalizer->submit(createStroke(layer, 1, 20), nullptr, "");
+        REQUIRE(finalizer->hasPendingStrokes(image1));
+        REQUIRE(finalizer->hasPendingStrokes(image5));
+
+        finalizer->finish();
+
+        REQUIRE_FALSE(finalizer->hasPendingStrokes());
+        REQUIRE(committedFrames == QList<int>({ 1, 5, 1, 1 }));
+        REQUIRE_FALSE(image5->isEmpty());
+        REQUIRE(image5->getLastCurveNumber() == 0);
+        REQUIRE(image1->getLastCurveNumber() == 2);
+        REQUIRE(image1->curve(0).getOrigin().y() == Approx(0));
+        REQUIRE(image1->curve(1).getOrigin().y() == Approx(10));
+        REQUIRE(image1->curve(2).getOrigin().y() == Approx(20));
+    }
+
+    SECTION("Strokes finalized by the worker are committed in order")
+    {
+        finalizer->submit(createStroke(layer, 1, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 5, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 1, 10), nullptr, "");
+
+        QElapsedTimer timer;
+        timer.start();
+        while (finalizer->hasPendingStrokes() && timer.elapsed() < 10000)
+        {
+            QCoreApplication::processEvents();
+        }
+
+        REQUIRE_FALSE(finalizer->hasPendingStrokes());
+        REQUIRE(committedFrames == QList<int>({ 1, 5, 1 }));
+        REQUIRE(image1->getLastCurveNumber() == 1);
+        REQUIRE(image1->curve(0).getOrigin().y() == Approx(0));
+        REQUIRE(image1->curve(1).getOrigin().y() == Approx(10));
+    }
+
+    SECTION("A keyframe changed while the stroke is worked on keeps the change")
+    {
+        // The snapshot is taken on submit, the curve added afterwards isn't in it
+        finalizer->submit(createStroke(layer, 1, 10), nullptr, "");
+        BezierCurve curve({ QPointF(0, 50), QPointF(20, 50) });
+        image1->addCurve(curve, 1.0, false);
+
+        finalizer->finish();
+
+        REQUIRE(image1->getLastCurveNumber() == 1);
+        REQUIRE(image1->curve(0).getOrigin().y() == Approx(50));
+        REQUIRE(image1->curve(1).getOrigin().y() == Approx(10));
+    }
+
+    SECTION("The undo step of a stroke begins with the strokes committed before it")
+    {
+        UndoSaveState drawnState;
+        drawnState.layerId = layer->id();
+        drawnState.layerType = Layer::VECTOR;
+        drawnState.recordType = UndoRedoRecordType::KEYFRAME_MODIFY;
+        drawnState.keyframe.reset(image1->clone());
+
+        finalizer->submit(createStroke(layer, 1, 0), nullptr, "");
+        finalizer->finish();
+
+        std::unique_ptr<const UndoSaveState> state(VectorStrokeFinalizer::undoStateBefore(drawnState, *image1));
+        REQUIRE(state->layerId == layer->id());
+        REQUIRE(state->layerType == Layer::VECTOR);
+        REQUIRE(state->recordType == UndoRedoRecordType::KEYFRAME_MODIFY);
+        REQUIRE(static_cast<VectorImage*>(drawnState.keyframe.get())->isEmpty());
+        REQUIRE_FALSE(static_cast<VectorImage*>(state->keyframe.get())->isEmpty());
+    }
+
+    SECTION("Strokes on a deleted keyframe are dropped")
+    {
+        finalizer->submit(createStroke(layer, 1, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 5, 0), nullptr, "");
+        finalizer->submit(createStroke(layer, 1, 10), nullptr, "");
+
+        REQUIRE(layer->removeKeyFrame(1));
+        REQUIRE(finalizer->hasPendingStrokes(image5));
+
+        finalizer->finish();
+
+        REQUIRE_FALSE(finalizer->hasPendingStrokes());
+        REQUIRE(committedFrames == QList<int>({ 5 }));
+        REQUIRE_FALSE(image5->isEmpty());
+        REQUIRE(image5->getLastCurveNumber() == 0);
+    }
+
+    delete editor;
+    delete scribbleArea;
+}
@@ -0,0 +1,256 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#include "editsession.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QtMath>
+
+#include "object.h"
+#include "layerbitmap.h"
+#include "layervector.h"
+#include "bitmapimage.h"
+#include "vectorimage.h"
+#include "beziercurve.h"
+#include "tiledbuffer.h"
+#include "filemanager.h"
+
+namespace
+{
+    bool parsePoint(const QString& text, QPointF& point)
+    {
+        const QStringList parts = text.split(',');
+        if (parts.size() != 2) { return false; }
+
+        bool okX = false;
+        bool okY = false;
+        point = QPointF(parts[0].toDouble(&okX), parts[1].toDouble(&okY));
+        return okX && okY;
+    }
+
+    KeyFrame* keyFrameToEdit(Layer* layer, int frame)
+    {
+        KeyFrame* key = layer->getLastKeyFrameAtPosition(frame);
+        if (key == nullptr && layer->addNewKeyFrameAt(frame))
+        {
+            key = layer->getKeyFrameAt(frame);
+        }
+        return key;
+    }
+}
+
+Status EditSession::load(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        return Status(Status::FILE_NOT_FOUND, tr("Could not open the script %1").arg(filePath));
+    }
+
+    mCommands.clear();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd())
+    {
+        lineNumber++;
+        QString line = in.readLine();
+        line = line.left(line.indexOf('#')).simplified();
+        if (line.isEmpty()) { continue; }
+
+        Command command;
+        command.line = lineNumber;
+        command.args = line.split(' ');
+        command.name = command.args.takeFirst().toLower();
+        mCommands.append(command);
+    }
+    return Status::OK;
+}
+
+Status EditSession::replay(Object* object, const QString& savePath)
+{
+    mTimings.clear();
+    for (const Command& command : mCommands)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        Status st = run(command, object, savePath);
+        if (!st.ok())
+        {
+            return Status(st.code(), tr("Line %1: %2").arg(command.line).arg(st.description()));
+        }
+        mTimings[command.name].append(timer.nsecsElapsed());
+    }
+    return Status::OK;
+}
+
+Status EditSession::run(const Command& command, Object* object, const QString& savePath)
+{
+    if (command.name == "layer" || command.name == "frame")
+    {
+        bool ok = false;
+        const int value = command.args.value(0).toInt(&ok);
+        if (!ok) { return Status(Status::INVALID_ARGUMENT, tr("%1 needs a number").arg(command.name)); }
+
+        if (command.name == "layer")
+        {
+            if (object->getLayer(value) == nullptr) { return Status(Status::INVALID_ARGUMENT, tr("There is no layer %1").arg(value)); }
+            mLayerIndex = value;
+        }
+        else
+        {
+            mFrame = qMax(1, value);
+        }
+        return Status::OK;
+    }
+
+    if (command.name == "save")
+    {
+        FileManager fm;
+        return fm.save(object, savePath);
+    }
+
+    Layer* layer = object->getLayer(mLayerIndex);
+    if (layer == nullptr) { return Status(Status::INVALID_ARGUMENT, tr("There is no layer %1").arg(mLayerIndex)); }
+
+    if (command.name == "stroke") { return stroke(command, layer); }
+    if (command.name == "fill") { return fill(command, layer); }
+    if (command.name == "move") { return move(command, layer); }
+
+    return Status(Status::INVALID_ARGUMENT, tr("Unknown command %1").arg(command.name));
+}
+
+Status EditSession::stroke(const Command& command, Layer* layer)
+{
+    bool ok = false;
+    const qreal width = command.args.value(0).toDouble(&ok);
+    QList<QPointF> points;
+    for (int i = 1; i < command.args.size() && ok; i++)
+    {
+        QPointF point;
+        ok = parsePoint(command.args[i], point);
+        points.append(point);
+    }
+    if (!ok || points.size() < 2) { return Status(Status::INVALID_ARGUMENT, tr("stroke needs a width and at least two points")); }
+
+    KeyFrame* key = keyFrameToEdit(layer, mFrame);
+    if (layer->type() == Layer::BITMAP && key != nullptr)
+    {
+        // Dabs along the path, spaced the way the brush tools space them
+        TiledBuffer buffer;
+        const qreal spacing = qMax(1.0, width / 4);
+        for (int i = 1; i < points.size(); i++)
+        {
+            const QPointF delta = points[i] - points[i - 1];
+            const int steps = qMax(1, qCeil(std::hypot(delta.x(), delta.y()) / spacing));
+            for (int s = 0; s < steps; s++)
+            {
+                buffer.drawBrush(points[i - 1] + delta * s / steps, width, QPen(Qt::NoPen), QBrush(Qt::black), QPainter::CompositionMode_SourceOver, true);
+            }
+        }
+        static_cast<BitmapImage*>(key)->paste(&buffer);
+        return Status::OK;
+    }
+    if (layer->type() == Layer::VECTOR && key != nullptr)
+    {
+        BezierCurve curve(points);
+        curve.setWidth(width);
+        static_cast<VectorImage*>(key)->addCurve(curve, 1.0, true);
+        return Status::OK;
+    }
+    return Status(Status::ERROR_INVALID_LAYER_TYPE, tr("stroke needs a bitmap or vector layer"));
+}
+
+Status EditSession::fill(const Command& command, Layer* layer)
+{
+    QPointF point;
+    if (!parsePoint(command.args.value(0), point)) { return Status(Status::INVALID_ARGUMENT, tr("fill needs a point")); }
+    if (layer->type() != Layer::BITMAP) { return Status(Status::ERROR_INVALID_LAYER_TYPE, tr("fill needs a bitmap layer")); }
+
+    BitmapImage* image = static_cast<BitmapImage*>(keyFrameToEdit(layer, mFrame));
+    if (image == nullptr) { return Status::FAIL; }
+
+    // Like the bucket tool, the fill can't leak further than a margin around the drawing
+    const QRect region = image->bounds().united(QRect(point.toPoint(), QSize(1, 1))).adjusted(-64, -64, 64, 64);
+    BitmapImage* result = nullptr;
+    BitmapImage::floodFill(&result, image, region, point.toPoint(), qRgb(255, 0, 0), 32, 0);
+    std::unique_ptr<BitmapImage> filled(result);
+    if (filled)
+    {
+        image->paste(filled.get());
+    }
+    return Status::OK;
+}
+
+Status EditSession::move(const Command& command, Layer* layer)
+{
+    bool okX = false;
+    bool okY = false;
+    const QPoint delta(command.args.value(0).toInt(&okX), command.args.value(1).toInt(&okY));
+    if (!okX || !okY) { return Status(Status::INVALID_ARGUMENT, tr("move needs dx and dy")); }
+
+    KeyFrame* key = keyFrameToEdit(layer, mFrame);
+    if (layer->type() == Layer::BITMAP && key != nullptr)
+    {
+        BitmapImage* image = static_cast<BitmapImage*>(key);
+        image->moveTopLeft(image->topLeft() + delta);
+        return Status::OK;
+    }
+    if (layer->type() == Layer::VECTOR && key != nullptr)
+    {
+        VectorImage* image = static_cast<VectorImage*>(key);
+        image->selectAll();
+        image->applySelectionTransformation(QTransform::fromTranslate(delta.x(), delta.y()));
+        image->deselectAll();
+        return Status::OK;
+    }
+    return Status(Status::ERROR_INVALID_LAYER_TYPE, tr("move needs a bitmap or vector layer"));
+}
+
+QJsonObject EditSession::report() const
+{
+    auto milliseconds = [](qint64 ns) { return ns / 1000000.0; };
+
+    QJsonArray commands;
+    for (auto it = mTimings.cbegin(); it != mTimings.cend(); ++it)
+    {
+        QVector<qint64> timings = it.value();
+        std::sort(timings.begin(), timings.end());
+
+        qint64 total = 0;
+        for (qint64 t : timings) { total += t; }
+
+        const int count = timings.size();
+        QJsonObject command;
+        command["name"] = it.key();
+        command["count"] = count;
+        command["totalMs"] = milliseconds(total);
+        command["meanMs"] = milliseconds(total / count);
+        command["p50Ms"] = milliseconds(timings[count / 2]);
+        command["p95Ms"] = milliseconds(timings[qMin(count - 1, count * 95 / 100)]);
+        command["maxMs"] = milliseconds(timings.last());
+        commands.append(command);
+    }
+
+    QJsonObject root;
+    root["commands"] = commands;
+    return root;
+}
@@ -0,0 +1,76 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+#ifndef EDITSESSION_H
+#define EDITSESSION_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "pencilerror.h"
+
+class Object;
+class Layer;
+
+/**
+ * A scripted editing session replayed against a project, timing each edit.
+ *
+ * The script has one command per line, '#' starts a comment:
+ *
+ *     layer <index>                 edit the layer at the index, 0 is the bottom one
+ *     frame <position>              edit the keyframe at or before the position, adding one if there is none
+ *     stroke <width> x,y x,y ...    draw a stroke through the points, a curve on vector layers
+ *     fill x,y                      flood fill the area at the point, on bitmap layers
+ *     move dx dy                    move the whole keyframe
+ *     save                          save the project to the output file
+ */
+class EditSession
+{
+    Q_DECLARE_TR_FUNCTIONS(EditSession)
+public:
+    struct Command
+    {
+        int line = 0;
+        QString name;
+        QStringList args;
+    };
+
+    Status load(const QString& filePath);
+
+    /** Replays the commands one after the other, the project is saved to the given path by 'save' */
+    Status replay(Object* object, const QString& savePath);
+
+    /** The count, mean, median, 95th percentile and worst time of each replayed command, in milliseconds */
+    QJsonObject report() const;
+
+private:
+    Status run(const Command& command, Object* object, const QString& savePath);
+    Status stroke(const Command& command, Layer* layer);
+    Status fill(const Command& command, Layer* layer);
+    Status move(const Command& command, Layer* layer);
+
+    QList<Command> mCommands;
+    int mLayerIndex = 1;
+    int mFrame = 1;
+
+    // Nanoseconds each command took, by command name
+    QMap<QString, QVector<qint64>> mTimings;
+};
+
+#endif // EDITSESSION_H
@@ -0,0 +1,170 @@
+/*
+
+Pencil2D - Traditional Animation Software
+Copyright (C) 2012-2020 Matthew Chiawen Chang
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+*/
+
+#include <cstdio>
+#include <memory>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include "object.h"
+#include "layer.h"
+#include "keyframe.h"
+#include "filemanager.h"
+#include "syntheticproject.h"
+#include "editsession.h"
+
+/*
+ * Generates a large project for stress testing, e.g.
+ *
+ *     stressgen --bitmap-layers 40 --keyframes 2000 --sound-clips 20 -o huge.pclx
+ *
+ * and optionally replays a scripted editing session on it, printing how long each edit took.
+ */
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates a synthetic Pencil2D project for stress testing");
+    parser.addHelpOption();
+
+    SyntheticProjectOptions options;
+    struct IntOption { QCommandLineOption option; int* value; };
+    const QList<IntOption> intOptions {
+        { { "bitmap-layers", "Number of bitmap layers", "count", QString::number(options.bitmapLayers) }, &options.bitmapLayers },
+        { { "vector-layers", "Number of vector layers", "count", QString::number(options.vectorLayers) }, &options.vectorLayers },
+        { { "keyframes", "Keyframes per layer", "count", QString::number(options.keyFrames) }, &options.keyFrames },
+        { { "spacing", "Frames between two keyframes", "frames", QString::number(options.keyFrameSpacing) }, &options.keyFrameSpacing },
+        { { "strokes", "Shapes per bitmap keyframe", "count", QString::number(options.strokesPerFrame) }, &options.strokesPerFrame },
+        { { "curves", "Curves per vector keyframe", "count", QString::number(options.curvesPerFrame) }, &options.curvesPerFrame },
+        { { "sound-clips", "Sound clips on a sound layer", "count", QString::number(options.soundClips) }, &options.soundClips },
+        { { "camera-keys", "Camera keyframes", "count", QString::number(options.cameraKeys) }, &options.cameraKeys },
+    };
+    for (const IntOption& o : intOptions)
+    {
+        parser.addOption(o.option);
+    }
+    QCommandLineOption widthOption("width", "Width of the drawings", "pixels", QString::number(options.imageSize.width()));
+    QCommandLineOption heightOption("height", "Height of the drawings", "pixels", QString::number(options.imageSize.height()));
+    QCommandLineOption seedOption("seed", "Seed of the generated content", "seed", QString::number(options.seed));
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "The generated .pclx file", "output_path");
+    QCommandLineOption scriptOption("script", "Replay the edits in the script after generating", "script_path");
+    QCommandLineOption reportOption("report", "Write the timings as JSON to the file instead of the standard output", "report_path");
+    parser.addOptions({ widthOption, heightOption, seedOption, outputOption, scriptOption, reportOption });
+    parser.process(app);
+
+    for (const IntOption& o : intOptions)
+    {
+        bool ok = false;
+        *o.value = parser.value(o.option).toInt(&ok);
+        if (!ok || *o.value < 0)
+        {
+            err << "Invalid value for --" << o.option.names().first() << "\n";
+            return 1;
+        }
+    }
+    options.keyFrameSpacing = qMax(1, options.keyFrameSpacing);
+    options.imageSize = QSize(parser.value(widthOption).toInt(), parser.value(heightOption).toInt());
+    options.seed = parser.value(seedOption).toUInt();
+
+    const QString outputPath = parser.value(outputOption);
+    if (outputPath.isEmpty())
+    {
+        err << "An output file is required, see --help\n";
+        return 1;
+    }
+
+    EditSession session;
+    if (parser.isSet(scriptOption))
+    {
+        Status st = session.load(parser.value(scriptOption));
+        if (!st.ok())
+        {
+            err << st.description() << "\n";
+            return 1;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Each layer is written to the working folder as soon as it is generated and its bitmaps are
+    // dropped from memory, so the project can be much larger than the memory of the machine.
+    Status flushStatus = Status::OK;
+    auto flushLayer = [&flushStatus](Object* object, Layer* layer)
+    {
+        QStringList files;
+        layer->presave(object->dataDir());
+        Status st = layer->save(object->dataDir(), files, [] {});
+        if (!st.ok()) { flushStatus = st; }
+        layer->foreachKeyFrame([](KeyFrame* key) { key->unloadFile(); });
+    };
+    std::unique_ptr<Object> object(createSyntheticProject(options, flushLayer));
+    const qint64 generateNs = timer.nsecsElapsed();
+    if (!flushStatus.ok())
+    {
+        err << "Could not write the generated layers: " << flushStatus.details().str() << "\n";
+        return 1;
+    }
+
+    timer.restart();
+    FileManager fm;
+    Status st = fm.save(object.get(), outputPath);
+    const qint64 saveNs = timer.nsecsElapsed();
+    if (!st.ok())
+    {
+        err << "Could not save " << outputPath << ": " << st.description() << "\n";
+        return 1;
+    }
+
+    st = session.replay(object.get(), outputPath);
+    if (!st.ok())
+    {
+        err << st.description() << "\n";
+        return 1;
+    }
+
+    QFile reportFile;
+    if (parser.isSet(reportOption))
+    {
+        reportFile.setFileName(parser.value(reportOption));
+        if (!reportFile.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            err << "Could not write " << reportFile.fileName() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        reportFile.open(stdout, QFile::WriteOnly);
+    }
+
+    QJsonObject report = session.report();
+    report["generateMs"] = generateNs / 1000000.0;
+    report["saveMs"] = saveNs / 1000000.0;
+    reportFile.write(QJsonDocument(report).toJson());
+    return 0;
+}
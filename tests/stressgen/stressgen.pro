@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Generates large projects for stress testing and
+# replays scripted edits on them, e.g.
+#   ./stressgen --keyframes 2000 -o huge.pclx --script edits.txt
+#
+#-------------------------------------------------
+
+! include( ../../util/common.pri ) { error( Could not find the common.pri file! ) }
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+QT += core widgets gui xml multimedia svg
+
+TARGET = stressgen
+
+INCLUDEPATH += \
+    ../bench/src \
+    ../../core_lib/src \
+    ../../core_lib/src/graphics \
+    ../../core_lib/src/graphics/bitmap \
+    ../../core_lib/src/graphics/vector \
+    ../../core_lib/src/interface \
+    ../../core_lib/src/structure \
+    ../../core_lib/src/tool \
+    ../../core_lib/src/util \
+    ../../core_lib/ui \
+    ../../core_lib/src/managers
+
+HEADERS += \
+    ../bench/src/syntheticproject.h \
+    src/editsession.h
+
+SOURCES += \
+    src/main.cpp \
+    src/editsession.cpp \
+    ../bench/src/syntheticproject.cpp
+
+# --- core_lib ---
+
+BUILDTYPE =
+debug_and_release:CONFIG(debug,debug|release) BUILDTYPE = debug
+debug_and_release:CONFIG(release,debug|release) BUILDTYPE = release
+
+win32-msvc* {
+    LIBS += -L$$OUT_PWD/../../core_lib/$$BUILDTYPE/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/$$BUILDTYPE/core_lib.lib
+}
+
+win32-g++ {
+    LIBS += -L$$OUT_PWD/../../core_lib/$$BUILDTYPE/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/$$BUILDTYPE/libcore_lib.a
+}
+
+# --- mac os and linux
+unix {
+    LIBS += -L$$OUT_PWD/../../core_lib/ -lcore_lib
+    PRE_TARGETDEPS += $$OUT_PWD/../../core_lib/libcore_lib.a
+}
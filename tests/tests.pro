@@ -33,16 +33,32 @@ SOURCES += \
     src/main.cpp \
     src/test_colormanager.cpp \
     src/test_layer.cpp \
+    src/test_keyframeselection.cpp \
+    src/test_keyframethumbnailcache.cpp \
     src/test_layerbitmap.cpp \
     src/test_layercamera.cpp \
     src/test_layermanager.cpp \
     src/test_layersound.cpp \
     src/test_layervector.cpp \
     src/test_object.cpp \
+    src/test_playbackscheduler.cpp \
+    src/test_renderaheadqueue.cpp \
+    src/test_soundmixer.cpp \
+    src/test_movieexporter.cpp \
+    src/test_imagebatchdecoder.cpp \
     src/test_filemanager.cpp \
     src/test_bitmapimage.cpp \
+    src/test_beziercurve.cpp \
     src/test_bitmapbucket.cpp \
+    src/test_affinesampler.cpp \
+    src/test_bitmaptransformbatch.cpp \
+    src/test_pegbaraligner.cpp \
+    src/test_curveindex.cpp \
+    src/test_planarmap.cpp \
+    src/test_profiler.cpp \
     src/test_vectorimage.cpp \
+    src/test_vectorrasterizer.cpp \
+    src/test_vectorstrokefinalizer.cpp \
     src/test_viewmanager.cpp
 
 # --- core_lib ---